@@ -0,0 +1,276 @@
+#include "BenchmarkCommon.h"
+#include "../Renderer/VulkanAllocator.h"
+#include "../Renderer/VulkanCore.h"
+#include "../Renderer/VulkanHelpers.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace renderer::benchmark
+{
+	using namespace renderer::vulkan;
+
+	namespace
+	{
+		constexpr uint32_t empty_vertex_shader[]{
+			0x07230203, 0x00010000, 0x00000000, 0x00000005, 0x00000000,	// header, bound 5
+			0x00020011, 0x00000001,											// OpCapability Shader
+			0x0003000e, 0x00000000, 0x00000001,								// OpMemoryModel Logical GLSL450
+			0x0005000f, 0x00000000, 0x00000004, 0x6e69616d, 0x00000000,		// OpEntryPoint Vertex %4 "main"
+			0x00020013, 0x00000001,											// %1 = OpTypeVoid
+			0x00030021, 0x00000002, 0x00000001,								// %2 = OpTypeFunction %1
+			0x00050036, 0x00000001, 0x00000004, 0x00000000, 0x00000002,		// %4 = OpFunction %1 None %2
+			0x000200f8, 0x00000003,											// %3 = OpLabel
+			0x000100fd,														// OpReturn
+			0x00010038														// OpFunctionEnd
+		};
+
+	} // anonymous namespace
+
+	double elapsed_ms(clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+	}
+
+	bool parse_count(const char* text, uint32_t& out_value)
+	{
+		// stoul accepts a sign and wraps negative numbers around
+		if (!text || *text < '0' || *text > '9')
+			return false;
+
+		try
+		{
+			size_t length{ 0 };
+			const unsigned long value{ std::stoul(text, &length) };
+			if (text[length] != '\0' || value > UINT32_MAX)
+				return false;
+
+			out_value = (uint32_t)value;
+			return true;
+		}
+		catch (const std::exception&)
+		{
+			return false;
+		}
+	}
+
+	bool check(result& r, bool condition, const char* description)
+	{
+		if (!condition)
+		{
+			std::cerr << r.name << ": check failed: " << description << "\n";
+			++r.failed_checks;
+		}
+		return condition;
+	}
+
+	VkShaderModule create_empty_vertex_shader()
+	{
+		VkShaderModuleCreateInfo module_info{};
+		module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		module_info.codeSize = sizeof(empty_vertex_shader);
+		module_info.pCode = empty_vertex_shader;
+
+		VkShaderModule shader_module{ VK_NULL_HANDLE };
+		VKCALL(vkCreateShaderModule(core::get_logical_device(), &module_info, nullptr, &shader_module), "failed to create benchmark shader module");
+		return shader_module;
+	}
+
+	VkPipeline create_null_pipeline(VkShaderModule shader_module, VkPipelineLayout layout, VkRenderPass render_pass,
+									VkPrimitiveTopology topology, VkCullModeFlags cull_mode, VkFrontFace front_face, float depth_bias)
+	{
+		VkPipelineShaderStageCreateInfo stage = vkh::pipeline_shader_stage(shader_module, VK_SHADER_STAGE_VERTEX_BIT, "main");
+
+		VkPipelineVertexInputStateCreateInfo vertex_input{};
+		vertex_input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+		VkPipelineInputAssemblyStateCreateInfo input_assembly = vkh::pipeline_input_assembly_state(topology, 0, VK_FALSE);
+		VkPipelineViewportStateCreateInfo viewport_state = vkh::viewport_state_dynamic();
+
+		VkPipelineRasterizationStateCreateInfo rasterization = vkh::pipeline_rasterization_state(VK_POLYGON_MODE_FILL, cull_mode, front_face);
+		rasterization.rasterizerDiscardEnable = VK_TRUE;
+		rasterization.depthBiasEnable = depth_bias != 0.f;
+		rasterization.depthBiasConstantFactor = depth_bias;
+
+		VkPipelineMultisampleStateCreateInfo multisample = vkh::pipeline_multisample_state();
+		VkPipelineColorBlendStateCreateInfo color_blend = vkh::pipeline_color_blend_state(0, nullptr);
+
+		const std::vector<VkDynamicState> dynamic_states{ VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamic_state = vkh::pipeline_dynamic_state(dynamic_states);
+
+		VkGraphicsPipelineCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		info.stageCount = 1;
+		info.pStages = &stage;
+		info.pVertexInputState = &vertex_input;
+		info.pInputAssemblyState = &input_assembly;
+		info.pViewportState = &viewport_state;
+		info.pRasterizationState = &rasterization;
+		info.pMultisampleState = &multisample;
+		info.pColorBlendState = &color_blend;
+		info.pDynamicState = &dynamic_state;
+		info.layout = layout;
+		info.renderPass = render_pass;
+		info.subpass = 0;
+
+		VkPipeline pipeline{ VK_NULL_HANDLE };
+		VKCALL(vkCreateGraphicsPipelines(core::get_logical_device(), VK_NULL_HANDLE, 1, &info, nullptr, &pipeline), "failed to create benchmark pipeline");
+		return pipeline;
+	}
+
+	bool create_null_target(null_target& out_target)
+	{
+		VkDevice device{ core::get_logical_device() };
+
+		VkSubpassDescription subpass{};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+
+		VkRenderPassCreateInfo render_pass_info{};
+		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		render_pass_info.subpassCount = 1;
+		render_pass_info.pSubpasses = &subpass;
+		VKCALL(vkCreateRenderPass(device, &render_pass_info, nullptr, &out_target.render_pass), "failed to create benchmark render pass");
+
+		VkFramebufferCreateInfo frame_buffer_info{};
+		frame_buffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		frame_buffer_info.renderPass = out_target.render_pass;
+		frame_buffer_info.width = 1;
+		frame_buffer_info.height = 1;
+		frame_buffer_info.layers = 1;
+		VKCALL(vkCreateFramebuffer(device, &frame_buffer_info, nullptr, &out_target.frame_buffer), "failed to create benchmark frame buffer");
+
+		return out_target.render_pass && out_target.frame_buffer;
+	}
+
+	void destroy_null_target(null_target& target)
+	{
+		VkDevice device{ core::get_logical_device() };
+		if (target.frame_buffer)
+			vkDestroyFramebuffer(device, target.frame_buffer, nullptr);
+		if (target.render_pass)
+			vkDestroyRenderPass(device, target.render_pass, nullptr);
+		target = {};
+	}
+
+	void begin_null_render_pass(VkCommandBuffer command_buffer, const null_target& target)
+	{
+		VkRenderPassBeginInfo begin_info{};
+		begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		begin_info.renderPass = target.render_pass;
+		begin_info.framebuffer = target.frame_buffer;
+		begin_info.renderArea = vkh::rect_2d(1, 1, 0, 0);
+		vkCmdBeginRenderPass(command_buffer, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkViewport viewport = vkh::viewport(1.f, 1.f, 0.f, 1.f);
+		VkRect2D scissor = vkh::rect_2d(1, 1, 0, 0);
+		vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+		vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+	}
+
+	bool create_gpu_timer(uint32_t frame_count, gpu_timer& out_timer)
+	{
+		out_timer = {};
+		if (!frame_count || !core::get_physical_device_properties().limits.timestampComputeAndGraphics)
+			return false;
+
+		VkQueryPoolCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		info.queryCount = frame_count * 2;
+		VKCALL(vkCreateQueryPool(core::get_logical_device(), &info, allocator::get_callbacks(allocator::object_type::other), &out_timer.query_pool),
+			   "failed to create benchmark query pool");
+		if (!out_timer.query_pool)
+			return false;
+
+		out_timer.frame_count = frame_count;
+		return true;
+	}
+
+	void destroy_gpu_timer(gpu_timer& timer)
+	{
+		if (timer.query_pool)
+			vkDestroyQueryPool(core::get_logical_device(), timer.query_pool, allocator::get_callbacks(allocator::object_type::other));
+		timer = {};
+	}
+
+	void begin_gpu_timer(VkCommandBuffer command_buffer, const gpu_timer& timer, uint32_t frame)
+	{
+		if (!timer.query_pool || frame >= timer.frame_count)
+			return;
+
+		vkCmdResetQueryPool(command_buffer, timer.query_pool, frame * 2, 2);
+		vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timer.query_pool, frame * 2);
+	}
+
+	void end_gpu_timer(VkCommandBuffer command_buffer, const gpu_timer& timer, uint32_t frame)
+	{
+		if (timer.query_pool && frame < timer.frame_count)
+			vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timer.query_pool, frame * 2 + 1);
+	}
+
+	double read_gpu_timer_ms(const gpu_timer& timer)
+	{
+		if (!timer.query_pool)
+			return 0;
+
+		std::vector<uint64_t> timestamps(timer.frame_count * 2);
+		const VkResult result{ vkGetQueryPoolResults(core::get_logical_device(), timer.query_pool, 0, timer.frame_count * 2,
+													 timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+													 VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) };
+		if (result != VK_SUCCESS)
+		{
+			std::cerr << "failed to read benchmark timestamps!\n";
+			return 0;
+		}
+
+		const double period{ core::get_physical_device_properties().limits.timestampPeriod };
+		double total_ms{ 0 };
+		for (uint32_t frame{ 0 }; frame < timer.frame_count; ++frame)
+			total_ms += (double)(timestamps[frame * 2 + 1] - timestamps[frame * 2]) * period / 1e6;
+		return total_ms / timer.frame_count;
+	}
+
+	void write_device_json(std::ostream& out)
+	{
+		const VkPhysicalDeviceProperties properties{ core::get_physical_device_properties() };
+
+		out << "  \"device\": { \"name\": \"" << properties.deviceName << "\", \"type\": " << properties.deviceType
+			<< ", \"api_version\": \"" << VK_VERSION_MAJOR(properties.apiVersion) << "." << VK_VERSION_MINOR(properties.apiVersion)
+			<< "." << VK_VERSION_PATCH(properties.apiVersion) << "\", \"driver_version\": " << properties.driverVersion
+			<< ", \"vendor_id\": " << properties.vendorID << " },\n";
+	}
+
+	void write_results_json(std::ostream& out, const std::vector<result>& results)
+	{
+		out << "  \"results\": [\n";
+
+		for (size_t i{ 0 }; i < results.size(); ++i)
+		{
+			const result& r{ results[i] };
+			std::vector<double> sorted{ r.samples_ms };
+			std::sort(sorted.begin(), sorted.end());
+
+			double total{ 0 };
+			for (double sample : sorted)
+				total += sample;
+
+			auto percentile = [&](double p) { return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))]; };
+
+			out << "    { \"name\": \"" << r.name << "\", \"iterations\": " << sorted.size()
+				<< ", \"total_ms\": " << total
+				<< ", \"mean_ms\": " << (sorted.empty() ? 0.0 : total / sorted.size())
+				<< ", \"median_ms\": " << percentile(0.5)
+				<< ", \"p95_ms\": " << percentile(0.95)
+				<< ", \"min_ms\": " << (sorted.empty() ? 0.0 : sorted.front())
+				<< ", \"max_ms\": " << (sorted.empty() ? 0.0 : sorted.back())
+				<< ", \"failed_checks\": " << r.failed_checks;
+
+			for (const auto& [name, value] : r.metrics)
+				out << ", \"" << name << "\": " << value;
+
+			out << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+
+		out << "  ]\n";
+	}
+}
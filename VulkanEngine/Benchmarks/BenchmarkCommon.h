@@ -0,0 +1,62 @@
+#pragma once
+#include "../Renderer/VulkanCommonHeaders.h"
+
+#include <chrono>
+#include <ostream>
+
+// shared by the headless benchmark and replay tools
+namespace renderer::benchmark
+{
+	using clock = std::chrono::steady_clock;
+
+	struct result
+	{
+		std::string									name;
+		std::vector<double>							samples_ms;
+		std::vector<std::pair<std::string, double>>	metrics;
+		uint32_t									failed_checks{ 0 };
+	};
+
+	// one pair of timestamps per frame around the gpu work of a scenario
+	struct gpu_timer
+	{
+		VkQueryPool		query_pool{ VK_NULL_HANDLE };
+		uint32_t		frame_count{ 0 };
+	};
+
+	// render pass and 1x1 frame buffer without attachments, draws only exercise recording and submission
+	struct null_target
+	{
+		VkRenderPass		render_pass{ VK_NULL_HANDLE };
+		VkFramebuffer		frame_buffer{ VK_NULL_HANDLE };
+	};
+
+	double elapsed_ms(clock::time_point start);
+	// a whole decimal number that fits 32 bits, false for anything else
+	bool parse_count(const char* text, uint32_t& out_value);
+	// reports a failed condition on stderr and counts it in the result, any failed check fails the run
+	bool check(result& r, bool condition, const char* description);
+
+	// void main() {} vertex shader, pipelines built from it run with rasterizer discard and read no vertex attributes
+	VkShaderModule create_empty_vertex_shader();
+	VkPipeline create_null_pipeline(VkShaderModule shader_module, VkPipelineLayout layout, VkRenderPass render_pass,
+									VkPrimitiveTopology topology, VkCullModeFlags cull_mode, VkFrontFace front_face, float depth_bias);
+
+	bool create_null_target(null_target& out_target);
+	void destroy_null_target(null_target& target);
+	// begins the render pass and sets the dynamic viewport and scissor
+	void begin_null_render_pass(VkCommandBuffer command_buffer, const null_target& target);
+
+	// false without timestamp support on the graphics and compute queues, every call below is a no-op on such a timer
+	bool create_gpu_timer(uint32_t frame_count, gpu_timer& out_timer);
+	void destroy_gpu_timer(gpu_timer& timer);
+	void begin_gpu_timer(VkCommandBuffer command_buffer, const gpu_timer& timer, uint32_t frame);
+	void end_gpu_timer(VkCommandBuffer command_buffer, const gpu_timer& timer, uint32_t frame);
+	// waits for every frame and returns their mean gpu time, 0 if nothing was timed
+	double read_gpu_timer_ms(const gpu_timer& timer);
+
+	// "device": {...} of the physical device core was initialized with
+	void write_device_json(std::ostream& out);
+	// "results": [...] with per result totals, mean, median, p95, min, max, failed checks and its metrics
+	void write_results_json(std::ostream& out, const std::vector<result>& results);
+}
@@ -0,0 +1,397 @@
+// replays a frame capture written by capture::begin_capture on a headless device as fast as possible.
+// pipelines are replaced by empty rasterizer discard pipelines and buffers by placeholders of the captured size, so the
+// replay measures what the renderer does on the cpu and the driver per draw, bind and upload, not shading cost.
+//
+// usage: CaptureReplay --capture frames.rcap [--output results.json] [--loops n]
+
+#include "BenchmarkCommon.h"
+#include "../Renderer/VulkanCore.h"
+#include "../Renderer/VulkanHelpers.h"
+#include "../Renderer/VulkanMemory.h"
+#include "../Renderer/VulkanCapture.h"
+#include "../Renderer/VulkanRenderQueue.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <tuple>
+
+using namespace renderer;
+using namespace renderer::vulkan;
+using namespace renderer::benchmark;
+
+namespace
+{
+	struct config
+	{
+		std::string	capture{};
+		std::string	output{};
+		uint32_t	loops{ 1 };
+	};
+
+	// replay objects standing in for the captured handles, indexed by capture id - 1
+	struct replay_context
+	{
+		VkShaderModule						shader_module{ VK_NULL_HANDLE };
+		null_target							target{};
+		VkDescriptorSetLayout				empty_set_layout{ VK_NULL_HANDLE };
+		VkDescriptorPool					descriptor_pool{ VK_NULL_HANDLE };
+		std::vector<VkPipelineLayout>		layouts;
+		std::vector<VkPipeline>				pipelines;
+		std::vector<VkDescriptorSet>		material_sets;
+		std::vector<memory::buffer>			buffers;
+		memory::buffer						upload_staging{};
+		memory::buffer						upload_destination{};
+
+		// one queue per distinct configuration seen in the capture
+		std::map<std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>, std::unique_ptr<render_queue::queue>> queues;
+	}context{};
+
+	// queues preallocate capacity draws and capacity * instance_stride bytes, beyond these the file is not a real capture.
+	// the stride limit is the guaranteed minimum of maxVertexInputBindingStride, instances are bound as vertex input
+	constexpr uint32_t max_queue_capacity{ 1 << 20 };
+	constexpr uint32_t max_instance_stride{ 2048 };
+
+	// every id a draw refers to has to name an object the replay creates, the file is not trusted
+	bool validate_capture(const capture::capture_data& data)
+	{
+		// the capture hands out ids on first use by a draw, so no object count can exceed the draw count
+		uint64_t draw_count{ 0 };
+		for (const capture::frame& f : data.frames)
+			for (const capture::queue_submission& q : f.queues)
+				draw_count += q.draws.size();
+		if (data.pipeline_count > draw_count || data.layout_count > draw_count || data.material_set_count > draw_count)
+			return false;
+
+		for (const capture::frame& f : data.frames)
+		{
+			for (const capture::queue_submission& q : f.queues)
+			{
+				if (q.material_set_index > data.max_material_set_index || q.draws.size() > q.capacity || q.capacity > max_queue_capacity ||
+					q.instance_stride > max_instance_stride || q.instance_data.size() != q.draws.size() * q.instance_stride)
+					return false;
+
+				for (const capture::captured_draw& d : q.draws)
+				{
+					if (!d.pipeline || d.pipeline > data.pipeline_count || !d.layout || d.layout > data.layout_count || !d.count ||
+						d.material_set > data.material_set_count || d.vertex_buffer > data.buffer_sizes.size() ||
+						d.index_buffer > data.buffer_sizes.size() ||
+						(d.index_buffer && d.index_type != VK_INDEX_TYPE_UINT16 && d.index_type != VK_INDEX_TYPE_UINT32))
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool create_replay_context(const capture::capture_data& data)
+	{
+		VkDevice device{ core::get_logical_device() };
+
+		if (data.max_material_set_index >= core::get_physical_device_properties().limits.maxBoundDescriptorSets)
+			return false;
+
+		context.shader_module = create_empty_vertex_shader();
+		if (!context.shader_module || !create_null_target(context.target))
+			return false;
+
+		// every captured set index gets an empty layout, so any replay set is compatible with any replay pipeline layout
+		VkDescriptorSetLayoutCreateInfo set_layout_info = vkh::descriptor_set_layout(0, nullptr);
+		VKCALL(vkCreateDescriptorSetLayout(device, &set_layout_info, nullptr, &context.empty_set_layout), "failed to create replay set layout");
+
+		const std::vector<VkDescriptorSetLayout> set_layouts(data.max_material_set_index + 1, context.empty_set_layout);
+		VkPipelineLayoutCreateInfo layout_info{};
+		layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layout_info.setLayoutCount = (uint32_t)set_layouts.size();
+		layout_info.pSetLayouts = set_layouts.data();
+
+		// distinct layouts keep the render queue's rebind on layout change part of the replay
+		context.layouts.resize(std::max(data.layout_count, 1u));
+		for (VkPipelineLayout& layout : context.layouts)
+			VKCALL(vkCreatePipelineLayout(device, &layout_info, nullptr, &layout), "failed to create replay pipeline layout");
+
+		context.pipelines.resize(data.pipeline_count);
+		for (VkPipeline& pipeline : context.pipelines)
+		{
+			pipeline = create_null_pipeline(context.shader_module, context.layouts[0], context.target.render_pass,
+											VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0.f);
+			if (!pipeline)
+				return false;
+		}
+
+		if (data.material_set_count)
+		{
+			VkDescriptorPoolSize pool_size{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 };
+			VkDescriptorPoolCreateInfo pool_info = vkh::descriptor_pool(1, &pool_size, data.material_set_count);
+			VKCALL(vkCreateDescriptorPool(device, &pool_info, nullptr, &context.descriptor_pool), "failed to create replay descriptor pool");
+
+			const std::vector<VkDescriptorSetLayout> layouts(data.material_set_count, context.empty_set_layout);
+			context.material_sets.resize(data.material_set_count);
+			VkDescriptorSetAllocateInfo alloc_info = vkh::descriptor_set_alloc_info(context.descriptor_pool, layouts.data(), data.material_set_count);
+			VKCALL(vkAllocateDescriptorSets(device, &alloc_info, context.material_sets.data()), "failed to allocate replay descriptor sets");
+		}
+
+		context.buffers.resize(data.buffer_sizes.size());
+		for (size_t i{ 0 }; i < data.buffer_sizes.size(); ++i)
+		{
+			if (!memory::create_buffer(std::max<uint64_t>(data.buffer_sizes[i], 16), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+									   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, context.buffers[i]))
+				return false;
+		}
+
+		uint64_t largest_upload{ 0 };
+		for (const capture::frame& f : data.frames)
+			for (uint64_t bytes : f.uploads)
+				largest_upload = std::max(largest_upload, bytes);
+
+		if (largest_upload &&
+			(!memory::create_buffer(largest_upload, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+									VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, context.upload_staging) ||
+			 !memory::create_buffer(largest_upload, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, context.upload_destination)))
+			return false;
+
+		for (const capture::frame& f : data.frames)
+		{
+			for (const capture::queue_submission& q : f.queues)
+			{
+				auto& queue = context.queues[{ q.capacity, q.instance_stride, q.instance_binding, q.material_set_index }];
+				if (!queue)
+					queue = std::make_unique<render_queue::queue>(q.capacity, q.instance_stride, q.instance_binding, q.material_set_index);
+			}
+		}
+
+		return true;
+	}
+
+	void destroy_replay_context()
+	{
+		VkDevice device{ core::get_logical_device() };
+		vkDeviceWaitIdle(device);
+
+		context.queues.clear();
+		memory::destroy_buffer(context.upload_staging);
+		memory::destroy_buffer(context.upload_destination);
+		for (memory::buffer& buffer : context.buffers)
+			memory::destroy_buffer(buffer);
+		if (context.descriptor_pool)
+			vkDestroyDescriptorPool(device, context.descriptor_pool, nullptr);
+		for (VkPipeline pipeline : context.pipelines)
+			vkDestroyPipeline(device, pipeline, nullptr);
+		for (VkPipelineLayout layout : context.layouts)
+			vkDestroyPipelineLayout(device, layout, nullptr);
+		if (context.empty_set_layout)
+			vkDestroyDescriptorSetLayout(device, context.empty_set_layout, nullptr);
+		destroy_null_target(context.target);
+		if (context.shader_module)
+			vkDestroyShaderModule(device, context.shader_module, nullptr);
+		context = {};
+	}
+
+	template<typename T>
+	T remap(const std::vector<T>& objects, uint32_t id)
+	{
+		return id ? objects[id - 1] : VK_NULL_HANDLE;
+	}
+
+	render_queue::draw_item remap_draw(const capture::captured_draw& c)
+	{
+		render_queue::draw_item draw{};
+		draw.pipeline = remap(context.pipelines, c.pipeline);
+		draw.layout = remap(context.layouts, c.layout);
+		draw.material_set = remap(context.material_sets, c.material_set);
+		draw.vertex_buffer = c.vertex_buffer ? context.buffers[c.vertex_buffer - 1].buffer : VK_NULL_HANDLE;
+		draw.vertex_buffer_offset = c.vertex_buffer_offset;
+		draw.index_buffer = c.index_buffer ? context.buffers[c.index_buffer - 1].buffer : VK_NULL_HANDLE;
+		draw.index_buffer_offset = c.index_buffer_offset;
+		draw.index_type = (VkIndexType)c.index_type;
+		draw.count = c.count;
+		draw.first = c.first;
+		draw.vertex_offset = c.vertex_offset;
+		return draw;
+	}
+
+	// uploads are replayed before the render pass, the capture doesn't keep their order relative to the draws
+	void replay_frame(const capture::frame& f)
+	{
+		core::begin_frame();
+		VkCommandBuffer command_buffer{ core::get_command_buffer() };
+
+		// a zero sized copy is invalid usage
+		for (uint64_t bytes : f.uploads)
+		{
+			if (!bytes)
+				continue;
+			VkBufferCopy region{ 0, 0, bytes };
+			vkCmdCopyBuffer(command_buffer, context.upload_staging.buffer, context.upload_destination.buffer, 1, &region);
+		}
+
+		begin_null_render_pass(command_buffer, context.target);
+		for (const capture::queue_submission& q : f.queues)
+		{
+			render_queue::queue& queue{ *context.queues[{ q.capacity, q.instance_stride, q.instance_binding, q.material_set_index }] };
+			queue.reset();
+			for (size_t i{ 0 }; i < q.draws.size(); ++i)
+				queue.submit(q.draws[i].key, remap_draw(q.draws[i]), q.instance_stride ? q.instance_data.data() + i * q.instance_stride : nullptr);
+			queue.record(command_buffer);
+		}
+		vkCmdEndRenderPass(command_buffer);
+
+		vkEndCommandBuffer(command_buffer);
+		core::end_frame();
+	}
+
+	// the capture path is user input, quotes, backslashes and control characters have to be escaped
+	void write_json_string(std::ostream& out, const std::string& text)
+	{
+		out << '"';
+		for (const char c : text)
+		{
+			if (c == '"' || c == '\\')
+				out << '\\' << c;
+			else if ((unsigned char)c < 0x20)
+				out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+			else
+				out << c;
+		}
+		out << '"';
+	}
+
+	void print_usage()
+	{
+		std::cerr << "usage: CaptureReplay --capture frames.rcap [--output results.json] [--loops n]\n";
+	}
+
+	bool parse_arguments(int argc, char** argv, config& options)
+	{
+		for (int i{ 1 }; i < argc; ++i)
+		{
+			const std::string argument{ argv[i] };
+			if (i + 1 >= argc)
+			{
+				std::cerr << "missing value for " << argument << "\n";
+				print_usage();
+				return false;
+			}
+
+			const char* value{ argv[++i] };
+			if (argument == "--capture")
+				options.capture = value;
+			else if (argument == "--output")
+				options.output = value;
+			else if (argument == "--loops")
+			{
+				if (!parse_count(value, options.loops))
+				{
+					std::cerr << "--loops expects a whole number, got " << value << "\n";
+					print_usage();
+					return false;
+				}
+				options.loops = std::max(1u, options.loops);
+			}
+			else
+			{
+				std::cerr << "unknown argument " << argument << "\n";
+				print_usage();
+				return false;
+			}
+		}
+
+		if (options.capture.empty())
+		{
+			print_usage();
+			return false;
+		}
+		return true;
+	}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	config options{};
+	if (!parse_arguments(argc, argv, options))
+		return 1;
+
+	capture::capture_data data{};
+	if (!capture::load_capture(options.capture, data) || data.frames.empty() || !validate_capture(data))
+	{
+		std::cerr << "failed to load " << options.capture << "!\n";
+		return 1;
+	}
+
+	if (!vulkan::core::init(nullptr))
+	{
+		std::cerr << "failed to initialize a headless vulkan device!\n";
+		return 1;
+	}
+
+	// progress goes to stderr, stdout only carries the json when there is no --output
+	std::cerr << "replaying " << data.frames.size() << " frames on " << vulkan::core::get_physical_device_properties().deviceName << "\n";
+
+	if (!create_replay_context(data))
+	{
+		std::cerr << "failed to create the replay objects!\n";
+		destroy_replay_context();
+		vulkan::core::shutdown();
+		return 1;
+	}
+
+	result replay{ "replay" };
+	result captured{ "captured" };
+	uint64_t draw_count{ 0 };
+	uint64_t upload_bytes{ 0 };
+	for (const capture::frame& f : data.frames)
+	{
+		captured.samples_ms.push_back(f.captured_ms);
+		for (const capture::queue_submission& q : f.queues)
+			draw_count += q.draws.size();
+		for (uint64_t bytes : f.uploads)
+			upload_bytes += bytes;
+	}
+
+	// every loop replays the whole capture, more loops smooth out driver warm up
+	for (uint32_t loop{ 0 }; loop < options.loops; ++loop)
+	{
+		for (const capture::frame& f : data.frames)
+		{
+			const clock::time_point start{ clock::now() };
+			replay_frame(f);
+			replay.samples_ms.push_back(elapsed_ms(start));
+		}
+	}
+	vkDeviceWaitIdle(vulkan::core::get_logical_device());
+
+	replay.metrics.push_back({ "frames", (double)data.frames.size() });
+	replay.metrics.push_back({ "loops", (double)options.loops });
+	replay.metrics.push_back({ "draws_per_frame", (double)draw_count / data.frames.size() });
+	replay.metrics.push_back({ "upload_bytes_per_frame", (double)upload_bytes / data.frames.size() });
+	replay.metrics.push_back({ "pipelines", (double)data.pipeline_count });
+
+	std::ostringstream json{};
+	json << "{\n";
+	write_device_json(json);
+	json << "  \"capture\": ";
+	write_json_string(json, options.capture);
+	json << ",\n";
+	write_results_json(json, { replay, captured });
+	json << "}\n";
+
+	if (options.output.empty())
+	{
+		std::cout << json.str();
+	}
+	else
+	{
+		std::ofstream file{ options.output };
+		file << json.str();
+		if (!file)
+			std::cerr << "failed to write " << options.output << "!\n";
+	}
+
+	destroy_replay_context();
+	vulkan::core::shutdown();
+	return 0;
+}
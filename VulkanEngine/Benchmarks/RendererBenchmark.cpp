@@ -0,0 +1,1535 @@
+// headless renderer benchmarks, results are written as json so runs can be compared per commit.
+// runs on any vulkan implementation, point VK_ICD_FILENAMES at lavapipe or swiftshader to run without a gpu.
+//
+// usage: RendererBenchmark [--output results.json] [--scenario name] [--frames n] [--draws n] [--descriptor-sets n]
+//                          [--pipelines n] [--textures n] [--texture-size n] [--uploads n] [--upload-size-mb n]
+//                          [--resizes n] [--lights n] [--static-objects n] [--dynamic-objects n] [--particles n]
+//                          [--characters n] [--meshes n] [--seed n]
+
+#include "BenchmarkCommon.h"
+#include "../Geometry/Bvh.h"
+#include "../Geometry/MeshAsset.h"
+#include "../Geometry/MeshOptimizer.h"
+#include "../Geometry/Particles.h"
+#include "../Geometry/Skinning.h"
+#include "../Renderer/VulkanCommandCache.h"
+#include "../Renderer/VulkanCore.h"
+#include "../Renderer/VulkanDefragmenter.h"
+#include "../Renderer/VulkanHelpers.h"
+#include "../Renderer/VulkanLightClusters.h"
+#include "../Renderer/VulkanLod.h"
+#include "../Renderer/VulkanMemory.h"
+#include "../Renderer/VulkanMeshlets.h"
+#include "../Renderer/VulkanParticles.h"
+#include "../Renderer/VulkanResource.h"
+#include "../Renderer/VulkanSkinning.h"
+#include "../Renderer/VulkanTextures.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+
+using namespace renderer;
+using namespace renderer::vulkan;
+using namespace renderer::benchmark;
+
+namespace
+{
+	struct config
+	{
+		std::string	output{};
+		std::string	scenario{};
+		uint32_t	frames{ 300 };
+		uint32_t	draws{ 10000 };
+		uint32_t	descriptor_sets{ 1000 };
+		uint32_t	pipelines{ 64 };
+		uint32_t	textures{ 32 };
+		uint32_t	texture_size{ 512 };
+		uint32_t	uploads{ 32 };
+		uint32_t	upload_size_mb{ 4 };
+		uint32_t	resizes{ 100 };
+		uint32_t	lights{ 10000 };	// largest light count of the binning sweep
+		uint32_t	static_objects{ 1000000 };
+		uint32_t	dynamic_objects{ 50000 };
+		uint32_t	particles{ 1 << 20 };
+		uint32_t	characters{ 2000 };	// largest character count of the skinning sweep
+		uint32_t	meshes{ 16 };
+		uint32_t	seed{ 1234 };
+	};
+
+	constexpr uint32_t uniform_range{ 256 };
+
+	// objects shared by the scenarios that record draws
+	struct draw_context
+	{
+		VkShaderModule			shader_module{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout	set_layout{ VK_NULL_HANDLE };
+		VkPipelineLayout		pipeline_layout{ VK_NULL_HANDLE };
+		null_target				target{};
+		VkPipeline				pipelines[2]{};
+		memory::buffer			uniforms{};
+	}context{};
+
+	VkPipeline create_pipeline(VkPrimitiveTopology topology, VkCullModeFlags cull_mode, VkFrontFace front_face, float depth_bias)
+	{
+		return create_null_pipeline(context.shader_module, context.pipeline_layout, context.target.render_pass, topology, cull_mode, front_face, depth_bias);
+	}
+
+	bool create_draw_context()
+	{
+		VkDevice device{ core::get_logical_device() };
+
+		context.shader_module = create_empty_vertex_shader();
+
+		VkDescriptorSetLayoutBinding binding = vkh::descriptor_set_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0);
+		VkDescriptorSetLayoutCreateInfo set_layout_info = vkh::descriptor_set_layout(1, &binding);
+		VKCALL(vkCreateDescriptorSetLayout(device, &set_layout_info, nullptr, &context.set_layout), "failed to create benchmark set layout");
+
+		VkPipelineLayoutCreateInfo layout_info{};
+		layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layout_info.setLayoutCount = 1;
+		layout_info.pSetLayouts = &context.set_layout;
+		VKCALL(vkCreatePipelineLayout(device, &layout_info, nullptr, &context.pipeline_layout), "failed to create benchmark pipeline layout");
+
+		if (!create_null_target(context.target))
+			return false;
+
+		context.pipelines[0] = create_pipeline(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0.f);
+		context.pipelines[1] = create_pipeline(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0.f);
+
+		if (!context.shader_module || !context.pipeline_layout || !context.pipelines[0] || !context.pipelines[1])
+			return false;
+
+		return memory::create_buffer(1 << 20, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+									 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, context.uniforms);
+	}
+
+	void destroy_draw_context()
+	{
+		VkDevice device{ core::get_logical_device() };
+		vkDeviceWaitIdle(device);
+
+		memory::destroy_buffer(context.uniforms);
+		for (VkPipeline pipeline : context.pipelines)
+			vkDestroyPipeline(device, pipeline, nullptr);
+		destroy_null_target(context.target);
+		vkDestroyPipelineLayout(device, context.pipeline_layout, nullptr);
+		vkDestroyDescriptorSetLayout(device, context.set_layout, nullptr);
+		vkDestroyShaderModule(device, context.shader_module, nullptr);
+		context = {};
+	}
+
+	void begin_render_pass(VkCommandBuffer command_buffer)
+	{
+		begin_null_render_pass(command_buffer, context.target);
+	}
+
+	void end_frame(VkCommandBuffer command_buffer)
+	{
+		vkEndCommandBuffer(command_buffer);
+		core::end_frame();
+	}
+
+	result frame_overhead(const config& options)
+	{
+		result r{ "frame_overhead" };
+
+		for (uint32_t frame{ 0 }; frame < options.frames; ++frame)
+		{
+			const clock::time_point start{ clock::now() };
+			core::begin_frame();
+			end_frame(core::get_command_buffer());
+			r.samples_ms.push_back(elapsed_ms(start));
+		}
+
+		vkDeviceWaitIdle(core::get_logical_device());
+		return r;
+	}
+
+	result draws(const config& options)
+	{
+		result r{ "draws" };
+
+		for (uint32_t frame{ 0 }; frame < options.frames; ++frame)
+		{
+			const clock::time_point start{ clock::now() };
+			core::begin_frame();
+			VkCommandBuffer command_buffer{ core::get_command_buffer() };
+			begin_render_pass(command_buffer);
+
+			// switch pipelines every 64 draws so binds are part of the measurement
+			for (uint32_t draw{ 0 }; draw < options.draws; ++draw)
+			{
+				if (draw % 64 == 0)
+					vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context.pipelines[(draw / 64) & 1]);
+				vkCmdDraw(command_buffer, 3, 1, 0, draw);
+			}
+
+			vkCmdEndRenderPass(command_buffer);
+			end_frame(command_buffer);
+			r.samples_ms.push_back(elapsed_ms(start));
+		}
+
+		vkDeviceWaitIdle(core::get_logical_device());
+
+		double total_ms{ 0 };
+		for (double sample : r.samples_ms)
+			total_ms += sample;
+		r.metrics.push_back({ "draws_per_frame", (double)options.draws });
+		r.metrics.push_back({ "draws_per_second", total_ms > 0 ? options.draws * (double)options.frames / (total_ms / 1000.0) : 0 });
+		return r;
+	}
+
+	// the draws scenario with its draws split into static batches of 64 that are recorded once into cached secondary
+	// command buffers, every 16th frame one batch changes its version and is recorded again
+	result cached_draws(const config& options)
+	{
+		result r{ "cached_draws" };
+		if (!command_cache::init())
+		{
+			command_cache::shutdown();
+			return r;
+		}
+
+		constexpr uint32_t draws_per_batch{ 64 };
+		const uint32_t batch_count{ (options.draws + draws_per_batch - 1) / draws_per_batch };
+		std::vector<uint64_t> versions(batch_count, 0);
+
+		for (uint32_t frame{ 0 }; frame < options.frames; ++frame)
+		{
+			const clock::time_point start{ clock::now() };
+			core::begin_frame();
+			VkCommandBuffer command_buffer{ core::get_command_buffer() };
+
+			VkRenderPassBeginInfo begin_info{};
+			begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			begin_info.renderPass = context.target.render_pass;
+			begin_info.framebuffer = context.target.frame_buffer;
+			begin_info.renderArea = vkh::rect_2d(1, 1, 0, 0);
+			vkCmdBeginRenderPass(command_buffer, &begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+			if (frame % 16 == 15 && batch_count)
+				++versions[(frame / 16) % batch_count];
+
+			std::vector<VkCommandBuffer> secondaries(batch_count);
+			for (uint32_t batch{ 0 }; batch < batch_count; ++batch)
+			{
+				const command_cache::batch_key key{ batch, context.pipelines[batch & 1], vkh::viewport(1.f, 1.f, 0.f, 1.f) };
+				const uint32_t first_draw{ batch * draws_per_batch }, end_draw{ std::min(options.draws, first_draw + draws_per_batch) };
+				secondaries[batch] = command_cache::get(context.target.render_pass, 0, key, versions[batch], [=](VkCommandBuffer secondary) {
+					for (uint32_t draw{ first_draw }; draw < end_draw; ++draw)
+						vkCmdDraw(secondary, 3, 1, 0, draw);
+				});
+			}
+			if (batch_count)
+				vkCmdExecuteCommands(command_buffer, batch_count, secondaries.data());
+
+			vkCmdEndRenderPass(command_buffer);
+			end_frame(command_buffer);
+			r.samples_ms.push_back(elapsed_ms(start));
+		}
+
+		vkDeviceWaitIdle(core::get_logical_device());
+
+		double total_ms{ 0 };
+		for (double sample : r.samples_ms)
+			total_ms += sample;
+		const command_cache::statistics statistics{ command_cache::get_statistics() };
+		r.metrics.push_back({ "draws_per_frame", (double)options.draws });
+		r.metrics.push_back({ "draws_per_second", total_ms > 0 ? options.draws * (double)options.frames / (total_ms / 1000.0) : 0 });
+		r.metrics.push_back({ "cache_hits", (double)statistics.hits });
+		r.metrics.push_back({ "cache_records", (double)statistics.records });
+		r.metrics.push_back({ "cache_rerecords", (double)statistics.rerecords });
+
+		command_cache::shutdown();
+		return r;
+	}
+
+	result descriptor_churn(const config& options)
+	{
+		result r{ "descriptor_churn" };
+		VkDevice device{ core::get_logical_device() };
+
+		// one pool per frame in flight, reset once the frame fence has been waited on in begin_frame
+		VkDescriptorPoolSize pool_size{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, options.descriptor_sets };
+		VkDescriptorPoolCreateInfo pool_info = vkh::descriptor_pool(1, &pool_size, options.descriptor_sets);
+		std::array<VkDescriptorPool, core::max_current_frames> pools{};
+		for (VkDescriptorPool& pool : pools)
+			VKCALL(vkCreateDescriptorPool(device, &pool_info, nullptr, &pool), "failed to create benchmark descriptor pool");
+
+		const VkDeviceSize alignment{ std::max<VkDeviceSize>(core::get_physical_device_properties().limits.minUniformBufferOffsetAlignment, uniform_range) };
+		const uint32_t slot_count{ (uint32_t)(context.uniforms.size / alignment) };
+
+		std::vector<VkDescriptorSetLayout> layouts(options.descriptor_sets, context.set_layout);
+		std::vector<VkDescriptorSet> sets(options.descriptor_sets);
+		std::vector<VkDescriptorBufferInfo> buffer_infos(options.descriptor_sets);
+		std::vector<VkWriteDescriptorSet> writes(options.descriptor_sets);
+
+		for (uint32_t frame{ 0 }; frame < options.frames; ++frame)
+		{
+			const clock::time_point start{ clock::now() };
+			core::begin_frame();
+			VkCommandBuffer command_buffer{ core::get_command_buffer() };
+			VkDescriptorPool pool{ pools[core::get_current_command_buffer_index()] };
+
+			vkResetDescriptorPool(device, pool, 0);
+			VkDescriptorSetAllocateInfo alloc_info = vkh::descriptor_set_alloc_info(pool, layouts.data(), options.descriptor_sets);
+			VKCALL(vkAllocateDescriptorSets(device, &alloc_info, sets.data()), "failed to allocate benchmark descriptor sets");
+
+			for (uint32_t i{ 0 }; i < options.descriptor_sets; ++i)
+			{
+				buffer_infos[i] = { context.uniforms.buffer, ((frame + i) % slot_count) * alignment, uniform_range };
+				writes[i] = vkh::write_descriptor_set(sets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &buffer_infos[i]);
+			}
+			vkUpdateDescriptorSets(device, options.descriptor_sets, writes.data(), 0, nullptr);
+
+			begin_render_pass(command_buffer);
+			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context.pipelines[0]);
+			for (uint32_t i{ 0 }; i < options.descriptor_sets; ++i)
+			{
+				vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context.pipeline_layout, 0, 1, &sets[i], 0, nullptr);
+				vkCmdDraw(command_buffer, 3, 1, 0, 0);
+			}
+			vkCmdEndRenderPass(command_buffer);
+
+			end_frame(command_buffer);
+			r.samples_ms.push_back(elapsed_ms(start));
+		}
+
+		vkDeviceWaitIdle(device);
+		for (VkDescriptorPool pool : pools)
+			vkDestroyDescriptorPool(device, pool, nullptr);
+
+		r.metrics.push_back({ "sets_per_frame", (double)options.descriptor_sets });
+		return r;
+	}
+
+	result pipeline_creation(const config& options)
+	{
+		result r{ "pipeline_creation" };
+
+		constexpr VkPrimitiveTopology topologies[]{ VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP };
+		constexpr VkCullModeFlags cull_modes[]{ VK_CULL_MODE_NONE, VK_CULL_MODE_FRONT_BIT, VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_AND_BACK };
+		constexpr VkFrontFace front_faces[]{ VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FRONT_FACE_CLOCKWISE };
+
+		std::vector<VkPipeline> pipelines{};
+		for (uint32_t i{ 0 }; i < options.pipelines; ++i)
+		{
+			// the depth bias makes every pipeline unique so drivers can't hand back an internally cached one
+			const clock::time_point start{ clock::now() };
+			pipelines.push_back(create_pipeline(topologies[i % 2], cull_modes[(i / 2) % 4], front_faces[(i / 8) % 2], 1.f + (float)i));
+			r.samples_ms.push_back(elapsed_ms(start));
+		}
+
+		for (VkPipeline pipeline : pipelines)
+			vkDestroyPipeline(core::get_logical_device(), pipeline, nullptr);
+
+		return r;
+	}
+
+	result texture_uploads(const config& options)
+	{
+		result r{ "texture_uploads" };
+		std::mt19937 random{ options.seed };
+
+		textures::texture_data data{};
+		data.format = VK_FORMAT_R8G8B8A8_UNORM;
+		data.width = options.texture_size;
+		data.height = options.texture_size;
+		data.mip_count = 1;
+		data.mip_offsets = { 0 };
+		data.bytes.resize((size_t)options.texture_size * options.texture_size * 4);
+		for (uint8_t& byte : data.bytes)
+			byte = (uint8_t)random();
+
+		uint64_t uploaded_bytes{ 0 };
+		double total_ms{ 0 };
+		std::vector<textures::texture> uploaded(options.textures);
+		for (textures::texture& texture : uploaded)
+		{
+			// includes staging, copy, gpu mip generation and the wait for completion
+			const clock::time_point start{ clock::now() };
+			if (!textures::create_texture(data, texture))
+				break;
+			r.samples_ms.push_back(elapsed_ms(start));
+
+			total_ms += r.samples_ms.back();
+			uploaded_bytes += data.bytes.size();
+		}
+
+		for (textures::texture& texture : uploaded)
+			textures::destroy_texture(texture);
+
+		r.metrics.push_back({ "texture_size", (double)options.texture_size });
+		r.metrics.push_back({ "megabytes_per_second", total_ms > 0 ? (uploaded_bytes / (1024.0 * 1024.0)) / (total_ms / 1000.0) : 0 });
+		return r;
+	}
+
+	result buffer_uploads(const config& options)
+	{
+		result r{ "buffer_uploads" };
+		const VkDeviceSize size{ (VkDeviceSize)options.upload_size_mb << 20 };
+
+		memory::buffer staging{};
+		memory::buffer destination{};
+		if (!memory::create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+								   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging) ||
+			!memory::create_buffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, destination))
+		{
+			memory::destroy_buffer(staging);
+			memory::destroy_buffer(destination);
+			return r;
+		}
+
+		std::vector<uint8_t> source(size);
+		std::mt19937 random{ options.seed };
+		for (uint8_t& byte : source)
+			byte = (uint8_t)random();
+
+		double total_ms{ 0 };
+		for (uint32_t i{ 0 }; i < options.uploads; ++i)
+		{
+			// cpu write into the staging buffer plus the gpu copy
+			const clock::time_point start{ clock::now() };
+			memcpy(staging.mapped, source.data(), size);
+
+			VkCommandBuffer command_buffer{ core::begin_single_time_commands() };
+			VkBufferCopy region{ 0, 0, size };
+			vkCmdCopyBuffer(command_buffer, staging.buffer, destination.buffer, 1, &region);
+			core::end_single_time_commands(command_buffer);
+
+			r.samples_ms.push_back(elapsed_ms(start));
+			total_ms += r.samples_ms.back();
+		}
+
+		memory::destroy_buffer(staging);
+		memory::destroy_buffer(destination);
+
+		r.metrics.push_back({ "upload_size_mb", (double)options.upload_size_mb });
+		r.metrics.push_back({ "megabytes_per_second", total_ms > 0 ? options.uploads * (double)options.upload_size_mb / (total_ms / 1000.0) : 0 });
+		return r;
+	}
+
+	// streams movable buffers in and out every frame with the defragmenter running, the block bytes per used byte
+	// should level off instead of growing with the frame count
+	result asset_churn(const config& options)
+	{
+		result r{ "asset_churn" };
+		constexpr uint32_t resident_assets{ 2048 };
+		constexpr uint32_t churn_per_frame{ 16 };
+
+		std::mt19937 random{ options.seed };
+		auto create_asset = [&random]() {
+			const VkDeviceSize size{ (VkDeviceSize)(1 + random() % 512) << 10 };
+			return resources::create_buffer(size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+		};
+
+		std::vector<resources::buffer_handle> assets(resident_assets);
+		for (resources::buffer_handle& asset : assets)
+			asset = create_asset();
+
+		defragmenter::init();
+		double peak_overhead{ 0 };
+		for (uint32_t frame{ 0 }; frame < options.frames; ++frame)
+		{
+			const clock::time_point start{ clock::now() };
+			core::begin_frame();
+			VkCommandBuffer command_buffer{ core::get_command_buffer() };
+
+			for (uint32_t i{ 0 }; i < churn_per_frame; ++i)
+			{
+				resources::buffer_handle& asset{ assets[random() % resident_assets] };
+				resources::destroy(asset);
+				asset = create_asset();
+			}
+			defragmenter::update(command_buffer);
+
+			end_frame(command_buffer);
+			r.samples_ms.push_back(elapsed_ms(start));
+
+			const memory::statistics memory_statistics{ memory::get_statistics() };
+			if (memory_statistics.block_used_bytes)
+				peak_overhead = std::max(peak_overhead, (double)memory_statistics.block_bytes / (double)memory_statistics.block_used_bytes);
+		}
+
+		vkDeviceWaitIdle(core::get_logical_device());
+		const memory::statistics memory_statistics{ memory::get_statistics() };
+		const defragmenter::statistics defrag_statistics{ defragmenter::get_statistics() };
+		defragmenter::shutdown();
+		for (resources::buffer_handle asset : assets)
+			resources::destroy(asset);
+
+		r.metrics.push_back({ "blocks", (double)memory_statistics.block_count });
+		r.metrics.push_back({ "block_bytes_per_used_byte", memory_statistics.block_used_bytes ?
+								(double)memory_statistics.block_bytes / (double)memory_statistics.block_used_bytes : 0 });
+		r.metrics.push_back({ "peak_block_bytes_per_used_byte", peak_overhead });
+		r.metrics.push_back({ "megabytes_moved", defrag_statistics.bytes_moved / (1024.0 * 1024.0) });
+		r.metrics.push_back({ "blocks_freed", (double)defrag_statistics.blocks_freed });
+		return r;
+	}
+
+	// a headless device has no swap chain, so a resize is modelled as what the renderer redoes besides vkCreateSwapchainKHR:
+	// idle the device and rebuild the size dependent color target, its view and frame buffer
+	result resize_storm(const config& options)
+	{
+		result r{ "resize_storm" };
+		VkDevice device{ core::get_logical_device() };
+		constexpr VkFormat color_format{ VK_FORMAT_R8G8B8A8_UNORM };
+
+		VkAttachmentDescription attachment{};
+		attachment.format = color_format;
+		attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference color_reference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		VkSubpassDescription subpass{};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &color_reference;
+
+		VkRenderPassCreateInfo render_pass_info{};
+		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		render_pass_info.attachmentCount = 1;
+		render_pass_info.pAttachments = &attachment;
+		render_pass_info.subpassCount = 1;
+		render_pass_info.pSubpasses = &subpass;
+
+		VkRenderPass render_pass{ VK_NULL_HANDLE };
+		VKCALL(vkCreateRenderPass(device, &render_pass_info, nullptr, &render_pass), "failed to create resize render pass");
+
+		memory::image target{};
+		VkImageView view{ VK_NULL_HANDLE };
+		VkFramebuffer frame_buffer{ VK_NULL_HANDLE };
+		auto destroy_target = [&]() {
+			if (frame_buffer)
+				vkDestroyFramebuffer(device, frame_buffer, nullptr);
+			if (view)
+				vkDestroyImageView(device, view, nullptr);
+			memory::destroy_image(target);
+			frame_buffer = VK_NULL_HANDLE;
+			view = VK_NULL_HANDLE;
+		};
+
+		std::mt19937 random{ options.seed };
+		std::uniform_int_distribution<uint32_t> size_distribution{ 256, 2048 };
+
+		for (uint32_t i{ 0 }; i < options.resizes; ++i)
+		{
+			const uint32_t width{ size_distribution(random) };
+			const uint32_t height{ size_distribution(random) };
+
+			const clock::time_point start{ clock::now() };
+			vkDeviceWaitIdle(device);
+			destroy_target();
+
+			VkImageCreateInfo image_info = vkh::image_2d(color_format, width, height, 1, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+			if (!memory::create_image(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, target))
+				break;
+
+			VkImageViewCreateInfo view_info = vkh::image_view_2d(target.image, color_format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+			VKCALL(vkCreateImageView(device, &view_info, nullptr, &view), "failed to create resize target view");
+
+			VkFramebufferCreateInfo frame_buffer_info{};
+			frame_buffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			frame_buffer_info.renderPass = render_pass;
+			frame_buffer_info.attachmentCount = 1;
+			frame_buffer_info.pAttachments = &view;
+			frame_buffer_info.width = width;
+			frame_buffer_info.height = height;
+			frame_buffer_info.layers = 1;
+			VKCALL(vkCreateFramebuffer(device, &frame_buffer_info, nullptr, &frame_buffer), "failed to create resize frame buffer");
+
+			r.samples_ms.push_back(elapsed_ms(start));
+		}
+
+		destroy_target();
+		vkDestroyRenderPass(device, render_pass, nullptr);
+		return r;
+	}
+
+	// right handed, zero to one depth and flipped y like the renderer's projection
+	glm::mat4 perspective_projection(float fov_y, float aspect, float near_depth, float far_depth)
+	{
+		const float f{ 1.f / std::tan(fov_y * 0.5f) };
+		glm::mat4 projection{ 0.f };
+		projection[0][0] = f / aspect;
+		projection[1][1] = -f;
+		projection[2][2] = far_depth / (near_depth - far_depth);
+		projection[2][3] = -1.f;
+		projection[3][2] = near_depth * far_depth / (near_depth - far_depth);
+		return projection;
+	}
+
+	// cpu and gpu binning cost over a sweep of light counts up to --lights, a 1920x1080 grid and a camera looking down -z.
+	// samples are the cpu binning times at the largest count, the sweep is reported as metrics
+	result light_binning(const config& options)
+	{
+		result r{ "light_binning" };
+		VkDevice device{ core::get_logical_device() };
+		constexpr VkExtent2D extent{ 1920, 1080 };
+
+		light_clusters::settings settings{};
+		settings.max_lights = options.lights;
+		if (!light_clusters::init(settings))
+		{
+			light_clusters::shutdown();
+			return r;
+		}
+
+		const glm::mat4 view{ 1.f };
+		const glm::mat4 projection{ perspective_projection(1.f, (float)extent.width / extent.height, 0.1f, 1000.f) };
+		if (!light_clusters::update_grid(projection, extent))
+		{
+			light_clusters::shutdown();
+			return r;
+		}
+
+		// lights spread through the first 200 units of the frustum, half of them spot lights
+		std::mt19937 random{ options.seed };
+		std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+		std::vector<geometry::lights::light> lights(options.lights);
+		for (geometry::lights::light& l : lights)
+		{
+			const float depth{ 1.f + unit(random) * 199.f };
+			l.position = glm::vec3{ (unit(random) * 2.f - 1.f) * depth, (unit(random) * 2.f - 1.f) * depth * 0.6f, -depth };
+			l.range = 1.f + unit(random) * 7.f;
+			l.color = glm::vec3{ unit(random), unit(random), unit(random) };
+			if (unit(random) < 0.5f)
+			{
+				const glm::vec3 direction{ unit(random) * 2.f - 1.f, unit(random) * 2.f - 1.f, unit(random) * 2.f - 1.f };
+				l.type = geometry::lights::spot;
+				l.direction = direction / std::max(std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z), 1e-6f);
+				l.cos_outer_angle = 0.5f + unit(random) * 0.5f;
+			}
+		}
+
+		// gpu timestamps around the light upload and dispatch
+		gpu_timer timer{};
+		if (light_clusters::is_gpu_binning_supported())
+			create_gpu_timer(options.frames, timer);
+
+		std::vector<uint32_t> counts{};
+		for (uint32_t count : { 1000u, 2500u, 5000u, 10000u })
+		{
+			if (count < options.lights)
+				counts.push_back(count);
+		}
+		counts.push_back(options.lights);
+
+		for (uint32_t count : counts)
+		{
+			double cpu_total_ms{ 0 };
+			uint32_t index_count{ 0 };
+			for (uint32_t frame{ 0 }; frame < options.frames; ++frame)
+			{
+				core::begin_frame();
+				VkCommandBuffer command_buffer{ core::get_command_buffer() };
+
+				const clock::time_point start{ clock::now() };
+				light_clusters::bin_cpu(command_buffer, view, projection, lights.data(), count);
+				const double cpu_ms{ elapsed_ms(start) };
+				cpu_total_ms += cpu_ms;
+				index_count = light_clusters::get_statistics().index_count;
+				if (count == options.lights)
+					r.samples_ms.push_back(cpu_ms);
+
+				if (timer.query_pool)
+				{
+					begin_gpu_timer(command_buffer, timer, frame);
+					light_clusters::bin_gpu(command_buffer, view, projection, lights.data(), count);
+					end_gpu_timer(command_buffer, timer, frame);
+				}
+
+				end_frame(command_buffer);
+			}
+			vkDeviceWaitIdle(device);
+
+			const std::string suffix{ "_" + std::to_string(count) };
+			r.metrics.push_back({ "cpu_ms" + suffix, options.frames ? cpu_total_ms / options.frames : 0 });
+			r.metrics.push_back({ "indices" + suffix, (double)index_count });
+
+			if (timer.query_pool)
+				r.metrics.push_back({ "gpu_ms" + suffix, read_gpu_timer_ms(timer) });
+		}
+
+		const geometry::lights::cluster_grid& grid{ light_clusters::get_grid() };
+		r.metrics.push_back({ "clusters", (double)grid.cluster_count() });
+
+		destroy_gpu_timer(timer);
+		light_clusters::shutdown();
+		return r;
+	}
+
+	// camera at position turned by yaw radians around +y, looking down -z at yaw 0
+	glm::mat4 yaw_view(const glm::vec3& position, float yaw)
+	{
+		const glm::vec3 right{ std::cos(yaw), 0.f, std::sin(yaw) };
+		const glm::vec3 back{ -std::sin(yaw), 0.f, std::cos(yaw) };
+		glm::mat4 view{ 1.f };
+		view[0] = glm::vec4{ right.x, 0.f, back.x, 0.f };
+		view[1] = glm::vec4{ 0.f, 1.f, 0.f, 0.f };
+		view[2] = glm::vec4{ right.z, 0.f, back.z, 0.f };
+		view[3] = glm::vec4{ -(right.x * position.x + right.z * position.z), -position.y, -(back.x * position.x + back.z * position.z), 1.f };
+		return view;
+	}
+
+	// bvh over --static-objects static and --dynamic-objects moving boxes on a 2km square. every frame moves all dynamic
+	// objects, refits, and runs a batch of frustum, ray and sphere queries. samples are the refit times
+	result scene_bvh(const config& options)
+	{
+		result r{ "scene_bvh" };
+		constexpr uint32_t frustums_per_frame{ 64 }, rays_per_frame{ 16384 }, spheres_per_frame{ 1024 };
+
+		std::mt19937 random{ options.seed };
+		std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+		auto random_bounds = [&] {
+			const glm::vec3 center{ unit(random) * 2000.f - 1000.f, unit(random) * 50.f, unit(random) * 2000.f - 1000.f };
+			const glm::vec3 half_extent{ 0.25f + unit(random) * 2.f, 0.25f + unit(random) * 4.f, 0.25f + unit(random) * 2.f };
+			return geometry::bvh::aabb{ center - half_extent, center + half_extent };
+		};
+
+		geometry::bvh::scene scene{};
+		for (uint32_t i{ 0 }; i < options.static_objects; ++i)
+			scene.insert(random_bounds(), false);
+
+		std::vector<uint32_t> dynamic_objects(options.dynamic_objects);
+		for (uint32_t& object : dynamic_objects)
+			object = scene.insert(random_bounds(), true);
+
+		clock::time_point start{ clock::now() };
+		scene.build();
+		r.metrics.push_back({ "build_ms", elapsed_ms(start) });
+
+		const glm::mat4 projection{ perspective_projection(1.f, 16.f / 9.f, 0.1f, 500.f) };
+		std::vector<geometry::culling::frustum> frustums(frustums_per_frame);
+		std::vector<std::vector<uint32_t>> frustum_results{};
+		std::vector<glm::vec3> origins(rays_per_frame), directions(rays_per_frame);
+		std::vector<geometry::bvh::ray_hit> hits(rays_per_frame);
+		std::vector<uint32_t> sphere_result{};
+
+		double frustum_ms{ 0 }, ray_ms{ 0 }, sphere_ms{ 0 };
+		uint64_t visible{ 0 }, ray_hits{ 0 };
+		for (uint32_t frame{ 0 }; frame < options.frames; ++frame)
+		{
+			for (uint32_t object : dynamic_objects)
+			{
+				const geometry::bvh::aabb& bounds{ scene.get_bounds(object) };
+				const glm::vec3 step{ unit(random) - 0.5f, 0.f, unit(random) - 0.5f };
+				scene.update(object, { bounds.min + step, bounds.max + step });
+			}
+
+			start = clock::now();
+			scene.refit();
+			r.samples_ms.push_back(elapsed_ms(start));
+
+			for (geometry::culling::frustum& f : frustums)
+			{
+				const glm::vec3 position{ unit(random) * 2000.f - 1000.f, 10.f, unit(random) * 2000.f - 1000.f };
+				f = geometry::culling::extract_frustum(projection * yaw_view(position, unit(random) * 6.2831853f));
+			}
+			start = clock::now();
+			scene.query_frustums(frustums.data(), frustums_per_frame, frustum_results);
+			frustum_ms += elapsed_ms(start);
+			for (const std::vector<uint32_t>& objects : frustum_results)
+				visible += objects.size();
+
+			// picking rays from 100 units up to random points on the ground
+			for (uint32_t i{ 0 }; i < rays_per_frame; ++i)
+			{
+				origins[i] = glm::vec3{ unit(random) * 2000.f - 1000.f, 100.f, unit(random) * 2000.f - 1000.f };
+				directions[i] = glm::vec3{ unit(random) * 40.f - 20.f, -100.f, unit(random) * 40.f - 20.f };
+			}
+			start = clock::now();
+			scene.raycast_batch(origins.data(), directions.data(), rays_per_frame, 1.f, hits.data());
+			ray_ms += elapsed_ms(start);
+			for (const geometry::bvh::ray_hit& hit : hits)
+				ray_hits += hit.object != geometry::bvh::invalid_object;
+
+			start = clock::now();
+			for (uint32_t i{ 0 }; i < spheres_per_frame; ++i)
+			{
+				sphere_result.clear();
+				scene.query_sphere({ unit(random) * 2000.f - 1000.f, 25.f, unit(random) * 2000.f - 1000.f }, 20.f, sphere_result);
+			}
+			sphere_ms += elapsed_ms(start);
+		}
+
+		// an id removed before any build picked it up and reused straight away must be reported once
+		const geometry::bvh::aabb isolated{ glm::vec3{ -1.f, 5000.f, -1.f }, glm::vec3{ 1.f, 5002.f, 1.f } };
+		scene.remove(scene.insert(isolated, false));
+		const uint32_t reinserted{ scene.insert(isolated, true) };
+		sphere_result.clear();
+		scene.query_sphere(glm::vec3{ 0.f, 5001.f, 0.f }, 4.f, sphere_result);
+		check(r, sphere_result.size() == 1 && sphere_result[0] == reinserted, "removed pending object still returned by queries");
+		check(r, scene.raycast(glm::vec3{ 0.f, 5010.f, 0.f }, glm::vec3{ 0.f, -1.f, 0.f }, 20.f).object == reinserted, "raycast missed the reinserted object");
+
+		const geometry::bvh::statistics& statistics{ scene.get_statistics() };
+		const double frames{ (double)std::max(options.frames, 1u) };
+		r.metrics.push_back({ "frustum_queries_per_second", frustum_ms > 0 ? frustums_per_frame * frames / (frustum_ms / 1000.0) : 0 });
+		r.metrics.push_back({ "visible_per_frustum", (double)visible / (frustums_per_frame * frames) });
+		r.metrics.push_back({ "rays_per_second", ray_ms > 0 ? rays_per_frame * frames / (ray_ms / 1000.0) : 0 });
+		r.metrics.push_back({ "ray_hit_fraction", (double)ray_hits / (rays_per_frame * frames) });
+		r.metrics.push_back({ "sphere_queries_per_second", sphere_ms > 0 ? spheres_per_frame * frames / (sphere_ms / 1000.0) : 0 });
+		r.metrics.push_back({ "static_nodes", (double)statistics.static_nodes });
+		r.metrics.push_back({ "dynamic_nodes", (double)statistics.dynamic_nodes });
+		r.metrics.push_back({ "dynamic_quality", statistics.dynamic_quality });
+		r.metrics.push_back({ "dynamic_build_ms", statistics.dynamic_build_ms });
+		r.metrics.push_back({ "rebuilds", (double)statistics.rebuilds });
+		return r;
+	}
+
+	// a bumpy resolution x resolution quad grid as an unindexed triangle soup in random triangle order, the way dense
+	// cad exports arrive. the unit square is centred on the origin in xz
+	geometry::mesh make_triangle_soup(uint32_t resolution, std::mt19937& random)
+	{
+		auto grid_vertex = [resolution](uint32_t x, uint32_t z) {
+			const float u{ (float)x / resolution }, v{ (float)z / resolution };
+			geometry::vertex result{};
+			result.position = glm::vec3{ u - 0.5f, 0.01f * std::sin(u * 25.f) * std::cos(v * 19.f), v - 0.5f };
+			result.normal = glm::vec3{ 0.f, 1.f, 0.f };
+			result.uv = glm::vec2{ u, v };
+			return result;
+		};
+
+		std::vector<std::array<geometry::vertex, 3>> triangles{};
+		for (uint32_t z{ 0 }; z < resolution; ++z)
+		{
+			for (uint32_t x{ 0 }; x < resolution; ++x)
+			{
+				triangles.push_back({ grid_vertex(x, z), grid_vertex(x, z + 1), grid_vertex(x + 1, z) });
+				triangles.push_back({ grid_vertex(x + 1, z), grid_vertex(x, z + 1), grid_vertex(x + 1, z + 1) });
+			}
+		}
+		std::shuffle(triangles.begin(), triangles.end(), random);
+
+		geometry::mesh m{};
+		for (const std::array<geometry::vertex, 3>& triangle : triangles)
+		{
+			for (const geometry::vertex& v : triangle)
+			{
+				m.indices.push_back((uint32_t)m.vertices.size());
+				m.vertices.push_back(v);
+			}
+		}
+		return m;
+	}
+
+	// the triangles of an index range by position, each rotated to start at its smallest corner so the winding is kept,
+	// sorted. equal for two meshes that draw the same surface whatever their vertex and triangle order
+	std::vector<std::array<float, 9>> sorted_triangles(const geometry::mesh& m, uint32_t first_index, uint32_t index_count)
+	{
+		auto less = [](const glm::vec3& a, const glm::vec3& b) {
+			return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+		};
+
+		std::vector<std::array<float, 9>> triangles(index_count / 3);
+		for (uint32_t t{ 0 }; t < index_count / 3; ++t)
+		{
+			const uint32_t* triangle{ &m.indices[first_index + t * 3] };
+			uint32_t first{ 0 };
+			for (uint32_t k{ 1 }; k < 3; ++k)
+			{
+				if (less(m.vertices[triangle[k]].position, m.vertices[triangle[first]].position))
+					first = k;
+			}
+
+			for (uint32_t k{ 0 }; k < 3; ++k)
+			{
+				const glm::vec3& p{ m.vertices[triangle[(first + k) % 3]].position };
+				triangles[t][k * 3] = p.x;
+				triangles[t][k * 3 + 1] = p.y;
+				triangles[t][k * 3 + 2] = p.z;
+			}
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	bool indices_in_range(const geometry::mesh& m)
+	{
+		return std::all_of(m.indices.begin(), m.indices.end(), [&m](uint32_t index) { return index < m.vertices.size(); });
+	}
+
+	// right handed view from eye towards target with +y up, target must not be straight above or below
+	glm::mat4 look_at(const glm::vec3& eye, const glm::vec3& target)
+	{
+		const glm::vec3 back{ glm::normalize(eye - target) };
+		const glm::vec3 right{ glm::normalize(glm::cross(glm::vec3{ 0.f, 1.f, 0.f }, back)) };
+		const glm::vec3 up{ glm::cross(back, right) };
+		glm::mat4 view{ 1.f };
+		for (uint32_t i{ 0 }; i < 3; ++i)
+		{
+			view[i][0] = right[i];
+			view[i][1] = up[i];
+			view[i][2] = back[i];
+		}
+		view[3] = glm::vec4{ -glm::dot(right, eye), -glm::dot(up, eye), -glm::dot(back, eye), 1.f };
+		return view;
+	}
+
+	bool same_asset(const geometry::mesh_asset& a, const geometry::mesh_asset& b)
+	{
+		auto same_bytes = [](const auto& x, const auto& y) {
+			return x.size() == y.size() && (x.empty() || memcmp(x.data(), y.data(), x.size() * sizeof(x[0])) == 0);
+		};
+		return same_bytes(a.geometry.vertices, b.geometry.vertices) && same_bytes(a.geometry.indices, b.geometry.indices) &&
+			   same_bytes(a.meshlets.meshlets, b.meshlets.meshlets) && same_bytes(a.meshlets.bounds, b.meshlets.bounds) &&
+			   same_bytes(a.meshlets.vertices, b.meshlets.vertices) && same_bytes(a.meshlets.triangles, b.meshlets.triangles) &&
+			   same_bytes(a.lods, b.lods);
+	}
+
+	// the offline import path over --meshes dense triangle soups: welding and reordering on the job system, meshlets,
+	// lod chains and their selection, an asset round trip, then --frames of cpu cluster culling and meshlet draws.
+	// samples are the import batch times, every stage is checked against its input
+	result mesh_import(const config& options)
+	{
+		result r{ "mesh_import" };
+		constexpr uint32_t resolution{ 128 };
+
+		std::mt19937 random{ options.seed };
+		std::vector<geometry::mesh> meshes{};
+		for (uint32_t i{ 0 }; i < options.meshes; ++i)
+			meshes.push_back(make_triangle_soup(resolution, random));
+		if (meshes.empty())
+			return r;
+		const std::vector<std::array<float, 9>> source_triangles{ sorted_triangles(meshes[0], 0, (uint32_t)meshes[0].indices.size()) };
+
+		clock::time_point start{ clock::now() };
+		const std::vector<geometry::optimizer::mesh_statistics> statistics{ geometry::optimizer::optimize_meshes(meshes) };
+		r.samples_ms.push_back(elapsed_ms(start));
+
+		const geometry::optimizer::batch_statistics batch{ geometry::optimizer::summarize(statistics) };
+		r.metrics.push_back({ "triangles", (double)batch.triangle_count });
+		r.metrics.push_back({ "vertices_before", (double)batch.vertices_before });
+		r.metrics.push_back({ "vertices_after", (double)batch.vertices_after });
+		r.metrics.push_back({ "acmr_before", batch.acmr_before });
+		r.metrics.push_back({ "acmr_after", batch.acmr_after });
+		r.metrics.push_back({ "atvr_before", batch.atvr_before });
+		r.metrics.push_back({ "atvr_after", batch.atvr_after });
+		r.metrics.push_back({ "kilobytes_fetched_before", batch.bytes_fetched_before / 1024.0 });
+		r.metrics.push_back({ "kilobytes_fetched_after", batch.bytes_fetched_after / 1024.0 });
+
+		const uint32_t triangle_count{ resolution * resolution * 2 };
+		check(r, batch.triangle_count == (uint64_t)triangle_count * options.meshes, "optimisation changed the triangle count");
+		check(r, batch.vertices_after == (uint64_t)(resolution + 1) * (resolution + 1) * options.meshes, "welding left duplicate vertices");
+		check(r, batch.acmr_after < batch.acmr_before, "vertex cache optimisation did not lower the acmr");
+		check(r, batch.bytes_fetched_after < batch.bytes_fetched_before, "vertex fetch optimisation did not lower the fetched bytes");
+		for (const geometry::mesh& m : meshes)
+			check(r, m.indices.size() == triangle_count * 3 && indices_in_range(m), "optimised indices out of range");
+		check(r, sorted_triangles(meshes[0], 0, (uint32_t)meshes[0].indices.size()) == source_triangles, "optimisation changed the surface");
+
+		std::vector<geometry::mesh_asset> assets(meshes.size());
+		start = clock::now();
+		for (size_t i{ 0 }; i < meshes.size(); ++i)
+		{
+			assets[i].geometry = std::move(meshes[i]);
+			assets[i].meshlets = geometry::build_meshlets(assets[i].geometry);
+		}
+		r.metrics.push_back({ "meshlet_ms", elapsed_ms(start) });
+		r.metrics.push_back({ "meshlets_per_mesh", (double)assets[0].meshlets.meshlets.size() });
+
+		for (const geometry::mesh_asset& asset : assets)
+		{
+			uint32_t meshlet_triangles{ 0 };
+			for (const geometry::meshlet& m : asset.meshlets.meshlets)
+			{
+				check(r, m.vertex_count <= geometry::meshlet_max_vertices && m.triangle_count <= geometry::meshlet_max_triangles && m.triangle_offset % 4 == 0,
+					  "meshlet over its limits");
+				meshlet_triangles += m.triangle_count;
+			}
+			check(r, meshlet_triangles == triangle_count, "meshlets do not cover every triangle");
+		}
+
+		// lods go after lod 0 in the index buffer, the meshlets above only cover lod 0
+		start = clock::now();
+		for (geometry::mesh_asset& asset : assets)
+			asset.lods = geometry::build_lod_chain(asset.geometry);
+		r.metrics.push_back({ "lod_ms", elapsed_ms(start) });
+
+		const std::vector<geometry::mesh_lod>& lods{ assets[0].lods };
+		r.metrics.push_back({ "lods", (double)lods.size() });
+		r.metrics.push_back({ "coarsest_lod_triangles", lods.back().index_count / 3.0 });
+		r.metrics.push_back({ "coarsest_lod_error", lods.back().error });
+		check(r, lods.size() > 1 && lods[0].index_offset == 0 && lods[0].index_count == triangle_count * 3, "no lod chain");
+		for (size_t i{ 1 }; i < lods.size(); ++i)
+		{
+			check(r, lods[i].index_offset == lods[i - 1].index_offset + lods[i - 1].index_count && lods[i].index_count < lods[i - 1].index_count &&
+					 lods[i].index_count % 3 == 0 && lods[i].error >= lods[i - 1].error, "lods not contiguous and coarser");
+			// the grid's bounding radius is about 0.71, lod_settings limits the error to 5% of it
+			check(r, lods[i].error <= 0.05f * 0.72f, "lod error above the limit");
+		}
+		check(r, lods.back().index_offset + lods.back().index_count == assets[0].geometry.indices.size() && indices_in_range(assets[0].geometry),
+			  "lod indices out of range");
+		check(r, sorted_triangles(assets[0].geometry, 0, lods[0].index_count) == source_triangles, "lod generation changed lod 0");
+
+		// the finest lod close up, coarser with distance, and no switch back and forth right at a threshold
+		constexpr float pixels_per_unit{ 1000.f }, threshold_pixels{ 1.f }, hysteresis{ 0.25f };
+		const uint32_t coarsest{ (uint32_t)lods.size() - 1 };
+		check(r, geometry::select_lod(lods, 0.1f, pixels_per_unit, threshold_pixels, hysteresis, coarsest) == 0, "close up lod is not the finest");
+		check(r, geometry::select_lod(lods, 1e6f, pixels_per_unit, threshold_pixels, hysteresis, 0) == coarsest, "distant lod is not the coarsest");
+		const float switch_distance{ lods[1].error * pixels_per_unit / threshold_pixels };
+		check(r, geometry::select_lod(lods, switch_distance * 1.01f, pixels_per_unit, threshold_pixels, hysteresis, 0) == 0,
+			  "coarser lod taken inside the hysteresis band");
+		check(r, geometry::select_lod(lods, switch_distance * 1.01f, pixels_per_unit, threshold_pixels, hysteresis, 1) == 1,
+			  "finer lod taken outside the threshold");
+
+		std::vector<vulkan::lod::lod_instance> instances(256);
+		for (uint32_t i{ 0 }; i < instances.size(); ++i)
+		{
+			instances[i].lods = &lods;
+			instances[i].model[3] = glm::vec4{ 0.f, 0.f, -(float)i * i * 0.05f, 1.f };
+			instances[i].bounds_radius = 0.72f;
+		}
+		// built by hand, a headless device has no swap chain extent for make_view
+		const vulkan::lod::lod_view lod_view{ glm::vec3{ 0.f }, pixels_per_unit, threshold_pixels, hysteresis };
+		vulkan::lod::select_lods(instances, lod_view);
+		bool monotonic{ instances[0].current_lod == 0 && instances.back().current_lod == coarsest };
+		for (size_t i{ 1 }; i < instances.size(); ++i)
+			monotonic &= instances[i].current_lod >= instances[i - 1].current_lod;
+		check(r, monotonic, "selected lods do not get coarser with distance");
+
+		// the loader has to give back what was saved and reject a truncated file
+		const std::string asset_path{ (std::filesystem::temp_directory_path() / "mesh_import_benchmark.vmsh").string() };
+		geometry::mesh_asset loaded{};
+		check(r, geometry::save_mesh_asset(asset_path, assets[0]) && geometry::load_mesh_asset(asset_path, loaded) && same_asset(assets[0], loaded),
+			  "mesh asset round trip");
+		std::filesystem::resize_file(asset_path, std::filesystem::file_size(asset_path) - 1);
+		check(r, !geometry::load_mesh_asset(asset_path, loaded), "truncated mesh asset was loaded");
+		std::filesystem::remove(asset_path);
+
+		// the grid faces +y: seen from above nothing is culled, from below the cone test culls back facing clusters and
+		// looking away the frustum test culls everything
+		const glm::mat4 projection{ perspective_projection(1.f, 16.f / 9.f, 0.1f, 100.f) };
+		auto cull = [&](const glm::vec3& eye, const glm::vec3& target) {
+			geometry::culling::cluster_statistics statistics{};
+			std::vector<uint32_t> indices{};
+			const geometry::culling::frustum frustum{ geometry::culling::extract_frustum(projection * look_at(eye, target)) };
+			geometry::culling::cull_meshlets(assets[0].meshlets, glm::mat4{ 1.f }, frustum, eye, indices, statistics);
+			check(r, indices.size() == statistics.triangles_visible * 3, "culled index count does not match the visible triangles");
+			return statistics;
+		};
+		const geometry::culling::cluster_statistics above{ cull({ 0.f, 1.5f, 1.5f }, glm::vec3{ 0.f }) };
+		const geometry::culling::cluster_statistics below{ cull({ 0.f, -1.5f, 1.5f }, glm::vec3{ 0.f }) };
+		const geometry::culling::cluster_statistics away{ cull({ 0.f, 1.5f, 1.5f }, { 0.f, 3.f, 3.f }) };
+		check(r, above.triangles_visible == triangle_count, "front facing clusters were culled");
+		check(r, below.triangles_visible < triangle_count / 2, "back facing clusters were not culled");
+		check(r, away.meshlets_visible == 0, "clusters behind the camera were not culled");
+		r.metrics.push_back({ "back_facing_visible_fraction", (double)below.triangles_visible / triangle_count });
+
+		// meshlet draws of every mesh orbiting around the grid, recorded with the empty pipeline
+		vulkan::meshlets::settings settings{};
+		settings.max_indices_per_frame = triangle_count * 3 * options.meshes;
+		if (!vulkan::meshlets::init(settings))
+		{
+			vulkan::meshlets::shutdown();
+			return r;
+		}
+
+		double cull_ms{ 0 };
+		uint64_t submitted{ 0 }, visible{ 0 };
+		for (uint32_t frame{ 0 }; frame < options.frames; ++frame)
+		{
+			core::begin_frame();
+			vulkan::meshlets::begin_frame();
+			VkCommandBuffer command_buffer{ core::get_command_buffer() };
+			begin_render_pass(command_buffer);
+			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context.pipelines[0]);
+
+			const float angle{ frame * 0.05f };
+			const glm::vec3 eye{ 1.5f * std::cos(angle), 1.5f * std::sin(angle * 0.7f), 1.5f * std::sin(angle) };
+			const geometry::culling::frustum frustum{ geometry::culling::extract_frustum(projection * look_at(eye, glm::vec3{ 0.f })) };
+			start = clock::now();
+			for (const geometry::mesh_asset& asset : assets)
+				check(r, vulkan::meshlets::draw(command_buffer, asset.meshlets, glm::mat4{ 1.f }, frustum, eye), "meshlet draw");
+			cull_ms += elapsed_ms(start);
+
+			vkCmdEndRenderPass(command_buffer);
+			end_frame(command_buffer);
+			submitted += vulkan::meshlets::get_frame_statistics().triangles_submitted;
+			visible += vulkan::meshlets::get_frame_statistics().triangles_visible;
+		}
+		vkDeviceWaitIdle(core::get_logical_device());
+		vulkan::meshlets::shutdown();
+
+		r.metrics.push_back({ "cull_ms_per_frame", options.frames ? cull_ms / options.frames : 0 });
+		r.metrics.push_back({ "visible_triangle_fraction", submitted ? (double)visible / submitted : 0 });
+		return r;
+	}
+
+	// copies size bytes of a device buffer with transfer source usage into out_bytes, waits for the copy
+	bool read_buffer(VkBuffer buffer, VkDeviceSize size, std::vector<uint8_t>& out_bytes)
+	{
+		memory::buffer staging{};
+		if (!memory::create_buffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+								   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging))
+			return false;
+
+		VkCommandBuffer command_buffer{ core::begin_single_time_commands() };
+		const VkBufferCopy region{ 0, 0, size };
+		vkCmdCopyBuffer(command_buffer, buffer, staging.buffer, 1, &region);
+		core::end_single_time_commands(command_buffer);
+
+		out_bytes.resize(size);
+		memcpy(out_bytes.data(), staging.mapped, size);
+		memory::destroy_buffer(staging);
+		return true;
+	}
+
+	// live gpu particles that have no match among the cpu simulator's. both sides spawn from the same seeds and
+	// integrate the same way, only their slot order differs, so both are sorted by age and lifetime and walked together.
+	// fused multiply adds on the gpu can kill a particle a step apart, each of those counts once
+	uint32_t compare_particles(const geometry::particles::simulator& simulator, std::vector<geometry::particles::particle>& gpu)
+	{
+		std::vector<geometry::particles::particle> cpu(simulator.size());
+		for (uint32_t i{ 0 }; i < simulator.size(); ++i)
+			cpu[i] = simulator.get(i);
+
+		auto less = [](const geometry::particles::particle& a, const geometry::particles::particle& b) {
+			return a.age != b.age ? a.age < b.age : a.lifetime < b.lifetime;
+		};
+		std::sort(cpu.begin(), cpu.end(), less);
+		std::sort(gpu.begin(), gpu.end(), less);
+
+		auto close = [](float a, float b) { return std::abs(a - b) <= 1e-3f * (1.f + std::abs(a)); };
+		auto same = [&close](const geometry::particles::particle& a, const geometry::particles::particle& b) {
+			return a.age == b.age && close(a.lifetime, b.lifetime) && close(a.position.x, b.position.x) && close(a.position.y, b.position.y) &&
+				   close(a.position.z, b.position.z) && close(a.velocity.x, b.velocity.x) && close(a.velocity.y, b.velocity.y) &&
+				   close(a.velocity.z, b.velocity.z);
+		};
+
+		uint32_t mismatches{ 0 };
+		size_t c{ 0 }, g{ 0 };
+		while (c < cpu.size() && g < gpu.size())
+		{
+			if (same(cpu[c], gpu[g]))
+			{
+				++c;
+				++g;
+				continue;
+			}
+
+			++mismatches;
+			if (less(cpu[c], gpu[g]))
+				++c;
+			else
+				++g;
+		}
+		return mismatches + (uint32_t)(cpu.size() - c + gpu.size() - g);
+	}
+
+	// --particles kept alive by an emitter that outpaces their lifetime, simulated and sorted with the cpu fallback
+	// and, when the compute shaders are available, on the gpu. the gpu particles are read back after the last frame
+	// and checked against the cpu ones. samples are the cpu simulation times
+	result particle_simulation(const config& options)
+	{
+		result r{ "particle_simulation" };
+		VkDevice device{ core::get_logical_device() };
+		constexpr float delta_time{ 1.f / 60.f };
+
+		geometry::particles::emitter source{};
+		source.radius = 5.f;
+		source.velocity_spread = 4.f;
+		source.min_lifetime = 2.f;
+		source.max_lifetime = 4.f;
+		const geometry::particles::forces forces{};
+		const uint32_t emit_count{ std::max(options.particles / 60, 1u) };
+		const glm::mat4 view{ yaw_view({ 0.f, 2.f, 30.f }, 0.f) };
+
+		geometry::particles::simulator simulator{ options.particles };
+		std::vector<uint32_t> order{};
+		double sort_ms{ 0 };
+		for (uint32_t frame{ 0 }; frame < options.frames; ++frame)
+		{
+			clock::time_point start{ clock::now() };
+			simulator.emit(source, emit_count, frame);
+			simulator.simulate(forces, delta_time);
+			r.samples_ms.push_back(elapsed_ms(start));
+
+			start = clock::now();
+			simulator.sort(view, order);
+			sort_ms += elapsed_ms(start);
+		}
+		r.metrics.push_back({ "cpu_particles", (double)simulator.size() });
+		r.metrics.push_back({ "cpu_sort_ms", options.frames ? sort_ms / options.frames : 0 });
+
+		vulkan::particles::settings settings{};
+		settings.capacity = options.particles;
+		// gpu timestamps around the whole simulate
+		gpu_timer timer{};
+		if (!vulkan::particles::init(settings) || !vulkan::particles::is_supported() || !create_gpu_timer(options.frames, timer))
+		{
+			vulkan::particles::shutdown();
+			return r;
+		}
+
+		double record_ms{ 0 };
+		for (uint32_t frame{ 0 }; frame < options.frames; ++frame)
+		{
+			core::begin_frame();
+			VkCommandBuffer command_buffer{ core::get_command_buffer() };
+
+			begin_gpu_timer(command_buffer, timer, frame);
+			const clock::time_point start{ clock::now() };
+			vulkan::particles::simulate(command_buffer, source, emit_count, forces, delta_time, view);
+			record_ms += elapsed_ms(start);
+			end_gpu_timer(command_buffer, timer, frame);
+
+			end_frame(command_buffer);
+		}
+		vkDeviceWaitIdle(device);
+
+		r.metrics.push_back({ "gpu_ms", read_gpu_timer_ms(timer) });
+		r.metrics.push_back({ "gpu_record_ms", record_ms / options.frames });
+		r.metrics.push_back({ "gpu_dispatches", (double)vulkan::particles::get_statistics().dispatches });
+
+		// both ran options.frames steps with seeds 0 and up
+		std::vector<uint8_t> counter_bytes{}, alive_bytes{}, particle_bytes{};
+		const VkDeviceSize capacity{ settings.capacity };
+		if (check(r, read_buffer(vulkan::particles::get_counter_buffer(), 4 * sizeof(uint32_t), counter_bytes) &&
+					 read_buffer(vulkan::particles::get_alive_buffer(), capacity * 2 * sizeof(uint32_t), alive_bytes) &&
+					 read_buffer(vulkan::particles::get_particle_buffer(), capacity * sizeof(geometry::particles::particle), particle_bytes),
+				  "particle readback"))
+		{
+			const uint32_t* counters{ reinterpret_cast<const uint32_t*>(counter_bytes.data()) };
+			const uint32_t list{ vulkan::particles::get_current_alive_list() };
+			const uint32_t alive_count{ counters[list] };
+			const uint32_t dead_count{ counters[2] };
+			check(r, alive_count <= capacity && alive_count + dead_count == capacity, "gpu alive and dead counts don't add up to the capacity");
+
+			std::vector<geometry::particles::particle> gpu{};
+			const uint32_t* alive{ reinterpret_cast<const uint32_t*>(alive_bytes.data()) + list * capacity };
+			const auto* particles{ reinterpret_cast<const geometry::particles::particle*>(particle_bytes.data()) };
+			for (uint32_t i{ 0 }; i < std::min<VkDeviceSize>(alive_count, capacity); ++i)
+			{
+				if (check(r, alive[i] < capacity, "gpu alive list index out of range"))
+					gpu.push_back(particles[alive[i]]);
+			}
+
+			const uint32_t mismatches{ compare_particles(simulator, gpu) };
+			r.metrics.push_back({ "gpu_particles", (double)alive_count });
+			r.metrics.push_back({ "gpu_cpu_mismatches", (double)mismatches });
+			check(r, mismatches <= std::max(simulator.size() / 1000, 4u), "gpu particles differ from the cpu simulator");
+		}
+
+		destroy_gpu_timer(timer);
+		vulkan::particles::shutdown();
+		return r;
+	}
+
+	// joint palettes and gpu skinning over a sweep of character counts up to --characters, every character a 4096 vertex
+	// tube bent along a 32 joint chain. samples are the palette times at the largest count, the sweep is reported as metrics
+	result skinned_characters(const config& options)
+	{
+		result r{ "skinned_characters" };
+		VkDevice device{ core::get_logical_device() };
+		constexpr uint32_t joint_count{ 32 }, rings{ 128 }, ring_vertices{ 32 }, pose_variations{ 16 };
+
+		// a chain of joints one unit apart up +y, every vertex split between the two joints nearest to its ring
+		geometry::skinning::skeleton skeleton{};
+		for (uint32_t j{ 0 }; j < joint_count; ++j)
+		{
+			glm::mat4 inverse_bind{ 1.f };
+			inverse_bind[3] = glm::vec4{ 0.f, -(float)j, 0.f, 1.f };
+			skeleton.parents.push_back((int32_t)j - 1);
+			skeleton.inverse_bind.push_back(inverse_bind);
+		}
+
+		std::vector<geometry::skinning::skinned_vertex> vertices{};
+		for (uint32_t ring{ 0 }; ring < rings; ++ring)
+		{
+			const float height{ (float)ring * (joint_count - 1) / (rings - 1) };
+			const uint32_t joint{ std::min((uint32_t)height, joint_count - 2) };
+			const float blend{ height - (float)joint };
+			for (uint32_t i{ 0 }; i < ring_vertices; ++i)
+			{
+				const float angle{ 6.2831853f * i / ring_vertices };
+				geometry::skinning::skinned_vertex v{};
+				v.normal = glm::vec3{ std::cos(angle), 0.f, std::sin(angle) };
+				v.position = glm::vec3{ v.normal.x * 0.3f, height, v.normal.z * 0.3f };
+				v.uv = glm::vec2{ (float)i / ring_vertices, (float)ring / rings };
+				v.joints = geometry::skinning::pack_joints(joint, joint + 1, 0, 0);
+				v.weights = geometry::skinning::pack_weights({ 1.f - blend, blend, 0.f, 0.f });
+				vertices.push_back(v);
+			}
+		}
+
+		// a few bend variations shared by the characters, each joint turned a little around z relative to its parent
+		std::vector<glm::mat4> local_poses(pose_variations * joint_count, glm::mat4{ 1.f });
+		auto update_poses = [&](float time) {
+			for (uint32_t p{ 0 }; p < pose_variations; ++p)
+			{
+				for (uint32_t j{ 0 }; j < joint_count; ++j)
+				{
+					const float angle{ 0.05f * std::sin(time + p * 0.7f + j * 0.2f) };
+					glm::mat4& local{ local_poses[p * joint_count + j] };
+					local = glm::mat4{ 1.f };
+					local[0] = glm::vec4{ std::cos(angle), std::sin(angle), 0.f, 0.f };
+					local[1] = glm::vec4{ -std::sin(angle), std::cos(angle), 0.f, 0.f };
+					local[3] = glm::vec4{ 0.f, j ? 1.f : 0.f, 0.f, 1.f };
+				}
+			}
+		};
+
+		std::vector<uint32_t> counts{};
+		for (uint32_t count : { 100u, 250u, 500u, 1000u })
+		{
+			if (count < options.characters)
+				counts.push_back(count);
+		}
+		counts.push_back(options.characters);
+
+		// the output region is per frame slot, counts past the clamp only measure the palettes
+		constexpr uint64_t max_skinned_vertices{ 1 << 22 };
+		const uint64_t sweep_vertices{ std::min((uint64_t)options.characters * vertices.size(), max_skinned_vertices) };
+		const uint32_t gpu_characters{ (uint32_t)(sweep_vertices / vertices.size()) };
+		r.metrics.push_back({ "gpu_max_characters", (double)gpu_characters });
+
+		skinning::settings settings{};
+		settings.max_input_vertices = (uint32_t)vertices.size();
+		settings.max_output_vertices = gpu_characters * (uint32_t)vertices.size();
+		settings.max_joints = gpu_characters * joint_count;
+		settings.max_characters = gpu_characters;
+		uint32_t mesh{ skinning::invalid_mesh };
+		if (check(r, skinning::init(settings), "skinning init failed"))
+		{
+			mesh = skinning::add_mesh(vertices.data(), (uint32_t)vertices.size());
+			check(r, mesh != skinning::invalid_mesh, "skinned mesh does not fit the input buffer");
+		}
+
+		// gpu timestamps around the skinning dispatch
+		gpu_timer timer{};
+		if (mesh != skinning::invalid_mesh)
+			check(r, create_gpu_timer(options.frames, timer), "failed to create the gpu timer");
+
+		std::vector<geometry::skinning::pose> poses(options.characters);
+		std::vector<skinning::character> characters(options.characters);
+		std::vector<uint32_t> palette_offsets(options.characters), first_vertices(options.characters);
+		std::vector<geometry::skinning::joint_matrix> palettes((size_t)options.characters * joint_count);
+		for (uint32_t i{ 0 }; i < options.characters; ++i)
+		{
+			poses[i] = { &skeleton, local_poses.data() + (i % pose_variations) * joint_count };
+			characters[i] = { mesh, poses[i] };
+			palette_offsets[i] = i * joint_count;
+		}
+
+		for (uint32_t count : counts)
+		{
+			const bool gpu{ timer.query_pool && count <= gpu_characters };
+			bool skinned{ true };
+			double palette_total_ms{ 0 };
+			for (uint32_t frame{ 0 }; frame < options.frames; ++frame)
+			{
+				update_poses(frame / 60.f);
+
+				const clock::time_point start{ clock::now() };
+				geometry::skinning::compute_palettes(poses.data(), count, palette_offsets.data(), palettes.data());
+				const double palette_ms{ elapsed_ms(start) };
+				palette_total_ms += palette_ms;
+				if (count == options.characters)
+					r.samples_ms.push_back(palette_ms);
+
+				if (gpu)
+				{
+					core::begin_frame();
+					VkCommandBuffer command_buffer{ core::get_command_buffer() };
+					begin_gpu_timer(command_buffer, timer, frame);
+					skinned &= skinning::skin(command_buffer, characters.data(), count, first_vertices.data());
+					end_gpu_timer(command_buffer, timer, frame);
+					end_frame(command_buffer);
+				}
+			}
+			vkDeviceWaitIdle(device);
+			check(r, skinned, "skinning dispatch rejected the characters");
+
+			const std::string suffix{ "_" + std::to_string(count) };
+			const double frames{ (double)std::max(options.frames, 1u) };
+			r.metrics.push_back({ "palette_ms" + suffix, palette_total_ms / frames });
+
+			if (gpu)
+			{
+				const double gpu_ms{ read_gpu_timer_ms(timer) };
+				r.metrics.push_back({ "gpu_ms" + suffix, gpu_ms });
+				r.metrics.push_back({ "gpu_vertices_per_second" + suffix, gpu_ms > 0 ? count * vertices.size() / (gpu_ms / 1000.0) : 0 });
+			}
+		}
+
+		// single threaded reference of what the vertex shaders of every pass would otherwise repeat per character
+		std::vector<geometry::vertex> skinned(vertices.size());
+		const clock::time_point start{ clock::now() };
+		geometry::skinning::skin(vertices.data(), (uint32_t)vertices.size(), palettes.data(), skinned.data());
+		r.metrics.push_back({ "cpu_skin_ms_per_character", elapsed_ms(start) });
+		r.metrics.push_back({ "vertices_per_character", (double)vertices.size() });
+
+		destroy_gpu_timer(timer);
+		skinning::shutdown();
+		return r;
+	}
+
+	void write_json(std::ostream& out, const config& options, const std::vector<result>& results)
+	{
+		out << "{\n";
+		write_device_json(out);
+		out << "  \"config\": { \"frames\": " << options.frames << ", \"draws\": " << options.draws
+			<< ", \"descriptor_sets\": " << options.descriptor_sets << ", \"pipelines\": " << options.pipelines
+			<< ", \"textures\": " << options.textures << ", \"texture_size\": " << options.texture_size
+			<< ", \"uploads\": " << options.uploads << ", \"upload_size_mb\": " << options.upload_size_mb
+			<< ", \"resizes\": " << options.resizes << ", \"lights\": " << options.lights
+			<< ", \"static_objects\": " << options.static_objects << ", \"dynamic_objects\": " << options.dynamic_objects
+			<< ", \"particles\": " << options.particles << ", \"characters\": " << options.characters
+			<< ", \"meshes\": " << options.meshes << ", \"seed\": " << options.seed << " },\n";
+		write_results_json(out, results);
+		out << "}\n";
+	}
+
+	const std::pair<const char*, std::function<result(const config&)>> scenarios[]{
+		{ "frame_overhead", frame_overhead }, { "draws", draws }, { "cached_draws", cached_draws }, { "descriptor_churn", descriptor_churn },
+		{ "pipeline_creation", pipeline_creation }, { "texture_uploads", texture_uploads },
+		{ "buffer_uploads", buffer_uploads }, { "asset_churn", asset_churn }, { "resize_storm", resize_storm }, { "light_binning", light_binning },
+		{ "scene_bvh", scene_bvh }, { "particle_simulation", particle_simulation },
+		{ "skinned_characters", skinned_characters }, { "mesh_import", mesh_import }
+	};
+
+	void print_usage()
+	{
+		std::cerr << "usage: RendererBenchmark [--output results.json] [--scenario name] [--frames n] [--draws n] [--descriptor-sets n]\n"
+					 "                         [--pipelines n] [--textures n] [--texture-size n] [--uploads n] [--upload-size-mb n]\n"
+					 "                         [--resizes n] [--lights n] [--static-objects n] [--dynamic-objects n] [--particles n]\n"
+					 "                         [--characters n] [--meshes n] [--seed n]\n"
+					 "counts must be at least 1, scenarios:";
+		for (const auto& scenario : scenarios)
+			std::cerr << " " << scenario.first;
+		std::cerr << "\n";
+	}
+
+	bool parse_arguments(int argc, char** argv, config& options)
+	{
+		const std::pair<const char*, uint32_t*> counts[]{
+			{ "--frames", &options.frames }, { "--draws", &options.draws }, { "--descriptor-sets", &options.descriptor_sets },
+			{ "--pipelines", &options.pipelines }, { "--textures", &options.textures }, { "--texture-size", &options.texture_size },
+			{ "--uploads", &options.uploads }, { "--upload-size-mb", &options.upload_size_mb }, { "--resizes", &options.resizes },
+			{ "--lights", &options.lights }, { "--static-objects", &options.static_objects },
+			{ "--dynamic-objects", &options.dynamic_objects }, { "--particles", &options.particles },
+			{ "--characters", &options.characters }, { "--meshes", &options.meshes }, { "--seed", &options.seed }
+		};
+
+		for (int i{ 1 }; i < argc; ++i)
+		{
+			const std::string argument{ argv[i] };
+			if (i + 1 >= argc)
+			{
+				std::cerr << "missing value for " << argument << "\n";
+				print_usage();
+				return false;
+			}
+
+			const char* value{ argv[++i] };
+			if (argument == "--output")
+			{
+				options.output = value;
+				continue;
+			}
+			if (argument == "--scenario")
+			{
+				options.scenario = value;
+				if (std::none_of(std::begin(scenarios), std::end(scenarios), [&](const auto& scenario) { return options.scenario == scenario.first; }))
+				{
+					std::cerr << "unknown scenario " << value << "\n";
+					print_usage();
+					return false;
+				}
+				continue;
+			}
+
+			auto count = std::find_if(std::begin(counts), std::end(counts), [&](const auto& c) { return argument == c.first; });
+			if (count == std::end(counts))
+			{
+				std::cerr << "unknown argument " << argument << "\n";
+				print_usage();
+				return false;
+			}
+			if (!parse_count(value, *count->second))
+			{
+				std::cerr << argument << " expects a whole number, got " << value << "\n";
+				print_usage();
+				return false;
+			}
+			// zero sized pools, buffers and sweeps are invalid vulkan usage, only the seed may be 0
+			if (*count->second == 0 && count->second != &options.seed)
+			{
+				std::cerr << argument << " must be at least 1\n";
+				print_usage();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	config options{};
+	if (!parse_arguments(argc, argv, options))
+		return 1;
+
+	if (!vulkan::core::init(nullptr))
+	{
+		std::cerr << "failed to initialize a headless vulkan device!\n";
+		return 1;
+	}
+
+	// progress goes to stderr, stdout only carries the json when there is no --output
+	std::cerr << "running on " << vulkan::core::get_physical_device_properties().deviceName << "\n";
+
+	if (!create_draw_context())
+	{
+		std::cerr << "failed to create the benchmark pipelines!\n";
+		destroy_draw_context();
+		vulkan::core::shutdown();
+		return 1;
+	}
+
+	std::vector<result> results{};
+	uint32_t failed_checks{ 0 };
+	for (const auto& [name, run] : scenarios)
+	{
+		if (!options.scenario.empty() && options.scenario != name)
+			continue;
+
+		std::cerr << "running " << name << "...\n";
+		results.push_back(run(options));
+		failed_checks += results.back().failed_checks;
+	}
+
+	std::ostringstream json{};
+	write_json(json, options, results);
+
+	if (options.output.empty())
+	{
+		std::cout << json.str();
+	}
+	else
+	{
+		std::ofstream file{ options.output };
+		file << json.str();
+		if (!file)
+			std::cerr << "failed to write " << options.output << "!\n";
+	}
+
+	destroy_draw_context();
+	vulkan::core::shutdown();
+	return failed_checks ? 1 : 0;
+}
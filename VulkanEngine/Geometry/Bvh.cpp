@@ -0,0 +1,735 @@
+#include "Bvh.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+
+namespace renderer::geometry::bvh
+{
+	namespace
+	{
+		static_assert(sizeof(scene::node) == 32);
+
+		constexpr uint32_t max_bins{ 32 };
+		constexpr uint32_t stack_size{ 128 };
+		// deeper nodes split at the median, which ends after at most 32 more levels, so the traversal stack never fills
+		constexpr uint32_t max_sah_depth{ 64 };
+		static_assert(max_sah_depth + 32 + 1 <= stack_size);
+		constexpr float traversal_cost{ 1.f };	// relative to one object test
+
+		enum class frustum_result
+		{
+			outside,
+			intersecting,
+			inside,
+		};
+
+		using clock = std::chrono::steady_clock;
+
+		double elapsed_ms(clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		}
+
+		void grow(aabb& box, const aabb& other)
+		{
+			box.min = glm::vec3{ std::min(box.min.x, other.min.x), std::min(box.min.y, other.min.y), std::min(box.min.z, other.min.z) };
+			box.max = glm::vec3{ std::max(box.max.x, other.max.x), std::max(box.max.y, other.max.y), std::max(box.max.z, other.max.z) };
+		}
+
+		void grow(aabb& box, const glm::vec3& p)
+		{
+			box.min = glm::vec3{ std::min(box.min.x, p.x), std::min(box.min.y, p.y), std::min(box.min.z, p.z) };
+			box.max = glm::vec3{ std::max(box.max.x, p.x), std::max(box.max.y, p.y), std::max(box.max.z, p.z) };
+		}
+
+		float half_area(const glm::vec3& min, const glm::vec3& max)
+		{
+			const glm::vec3 e{ max - min };
+			if (e.x < 0.f || e.y < 0.f || e.z < 0.f)
+				return 0.f;
+			return e.x * e.y + e.y * e.z + e.z * e.x;
+		}
+
+		glm::vec3 centroid(const aabb& box)
+		{
+			return (box.min + box.max) * 0.5f;
+		}
+
+		frustum_result test_frustum(const culling::frustum& f, const glm::vec3& min, const glm::vec3& max)
+		{
+			frustum_result result{ frustum_result::inside };
+			for (const glm::vec4& plane : f.planes)
+			{
+				// the box corners furthest along and against the plane normal
+				const glm::vec3 positive{ plane.x >= 0.f ? max.x : min.x, plane.y >= 0.f ? max.y : min.y, plane.z >= 0.f ? max.z : min.z };
+				const glm::vec3 negative{ plane.x >= 0.f ? min.x : max.x, plane.y >= 0.f ? min.y : max.y, plane.z >= 0.f ? min.z : max.z };
+				if (plane.x * positive.x + plane.y * positive.y + plane.z * positive.z + plane.w < 0.f)
+					return frustum_result::outside;
+				if (plane.x * negative.x + plane.y * negative.y + plane.z * negative.z + plane.w < 0.f)
+					result = frustum_result::intersecting;
+			}
+			return result;
+		}
+
+		bool test_sphere(const glm::vec3& center, float radius_squared, const glm::vec3& min, const glm::vec3& max)
+		{
+			float distance_squared{ 0.f };
+			for (int i{ 0 }; i < 3; ++i)
+			{
+				const float v{ std::clamp(center[i], min[i], max[i]) - center[i] };
+				distance_squared += v * v;
+			}
+			return distance_squared <= radius_squared;
+		}
+
+		// slab test, entry distance or FLT_MAX when missed
+		float intersect_ray(const glm::vec3& origin, const glm::vec3& inverse_direction, float max_distance, const glm::vec3& min, const glm::vec3& max)
+		{
+			float t_min{ 0.f }, t_max{ max_distance };
+			for (int i{ 0 }; i < 3; ++i)
+			{
+				float t0{ (min[i] - origin[i]) * inverse_direction[i] };
+				float t1{ (max[i] - origin[i]) * inverse_direction[i] };
+				if (t0 > t1)
+					std::swap(t0, t1);
+				t_min = std::max(t_min, t0);
+				t_max = std::min(t_max, t1);
+			}
+			return t_min <= t_max ? t_min : FLT_MAX;
+		}
+
+		// state shared by the jobs of one build
+		struct builder
+		{
+			const aabb*					bounds;
+			const settings&				build_settings;
+			std::vector<glm::vec3>		centroids;
+			std::vector<uint32_t>		order;		// permutation of the bounds indices, leaves reference ranges of it
+			std::vector<scene::node>&	nodes;
+			std::atomic<uint32_t>		node_count{ 1 };
+
+			void make_leaf(scene::node& n, uint32_t begin, uint32_t end)
+			{
+				n.first = begin;
+				n.count = end - begin;
+			}
+
+			void build(uint32_t node_index, uint32_t begin, uint32_t end, uint32_t depth)
+			{
+				scene::node& n{ nodes[node_index] };
+				aabb box{};
+				aabb centroid_box{};
+				for (uint32_t i{ begin }; i < end; ++i)
+				{
+					grow(box, bounds[order[i]]);
+					grow(centroid_box, centroids[order[i]]);
+				}
+				n.min = box.min;
+				n.max = box.max;
+
+				const uint32_t count{ end - begin };
+				if (count <= std::max(build_settings.max_leaf_size, 1u))
+				{
+					make_leaf(n, begin, end);
+					return;
+				}
+
+				// binned sah over all three axes
+				const uint32_t bin_count{ std::clamp(build_settings.sah_bins, 2u, max_bins) };
+				float best_cost{ FLT_MAX };
+				int best_axis{ -1 };
+				uint32_t best_split{ 0 };
+				const glm::vec3 extent{ centroid_box.max - centroid_box.min };
+
+				for (int axis{ 0 }; axis < 3 && depth < max_sah_depth; ++axis)
+				{
+					if (extent[axis] <= 0.f)
+						continue;
+
+					aabb bin_bounds[max_bins]{};
+					uint32_t bin_counts[max_bins]{};
+					const float scale{ bin_count / extent[axis] };
+					for (uint32_t i{ begin }; i < end; ++i)
+					{
+						const uint32_t bin{ std::min((uint32_t)((centroids[order[i]][axis] - centroid_box.min[axis]) * scale), bin_count - 1) };
+						++bin_counts[bin];
+						grow(bin_bounds[bin], bounds[order[i]]);
+					}
+
+					// sweep from the right, then evaluate every plane from the left
+					float right_area[max_bins]{};
+					uint32_t right_count[max_bins]{};
+					aabb right{};
+					uint32_t right_sum{ 0 };
+					for (uint32_t b{ bin_count - 1 }; b > 0; --b)
+					{
+						grow(right, bin_bounds[b]);
+						right_sum += bin_counts[b];
+						right_area[b] = half_area(right.min, right.max);
+						right_count[b] = right_sum;
+					}
+
+					aabb left{};
+					uint32_t left_sum{ 0 };
+					for (uint32_t b{ 0 }; b < bin_count - 1; ++b)
+					{
+						grow(left, bin_bounds[b]);
+						left_sum += bin_counts[b];
+						const float cost{ half_area(left.min, left.max) * left_sum + right_area[b + 1] * right_count[b + 1] };
+						if (left_sum && right_count[b + 1] && cost < best_cost)
+						{
+							best_cost = cost;
+							best_axis = axis;
+							best_split = b + 1;
+						}
+					}
+				}
+
+				const float parent_area{ half_area(box.min, box.max) };
+				const float split_cost{ parent_area > 0.f ? traversal_cost + best_cost / parent_area : FLT_MAX };
+				uint32_t middle{ begin };
+				if (best_axis >= 0 && (split_cost < (float)count || count > build_settings.max_leaf_size * 4))
+				{
+					const float scale{ bin_count / extent[best_axis] };
+					const float axis_min{ centroid_box.min[best_axis] };
+					middle = (uint32_t)(std::partition(order.begin() + begin, order.begin() + end, [&](uint32_t i) {
+						return std::min((uint32_t)((centroids[i][best_axis] - axis_min) * scale), bin_count - 1) < best_split;
+					}) - order.begin());
+				}
+				else if (count > build_settings.max_leaf_size * 4 || depth >= max_sah_depth)
+				{
+					// all centroids coincide or the tree is too deep, an even split still keeps the leaves small
+					middle = begin + count / 2;
+				}
+				else
+				{
+					make_leaf(n, begin, end);
+					return;
+				}
+
+				const uint32_t left_index{ node_count.fetch_add(2) };
+				n.first = left_index;
+				n.count = 0;
+
+				if (count > build_settings.parallel_build_threshold)
+				{
+					jobs::parallel_for(2, [&](uint32_t i) {
+						if (i == 0)
+							build(left_index, begin, middle, depth + 1);
+						else
+							build(left_index + 1, middle, end, depth + 1);
+					});
+				}
+				else
+				{
+					build(left_index, begin, middle, depth + 1);
+					build(left_index + 1, middle, end, depth + 1);
+				}
+			}
+		};
+
+	} // anonymous namespace
+
+	void build_tree(const aabb* bounds, const uint32_t* objects, uint32_t count, const settings& settings, scene::tree& out_tree)
+	{
+		out_tree.nodes.clear();
+		out_tree.objects.clear();
+		out_tree.build_cost = 0;
+		if (!count)
+			return;
+
+		out_tree.nodes.resize((size_t)count * 2);
+		builder b{ bounds, settings, {}, {}, out_tree.nodes };
+		b.centroids.resize(count);
+		b.order.resize(count);
+		for (uint32_t i{ 0 }; i < count; ++i)
+		{
+			b.centroids[i] = centroid(bounds[i]);
+			b.order[i] = i;
+		}
+
+		b.build(0, 0, count, 0);
+		out_tree.nodes.resize(b.node_count);
+
+		out_tree.objects.resize(count);
+		for (uint32_t i{ 0 }; i < count; ++i)
+			out_tree.objects[i] = objects[b.order[i]];
+		out_tree.build_cost = get_sah_cost(out_tree);
+	}
+
+	float get_sah_cost(const scene::tree& t)
+	{
+		if (t.nodes.empty())
+			return 0.f;
+
+		const float root_area{ half_area(t.nodes[0].min, t.nodes[0].max) };
+		if (root_area <= 0.f)
+			return 0.f;
+
+		float cost{ 0.f };
+		for (const scene::node& n : t.nodes)
+		{
+			const float area{ half_area(n.min, n.max) };
+			cost += n.count ? area * n.count : area * traversal_cost;
+		}
+		return cost / root_area;
+	}
+
+	scene::scene(const settings& settings)
+		: _settings{ settings }
+	{
+	}
+
+	scene::~scene()
+	{
+		for (auto* task : { _static_build.get(), _dynamic_build.get() })
+		{
+			if (task && task->active)
+				task->future.wait();
+		}
+	}
+
+	uint32_t scene::insert(const aabb& bounds, bool dynamic)
+	{
+		uint32_t object{ (uint32_t)_bounds.size() };
+		if (!_free_ids.empty())
+		{
+			object = _free_ids.back();
+			_free_ids.pop_back();
+		}
+		else
+		{
+			_bounds.emplace_back();
+			_membership.emplace_back();
+			_pending_slots.emplace_back();
+		}
+
+		_bounds[object] = bounds;
+		_membership[object] = dynamic ? membership::pending_dynamic : membership::pending_static;
+		push_pending(object);
+		return object;
+	}
+
+	void scene::update(uint32_t object, const aabb& bounds)
+	{
+		assert(object < _bounds.size() && _membership[object] != membership::none);
+		_bounds[object] = bounds;
+
+		membership& m{ _membership[object] };
+		if (m == membership::static_tree)
+		{
+			// its static tree leaf keeps the old bounds, the object is skipped there from now on
+			m = membership::pending_dynamic;
+			push_pending(object);
+			++_static_stale;
+		}
+		else if (m == membership::pending_static)
+		{
+			m = membership::pending_dynamic;
+		}
+	}
+
+	void scene::remove(uint32_t object)
+	{
+		assert(object < _bounds.size() && _membership[object] != membership::none);
+		membership& m{ _membership[object] };
+		if (m == membership::static_tree)
+			++_static_stale;
+		else if (m == membership::dynamic_tree)
+			++_dynamic_stale;
+		else
+			erase_pending(object);
+
+		// trees skip objects that are not theirs, the id can be reused right away
+		m = membership::none;
+		const bool building{ (_static_build && _static_build->active) || (_dynamic_build && _dynamic_build->active) };
+		(building ? _deferred_ids : _free_ids).push_back(object);
+	}
+
+	void scene::start_build(bool dynamic, bool background)
+	{
+		std::unique_ptr<build_task>& task{ dynamic ? _dynamic_build : _static_build };
+		if (!task)
+			task = std::make_unique<build_task>();
+		assert(!task->active);
+
+		// snapshot the objects, the scene keeps changing while the build runs
+		const membership tree_kind{ dynamic ? membership::dynamic_tree : membership::static_tree };
+		const membership pending_kind{ dynamic ? membership::pending_dynamic : membership::pending_static };
+		task->objects.clear();
+		task->bounds.clear();
+		for (uint32_t object{ 0 }; object < (uint32_t)_membership.size(); ++object)
+		{
+			if (_membership[object] == tree_kind || _membership[object] == pending_kind)
+			{
+				task->objects.push_back(object);
+				task->bounds.push_back(_bounds[object]);
+			}
+		}
+
+		build_task* t{ task.get() };
+		const settings build_settings{ _settings };
+		auto run = [t, build_settings]() {
+			const clock::time_point start{ clock::now() };
+			build_tree(t->bounds.data(), t->objects.data(), (uint32_t)t->objects.size(), build_settings, t->result);
+			t->build_ms = elapsed_ms(start);
+		};
+
+		t->active = true;
+		if (background)
+		{
+			t->future = jobs::submit(run);
+		}
+		else
+		{
+			run();
+			std::promise<void> done{};
+			done.set_value();
+			t->future = done.get_future();
+		}
+		++_statistics.rebuilds;
+	}
+
+	void scene::finish_build(bool dynamic)
+	{
+		build_task& task{ dynamic ? *_dynamic_build : *_static_build };
+		task.future.get();
+		task.active = false;
+
+		tree& target{ dynamic ? _dynamic_tree : _static_tree };
+		std::swap(target, task.result);
+
+		// objects that changed state during the build stay skipped by the new tree
+		const membership tree_kind{ dynamic ? membership::dynamic_tree : membership::static_tree };
+		const membership pending_kind{ dynamic ? membership::pending_dynamic : membership::pending_static };
+		for (uint32_t object : target.objects)
+		{
+			if (_membership[object] == pending_kind)
+				_membership[object] = tree_kind;
+		}
+
+		// stale count of the new tree: its objects that were removed or moved out since the snapshot
+		uint32_t stale{ 0 };
+		for (uint32_t object : target.objects)
+			stale += _membership[object] != tree_kind;
+		(dynamic ? _dynamic_stale : _static_stale) = stale;
+		(dynamic ? _statistics.dynamic_build_ms : _statistics.static_build_ms) = task.build_ms;
+
+		uint32_t kept{ 0 };
+		for (uint32_t object : _pending)
+		{
+			const membership m{ _membership[object] };
+			if (m == membership::pending_static || m == membership::pending_dynamic)
+			{
+				_pending_slots[object] = kept;
+				_pending[kept++] = object;
+			}
+		}
+		_pending.resize(kept);
+
+		// keep the swapped out tree's memory for the next build
+		task.result.nodes.clear();
+		task.result.objects.clear();
+
+		if (dynamic)
+			refit_dynamic();
+		release_deferred_ids();
+	}
+
+	void scene::push_pending(uint32_t object)
+	{
+		_pending_slots[object] = (uint32_t)_pending.size();
+		_pending.push_back(object);
+	}
+
+	void scene::erase_pending(uint32_t object)
+	{
+		const uint32_t slot{ _pending_slots[object] };
+		assert(slot < _pending.size() && _pending[slot] == object);
+		_pending[slot] = _pending.back();
+		_pending_slots[_pending[slot]] = slot;
+		_pending.pop_back();
+	}
+
+	void scene::release_deferred_ids()
+	{
+		const bool building{ (_static_build && _static_build->active) || (_dynamic_build && _dynamic_build->active) };
+		if (building)
+			return;
+
+		_free_ids.insert(_free_ids.end(), _deferred_ids.begin(), _deferred_ids.end());
+		_deferred_ids.clear();
+	}
+
+	void scene::refit_dynamic()
+	{
+		tree& t{ _dynamic_tree };
+		if (t.nodes.empty())
+		{
+			_statistics.dynamic_quality = 1.f;
+			return;
+		}
+
+		// children are always allocated after their parent, so a reverse sweep visits them first
+		for (size_t i{ t.nodes.size() }; i-- > 0;)
+		{
+			node& n{ t.nodes[i] };
+			aabb box{};
+			if (n.count)
+			{
+				for (uint32_t j{ n.first }; j < n.first + n.count; ++j)
+					grow(box, _bounds[t.objects[j]]);
+			}
+			else
+			{
+				const node& left{ t.nodes[n.first] };
+				const node& right{ t.nodes[n.first + 1] };
+				grow(box, aabb{ left.min, left.max });
+				grow(box, aabb{ right.min, right.max });
+			}
+			n.min = box.min;
+			n.max = box.max;
+		}
+
+		_statistics.dynamic_quality = t.build_cost > 0.f ? get_sah_cost(t) / t.build_cost : 1.f;
+	}
+
+	void scene::build()
+	{
+		for (bool dynamic : { false, true })
+		{
+			const std::unique_ptr<build_task>& task{ dynamic ? _dynamic_build : _static_build };
+			if (task && task->active)
+				finish_build(dynamic);
+			start_build(dynamic, false);
+			finish_build(dynamic);
+		}
+		_statistics.refit_ms = 0;
+	}
+
+	void scene::refit()
+	{
+		for (bool dynamic : { false, true })
+		{
+			const std::unique_ptr<build_task>& task{ dynamic ? _dynamic_build : _static_build };
+			if (task && task->active && task->future.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+				finish_build(dynamic);
+		}
+
+		const clock::time_point start{ clock::now() };
+		refit_dynamic();
+		_statistics.refit_ms = elapsed_ms(start);
+
+		bool pending_static{ false }, pending_dynamic{ false };
+		for (uint32_t object : _pending)
+		{
+			pending_static |= _membership[object] == membership::pending_static;
+			pending_dynamic |= _membership[object] == membership::pending_dynamic;
+		}
+
+		const bool static_busy{ _static_build && _static_build->active };
+		const bool dynamic_busy{ _dynamic_build && _dynamic_build->active };
+		const bool static_degraded{ _static_stale > _static_tree.objects.size() * _settings.max_stale_fraction };
+		const bool dynamic_degraded{ _statistics.dynamic_quality > _settings.rebuild_threshold ||
+									 _dynamic_stale > _dynamic_tree.objects.size() * _settings.max_stale_fraction };
+
+		if (!static_busy && (pending_static || static_degraded))
+			start_build(false, true);
+		if (!dynamic_busy && (pending_dynamic || dynamic_degraded))
+			start_build(true, true);
+
+		_statistics.static_objects = (uint32_t)_static_tree.objects.size() - _static_stale;
+		_statistics.dynamic_objects = (uint32_t)_dynamic_tree.objects.size() - _dynamic_stale;
+		_statistics.pending_objects = (uint32_t)_pending.size();
+		_statistics.static_nodes = (uint32_t)_static_tree.nodes.size();
+		_statistics.dynamic_nodes = (uint32_t)_dynamic_tree.nodes.size();
+		_statistics.static_rebuilding = _static_build && _static_build->active;
+		_statistics.dynamic_rebuilding = _dynamic_build && _dynamic_build->active;
+	}
+
+	// node_test(min, max) returns 0 to skip, 1 to descend and 2 to accept the whole subtree without further tests.
+	// object_test(object, accepted) is called for every object of the tree that still belongs to it
+	template<typename visit_node, typename visit_object>
+	void scene::traverse(const tree& t, membership kind, visit_node&& node_test, visit_object&& object_test) const
+	{
+		if (t.nodes.empty())
+			return;
+
+		struct entry { uint32_t node; bool accepted; };
+		entry stack[stack_size];
+		uint32_t stack_top{ 0 };
+		stack[stack_top++] = { 0, false };
+
+		while (stack_top)
+		{
+			const entry e{ stack[--stack_top] };
+			const node& n{ t.nodes[e.node] };
+
+			bool accepted{ e.accepted };
+			if (!accepted)
+			{
+				const int result{ node_test(n.min, n.max) };
+				if (!result)
+					continue;
+				accepted = result == 2;
+			}
+
+			if (n.count)
+			{
+				for (uint32_t i{ n.first }; i < n.first + n.count; ++i)
+				{
+					const uint32_t object{ t.objects[i] };
+					if (_membership[object] == kind)
+						object_test(object, accepted);
+				}
+				continue;
+			}
+
+			assert(stack_top + 2 <= stack_size);
+			stack[stack_top++] = { n.first + 1, accepted };
+			stack[stack_top++] = { n.first, accepted };
+		}
+	}
+
+	void scene::query_frustum(const culling::frustum& f, std::vector<uint32_t>& out_objects) const
+	{
+		auto node_test = [&f](const glm::vec3& min, const glm::vec3& max) {
+			const frustum_result result{ test_frustum(f, min, max) };
+			return result == frustum_result::outside ? 0 : result == frustum_result::inside ? 2 : 1;
+		};
+		auto object_test = [&](uint32_t object, bool accepted) {
+			if (accepted || test_frustum(f, _bounds[object].min, _bounds[object].max) != frustum_result::outside)
+				out_objects.push_back(object);
+		};
+
+		traverse(_static_tree, membership::static_tree, node_test, object_test);
+		traverse(_dynamic_tree, membership::dynamic_tree, node_test, object_test);
+		for (uint32_t object : _pending)
+		{
+			const membership m{ _membership[object] };
+			if ((m == membership::pending_static || m == membership::pending_dynamic) && test_frustum(f, _bounds[object].min, _bounds[object].max) != frustum_result::outside)
+				out_objects.push_back(object);
+		}
+	}
+
+	void scene::query_sphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out_objects) const
+	{
+		const float radius_squared{ radius * radius };
+		auto node_test = [&](const glm::vec3& min, const glm::vec3& max) {
+			return test_sphere(center, radius_squared, min, max) ? 1 : 0;
+		};
+		auto object_test = [&](uint32_t object, bool) {
+			if (test_sphere(center, radius_squared, _bounds[object].min, _bounds[object].max))
+				out_objects.push_back(object);
+		};
+
+		traverse(_static_tree, membership::static_tree, node_test, object_test);
+		traverse(_dynamic_tree, membership::dynamic_tree, node_test, object_test);
+		for (uint32_t object : _pending)
+		{
+			const membership m{ _membership[object] };
+			if ((m == membership::pending_static || m == membership::pending_dynamic) && test_sphere(center, radius_squared, _bounds[object].min, _bounds[object].max))
+				out_objects.push_back(object);
+		}
+	}
+
+	ray_hit scene::raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, const ray_filter& filter) const
+	{
+		const glm::vec3 inverse_direction{ 1.f / direction.x, 1.f / direction.y, 1.f / direction.z };
+		ray_hit hit{};
+		hit.distance = max_distance;
+
+		auto test_object = [&](uint32_t object) {
+			float distance{ intersect_ray(origin, inverse_direction, hit.distance, _bounds[object].min, _bounds[object].max) };
+			if (distance == FLT_MAX)
+				return;
+			if (filter && !filter(object, distance))
+				return;
+			if (distance <= hit.distance)
+			{
+				hit.distance = distance;
+				hit.object = object;
+			}
+		};
+
+		// front to back, subtrees further than the closest hit so far are skipped
+		for (const auto& [t, kind] : { std::pair<const tree*, membership>{ &_static_tree, membership::static_tree }, { &_dynamic_tree, membership::dynamic_tree } })
+		{
+			if (t->nodes.empty())
+				continue;
+
+			uint32_t stack[stack_size];
+			uint32_t stack_top{ 0 };
+			stack[stack_top++] = 0;
+			while (stack_top)
+			{
+				const node& n{ t->nodes[stack[--stack_top]] };
+				if (intersect_ray(origin, inverse_direction, hit.distance, n.min, n.max) == FLT_MAX)
+					continue;
+
+				if (n.count)
+				{
+					for (uint32_t i{ n.first }; i < n.first + n.count; ++i)
+					{
+						if (_membership[t->objects[i]] == kind)
+							test_object(t->objects[i]);
+					}
+					continue;
+				}
+
+				const node& left{ t->nodes[n.first] };
+				const node& right{ t->nodes[n.first + 1] };
+				const float left_distance{ intersect_ray(origin, inverse_direction, hit.distance, left.min, left.max) };
+				const float right_distance{ intersect_ray(origin, inverse_direction, hit.distance, right.min, right.max) };
+
+				assert(stack_top + 2 <= stack_size);
+				if (left_distance <= right_distance)
+				{
+					if (right_distance != FLT_MAX)
+						stack[stack_top++] = n.first + 1;
+					if (left_distance != FLT_MAX)
+						stack[stack_top++] = n.first;
+				}
+				else
+				{
+					if (left_distance != FLT_MAX)
+						stack[stack_top++] = n.first;
+					stack[stack_top++] = n.first + 1;
+				}
+			}
+		}
+
+		for (uint32_t object : _pending)
+		{
+			const membership m{ _membership[object] };
+			if (m == membership::pending_static || m == membership::pending_dynamic)
+				test_object(object);
+		}
+
+		if (hit.object == invalid_object)
+			hit.distance = FLT_MAX;
+		return hit;
+	}
+
+	void scene::query_frustums(const culling::frustum* frustums, uint32_t count, std::vector<std::vector<uint32_t>>& out_objects) const
+	{
+		out_objects.resize(count);
+		jobs::parallel_for(count, [&](uint32_t i) {
+			out_objects[i].clear();
+			query_frustum(frustums[i], out_objects[i]);
+		});
+	}
+
+	void scene::raycast_batch(const glm::vec3* origins, const glm::vec3* directions, uint32_t count, float max_distance, ray_hit* out_hits) const
+	{
+		constexpr uint32_t rays_per_job{ 256 };
+		jobs::parallel_for((count + rays_per_job - 1) / rays_per_job, [&](uint32_t job) {
+			const uint32_t end{ std::min(count, (job + 1) * rays_per_job) };
+			for (uint32_t i{ job * rays_per_job }; i < end; ++i)
+				out_hits[i] = raycast(origins[i], directions[i], max_distance);
+		});
+	}
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include "ClusterCuller.h"
+
+#include <cfloat>
+#include <functional>
+#include <future>
+#include <memory>
+
+#include <glm/vec3.hpp>
+
+namespace renderer::geometry::bvh
+{
+	constexpr uint32_t invalid_object{ UINT32_MAX };
+
+	struct aabb
+	{
+		glm::vec3	min{ FLT_MAX };
+		glm::vec3	max{ -FLT_MAX };
+	};
+
+	struct ray_hit
+	{
+		uint32_t	object{ invalid_object };
+		float		distance{ FLT_MAX };
+	};
+
+	struct settings
+	{
+		uint32_t	max_leaf_size{ 4 };
+		uint32_t	sah_bins{ 16 };
+		// the dynamic tree is rebuilt in the background once refitting made its sah cost this much worse than after its build
+		float		rebuild_threshold{ 1.5f };
+		// removed objects still referenced by a tree, as a fraction of its objects, before it is rebuilt
+		float		max_stale_fraction{ 0.25f };
+		// subtrees with more objects than this are built on their own job
+		uint32_t	parallel_build_threshold{ 16384 };
+	};
+
+	struct statistics
+	{
+		uint32_t	static_objects{ 0 };	// in the static tree
+		uint32_t	dynamic_objects{ 0 };	// in the dynamic tree
+		uint32_t	pending_objects{ 0 };	// inserted or turned dynamic since the last build, tested linearly
+		uint32_t	static_nodes{ 0 };
+		uint32_t	dynamic_nodes{ 0 };
+		float		dynamic_quality{ 1.f };	// sah cost after the last refit relative to the cost after the build
+		double		refit_ms{ 0 };
+		double		static_build_ms{ 0 };
+		double		dynamic_build_ms{ 0 };
+		uint32_t	rebuilds{ 0 };
+		bool		static_rebuilding{ false };
+		bool		dynamic_rebuilding{ false };
+	};
+
+	// narrow phase for raycast: called for objects whose bounds the ray hits, returns the exact hit distance or false
+	using ray_filter = std::function<bool(uint32_t object, float& out_distance)>;
+
+	// object level scene index: a static tree built once with binned sah, and a dynamic tree that is refitted every frame
+	// and rebuilt in the background when it degrades. nodes are 32 bytes with both children stored next to each other.
+	// objects inserted or moved since the last build are kept in a small list that every query tests linearly.
+	class scene
+	{
+	public:
+		explicit scene(const settings& settings = {});
+		~scene();	// waits for background builds
+		scene(const scene&) = delete;
+		scene& operator=(const scene&) = delete;
+
+		uint32_t insert(const aabb& bounds, bool dynamic);
+		// static objects that move become dynamic
+		void update(uint32_t object, const aabb& bounds);
+		void remove(uint32_t object);
+
+		// builds both trees on the calling thread and the job system, e.g. after loading a level
+		void build();
+
+		// once per frame on the owning thread: takes over finished background builds, refits the dynamic tree and starts
+		// background builds for trees that degraded or have pending objects
+		void refit();
+
+		// queries only read, any number may run concurrently between calls that modify the scene
+		void query_frustum(const culling::frustum& f, std::vector<uint32_t>& out_objects) const;
+		void query_sphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out_objects) const;
+		// closest object whose bounds (or filter, when given) the ray hits. direction does not need to be normalized,
+		// distances are in units of its length
+		ray_hit raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, const ray_filter& filter = {}) const;
+
+		// one query per job
+		void query_frustums(const culling::frustum* frustums, uint32_t count, std::vector<std::vector<uint32_t>>& out_objects) const;
+		void raycast_batch(const glm::vec3* origins, const glm::vec3* directions, uint32_t count, float max_distance, ray_hit* out_hits) const;
+
+		[[nodiscard]] const aabb& get_bounds(uint32_t object) const { return _bounds[object]; }
+		[[nodiscard]] const statistics& get_statistics() const { return _statistics; }
+
+		struct node
+		{
+			glm::vec3	min;
+			uint32_t	first;		// leaf: first entry in objects, internal: left child, the right child follows it
+			glm::vec3	max;
+			uint32_t	count;		// objects in a leaf, 0 for internal nodes
+		};
+
+		struct tree
+		{
+			std::vector<node>		nodes;
+			std::vector<uint32_t>	objects;
+			float					build_cost{ 0 };
+		};
+
+	private:
+		enum class membership : uint8_t
+		{
+			none,
+			static_tree,
+			dynamic_tree,
+			pending_static,
+			pending_dynamic,
+		};
+
+		struct build_task
+		{
+			std::future<void>		future;
+			std::vector<uint32_t>	objects;
+			std::vector<aabb>		bounds;
+			tree					result;
+			double					build_ms{ 0 };
+			bool					active{ false };
+		};
+
+		void start_build(bool dynamic, bool background);
+		void finish_build(bool dynamic);
+		void refit_dynamic();
+		void release_deferred_ids();
+		void push_pending(uint32_t object);
+		void erase_pending(uint32_t object);
+
+		template<typename visit_node, typename visit_object>
+		void traverse(const tree& t, membership kind, visit_node&& node_test, visit_object&& object_test) const;
+
+		settings						_settings;
+		std::vector<aabb>				_bounds;
+		std::vector<membership>			_membership;
+		std::vector<uint32_t>			_free_ids;
+		std::vector<uint32_t>			_deferred_ids;		// removed while a build was running, reused afterwards
+		std::vector<uint32_t>			_pending;
+		std::vector<uint32_t>			_pending_slots;		// index in _pending of every pending object
+		tree							_static_tree;
+		tree							_dynamic_tree;
+		uint32_t						_static_stale{ 0 };
+		uint32_t						_dynamic_stale{ 0 };
+		std::unique_ptr<build_task>		_static_build;
+		std::unique_ptr<build_task>		_dynamic_build;
+		statistics						_statistics{};
+	};
+
+	// binned sah build over bounds, objects maps every bounds entry to the id stored in the tree
+	void build_tree(const aabb* bounds, const uint32_t* objects, uint32_t count, const settings& settings, scene::tree& out_tree);
+	// sah cost of the tree normalised by its root area, comparable between builds and refits of the same objects
+	float get_sah_cost(const scene::tree& t);
+}
@@ -0,0 +1,127 @@
+#include "ClusterCuller.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/geometric.hpp>
+
+namespace renderer::geometry::culling
+{
+	namespace
+	{
+		// below this the job system overhead is larger than the culling work
+		constexpr uint32_t parallel_meshlet_threshold{ 1024 };
+		constexpr uint32_t meshlets_per_job{ 256 };
+
+		glm::vec4 row(const glm::mat4& m, int i)
+		{
+			return glm::vec4{ m[0][i], m[1][i], m[2][i], m[3][i] };
+		}
+
+		glm::vec3 xyz(const glm::vec4& v)
+		{
+			return glm::vec3{ v.x, v.y, v.z };
+		}
+
+		glm::vec4 normalize_plane(const glm::vec4& p)
+		{
+			const float length{ glm::length(xyz(p)) };
+			return p / length;
+		}
+
+	} // anonymous namespace
+
+	frustum extract_frustum(const glm::mat4& view_projection)
+	{
+		const glm::vec4 r0{ row(view_projection, 0) };
+		const glm::vec4 r1{ row(view_projection, 1) };
+		const glm::vec4 r2{ row(view_projection, 2) };
+		const glm::vec4 r3{ row(view_projection, 3) };
+
+		frustum f{};
+		f.planes[0] = normalize_plane(r3 + r0);	// left
+		f.planes[1] = normalize_plane(r3 - r0);	// right
+		f.planes[2] = normalize_plane(r3 + r1);	// bottom
+		f.planes[3] = normalize_plane(r3 - r1);	// top
+		f.planes[4] = normalize_plane(r2);		// near, depth is [0, 1]
+		f.planes[5] = normalize_plane(r3 - r2);	// far
+		return f;
+	}
+
+	bool is_sphere_visible(const frustum& f, const glm::vec3& center, float radius)
+	{
+		for (const glm::vec4& plane : f.planes)
+		{
+			if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius)
+				return false;
+		}
+		return true;
+	}
+
+	void cull_meshlets(const meshlet_data& data, const glm::mat4& model, const frustum& f, const glm::vec3& camera_position,
+					   std::vector<uint32_t>& out_indices, cluster_statistics& stats)
+	{
+		const uint32_t meshlet_count{ (uint32_t)data.meshlets.size() };
+		if (!meshlet_count)
+			return;
+
+		// bounds are in object space, scale the radius by the largest axis scale
+		const float max_scale{ std::max({ glm::length(xyz(model[0])), glm::length(xyz(model[1])), glm::length(xyz(model[2])) }) };
+
+		auto transform_point = [&model](const glm::vec3& p) { return xyz(model * glm::vec4{ p, 1.f }); };
+
+		std::vector<uint8_t> visible(meshlet_count, 0);
+		auto test = [&](uint32_t i) {
+			const meshlet_bounds& bounds{ data.bounds[i] };
+			const glm::vec3 center{ transform_point(bounds.center) };
+			if (!is_sphere_visible(f, center, bounds.radius * max_scale))
+				return;
+
+			if (bounds.cone_cutoff < 1.f)
+			{
+				const glm::vec3 axis{ xyz(model * glm::vec4{ bounds.cone_axis, 0.f }) };
+				const glm::vec3 view{ transform_point(bounds.cone_apex) - camera_position };
+
+				// every triangle in the cluster faces away from the camera
+				if (glm::dot(view, axis) >= bounds.cone_cutoff * glm::length(view) * glm::length(axis))
+					return;
+			}
+
+			visible[i] = 1;
+		};
+
+		if (meshlet_count >= parallel_meshlet_threshold)
+		{
+			const uint32_t job_count{ (meshlet_count + meshlets_per_job - 1) / meshlets_per_job };
+			jobs::parallel_for(job_count, [&](uint32_t job) {
+				const uint32_t end{ std::min(meshlet_count, (job + 1) * meshlets_per_job) };
+				for (uint32_t i{ job * meshlets_per_job }; i < end; ++i)
+					test(i);
+			});
+		}
+		else
+		{
+			for (uint32_t i{ 0 }; i < meshlet_count; ++i)
+				test(i);
+		}
+
+		// compaction stays serial, the output order has to be deterministic
+		for (uint32_t i{ 0 }; i < meshlet_count; ++i)
+		{
+			const meshlet& m{ data.meshlets[i] };
+			++stats.meshlets_tested;
+			stats.triangles_submitted += m.triangle_count;
+			if (!visible[i])
+				continue;
+
+			++stats.meshlets_visible;
+			stats.triangles_visible += m.triangle_count;
+
+			const uint32_t* vertices{ &data.vertices[m.vertex_offset] };
+			const uint8_t* triangles{ &data.triangles[m.triangle_offset] };
+			for (uint32_t j{ 0 }; j < m.triangle_count * 3; ++j)
+				out_indices.push_back(vertices[triangles[j]]);
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "Meshlet.h"
+
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace renderer::geometry::culling
+{
+	struct frustum
+	{
+		glm::vec4 planes[6];	// normalized, xyz points inside
+	};
+
+	struct cluster_statistics
+	{
+		uint32_t meshlets_tested{ 0 };
+		uint32_t meshlets_visible{ 0 };
+		uint64_t triangles_submitted{ 0 };
+		uint64_t triangles_visible{ 0 };
+
+		cluster_statistics& operator+=(const cluster_statistics& other)
+		{
+			meshlets_tested += other.meshlets_tested;
+			meshlets_visible += other.meshlets_visible;
+			triangles_submitted += other.triangles_submitted;
+			triangles_visible += other.triangles_visible;
+			return *this;
+		}
+	};
+
+	// expects a zero-to-one depth range projection
+	frustum extract_frustum(const glm::mat4& view_projection);
+
+	bool is_sphere_visible(const frustum& f, const glm::vec3& center, float radius);
+
+	// frustum and backface cone test for every meshlet of an instance, survivors are appended to out_indices
+	// as a triangle list indexing the mesh vertex buffer. camera_position is in world space, the cone test assumes
+	// a uniformly scaled model matrix.
+	void cull_meshlets(const meshlet_data& data, const glm::mat4& model, const frustum& f, const glm::vec3& camera_position,
+					   std::vector<uint32_t>& out_indices, cluster_statistics& stats);
+}
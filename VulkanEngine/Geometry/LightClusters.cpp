@@ -0,0 +1,286 @@
+#include "LightClusters.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <glm/geometric.hpp>
+
+namespace renderer::geometry::lights
+{
+	namespace
+	{
+		// view space bounds of one light with the cluster range they touch, inclusive
+		struct light_bounds
+		{
+			glm::vec3	center{};
+			float		radius{ 0.f };
+			uint32_t	index{ 0 };
+			uint32_t	min_x{ 0 }, max_x{ 0 };
+			uint32_t	min_y{ 0 }, max_y{ 0 };
+		};
+
+		// lights overlapping one depth slice, binned into (cluster, light) pairs and then sorted by cluster
+		struct slice_bin
+		{
+			std::vector<uint32_t>	lights;		// into bounds
+			std::vector<uint64_t>	pairs;		// cluster << 32 | light index
+			std::vector<uint32_t>	counts;		// per cluster of the slice
+			std::vector<uint32_t>	indices;
+		};
+
+		// reused across calls so binning does not allocate once the scene has warmed up
+		std::vector<light_bounds>	bounds{};
+		std::vector<slice_bin>		slices{};
+
+		glm::vec3 transform_point(const glm::mat4& m, const glm::vec3& p)
+		{
+			return glm::vec3{ m[0][0] * p.x + m[1][0] * p.y + m[2][0] * p.z + m[3][0],
+							  m[0][1] * p.x + m[1][1] * p.y + m[2][1] * p.z + m[3][1],
+							  m[0][2] * p.x + m[1][2] * p.y + m[2][2] * p.z + m[3][2] };
+		}
+
+		// ndc x and y of a view space point, only for points in front of the camera
+		float project_x(const glm::mat4& projection, const glm::vec3& p)
+		{
+			return (projection[0][0] * p.x + projection[2][0] * p.z) / -p.z;
+		}
+
+		float project_y(const glm::mat4& projection, const glm::vec3& p)
+		{
+			return (projection[1][1] * p.y + projection[2][1] * p.z) / -p.z;
+		}
+
+		// smallest sphere around the cone of a spot light
+		void spot_bounds(const light& l, glm::vec3& out_center, float& out_radius)
+		{
+			const float cos_angle{ std::clamp(l.cos_outer_angle, 0.f, 1.f) };
+			if (cos_angle < 0.70710678f)
+			{
+				// wider than 90 degrees, the cap circle is the widest part
+				out_center = l.position + l.direction * (l.range * cos_angle);
+				out_radius = l.range * std::sqrt(1.f - cos_angle * cos_angle);
+			}
+			else
+			{
+				out_center = l.position + l.direction * (l.range * 0.5f / cos_angle);
+				out_radius = l.range * 0.5f / cos_angle;
+			}
+		}
+
+		uint32_t ndc_to_tile(float ndc, uint32_t extent, uint32_t tile_size, uint32_t tile_count)
+		{
+			const float pixel{ (ndc * 0.5f + 0.5f) * (float)extent };
+			if (pixel <= 0.f)
+				return 0;
+			return std::min((uint32_t)pixel / tile_size, tile_count - 1);
+		}
+
+		bool sphere_intersects_aabb(const glm::vec3& center, float radius, const glm::vec4& aabb_min, const glm::vec4& aabb_max)
+		{
+			float distance_squared{ 0.f };
+			for (int i{ 0 }; i < 3; ++i)
+			{
+				const float v{ center[i] };
+				if (v < aabb_min[i])
+					distance_squared += (aabb_min[i] - v) * (aabb_min[i] - v);
+				else if (v > aabb_max[i])
+					distance_squared += (v - aabb_max[i]) * (v - aabb_max[i]);
+			}
+			return distance_squared <= radius * radius;
+		}
+
+		void bin_slice(const cluster_grid& grid, uint32_t z, slice_bin& bin)
+		{
+			const uint32_t slice_size{ grid.width * grid.height };
+			const uint32_t slice_base{ z * slice_size };
+
+			bin.pairs.clear();
+			for (uint32_t b : bin.lights)
+			{
+				const light_bounds& l{ bounds[b] };
+				for (uint32_t y{ l.min_y }; y <= l.max_y; ++y)
+				{
+					for (uint32_t x{ l.min_x }; x <= l.max_x; ++x)
+					{
+						const uint32_t cluster{ x + y * grid.width };
+						if (sphere_intersects_aabb(l.center, l.radius, grid.aabb_min[slice_base + cluster], grid.aabb_max[slice_base + cluster]))
+							bin.pairs.push_back((uint64_t)cluster << 32 | l.index);
+					}
+				}
+			}
+
+			// counting sort by cluster, lights were visited in index order so each cluster stays ordered
+			bin.counts.assign(slice_size, 0);
+			for (uint64_t pair : bin.pairs)
+				++bin.counts[pair >> 32];
+
+			std::vector<uint32_t>& offsets{ bin.lights };	// no longer needed, reuse its storage
+			offsets.resize(slice_size);
+			uint32_t offset{ 0 };
+			for (uint32_t i{ 0 }; i < slice_size; ++i)
+			{
+				offsets[i] = offset;
+				offset += bin.counts[i];
+			}
+
+			bin.indices.resize(bin.pairs.size());
+			for (uint64_t pair : bin.pairs)
+				bin.indices[offsets[pair >> 32]++] = (uint32_t)pair;
+		}
+
+	} // anonymous namespace
+
+	void build_grid(const glm::mat4& projection, uint32_t extent_width, uint32_t extent_height, const cluster_settings& settings, cluster_grid& out_grid)
+	{
+		assert(extent_width && extent_height && settings.tile_size && settings.depth_slices);
+		assert(settings.near_depth > 0.f && settings.far_depth > settings.near_depth);
+		assert(projection[2][3] == -1.f);	// perspective only
+
+		cluster_grid& grid{ out_grid };
+		grid.width = (extent_width + settings.tile_size - 1) / settings.tile_size;
+		grid.height = (extent_height + settings.tile_size - 1) / settings.tile_size;
+		grid.depth = settings.depth_slices;
+		grid.extent_width = extent_width;
+		grid.extent_height = extent_height;
+		grid.settings = settings;
+		grid.aabb_min.resize(grid.cluster_count());
+		grid.aabb_max.resize(grid.cluster_count());
+
+		// view space x and y at depth 1 of every tile edge
+		std::vector<float> edge_x(grid.width + 1);
+		std::vector<float> edge_y(grid.height + 1);
+		for (uint32_t x{ 0 }; x <= grid.width; ++x)
+		{
+			const float ndc{ (float)std::min(x * settings.tile_size, extent_width) / (float)extent_width * 2.f - 1.f };
+			edge_x[x] = (ndc + projection[2][0]) / projection[0][0];
+		}
+		for (uint32_t y{ 0 }; y <= grid.height; ++y)
+		{
+			const float ndc{ (float)std::min(y * settings.tile_size, extent_height) / (float)extent_height * 2.f - 1.f };
+			edge_y[y] = (ndc + projection[2][1]) / projection[1][1];
+		}
+
+		const float depth_ratio{ settings.far_depth / settings.near_depth };
+		for (uint32_t z{ 0 }; z < grid.depth; ++z)
+		{
+			const float near_z{ settings.near_depth * std::pow(depth_ratio, (float)z / grid.depth) };
+			const float far_z{ settings.near_depth * std::pow(depth_ratio, (float)(z + 1) / grid.depth) };
+
+			for (uint32_t y{ 0 }; y < grid.height; ++y)
+			{
+				for (uint32_t x{ 0 }; x < grid.width; ++x)
+				{
+					// the tile frustum is widest at the far plane of the slice, its corners bound the cluster
+					const float x0{ std::min(edge_x[x], edge_x[x + 1]) }, x1{ std::max(edge_x[x], edge_x[x + 1]) };
+					const float y0{ std::min(edge_y[y], edge_y[y + 1]) }, y1{ std::max(edge_y[y], edge_y[y + 1]) };
+
+					const uint32_t i{ x + y * grid.width + z * grid.width * grid.height };
+					grid.aabb_min[i] = glm::vec4{ std::min(x0 * near_z, x0 * far_z), std::min(y0 * near_z, y0 * far_z), -far_z, 0.f };
+					grid.aabb_max[i] = glm::vec4{ std::max(x1 * near_z, x1 * far_z), std::max(y1 * near_z, y1 * far_z), -near_z, 0.f };
+				}
+			}
+		}
+	}
+
+	uint32_t get_depth_slice(const cluster_grid& grid, float view_depth)
+	{
+		if (view_depth <= grid.settings.near_depth)
+			return 0;
+
+		const float slice{ std::log(view_depth / grid.settings.near_depth) / std::log(grid.settings.far_depth / grid.settings.near_depth) * grid.depth };
+		return std::min((uint32_t)slice, grid.depth - 1);
+	}
+
+	void bin_lights(const cluster_grid& grid, const glm::mat4& view, const glm::mat4& projection, const light* lights, uint32_t light_count,
+					cluster_lights& out_clusters)
+	{
+		assert(grid.cluster_count() && (lights || !light_count));
+
+		const uint32_t slice_size{ grid.width * grid.height };
+		const cluster_settings& settings{ grid.settings };
+		const uint32_t extent_width{ grid.extent_width };
+		const uint32_t extent_height{ grid.extent_height };
+
+		slices.resize(grid.depth);
+		for (slice_bin& bin : slices)
+			bin.lights.clear();
+		bounds.clear();
+
+		// cheap per light setup, serial so lights land in their slices in index order
+		for (uint32_t i{ 0 }; i < light_count; ++i)
+		{
+			const light& l{ lights[i] };
+			glm::vec3 center{ l.position };
+			float radius{ l.range };
+			if (l.type == spot)
+				spot_bounds(l, center, radius);
+
+			light_bounds b{};
+			b.center = transform_point(view, center);
+			b.radius = radius;
+			b.index = i;
+
+			const float depth{ -b.center.z };
+			if (depth + radius < settings.near_depth || depth - radius > settings.far_depth)
+				continue;
+
+			b.max_x = grid.width - 1;
+			b.max_y = grid.height - 1;
+			if (depth - radius > settings.near_depth)
+			{
+				// screen rectangle of the sphere's bounding box
+				float min_x{ 1.f }, max_x{ -1.f }, min_y{ 1.f }, max_y{ -1.f };
+				for (uint32_t corner{ 0 }; corner < 8; ++corner)
+				{
+					const glm::vec3 p{ b.center + glm::vec3{ corner & 1 ? radius : -radius, corner & 2 ? radius : -radius, corner & 4 ? radius : -radius } };
+					const float x{ project_x(projection, p) }, y{ project_y(projection, p) };
+					min_x = std::min(min_x, x), max_x = std::max(max_x, x);
+					min_y = std::min(min_y, y), max_y = std::max(max_y, y);
+				}
+
+				if (min_x > 1.f || max_x < -1.f || min_y > 1.f || max_y < -1.f)
+					continue;
+
+				b.min_x = ndc_to_tile(min_x, extent_width, settings.tile_size, grid.width);
+				b.max_x = ndc_to_tile(max_x, extent_width, settings.tile_size, grid.width);
+				b.min_y = ndc_to_tile(min_y, extent_height, settings.tile_size, grid.height);
+				b.max_y = ndc_to_tile(max_y, extent_height, settings.tile_size, grid.height);
+			}
+
+			const uint32_t first_slice{ get_depth_slice(grid, depth - radius) };
+			const uint32_t last_slice{ get_depth_slice(grid, depth + radius) };
+			const uint32_t bound_index{ (uint32_t)bounds.size() };
+			bounds.push_back(b);
+			for (uint32_t z{ first_slice }; z <= last_slice; ++z)
+				slices[z].lights.push_back(bound_index);
+		}
+
+		jobs::parallel_for(grid.depth, [&grid](uint32_t z) { bin_slice(grid, z, slices[z]); });
+
+		// compact the slices into one list, offsets follow the cluster index order
+		out_clusters.offsets.resize(grid.cluster_count());
+		out_clusters.counts.resize(grid.cluster_count());
+
+		uint32_t total{ 0 };
+		for (uint32_t z{ 0 }; z < grid.depth; ++z)
+		{
+			const slice_bin& bin{ slices[z] };
+			for (uint32_t i{ 0 }; i < slice_size; ++i)
+			{
+				out_clusters.offsets[z * slice_size + i] = total;
+				out_clusters.counts[z * slice_size + i] = bin.counts[i];
+				total += bin.counts[i];
+			}
+		}
+
+		out_clusters.indices.resize(total);
+		for (uint32_t z{ 0 }; z < grid.depth; ++z)
+		{
+			const slice_bin& bin{ slices[z] };
+			if (!bin.indices.empty())
+				std::copy(bin.indices.begin(), bin.indices.end(), out_clusters.indices.begin() + out_clusters.offsets[z * slice_size]);
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace renderer::geometry::lights
+{
+	enum light_type : uint32_t
+	{
+		point = 0,
+		spot = 1,
+	};
+
+	// std430 compatible, uploaded as is for the compute binning pass and the shading passes
+	struct light
+	{
+		glm::vec3	position{};			// world space
+		float		range{ 1.f };
+		glm::vec3	direction{ 0.f, 0.f, -1.f };	// spot lights, normalized
+		float		cos_outer_angle{ 0.f };			// spot lights
+		glm::vec3	color{ 1.f };
+		uint32_t	type{ point };
+	};
+	static_assert(sizeof(light) == 48);
+
+	struct cluster_settings
+	{
+		uint32_t	tile_size{ 64 };		// pixels
+		uint32_t	depth_slices{ 24 };		// exponentially distributed between near and far
+		float		near_depth{ 0.1f };
+		float		far_depth{ 1000.f };
+	};
+
+	struct cluster_grid
+	{
+		uint32_t				width{ 0 };		// tiles
+		uint32_t				height{ 0 };
+		uint32_t				depth{ 0 };		// slices
+		uint32_t				extent_width{ 0 };	// pixels
+		uint32_t				extent_height{ 0 };
+		cluster_settings		settings{};
+		std::vector<glm::vec4>	aabb_min;		// view space, w unused, index x + y * width + z * width * height
+		std::vector<glm::vec4>	aabb_max;
+
+		[[nodiscard]] uint32_t cluster_count() const { return width * height * depth; }
+	};
+
+	// per cluster offset and count into indices
+	struct cluster_lights
+	{
+		std::vector<uint32_t>	offsets;
+		std::vector<uint32_t>	counts;
+		std::vector<uint32_t>	indices;
+	};
+
+	// view space cluster bounds for a perspective projection (right handed view space, zero to one depth,
+	// off center and flipped y projections are fine). rebuild on resize or when the projection changes
+	void build_grid(const glm::mat4& projection, uint32_t extent_width, uint32_t extent_height, const cluster_settings& settings, cluster_grid& out_grid);
+
+	// depth slice of a view space depth (positive distance in front of the camera), clamped to the grid
+	uint32_t get_depth_slice(const cluster_grid& grid, float view_depth);
+
+	// cpu reference binning. every light is bounded by a sphere (spot lights by the sphere around their cone), narrowed to
+	// the clusters its screen rectangle and depth range touch and tested against each of their aabbs.
+	// runs one job per depth slice, the result is deterministic and ordered by light index within a cluster.
+	// keeps its scratch memory between calls, call from one thread at a time
+	void bin_lights(const cluster_grid& grid, const glm::mat4& view, const glm::mat4& projection, const light* lights, uint32_t light_count,
+					cluster_lights& out_clusters);
+}
@@ -0,0 +1,95 @@
+#include "Lod.h"
+#include "MeshOptimizer.h"
+#include "Simplifier.h"
+
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+
+namespace renderer::geometry
+{
+	namespace
+	{
+		// stop when a pass removes less than this fraction of the triangles, further lods would be near duplicates
+		constexpr float min_lod_progress{ 0.05f };
+		// keep the distance away from zero when the camera is inside the bounds
+		constexpr float min_lod_distance{ 1e-3f };
+
+	} // anonymous namespace
+
+	std::vector<mesh_lod> build_lod_chain(mesh& m, const lod_settings& settings)
+	{
+		std::vector<mesh_lod> lods{};
+		lods.push_back({ 0, (uint32_t)m.indices.size(), 0.f });
+		if (m.vertices.empty())
+			return lods;
+
+		glm::vec3 min_corner{ m.vertices[0].position };
+		glm::vec3 max_corner{ min_corner };
+		for (const vertex& v : m.vertices)
+		{
+			min_corner = glm::min(min_corner, v.position);
+			max_corner = glm::max(max_corner, v.position);
+		}
+		const float radius{ glm::length(max_corner - min_corner) * 0.5f };
+		const float error_limit{ settings.max_error * radius };
+
+		// every lod simplifies the previous one, the errors add up
+		std::vector<uint32_t> current{ m.indices };
+		float accumulated_error{ 0.f };
+
+		while (lods.size() < settings.max_lod_count)
+		{
+			const uint32_t target_index_count{ (uint32_t)(current.size() / 3 * settings.reduction) * 3 };
+			if (target_index_count / 3 < settings.min_triangle_count)
+				break;
+
+			float error{ 0.f };
+			std::vector<uint32_t> simplified{ simplifier::simplify(m.vertices, current, target_index_count,
+																   error_limit - accumulated_error, &error) };
+
+			if (simplified.empty() || (float)simplified.size() > (float)current.size() * (1.f - min_lod_progress))
+				break;
+
+			optimizer::optimize_vertex_cache(simplified, (uint32_t)m.vertices.size());
+			accumulated_error += error;
+
+			lods.push_back({ (uint32_t)m.indices.size(), (uint32_t)simplified.size(), accumulated_error });
+			m.indices.insert(m.indices.end(), simplified.begin(), simplified.end());
+			current = std::move(simplified);
+		}
+
+		return lods;
+	}
+
+	uint32_t select_lod(const std::vector<mesh_lod>& lods, float distance, float pixels_per_unit,
+						float threshold_pixels, float hysteresis, uint32_t current_lod)
+	{
+		if (lods.empty())
+			return 0;
+
+		const float scale{ pixels_per_unit / std::max(distance, min_lod_distance) };
+
+		uint32_t desired{ 0 };
+		for (uint32_t i{ 1 }; i < (uint32_t)lods.size(); ++i)
+		{
+			if (lods[i].error * scale > threshold_pixels)
+				break;
+			desired = i;
+		}
+
+		current_lod = std::min(current_lod, (uint32_t)lods.size() - 1);
+		if (desired <= current_lod)
+			return desired;
+
+		// going coarser, take the coarsest lod that is clearly below the threshold
+		uint32_t coarser{ current_lod };
+		for (uint32_t i{ current_lod + 1 }; i <= desired; ++i)
+		{
+			if (lods[i].error * scale > threshold_pixels * (1.f - hysteresis))
+				break;
+			coarser = i;
+		}
+		return coarser;
+	}
+}
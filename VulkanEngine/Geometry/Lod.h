@@ -0,0 +1,30 @@
+#pragma once
+#include "Mesh.h"
+
+namespace renderer::geometry
+{
+	struct mesh_lod
+	{
+		uint32_t	index_offset;
+		uint32_t	index_count;
+		float		error;			// object space geometric error compared to lod 0
+	};
+
+	struct lod_settings
+	{
+		uint32_t	max_lod_count{ 6 };
+		float		reduction{ 0.5f };			// triangle count ratio between two consecutive lods
+		float		max_error{ 0.05f };			// relative to the mesh bounding radius
+		uint32_t	min_triangle_count{ 64 };
+	};
+
+	// appends the simplified index lists of every lod to m.indices, lod 0 is the index range the mesh had on entry.
+	// lods share the vertex buffer, so run this after the vertex fetch optimisation.
+	std::vector<mesh_lod> build_lod_chain(mesh& m, const lod_settings& settings = {});
+
+	// picks the coarsest lod whose projected error stays below threshold_pixels. coarser lods are only taken once
+	// they are hysteresis (fraction) below the threshold, to avoid popping back and forth at the boundary.
+	// pixels_per_unit is the projected size of one object space unit at distance 1.
+	uint32_t select_lod(const std::vector<mesh_lod>& lods, float distance, float pixels_per_unit,
+						float threshold_pixels, float hysteresis, uint32_t current_lod);
+}
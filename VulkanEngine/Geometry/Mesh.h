@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+namespace renderer::geometry
+{
+	struct vertex
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	// indexed triangle list, the layout that is uploaded to the gpu as-is
+	struct mesh
+	{
+		std::vector<vertex>		vertices;
+		std::vector<uint32_t>	indices;
+	};
+}
@@ -0,0 +1,152 @@
+#include "MeshAsset.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace renderer::geometry
+{
+	namespace
+	{
+		constexpr uint32_t mesh_asset_magic{ 0x48534d56 }; // "VMSH"
+		constexpr uint32_t mesh_asset_version{ 2 };
+
+		struct mesh_asset_header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t vertex_count;
+			uint32_t index_count;
+			uint32_t meshlet_count;
+			uint32_t meshlet_vertex_count;
+			uint32_t meshlet_triangle_bytes;
+			uint32_t lod_count;
+		};
+
+		template<typename T>
+		void write_array(std::ofstream& file, const std::vector<T>& data)
+		{
+			file.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(T));
+		}
+
+		template<typename T>
+		bool read_array(std::ifstream& file, std::vector<T>& data, uint32_t count)
+		{
+			data.resize(count);
+			file.read(reinterpret_cast<char*>(data.data()), (std::streamsize)count * sizeof(T));
+			return (bool)file;
+		}
+
+		// every offset and index has to stay inside the arrays it points into, the asset is uploaded and drawn unchecked
+		bool is_consistent(const mesh_asset& asset)
+		{
+			const size_t vertex_count{ asset.geometry.vertices.size() };
+			const size_t index_count{ asset.geometry.indices.size() };
+			if (!std::all_of(asset.geometry.indices.begin(), asset.geometry.indices.end(), [&](uint32_t index) { return index < vertex_count; }) ||
+				!std::all_of(asset.meshlets.vertices.begin(), asset.meshlets.vertices.end(), [&](uint32_t index) { return index < vertex_count; }))
+				return false;
+
+			for (const meshlet& m : asset.meshlets.meshlets)
+			{
+				if (m.vertex_count > meshlet_max_vertices || m.triangle_count > meshlet_max_triangles ||
+					(uint64_t)m.vertex_offset + m.vertex_count > asset.meshlets.vertices.size() ||
+					(uint64_t)m.triangle_offset + m.triangle_count * 3 > asset.meshlets.triangles.size())
+					return false;
+
+				for (uint32_t i{ 0 }; i < m.triangle_count * 3; ++i)
+				{
+					if (asset.meshlets.triangles[m.triangle_offset + i] >= m.vertex_count)
+						return false;
+				}
+			}
+
+			return std::all_of(asset.lods.begin(), asset.lods.end(), [&](const mesh_lod& lod) {
+				return lod.index_count % 3 == 0 && (uint64_t)lod.index_offset + lod.index_count <= index_count;
+			});
+		}
+
+	} // anonymous namespace
+
+	bool save_mesh_asset(const std::string& path, const mesh_asset& asset)
+	{
+		std::ofstream file{ path, std::ios::binary };
+		if (!file)
+		{
+			std::cout << "failed to open " << path << " for writing!\n";
+			return false;
+		}
+
+		mesh_asset_header header{};
+		header.magic = mesh_asset_magic;
+		header.version = mesh_asset_version;
+		header.vertex_count = (uint32_t)asset.geometry.vertices.size();
+		header.index_count = (uint32_t)asset.geometry.indices.size();
+		header.meshlet_count = (uint32_t)asset.meshlets.meshlets.size();
+		header.meshlet_vertex_count = (uint32_t)asset.meshlets.vertices.size();
+		header.meshlet_triangle_bytes = (uint32_t)asset.meshlets.triangles.size();
+		header.lod_count = (uint32_t)asset.lods.size();
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		write_array(file, asset.geometry.vertices);
+		write_array(file, asset.geometry.indices);
+		write_array(file, asset.meshlets.meshlets);
+		write_array(file, asset.meshlets.bounds);
+		write_array(file, asset.meshlets.vertices);
+		write_array(file, asset.meshlets.triangles);
+		write_array(file, asset.lods);
+
+		return (bool)file;
+	}
+
+	bool load_mesh_asset(const std::string& path, mesh_asset& asset)
+	{
+		std::ifstream file{ path, std::ios::binary | std::ios::ate };
+		if (!file)
+		{
+			std::cout << "failed to open " << path << "!\n";
+			return false;
+		}
+		const uint64_t file_size{ (uint64_t)file.tellg() };
+		file.seekg(0);
+
+		mesh_asset_header header{};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!file || header.magic != mesh_asset_magic || header.version != mesh_asset_version)
+		{
+			std::cout << path << " is not a supported mesh asset!\n";
+			return false;
+		}
+
+		// the counts decide the allocation sizes, never trust them beyond what the file can hold
+		const uint64_t expected_size{ sizeof(header) + (uint64_t)header.vertex_count * sizeof(vertex) + (uint64_t)header.index_count * sizeof(uint32_t) +
+									  (uint64_t)header.meshlet_count * (sizeof(meshlet) + sizeof(meshlet_bounds)) +
+									  (uint64_t)header.meshlet_vertex_count * sizeof(uint32_t) + header.meshlet_triangle_bytes +
+									  (uint64_t)header.lod_count * sizeof(mesh_lod) };
+		if (expected_size != file_size)
+		{
+			std::cout << path << " is truncated or corrupt, " << file_size << " bytes instead of " << expected_size << "!\n";
+			return false;
+		}
+
+		const bool success{ read_array(file, asset.geometry.vertices, header.vertex_count) &&
+							read_array(file, asset.geometry.indices, header.index_count) &&
+							read_array(file, asset.meshlets.meshlets, header.meshlet_count) &&
+							read_array(file, asset.meshlets.bounds, header.meshlet_count) &&
+							read_array(file, asset.meshlets.vertices, header.meshlet_vertex_count) &&
+							read_array(file, asset.meshlets.triangles, header.meshlet_triangle_bytes) &&
+							read_array(file, asset.lods, header.lod_count) };
+
+		if (!success)
+		{
+			std::cout << path << " is truncated!\n";
+			return false;
+		}
+		if (!is_consistent(asset))
+		{
+			std::cout << path << " has out of range offsets or indices!\n";
+			return false;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "Lod.h"
+#include "Meshlet.h"
+
+#include <string>
+
+namespace renderer::geometry
+{
+	// binary mesh asset, written at import time after optimisation and loaded without further processing.
+	// geometry.indices holds the index lists of all lods back to back, meshlets are built from lod 0.
+	struct mesh_asset
+	{
+		mesh					geometry;
+		meshlet_data			meshlets;
+		std::vector<mesh_lod>	lods;
+	};
+
+	bool save_mesh_asset(const std::string& path, const mesh_asset& asset);
+	bool load_mesh_asset(const std::string& path, mesh_asset& asset);
+}
@@ -0,0 +1,461 @@
+#include "MeshOptimizer.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include <glm/geometric.hpp>
+
+namespace renderer::geometry::optimizer
+{
+	namespace
+	{
+		constexpr uint32_t invalid_index{ UINT32_MAX };
+
+		// scoring constants from "Linear-Speed Vertex Cache Optimisation", Tom Forsyth 2006
+		constexpr float cache_decay_power{ 1.5f };
+		constexpr float last_triangle_score{ 0.75f };
+		constexpr float valence_boost_scale{ 2.f };
+		constexpr float valence_boost_power{ 0.5f };
+
+		float forsyth_vertex_score(int32_t cache_position, uint32_t remaining_triangles)
+		{
+			// nothing left to draw with this vertex, never pick it
+			if (!remaining_triangles)
+				return -1.f;
+
+			float score{ 0.f };
+			if (cache_position >= 0)
+			{
+				if (cache_position < 3)
+				{
+					// used by the last triangle, fixed score so that strips are not favoured over fans
+					score = last_triangle_score;
+				}
+				else
+				{
+					constexpr float scaler{ 1.f / (optimize_cache_size - 3) };
+					score = std::pow(1.f - (float)(cache_position - 3) * scaler, cache_decay_power);
+				}
+			}
+
+			// boost vertices with few triangles left so that lone triangles do not get stranded
+			score += valence_boost_scale * std::pow((float)remaining_triangles, -valence_boost_power);
+			return score;
+		}
+
+		struct vertex_hasher
+		{
+			size_t operator()(const vertex& v) const
+			{
+				// FNV-1a over the raw bytes, vertex has no padding
+				static_assert(sizeof(vertex) == sizeof(float) * 8);
+				const uint8_t* bytes{ reinterpret_cast<const uint8_t*>(&v) };
+				uint64_t hash{ 14695981039346656037ull };
+				for (size_t i{ 0 }; i < sizeof(vertex); ++i)
+				{
+					hash ^= bytes[i];
+					hash *= 1099511628211ull;
+				}
+				return (size_t)hash;
+			}
+		};
+
+		struct vertex_equal
+		{
+			bool operator()(const vertex& a, const vertex& b) const
+			{
+				return std::memcmp(&a, &b, sizeof(vertex)) == 0;
+			}
+		};
+
+	} // anonymous namespace
+
+	uint32_t weld_vertices(mesh& m)
+	{
+		std::unordered_map<vertex, uint32_t, vertex_hasher, vertex_equal> unique_vertices{};
+		unique_vertices.reserve(m.vertices.size());
+
+		std::vector<uint32_t> remap(m.vertices.size());
+		std::vector<vertex> welded{};
+		welded.reserve(m.vertices.size());
+
+		for (size_t i{ 0 }; i < m.vertices.size(); ++i)
+		{
+			auto [it, inserted] = unique_vertices.try_emplace(m.vertices[i], (uint32_t)welded.size());
+			if (inserted)
+				welded.push_back(m.vertices[i]);
+			remap[i] = it->second;
+		}
+
+		for (uint32_t& index : m.indices)
+			index = remap[index];
+
+		const uint32_t removed{ (uint32_t)(m.vertices.size() - welded.size()) };
+		m.vertices = std::move(welded);
+		return removed;
+	}
+
+	void optimize_vertex_cache(std::vector<uint32_t>& indices, uint32_t vertex_count)
+	{
+		assert(indices.size() % 3 == 0);
+		const uint32_t triangle_count{ (uint32_t)indices.size() / 3 };
+		if (!triangle_count)
+			return;
+
+		// triangle adjacency per vertex, the first remaining_triangles[v] entries are the triangles not emitted yet
+		std::vector<uint32_t> remaining_triangles(vertex_count, 0);
+		for (uint32_t index : indices)
+			++remaining_triangles[index];
+
+		std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+		for (uint32_t v{ 0 }; v < vertex_count; ++v)
+			adjacency_offsets[v + 1] = adjacency_offsets[v] + remaining_triangles[v];
+
+		std::vector<uint32_t> adjacency(indices.size());
+		{
+			std::vector<uint32_t> cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+			for (uint32_t i{ 0 }; i < (uint32_t)indices.size(); ++i)
+				adjacency[cursor[indices[i]]++] = i / 3;
+		}
+
+		std::vector<int32_t> cache_position(vertex_count, -1);
+		std::vector<float> vertex_score(vertex_count);
+		for (uint32_t v{ 0 }; v < vertex_count; ++v)
+			vertex_score[v] = forsyth_vertex_score(-1, remaining_triangles[v]);
+
+		auto triangle_score = [&](uint32_t t) {
+			return vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+		};
+
+		std::vector<bool> emitted(triangle_count, false);
+		std::vector<uint32_t> result{};
+		result.reserve(indices.size());
+
+		std::array<uint32_t, optimize_cache_size + 3> cache{};
+		std::array<uint32_t, optimize_cache_size + 3> new_cache{};
+		uint32_t cache_count{ 0 };
+		uint32_t scan_cursor{ 0 };
+
+		uint32_t best_triangle{ 0 };
+		float best_score{ triangle_score(0) };
+		for (uint32_t t{ 1 }; t < triangle_count; ++t)
+		{
+			const float score{ triangle_score(t) };
+			if (score > best_score)
+			{
+				best_score = score;
+				best_triangle = t;
+			}
+		}
+
+		while (best_triangle != invalid_index)
+		{
+			emitted[best_triangle] = true;
+			const uint32_t* triangle{ &indices[best_triangle * 3] };
+			result.insert(result.end(), triangle, triangle + 3);
+
+			// remove the triangle from the remaining adjacency of its vertices
+			for (uint32_t k{ 0 }; k < 3; ++k)
+			{
+				const uint32_t v{ triangle[k] };
+				uint32_t* list{ &adjacency[adjacency_offsets[v]] };
+				const uint32_t count{ remaining_triangles[v] };
+				for (uint32_t i{ 0 }; i < count; ++i)
+				{
+					if (list[i] == best_triangle)
+					{
+						std::swap(list[i], list[count - 1]);
+						break;
+					}
+				}
+				--remaining_triangles[v];
+			}
+
+			// emitted vertices move to the front of the LRU cache
+			uint32_t new_count{ 0 };
+			for (uint32_t k{ 0 }; k < 3; ++k)
+			{
+				if (std::find(new_cache.begin(), new_cache.begin() + new_count, triangle[k]) == new_cache.begin() + new_count)
+					new_cache[new_count++] = triangle[k];
+			}
+			for (uint32_t i{ 0 }; i < cache_count; ++i)
+			{
+				const uint32_t v{ cache[i] };
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+					new_cache[new_count++] = v;
+			}
+
+			for (uint32_t i{ 0 }; i < new_count; ++i)
+			{
+				const uint32_t v{ new_cache[i] };
+				cache_position[v] = i < optimize_cache_size ? (int32_t)i : -1;
+				vertex_score[v] = forsyth_vertex_score(cache_position[v], remaining_triangles[v]);
+			}
+
+			// only triangles touching the cache (including the vertices that just fell out) changed score
+			best_triangle = invalid_index;
+			best_score = -1.f;
+			for (uint32_t i{ 0 }; i < new_count; ++i)
+			{
+				const uint32_t v{ new_cache[i] };
+				const uint32_t* list{ &adjacency[adjacency_offsets[v]] };
+				for (uint32_t j{ 0 }; j < remaining_triangles[v]; ++j)
+				{
+					const float score{ triangle_score(list[j]) };
+					if (score > best_score)
+					{
+						best_score = score;
+						best_triangle = list[j];
+					}
+				}
+			}
+
+			cache_count = std::min(new_count, optimize_cache_size);
+			std::swap(cache, new_cache);
+
+			// cache is dead, continue with the next triangle in the original order
+			if (best_triangle == invalid_index)
+			{
+				while (scan_cursor < triangle_count && emitted[scan_cursor])
+					++scan_cursor;
+				if (scan_cursor < triangle_count)
+					best_triangle = scan_cursor;
+			}
+		}
+
+		assert(result.size() == indices.size());
+		indices = std::move(result);
+	}
+
+	void optimize_overdraw(std::vector<uint32_t>& indices, const std::vector<vertex>& vertices, float threshold)
+	{
+		const uint32_t triangle_count{ (uint32_t)indices.size() / 3 };
+		const uint32_t vertex_count{ (uint32_t)vertices.size() };
+		if (triangle_count < 2)
+			return;
+
+		// split wherever the cache simulation goes cold, reordering those clusters costs (almost) no cache efficiency
+		std::vector<uint32_t> cluster_offsets{ 0 };
+		{
+			std::vector<uint32_t> timestamps(vertex_count, 0);
+			uint32_t timestamp{ analyze_cache_size + 1 };
+			for (uint32_t t{ 0 }; t < triangle_count; ++t)
+			{
+				uint32_t misses{ 0 };
+				for (uint32_t k{ 0 }; k < 3; ++k)
+				{
+					const uint32_t v{ indices[t * 3 + k] };
+					if (timestamp - timestamps[v] > analyze_cache_size)
+					{
+						timestamps[v] = timestamp++;
+						++misses;
+					}
+				}
+				if (misses == 3 && t > cluster_offsets.back())
+					cluster_offsets.push_back(t);
+			}
+		}
+		const uint32_t cluster_count{ (uint32_t)cluster_offsets.size() };
+		cluster_offsets.push_back(triangle_count);
+		if (cluster_count < 2)
+			return;
+
+		glm::vec3 mesh_centroid{ 0.f };
+		for (const vertex& v : vertices)
+			mesh_centroid += v.position;
+		mesh_centroid /= (float)vertex_count;
+
+		// clusters facing away from the mesh centre are likely occluders, draw them first
+		std::vector<float> sort_keys(cluster_count);
+		for (uint32_t c{ 0 }; c < cluster_count; ++c)
+		{
+			glm::vec3 centroid{ 0.f };
+			glm::vec3 normal{ 0.f };
+			float area_sum{ 0.f };
+			for (uint32_t t{ cluster_offsets[c] }; t < cluster_offsets[c + 1]; ++t)
+			{
+				const glm::vec3& p0{ vertices[indices[t * 3]].position };
+				const glm::vec3& p1{ vertices[indices[t * 3 + 1]].position };
+				const glm::vec3& p2{ vertices[indices[t * 3 + 2]].position };
+
+				const glm::vec3 n{ glm::cross(p1 - p0, p2 - p0) };
+				const float area{ glm::length(n) };
+				centroid += (p0 + p1 + p2) * (area / 3.f);
+				normal += n;
+				area_sum += area;
+			}
+
+			const float normal_length{ glm::length(normal) };
+			if (area_sum <= 0.f || normal_length <= 0.f)
+			{
+				sort_keys[c] = 0.f;
+				continue;
+			}
+
+			centroid /= area_sum;
+			sort_keys[c] = glm::dot(centroid - mesh_centroid, normal / normal_length);
+		}
+
+		std::vector<uint32_t> cluster_order(cluster_count);
+		for (uint32_t c{ 0 }; c < cluster_count; ++c)
+			cluster_order[c] = c;
+		std::stable_sort(cluster_order.begin(), cluster_order.end(),
+						 [&](uint32_t a, uint32_t b) { return sort_keys[a] > sort_keys[b]; });
+
+		std::vector<uint32_t> result{};
+		result.reserve(indices.size());
+		for (uint32_t c : cluster_order)
+			result.insert(result.end(), indices.begin() + cluster_offsets[c] * 3, indices.begin() + cluster_offsets[c + 1] * 3);
+
+		// boundaries were cold so this rarely triggers, but never trade more than the threshold of cache efficiency
+		const float acmr_before{ analyze_vertex_cache(indices, vertex_count).acmr };
+		const float acmr_after{ analyze_vertex_cache(result, vertex_count).acmr };
+		if (acmr_after <= acmr_before * threshold)
+			indices = std::move(result);
+	}
+
+	void optimize_vertex_fetch(mesh& m)
+	{
+		std::vector<uint32_t> remap(m.vertices.size(), invalid_index);
+		std::vector<vertex> reordered{};
+		reordered.reserve(m.vertices.size());
+
+		for (uint32_t& index : m.indices)
+		{
+			if (remap[index] == invalid_index)
+			{
+				remap[index] = (uint32_t)reordered.size();
+				reordered.push_back(m.vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		m.vertices = std::move(reordered);
+	}
+
+	vertex_cache_statistics analyze_vertex_cache(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size)
+	{
+		vertex_cache_statistics stats{};
+		if (indices.empty())
+			return stats;
+
+		// FIFO emulation: a vertex is still cached if fewer than cache_size misses happened since it was loaded
+		std::vector<uint32_t> timestamps(vertex_count, 0);
+		uint32_t timestamp{ cache_size + 1 };
+		for (uint32_t index : indices)
+		{
+			if (timestamp - timestamps[index] > cache_size)
+			{
+				timestamps[index] = timestamp++;
+				++stats.vertices_transformed;
+			}
+		}
+
+		stats.acmr = (float)stats.vertices_transformed / (float)(indices.size() / 3);
+		stats.atvr = vertex_count ? (float)stats.vertices_transformed / (float)vertex_count : 0.f;
+		return stats;
+	}
+
+	vertex_fetch_statistics analyze_vertex_fetch(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t vertex_size)
+	{
+		vertex_fetch_statistics stats{};
+		if (indices.empty() || !vertex_count)
+			return stats;
+
+		// model a small fully associative FIFO cache of lines in front of the vertex buffer
+		constexpr uint32_t line_cache_size{ 16 };
+		const uint64_t line_count{ ((uint64_t)vertex_count * vertex_size + analyze_cache_line_size - 1) / analyze_cache_line_size };
+		std::vector<uint32_t> timestamps(line_count, 0);
+		std::vector<bool> referenced(vertex_count, false);
+		uint32_t timestamp{ line_cache_size + 1 };
+		uint32_t unique_vertices{ 0 };
+
+		for (uint32_t index : indices)
+		{
+			if (!referenced[index])
+			{
+				referenced[index] = true;
+				++unique_vertices;
+			}
+
+			const uint64_t first_line{ (uint64_t)index * vertex_size / analyze_cache_line_size };
+			const uint64_t last_line{ ((uint64_t)index * vertex_size + vertex_size - 1) / analyze_cache_line_size };
+			for (uint64_t line{ first_line }; line <= last_line; ++line)
+			{
+				if (timestamp - timestamps[line] > line_cache_size)
+				{
+					timestamps[line] = timestamp++;
+					stats.bytes_fetched += analyze_cache_line_size;
+				}
+			}
+		}
+
+		stats.overfetch = (float)stats.bytes_fetched / (float)((uint64_t)unique_vertices * vertex_size);
+		return stats;
+	}
+
+	mesh_statistics optimize_mesh(mesh& m, const settings& options)
+	{
+		mesh_statistics stats{};
+		stats.triangle_count = (uint32_t)m.indices.size() / 3;
+		stats.vertex_count_before = (uint32_t)m.vertices.size();
+		stats.cache_before = analyze_vertex_cache(m.indices, stats.vertex_count_before);
+		stats.fetch_before = analyze_vertex_fetch(m.indices, stats.vertex_count_before, sizeof(vertex));
+
+		if (options.weld)
+			weld_vertices(m);
+		if (options.vertex_cache)
+			optimize_vertex_cache(m.indices, (uint32_t)m.vertices.size());
+		if (options.overdraw)
+			optimize_overdraw(m.indices, m.vertices, options.overdraw_threshold);
+		// must be last, it only changes the vertex order and keeps the triangle order intact
+		if (options.vertex_fetch)
+			optimize_vertex_fetch(m);
+
+		stats.vertex_count_after = (uint32_t)m.vertices.size();
+		stats.cache_after = analyze_vertex_cache(m.indices, stats.vertex_count_after);
+		stats.fetch_after = analyze_vertex_fetch(m.indices, stats.vertex_count_after, sizeof(vertex));
+		return stats;
+	}
+
+	std::vector<mesh_statistics> optimize_meshes(std::vector<mesh>& meshes, const settings& options)
+	{
+		std::vector<mesh_statistics> stats(meshes.size());
+		jobs::parallel_for((uint32_t)meshes.size(), [&](uint32_t i) { stats[i] = optimize_mesh(meshes[i], options); });
+		return stats;
+	}
+
+	batch_statistics summarize(const std::vector<mesh_statistics>& statistics)
+	{
+		batch_statistics batch{};
+		batch.mesh_count = (uint32_t)statistics.size();
+		uint64_t transformed_before{ 0 }, transformed_after{ 0 };
+
+		for (const mesh_statistics& stats : statistics)
+		{
+			batch.triangle_count += stats.triangle_count;
+			batch.vertices_before += stats.vertex_count_before;
+			batch.vertices_after += stats.vertex_count_after;
+			transformed_before += stats.cache_before.vertices_transformed;
+			transformed_after += stats.cache_after.vertices_transformed;
+			batch.bytes_fetched_before += stats.fetch_before.bytes_fetched;
+			batch.bytes_fetched_after += stats.fetch_after.bytes_fetched;
+		}
+
+		if (batch.triangle_count)
+		{
+			batch.acmr_before = (float)((double)transformed_before / (double)batch.triangle_count);
+			batch.acmr_after = (float)((double)transformed_after / (double)batch.triangle_count);
+		}
+		if (batch.vertices_before)
+			batch.atvr_before = (float)((double)transformed_before / (double)batch.vertices_before);
+		if (batch.vertices_after)
+			batch.atvr_after = (float)((double)transformed_after / (double)batch.vertices_after);
+		return batch;
+	}
+}
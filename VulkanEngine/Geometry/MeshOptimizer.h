@@ -0,0 +1,78 @@
+#pragma once
+#include "Mesh.h"
+
+namespace renderer::geometry::optimizer
+{
+	// size of the LRU cache modelled by the reordering, larger than any real post-transform cache on purpose
+	constexpr uint32_t optimize_cache_size{ 32 };
+	// FIFO cache and cache line used to report statistics, close to what current hardware does
+	constexpr uint32_t analyze_cache_size{ 16 };
+	constexpr uint32_t analyze_cache_line_size{ 64 };
+
+	struct settings
+	{
+		bool	weld{ true };
+		bool	vertex_cache{ true };
+		bool	overdraw{ true };
+		bool	vertex_fetch{ true };
+		// maximum ACMR growth allowed when reordering triangle clusters for overdraw
+		float	overdraw_threshold{ 1.05f };
+	};
+
+	struct vertex_cache_statistics
+	{
+		uint32_t	vertices_transformed{ 0 };
+		float		acmr{ 0.f };	// transformed vertices per triangle, 0.5 is the best possible, 3 the worst
+		float		atvr{ 0.f };	// transformed vertices per vertex, 1 is the best possible
+	};
+
+	struct vertex_fetch_statistics
+	{
+		uint64_t	bytes_fetched{ 0 };
+		float		overfetch{ 0.f };	// fetched bytes per byte of referenced vertex data, 1 is the best possible
+	};
+
+	struct mesh_statistics
+	{
+		uint32_t					triangle_count{ 0 };	// the same before and after, optimisation only reorders
+		uint32_t					vertex_count_before{ 0 };
+		uint32_t					vertex_count_after{ 0 };
+		vertex_cache_statistics		cache_before{};
+		vertex_cache_statistics		cache_after{};
+		vertex_fetch_statistics		fetch_before{};
+		vertex_fetch_statistics		fetch_after{};
+	};
+
+	// totals over a batch of meshes, acmr is per triangle and atvr per vertex of the whole batch
+	struct batch_statistics
+	{
+		uint32_t	mesh_count{ 0 };
+		uint64_t	triangle_count{ 0 };
+		uint64_t	vertices_before{ 0 };
+		uint64_t	vertices_after{ 0 };
+		float		acmr_before{ 0.f };
+		float		acmr_after{ 0.f };
+		float		atvr_before{ 0.f };
+		float		atvr_after{ 0.f };
+		uint64_t	bytes_fetched_before{ 0 };
+		uint64_t	bytes_fetched_after{ 0 };
+	};
+
+	// merges bitwise identical vertices and rewrites the indices, returns the number of removed vertices
+	uint32_t weld_vertices(mesh& m);
+	// Tom Forsyth's linear-speed vertex cache optimisation
+	void optimize_vertex_cache(std::vector<uint32_t>& indices, uint32_t vertex_count);
+	// reorders clusters of triangles front-to-back from the mesh centre outwards, must run after optimize_vertex_cache
+	void optimize_overdraw(std::vector<uint32_t>& indices, const std::vector<vertex>& vertices, float threshold);
+	// orders vertices by first use and drops unreferenced ones
+	void optimize_vertex_fetch(mesh& m);
+
+	vertex_cache_statistics analyze_vertex_cache(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size = analyze_cache_size);
+	vertex_fetch_statistics analyze_vertex_fetch(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t vertex_size);
+
+	mesh_statistics optimize_mesh(mesh& m, const settings& options = {});
+	// meshes are processed in parallel on the job system
+	std::vector<mesh_statistics> optimize_meshes(std::vector<mesh>& meshes, const settings& options = {});
+
+	batch_statistics summarize(const std::vector<mesh_statistics>& statistics);
+}
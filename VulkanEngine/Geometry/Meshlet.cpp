@@ -0,0 +1,154 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <glm/geometric.hpp>
+
+namespace renderer::geometry
+{
+	namespace
+	{
+		constexpr uint8_t unused_slot{ 0xff };
+
+		void finish_meshlet(meshlet_data& data, meshlet& current, const std::vector<vertex>& vertices)
+		{
+			if (!current.triangle_count)
+				return;
+
+			// keep the triangle data of every meshlet 4 byte aligned so the gpu can read it as uints
+			data.triangles.resize((data.triangles.size() + 3) & ~size_t{ 3 }, 0);
+
+			data.meshlets.push_back(current);
+			data.bounds.push_back(compute_meshlet_bounds(data, current, vertices));
+
+			current = {};
+			current.vertex_offset = (uint32_t)data.vertices.size();
+			current.triangle_offset = (uint32_t)data.triangles.size();
+		}
+
+	} // anonymous namespace
+
+	meshlet_data build_meshlets(const mesh& m, uint32_t max_vertices, uint32_t max_triangles)
+	{
+		assert(max_vertices >= 3 && max_vertices <= 255);
+		assert(max_triangles >= 1);
+
+		meshlet_data data{};
+		const size_t triangle_count{ m.indices.size() / 3 };
+		data.meshlets.reserve(triangle_count / max_triangles + 1);
+		data.triangles.reserve(m.indices.size() + data.meshlets.capacity() * 4);
+
+		// local index of each mesh vertex in the meshlet that is being built
+		std::vector<uint8_t> local_index(m.vertices.size(), unused_slot);
+		meshlet current{};
+
+		for (size_t t{ 0 }; t < triangle_count; ++t)
+		{
+			const uint32_t* triangle{ &m.indices[t * 3] };
+
+			uint32_t new_vertices{ 0 };
+			for (uint32_t k{ 0 }; k < 3; ++k)
+			{
+				// count each new vertex once, degenerate triangles may repeat a vertex
+				if (local_index[triangle[k]] == unused_slot &&
+					(k == 0 || triangle[k] != triangle[0]) && (k < 2 || triangle[k] != triangle[1]))
+					++new_vertices;
+			}
+
+			if (current.vertex_count + new_vertices > max_vertices || current.triangle_count + 1 > max_triangles)
+			{
+				for (uint32_t i{ 0 }; i < current.vertex_count; ++i)
+					local_index[data.vertices[current.vertex_offset + i]] = unused_slot;
+				finish_meshlet(data, current, m.vertices);
+			}
+
+			for (uint32_t k{ 0 }; k < 3; ++k)
+			{
+				uint8_t& slot{ local_index[triangle[k]] };
+				if (slot == unused_slot)
+				{
+					slot = (uint8_t)current.vertex_count++;
+					data.vertices.push_back(triangle[k]);
+				}
+				data.triangles.push_back(slot);
+			}
+			++current.triangle_count;
+		}
+
+		finish_meshlet(data, current, m.vertices);
+		return data;
+	}
+
+	meshlet_bounds compute_meshlet_bounds(const meshlet_data& data, const meshlet& m, const std::vector<vertex>& vertices)
+	{
+		meshlet_bounds bounds{};
+		const uint32_t* meshlet_vertices{ &data.vertices[m.vertex_offset] };
+		const uint8_t* meshlet_triangles{ &data.triangles[m.triangle_offset] };
+
+		// bounding sphere around the aabb centre, slightly loose but cheap and stable
+		glm::vec3 min_corner{ vertices[meshlet_vertices[0]].position };
+		glm::vec3 max_corner{ min_corner };
+		for (uint32_t i{ 1 }; i < m.vertex_count; ++i)
+		{
+			min_corner = glm::min(min_corner, vertices[meshlet_vertices[i]].position);
+			max_corner = glm::max(max_corner, vertices[meshlet_vertices[i]].position);
+		}
+
+		bounds.center = (min_corner + max_corner) * 0.5f;
+		for (uint32_t i{ 0 }; i < m.vertex_count; ++i)
+			bounds.radius = std::max(bounds.radius, glm::distance(bounds.center, vertices[meshlet_vertices[i]].position));
+
+		// normal cone, the average face normal and the largest deviation from it
+		std::vector<glm::vec3> normals{};
+		std::vector<glm::vec3> corners{};
+		normals.reserve(m.triangle_count);
+		corners.reserve(m.triangle_count);
+		glm::vec3 axis{ 0.f };
+
+		for (uint32_t t{ 0 }; t < m.triangle_count; ++t)
+		{
+			const glm::vec3& p0{ vertices[meshlet_vertices[meshlet_triangles[t * 3]]].position };
+			const glm::vec3& p1{ vertices[meshlet_vertices[meshlet_triangles[t * 3 + 1]]].position };
+			const glm::vec3& p2{ vertices[meshlet_vertices[meshlet_triangles[t * 3 + 2]]].position };
+
+			const glm::vec3 n{ glm::cross(p1 - p0, p2 - p0) };
+			const float area{ glm::length(n) };
+			if (area <= 0.f)
+				continue;
+
+			normals.push_back(n / area);
+			corners.push_back(p0);
+			axis += n / area;
+		}
+
+		const float axis_length{ glm::length(axis) };
+		bounds.cone_cutoff = 1.f;
+		if (normals.empty() || axis_length <= 0.f)
+			return bounds;
+
+		axis /= axis_length;
+		float min_dot{ 1.f };
+		for (const glm::vec3& n : normals)
+			min_dot = std::min(min_dot, glm::dot(n, axis));
+
+		// normals spread over more than a hemisphere, backface culling the cluster is impossible
+		if (min_dot <= 0.1f)
+			return bounds;
+
+		// move the apex back along the axis until every triangle plane has it on its positive side
+		float max_t{ 0.f };
+		for (size_t i{ 0 }; i < normals.size(); ++i)
+		{
+			const float dc{ glm::dot(axis, normals[i]) };
+			const float t{ glm::dot(bounds.center - corners[i], normals[i]) / dc };
+			max_t = std::max(max_t, t);
+		}
+
+		bounds.cone_apex = bounds.center - axis * max_t;
+		bounds.cone_axis = axis;
+		bounds.cone_cutoff = std::sqrt(1.f - min_dot * min_dot);
+		return bounds;
+	}
+}
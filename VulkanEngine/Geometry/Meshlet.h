@@ -0,0 +1,39 @@
+#pragma once
+#include "Mesh.h"
+
+namespace renderer::geometry
+{
+	// limits chosen to fit the common mesh shader output sizes, 124 triangles keep the index data 4 byte aligned
+	constexpr uint32_t meshlet_max_vertices{ 64 };
+	constexpr uint32_t meshlet_max_triangles{ 124 };
+
+	struct meshlet
+	{
+		uint32_t vertex_offset;		// into meshlet_data::vertices
+		uint32_t triangle_offset;	// into meshlet_data::triangles, always a multiple of 4
+		uint32_t vertex_count;
+		uint32_t triangle_count;
+	};
+
+	struct meshlet_bounds
+	{
+		glm::vec3	center;
+		float		radius;
+		glm::vec3	cone_apex;
+		float		cone_cutoff;	// cos of the cone half angle + 90 degrees, 1 when the cone can't be used for culling
+		glm::vec3	cone_axis;
+		float		padding;
+	};
+
+	struct meshlet_data
+	{
+		std::vector<meshlet>		meshlets;
+		std::vector<meshlet_bounds>	bounds;
+		std::vector<uint32_t>		vertices;	// indices into the mesh vertex buffer
+		std::vector<uint8_t>		triangles;	// 3 meshlet local vertex indices per triangle
+	};
+
+	// partitions the mesh in index order, run the vertex cache optimisation first for tighter meshlets
+	meshlet_data build_meshlets(const mesh& m, uint32_t max_vertices = meshlet_max_vertices, uint32_t max_triangles = meshlet_max_triangles);
+	meshlet_bounds compute_meshlet_bounds(const meshlet_data& data, const meshlet& m, const std::vector<vertex>& vertices);
+}
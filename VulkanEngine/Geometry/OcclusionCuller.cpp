@@ -0,0 +1,443 @@
+#include "OcclusionCuller.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define OCCLUSION_X64 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AVX2_FUNCTION
+#else
+// gcc and clang only emit avx2 instructions in functions that ask for them, msvc accepts the intrinsics anywhere
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace renderer::geometry::occlusion
+{
+	namespace
+	{
+		constexpr uint32_t tile_width{ 8 };		// one avx2 register of depth values
+		constexpr uint32_t tile_height{ 8 };
+		constexpr uint32_t objects_per_job{ 256 };
+
+		using triangle = culler::triangle;
+		using clock = std::chrono::steady_clock;
+
+		double elapsed_ms(clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		}
+
+		bool has_avx2()
+		{
+#if defined(OCCLUSION_X64) && defined(_MSC_VER)
+			int info[4]{};
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+
+			// the os must save the ymm registers on context switches
+			__cpuid(info, 1);
+			const bool osxsave{ (info[2] & (1 << 27)) != 0 }, avx{ (info[2] & (1 << 28)) != 0 };
+			if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+				return false;
+
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#elif defined(OCCLUSION_X64)
+			return __builtin_cpu_supports("avx2");
+#else
+			return false;
+#endif
+		}
+
+		glm::vec4 lerp(const glm::vec4& a, const glm::vec4& b, float t)
+		{
+			return a + (b - a) * t;
+		}
+
+		// edge function through a and b, positive on the side of the third vertex of a triangle with positive area
+		void setup_edge(float ax, float ay, float bx, float by, float& out_a, float& out_b, float& out_c)
+		{
+			out_a = ay - by;
+			out_b = bx - ax;
+			out_c = ax * by - ay * bx;
+		}
+
+		bool setup_triangle(const glm::vec4 (&clip)[3], uint32_t width, uint32_t height, bool cull_backfaces, triangle& out)
+		{
+			float x[3], y[3], z[3];
+			for (uint32_t i{ 0 }; i < 3; ++i)
+			{
+				const float inv_w{ 1.f / clip[i].w };
+				x[i] = (clip[i].x * inv_w * 0.5f + 0.5f) * (float)width;
+				y[i] = (clip[i].y * inv_w * 0.5f + 0.5f) * (float)height;
+				z[i] = inv_w;
+			}
+
+			// y points down the screen, so counter-clockwise front faces have a negative area here
+			float area{ (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]) };
+			if (area == 0.f || (cull_backfaces && area > 0.f))
+				return false;
+			if (area < 0.f)
+			{
+				std::swap(x[1], x[2]);
+				std::swap(y[1], y[2]);
+				std::swap(z[1], z[2]);
+				area = -area;
+			}
+
+			const float min_x{ std::max(std::floor(std::min({ x[0], x[1], x[2] })), 0.f) };
+			const float max_x{ std::min(std::ceil(std::max({ x[0], x[1], x[2] })), (float)width) };
+			const float min_y{ std::max(std::floor(std::min({ y[0], y[1], y[2] })), 0.f) };
+			const float max_y{ std::min(std::ceil(std::max({ y[0], y[1], y[2] })), (float)height) };
+			if (min_x >= max_x || min_y >= max_y)
+				return false;
+
+			out.min_x = (uint32_t)min_x;
+			out.max_x = (uint32_t)max_x;
+			out.min_y = (uint32_t)min_y;
+			out.max_y = (uint32_t)max_y;
+
+			// edge i is opposite vertex i, so its function is the barycentric weight of that vertex times the area
+			setup_edge(x[1], y[1], x[2], y[2], out.a[0], out.b[0], out.c[0]);
+			setup_edge(x[2], y[2], x[0], y[0], out.a[1], out.b[1], out.c[1]);
+			setup_edge(x[0], y[0], x[1], y[1], out.a[2], out.b[2], out.c[2]);
+
+			const float inv_area{ 1.f / area };
+			out.z_x = (out.a[0] * z[0] + out.a[1] * z[1] + out.a[2] * z[2]) * inv_area;
+			out.z_y = (out.b[0] * z[0] + out.b[1] * z[1] + out.b[2] * z[2]) * inv_area;
+			out.z_c = (out.c[0] * z[0] + out.c[1] * z[1] + out.c[2] * z[2]) * inv_area;
+			return true;
+		}
+
+		// pixel centers inside the triangle keep the nearest depth, the larger 1 / w
+		void rasterize_scalar(const triangle& t, float* depth, uint32_t width, uint32_t first_row, uint32_t end_row)
+		{
+			for (uint32_t y{ first_row }; y < end_row; ++y)
+			{
+				const float py{ (float)y + 0.5f };
+				float* row{ depth + (size_t)y * width };
+				for (uint32_t x{ t.min_x }; x < t.max_x; ++x)
+				{
+					const float px{ (float)x + 0.5f };
+					if (t.a[0] * px + (t.b[0] * py + t.c[0]) >= 0.f && t.a[1] * px + (t.b[1] * py + t.c[1]) >= 0.f &&
+						t.a[2] * px + (t.b[2] * py + t.c[2]) >= 0.f)
+					{
+						row[x] = std::max(row[x], t.z_x * px + (t.z_y * py + t.z_c));
+					}
+				}
+			}
+		}
+
+		float tile_min_scalar(const float* depth, uint32_t width)
+		{
+			float result{ depth[0] };
+			for (uint32_t y{ 0 }; y < tile_height; ++y)
+			{
+				for (uint32_t x{ 0 }; x < tile_width; ++x)
+					result = std::min(result, depth[(size_t)y * width + x]);
+			}
+			return result;
+		}
+
+		// true when a pixel in rows [0, rows) and columns [first_column, end_column) of the tile is farther than z
+		bool tile_visible_scalar(const float* depth, uint32_t width, uint32_t rows, uint32_t first_column, uint32_t end_column, float z)
+		{
+			for (uint32_t y{ 0 }; y < rows; ++y)
+			{
+				for (uint32_t x{ first_column }; x < end_column; ++x)
+				{
+					if (depth[(size_t)y * width + x] < z)
+						return true;
+				}
+			}
+			return false;
+		}
+
+#ifdef OCCLUSION_X64
+		// the scalar version eight pixels at a time, with the same order of operations so both produce the same depth
+		AVX2_FUNCTION void rasterize_avx2(const triangle& t, float* depth, uint32_t width, uint32_t first_row, uint32_t end_row)
+		{
+			const __m256 lane_centers{ _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f) };
+			const __m256 zero{ _mm256_setzero_ps() };
+			const __m256 a0{ _mm256_set1_ps(t.a[0]) }, a1{ _mm256_set1_ps(t.a[1]) }, a2{ _mm256_set1_ps(t.a[2]) };
+			const __m256 z_x{ _mm256_set1_ps(t.z_x) };
+			const uint32_t first_x{ t.min_x & ~(tile_width - 1) };
+
+			for (uint32_t y{ first_row }; y < end_row; ++y)
+			{
+				const float py{ (float)y + 0.5f };
+				const __m256 row0{ _mm256_set1_ps(t.b[0] * py + t.c[0]) };
+				const __m256 row1{ _mm256_set1_ps(t.b[1] * py + t.c[1]) };
+				const __m256 row2{ _mm256_set1_ps(t.b[2] * py + t.c[2]) };
+				const __m256 row_z{ _mm256_set1_ps(t.z_y * py + t.z_c) };
+				float* row{ depth + (size_t)y * width };
+
+				for (uint32_t x{ first_x }; x < t.max_x; x += tile_width)
+				{
+					const __m256 px{ _mm256_add_ps(_mm256_set1_ps((float)x), lane_centers) };
+					const __m256 e0{ _mm256_add_ps(_mm256_mul_ps(a0, px), row0) };
+					const __m256 e1{ _mm256_add_ps(_mm256_mul_ps(a1, px), row1) };
+					const __m256 e2{ _mm256_add_ps(_mm256_mul_ps(a2, px), row2) };
+					const __m256 inside{ _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)),
+													   _mm256_cmp_ps(e2, zero, _CMP_GE_OQ)) };
+					if (!_mm256_movemask_ps(inside))
+						continue;
+
+					const __m256 z{ _mm256_add_ps(_mm256_mul_ps(z_x, px), row_z) };
+					const __m256 current{ _mm256_loadu_ps(row + x) };
+					_mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_max_ps(current, z), inside));
+				}
+			}
+		}
+
+		AVX2_FUNCTION float tile_min_avx2(const float* depth, uint32_t width)
+		{
+			__m256 result{ _mm256_loadu_ps(depth) };
+			for (uint32_t y{ 1 }; y < tile_height; ++y)
+				result = _mm256_min_ps(result, _mm256_loadu_ps(depth + (size_t)y * width));
+
+			__m128 half{ _mm_min_ps(_mm256_castps256_ps128(result), _mm256_extractf128_ps(result, 1)) };
+			half = _mm_min_ps(half, _mm_movehl_ps(half, half));
+			half = _mm_min_ss(half, _mm_shuffle_ps(half, half, 1));
+			return _mm_cvtss_f32(half);
+		}
+
+		AVX2_FUNCTION bool tile_visible_avx2(const float* depth, uint32_t width, uint32_t rows, uint32_t first_column, uint32_t end_column, float z)
+		{
+			const int columns{ (int)(((1u << end_column) - 1) & ~((1u << first_column) - 1)) };
+			const __m256 object_z{ _mm256_set1_ps(z) };
+			for (uint32_t y{ 0 }; y < rows; ++y)
+			{
+				const __m256 farther{ _mm256_cmp_ps(_mm256_loadu_ps(depth + (size_t)y * width), object_z, _CMP_LT_OQ) };
+				if (_mm256_movemask_ps(farther) & columns)
+					return true;
+			}
+			return false;
+		}
+#endif
+
+	} // anonymous namespace
+
+	culler::culler(const settings& settings)
+		: _settings{ settings }
+	{
+		_tiles_x = std::max((settings.width + tile_width - 1) / tile_width, 1u);
+		_tiles_y = std::max((settings.height + tile_height - 1) / tile_height, 1u);
+		_width = _tiles_x * tile_width;
+		_height = _tiles_y * tile_height;
+		_depth.resize((size_t)_width * _height, 0.f);
+		_hiz.resize((size_t)_tiles_x * _tiles_y, 0.f);
+		_avx2 = settings.use_avx2 && has_avx2();
+	}
+
+	void culler::begin(const glm::mat4& view_projection)
+	{
+		_view_projection = view_projection;
+		_occluders.clear();
+		_statistics = {};
+		_statistics.avx2 = _avx2;
+	}
+
+	void culler::add_occluder(const mesh& occluder, const glm::mat4& model)
+	{
+		_occluders.push_back({ &occluder, _view_projection * model });
+		_statistics.triangles_submitted += (uint32_t)occluder.indices.size() / 3;
+	}
+
+	void culler::setup_triangles(uint32_t index)
+	{
+		thread_local std::vector<glm::vec4> clip_vertices{};
+
+		const occluder& o{ _occluders[index] };
+		const std::vector<vertex>& vertices{ o.source->vertices };
+		const std::vector<uint32_t>& indices{ o.source->indices };
+		std::vector<triangle>& triangles{ _triangles[index] };
+		triangles.clear();
+
+		clip_vertices.resize(vertices.size());
+		for (size_t i{ 0 }; i < vertices.size(); ++i)
+			clip_vertices[i] = o.transform * glm::vec4{ vertices[i].position, 1.f };
+
+		for (size_t i{ 0 }; i + 2 < indices.size(); i += 3)
+		{
+			const glm::vec4 corners[3]{ clip_vertices[indices[i]], clip_vertices[indices[i + 1]], clip_vertices[indices[i + 2]] };
+
+			// clip against the near plane, z >= 0, which leaves a triangle or a quad
+			glm::vec4 polygon[4];
+			uint32_t count{ 0 };
+			for (uint32_t j{ 0 }; j < 3; ++j)
+			{
+				const glm::vec4& a{ corners[j] };
+				const glm::vec4& b{ corners[(j + 1) % 3] };
+				if (a.z >= 0.f)
+					polygon[count++] = a;
+				if ((a.z >= 0.f) != (b.z >= 0.f))
+					polygon[count++] = lerp(a, b, a.z / (a.z - b.z));
+			}
+
+			for (uint32_t j{ 2 }; j < count; ++j)
+			{
+				const glm::vec4 clipped[3]{ polygon[0], polygon[j - 1], polygon[j] };
+				if (clipped[0].w <= 0.f || clipped[1].w <= 0.f || clipped[2].w <= 0.f)
+					continue;
+
+				triangle t{};
+				if (setup_triangle(clipped, _width, _height, _settings.cull_backfaces, t))
+					triangles.push_back(t);
+			}
+		}
+	}
+
+	void culler::rasterize_band(uint32_t first_tile_row, uint32_t end_tile_row)
+	{
+		const uint32_t first_row{ first_tile_row * tile_height }, end_row{ end_tile_row * tile_height };
+		float* depth{ _depth.data() };
+		std::fill(depth + (size_t)first_row * _width, depth + (size_t)end_row * _width, 0.f);
+
+		for (uint32_t i{ 0 }; i < (uint32_t)_occluders.size(); ++i)
+		{
+			for (const triangle& t : _triangles[i])
+			{
+				const uint32_t y0{ std::max(t.min_y, first_row) }, y1{ std::min(t.max_y, end_row) };
+				if (y0 >= y1)
+					continue;
+#ifdef OCCLUSION_X64
+				if (_avx2)
+				{
+					rasterize_avx2(t, depth, _width, y0, y1);
+					continue;
+				}
+#endif
+				rasterize_scalar(t, depth, _width, y0, y1);
+			}
+		}
+
+		for (uint32_t ty{ first_tile_row }; ty < end_tile_row; ++ty)
+		{
+			for (uint32_t tx{ 0 }; tx < _tiles_x; ++tx)
+			{
+				const float* tile{ depth + (size_t)ty * tile_height * _width + tx * tile_width };
+#ifdef OCCLUSION_X64
+				if (_avx2)
+				{
+					_hiz[(size_t)ty * _tiles_x + tx] = tile_min_avx2(tile, _width);
+					continue;
+				}
+#endif
+				_hiz[(size_t)ty * _tiles_x + tx] = tile_min_scalar(tile, _width);
+			}
+		}
+	}
+
+	void culler::rasterize()
+	{
+		const clock::time_point start{ clock::now() };
+		const uint32_t occluder_count{ (uint32_t)_occluders.size() };
+		if (_triangles.size() < occluder_count)
+			_triangles.resize(occluder_count);
+
+		jobs::parallel_for(occluder_count, [this](uint32_t i) { setup_triangles(i); });
+		_statistics.triangles_rasterized = 0;
+		for (uint32_t i{ 0 }; i < occluder_count; ++i)
+			_statistics.triangles_rasterized += (uint32_t)_triangles[i].size();
+
+		// every band tests all triangles against its rows, so a few bands per thread balance the load without much setup
+		const uint32_t band_count{ std::min(_tiles_y, (jobs::get_worker_count() + 1) * 2) };
+		jobs::parallel_for(band_count, [this, band_count](uint32_t band) {
+			rasterize_band(band * _tiles_y / band_count, (band + 1) * _tiles_y / band_count);
+		});
+
+		_statistics.occluders = occluder_count;
+		_statistics.rasterize_ms = elapsed_ms(start);
+	}
+
+	bool culler::is_visible(const bvh::aabb& bounds) const
+	{
+		float min_x{ FLT_MAX }, min_y{ FLT_MAX }, max_x{ -FLT_MAX }, max_y{ -FLT_MAX }, min_w{ FLT_MAX };
+		for (uint32_t i{ 0 }; i < 8; ++i)
+		{
+			const glm::vec4 corner{ i & 1 ? bounds.max.x : bounds.min.x, i & 2 ? bounds.max.y : bounds.min.y, i & 4 ? bounds.max.z : bounds.min.z, 1.f };
+			const glm::vec4 clip{ _view_projection * corner };
+			if (clip.z < 0.f || clip.w <= 0.f)
+				return true;
+
+			const float inv_w{ 1.f / clip.w };
+			const float x{ (clip.x * inv_w * 0.5f + 0.5f) * (float)_width };
+			const float y{ (clip.y * inv_w * 0.5f + 0.5f) * (float)_height };
+			min_x = std::min(min_x, x);
+			max_x = std::max(max_x, x);
+			min_y = std::min(min_y, y);
+			max_y = std::max(max_y, y);
+			min_w = std::min(min_w, clip.w);
+		}
+
+		if (max_x < 0.f || max_y < 0.f || min_x > (float)_width || min_y > (float)_height)
+			return false;
+
+		// every pixel the box touches, at least one
+		const uint32_t x0{ (uint32_t)std::clamp(std::floor(min_x), 0.f, (float)_width - 1.f) };
+		const uint32_t y0{ (uint32_t)std::clamp(std::floor(min_y), 0.f, (float)_height - 1.f) };
+		const uint32_t x1{ std::max((uint32_t)std::clamp(std::ceil(max_x), 0.f, (float)_width), x0 + 1) };
+		const uint32_t y1{ std::max((uint32_t)std::clamp(std::ceil(max_y), 0.f, (float)_height), y0 + 1) };
+
+		// the nearest point of the box, visible wherever an occluder is farther
+		const float z{ 1.f / min_w };
+		for (uint32_t ty{ y0 / tile_height }; ty <= (y1 - 1) / tile_height; ++ty)
+		{
+			for (uint32_t tx{ x0 / tile_width }; tx <= (x1 - 1) / tile_width; ++tx)
+			{
+				if (_hiz[(size_t)ty * _tiles_x + tx] >= z)
+					continue;
+
+				const uint32_t row0{ std::max(y0, ty * tile_height) }, row1{ std::min(y1, (ty + 1) * tile_height) };
+				const uint32_t column0{ std::max(x0, tx * tile_width) - tx * tile_width };
+				const uint32_t column1{ std::min(x1, (tx + 1) * tile_width) - tx * tile_width };
+				const float* tile{ _depth.data() + (size_t)row0 * _width + tx * tile_width };
+#ifdef OCCLUSION_X64
+				if (_avx2)
+				{
+					if (tile_visible_avx2(tile, _width, row1 - row0, column0, column1, z))
+						return true;
+					continue;
+				}
+#endif
+				if (tile_visible_scalar(tile, _width, row1 - row0, column0, column1, z))
+					return true;
+			}
+		}
+
+		return false;
+	}
+
+	void culler::filter(const bvh::scene& scene, std::vector<uint32_t>& objects)
+	{
+		const clock::time_point start{ clock::now() };
+		const uint32_t count{ (uint32_t)objects.size() };
+		_visible.resize(count);
+
+		jobs::parallel_for((count + objects_per_job - 1) / objects_per_job, [&](uint32_t job) {
+			const uint32_t end{ std::min(count, (job + 1) * objects_per_job) };
+			for (uint32_t i{ job * objects_per_job }; i < end; ++i)
+				_visible[i] = is_visible(scene.get_bounds(objects[i]));
+		});
+
+		uint32_t kept{ 0 };
+		for (uint32_t i{ 0 }; i < count; ++i)
+		{
+			if (_visible[i])
+				objects[kept++] = objects[i];
+		}
+		objects.resize(kept);
+
+		_statistics.objects_tested += count;
+		_statistics.objects_occluded += count - kept;
+		_statistics.test_ms += elapsed_ms(start);
+	}
+}
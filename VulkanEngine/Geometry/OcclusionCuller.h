@@ -0,0 +1,103 @@
+#pragma once
+#include "Bvh.h"
+#include "Mesh.h"
+
+#include <glm/mat4x4.hpp>
+
+namespace renderer::geometry::occlusion
+{
+	struct settings
+	{
+		// resolution of the depth buffer, rounded up to whole tiles of 8x8 pixels
+		uint32_t	width{ 512 };
+		uint32_t	height{ 256 };
+		bool		cull_backfaces{ false };	// counter-clockwise front faces, off since walls are often single sided planes
+		bool		use_avx2{ true };			// falls back to the scalar path when the cpu has no avx2
+	};
+
+	struct statistics
+	{
+		uint32_t	occluders{ 0 };
+		uint32_t	triangles_submitted{ 0 };
+		uint32_t	triangles_rasterized{ 0 };	// after near plane clipping, backface and zero area rejection
+		uint32_t	objects_tested{ 0 };
+		uint32_t	objects_occluded{ 0 };
+		double		rasterize_ms{ 0 };
+		double		test_ms{ 0 };
+		bool		avx2{ false };
+	};
+
+	// cpu occlusion culling against a low resolution depth buffer. selected occluders, large and simple meshes such as
+	// walls and floors, are rasterized into it and object bounds are tested against it before their draws are emitted.
+	// depth is stored as 1 / w so it interpolates linearly in screen space, with a per tile minimum as the hierarchical
+	// level: a box is culled tile by tile and only tiles whose minimum does not hide it are tested pixel by pixel.
+	//
+	// one frame: begin, add_occluder for every occluder, rasterize, then any number of concurrent tests. rasterize may
+	// run as a job while the gpu still works on the previous frame, it splits the buffer into bands over the job system.
+	class culler
+	{
+	public:
+		explicit culler(const settings& settings = {});
+		culler(const culler&) = delete;
+		culler& operator=(const culler&) = delete;
+
+		// expects a zero-to-one depth range projection, like culling::extract_frustum
+		void begin(const glm::mat4& view_projection);
+
+		// the mesh is referenced, not copied, and must stay alive until rasterize returns
+		void add_occluder(const mesh& occluder, const glm::mat4& model);
+
+		void rasterize();
+
+		// false when the box is fully behind occluders or outside the screen. boxes crossing the near plane are visible
+		[[nodiscard]] bool is_visible(const bvh::aabb& bounds) const;
+
+		// removes occluded objects from a list of scene objects, e.g. the result of a frustum query, keeping their order
+		void filter(const bvh::scene& scene, std::vector<uint32_t>& objects);
+
+		[[nodiscard]] uint32_t get_width() const { return _width; }
+		[[nodiscard]] uint32_t get_height() const { return _height; }
+		// row major 1 / w per pixel, 0 where nothing was drawn, for debug views
+		[[nodiscard]] const float* get_depth() const { return _depth.data(); }
+		[[nodiscard]] const statistics& get_statistics() const { return _statistics; }
+
+		// edge functions a * x + b * y + c are positive inside, depth is the plane z_x * x + z_y * y + z_c
+		struct triangle
+		{
+			float		a[3];
+			float		b[3];
+			float		c[3];
+			float		z_x;
+			float		z_y;
+			float		z_c;
+			uint32_t	min_x;
+			uint32_t	max_x;		// exclusive
+			uint32_t	min_y;
+			uint32_t	max_y;		// exclusive
+		};
+
+	private:
+		struct occluder
+		{
+			const mesh*		source;
+			glm::mat4		transform;		// view_projection * model
+		};
+
+		void setup_triangles(uint32_t occluder);
+		void rasterize_band(uint32_t first_tile_row, uint32_t end_tile_row);
+
+		settings									_settings;
+		uint32_t									_width;
+		uint32_t									_height;
+		uint32_t									_tiles_x;
+		uint32_t									_tiles_y;
+		bool										_avx2{ false };
+		glm::mat4									_view_projection{ 1.f };
+		std::vector<float>							_depth;
+		std::vector<float>							_hiz;				// farthest depth of each tile
+		std::vector<occluder>						_occluders;
+		std::vector<std::vector<triangle>>			_triangles;			// per occluder, reused between frames
+		std::vector<uint8_t>						_visible;
+		statistics									_statistics{};
+	};
+}
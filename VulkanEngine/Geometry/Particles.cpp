@@ -0,0 +1,258 @@
+#include "Particles.h"
+#include "../Utilities/JobSystem.h"
+#include "../Utilities/RadixSort.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PARTICLES_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace renderer::geometry::particles
+{
+	namespace
+	{
+		constexpr uint32_t particles_per_job{ 16384 };	// multiple of four so chunks start on whole sse registers
+
+		enum stream : uint32_t
+		{
+			position_x,
+			position_y,
+			position_z,
+			velocity_x,
+			velocity_y,
+			velocity_z,
+			age,
+			lifetime,
+		};
+
+		// population count of a four lane mask
+		constexpr uint32_t lane_counts[16]{ 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+		uint32_t chunk_count(uint32_t count)
+		{
+			return (count + particles_per_job - 1) / particles_per_job;
+		}
+
+		// lanes of the group of four starting at i that hold particles below end
+		uint32_t valid_lanes(uint32_t i, uint32_t end)
+		{
+			return end - i >= 4 ? 0xf : (1u << (end - i)) - 1;
+		}
+
+		float random_unit(uint32_t& state)
+		{
+			state = hash(state);
+			return (float)(state >> 8) * (1.f / 16777216.f);
+		}
+
+	} // anonymous namespace
+
+	uint32_t hash(uint32_t x)
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+		return x;
+	}
+
+	particle spawn(const emitter& source, uint32_t seed, uint32_t index)
+	{
+		uint32_t state{ hash(index + hash(seed)) };
+		particle p{};
+		p.position.x = source.position.x + source.radius * (random_unit(state) * 2.f - 1.f);
+		p.position.y = source.position.y + source.radius * (random_unit(state) * 2.f - 1.f);
+		p.position.z = source.position.z + source.radius * (random_unit(state) * 2.f - 1.f);
+		p.velocity.x = source.velocity.x + source.velocity_spread * (random_unit(state) * 2.f - 1.f);
+		p.velocity.y = source.velocity.y + source.velocity_spread * (random_unit(state) * 2.f - 1.f);
+		p.velocity.z = source.velocity.z + source.velocity_spread * (random_unit(state) * 2.f - 1.f);
+		p.lifetime = source.min_lifetime + (source.max_lifetime - source.min_lifetime) * random_unit(state);
+		return p;
+	}
+
+	void integrate(particle& p, const forces& forces, float delta_time)
+	{
+		const float damping{ std::max(0.f, 1.f - forces.drag * delta_time) };
+		p.velocity = (p.velocity + forces.gravity * delta_time) * damping;
+		p.position += p.velocity * delta_time;
+		p.age += delta_time;
+	}
+
+	uint32_t depth_key(float view_depth)
+	{
+		uint32_t bits{ 0 };
+		memcpy(&bits, &view_depth, sizeof(bits));
+		// flips negative floats completely and positive ones only in the sign so the keys order like the floats
+		return bits ^ ((bits >> 31) ? 0xffffffffu : 0x80000000u);
+	}
+
+	simulator::simulator(uint32_t capacity)
+		: _capacity{ capacity }
+	{
+		// padded to whole sse registers, the padding is integrated along with the last particles and never read back
+		const size_t padded{ ((size_t)capacity + 3) & ~(size_t)3 };
+		for (uint32_t s{ 0 }; s < stream_count; ++s)
+		{
+			_current.data[s].resize(padded, 0.f);
+			_next.data[s].resize(padded, 0.f);
+		}
+	}
+
+	uint32_t simulator::emit(const emitter& source, uint32_t count, uint32_t seed)
+	{
+		count = std::min(count, _capacity - _size);
+		float* data[stream_count]{};
+		for (uint32_t s{ 0 }; s < stream_count; ++s)
+			data[s] = _current.data[s].data() + _size;
+
+		for (uint32_t i{ 0 }; i < count; ++i)
+		{
+			const particle p{ spawn(source, seed, i) };
+			data[position_x][i] = p.position.x;
+			data[position_y][i] = p.position.y;
+			data[position_z][i] = p.position.z;
+			data[velocity_x][i] = p.velocity.x;
+			data[velocity_y][i] = p.velocity.y;
+			data[velocity_z][i] = p.velocity.z;
+			data[age][i] = p.age;
+			data[lifetime][i] = p.lifetime;
+		}
+
+		_size += count;
+		return count;
+	}
+
+	void simulator::simulate(const forces& forces, float delta_time)
+	{
+		if (!_size)
+			return;
+
+		const uint32_t chunks{ chunk_count(_size) };
+		_chunk_offsets.assign(chunks + 1, 0);
+		const float damping{ std::max(0.f, 1.f - forces.drag * delta_time) };
+
+		// integrates each chunk and counts its survivors
+		jobs::parallel_for(chunks, [&](uint32_t chunk) {
+			const uint32_t begin{ chunk * particles_per_job };
+			const uint32_t end{ std::min(_size, begin + particles_per_job) };
+			float* px{ _current.data[position_x].data() };
+			float* py{ _current.data[position_y].data() };
+			float* pz{ _current.data[position_z].data() };
+			float* vx{ _current.data[velocity_x].data() };
+			float* vy{ _current.data[velocity_y].data() };
+			float* vz{ _current.data[velocity_z].data() };
+			float* ages{ _current.data[age].data() };
+			const float* lifetimes{ _current.data[lifetime].data() };
+			uint32_t survivors{ 0 };
+
+#if PARTICLES_SSE
+			const __m128 dt{ _mm_set1_ps(delta_time) };
+			const __m128 damp{ _mm_set1_ps(damping) };
+			const __m128 gx{ _mm_set1_ps(forces.gravity.x * delta_time) };
+			const __m128 gy{ _mm_set1_ps(forces.gravity.y * delta_time) };
+			const __m128 gz{ _mm_set1_ps(forces.gravity.z * delta_time) };
+
+			for (uint32_t i{ begin }; i < end; i += 4)
+			{
+				const __m128 new_vx{ _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vx + i), gx), damp) };
+				const __m128 new_vy{ _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vy + i), gy), damp) };
+				const __m128 new_vz{ _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vz + i), gz), damp) };
+				_mm_storeu_ps(vx + i, new_vx);
+				_mm_storeu_ps(vy + i, new_vy);
+				_mm_storeu_ps(vz + i, new_vz);
+				_mm_storeu_ps(px + i, _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(new_vx, dt)));
+				_mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(new_vy, dt)));
+				_mm_storeu_ps(pz + i, _mm_add_ps(_mm_loadu_ps(pz + i), _mm_mul_ps(new_vz, dt)));
+
+				const __m128 new_age{ _mm_add_ps(_mm_loadu_ps(ages + i), dt) };
+				_mm_storeu_ps(ages + i, new_age);
+				const uint32_t alive{ (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(new_age, _mm_loadu_ps(lifetimes + i))) };
+				survivors += lane_counts[alive & valid_lanes(i, end)];
+			}
+#else
+			for (uint32_t i{ begin }; i < end; ++i)
+			{
+				vx[i] = (vx[i] + forces.gravity.x * delta_time) * damping;
+				vy[i] = (vy[i] + forces.gravity.y * delta_time) * damping;
+				vz[i] = (vz[i] + forces.gravity.z * delta_time) * damping;
+				px[i] += vx[i] * delta_time;
+				py[i] += vy[i] * delta_time;
+				pz[i] += vz[i] * delta_time;
+				ages[i] += delta_time;
+				survivors += ages[i] < lifetimes[i] ? 1 : 0;
+			}
+#endif
+			_chunk_offsets[chunk + 1] = survivors;
+		});
+
+		for (uint32_t chunk{ 0 }; chunk < chunks; ++chunk)
+			_chunk_offsets[chunk + 1] += _chunk_offsets[chunk];
+
+		const uint32_t survivors{ _chunk_offsets[chunks] };
+		if (survivors == _size)
+			return;
+
+		// every chunk writes its survivors at its prefix offset, in order
+		jobs::parallel_for(chunks, [&](uint32_t chunk) {
+			const uint32_t begin{ chunk * particles_per_job };
+			const uint32_t end{ std::min(_size, begin + particles_per_job) };
+			const float* ages{ _current.data[age].data() };
+			const float* lifetimes{ _current.data[lifetime].data() };
+			uint32_t write{ _chunk_offsets[chunk] };
+
+			for (uint32_t i{ begin }; i < end; ++i)
+			{
+				if (ages[i] >= lifetimes[i])
+					continue;
+				for (uint32_t s{ 0 }; s < stream_count; ++s)
+					_next.data[s][write] = _current.data[s][i];
+				++write;
+			}
+		});
+
+		std::swap(_current, _next);
+		_size = survivors;
+	}
+
+	void simulator::sort(const glm::mat4& view, std::vector<uint32_t>& out_order)
+	{
+		out_order.resize(_size);
+		_keys.resize(_size);
+		_scratch_keys.resize(_size);
+		_scratch_values.resize(_size);
+
+		// view space z, the third row of the view matrix
+		const float rx{ view[0][2] }, ry{ view[1][2] }, rz{ view[2][2] }, rw{ view[3][2] };
+		jobs::parallel_for(chunk_count(_size), [&](uint32_t chunk) {
+			const uint32_t begin{ chunk * particles_per_job };
+			const uint32_t end{ std::min(_size, begin + particles_per_job) };
+			const float* px{ _current.data[position_x].data() };
+			const float* py{ _current.data[position_y].data() };
+			const float* pz{ _current.data[position_z].data() };
+
+			for (uint32_t i{ begin }; i < end; ++i)
+			{
+				_keys[i] = depth_key(rx * px[i] + ry * py[i] + rz * pz[i] + rw);
+				out_order[i] = i;
+			}
+		});
+
+		sorting::radix_sort(_keys.data(), out_order.data(), _size, _scratch_keys.data(), _scratch_values.data());
+	}
+
+	particle simulator::get(uint32_t index) const
+	{
+		assert(index < _size);
+		particle p{};
+		p.position = { _current.data[position_x][index], _current.data[position_y][index], _current.data[position_z][index] };
+		p.velocity = { _current.data[velocity_x][index], _current.data[velocity_y][index], _current.data[velocity_z][index] };
+		p.age = _current.data[age][index];
+		p.lifetime = _current.data[lifetime][index];
+		return p;
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace renderer::geometry::particles
+{
+	// std430 compatible, the layout of the particle buffer of the gpu simulation
+	struct particle
+	{
+		glm::vec3	position{};
+		float		age{ 0.f };			// seconds since emission, dead once it reaches lifetime
+		glm::vec3	velocity{};
+		float		lifetime{ 0.f };
+	};
+	static_assert(sizeof(particle) == 32);
+
+	// particles spawn in a cube of half size radius around position, with velocity offset by up to velocity_spread on
+	// each axis and a lifetime between min_lifetime and max_lifetime
+	struct emitter
+	{
+		glm::vec3	position{};
+		float		radius{ 1.f };
+		glm::vec3	velocity{ 0.f, 5.f, 0.f };
+		float		velocity_spread{ 1.f };
+		float		min_lifetime{ 1.f };
+		float		max_lifetime{ 2.f };
+	};
+
+	struct forces
+	{
+		glm::vec3	gravity{ 0.f, -9.81f, 0.f };
+		float		drag{ 0.1f };		// fraction of the velocity lost per second
+	};
+
+	// the integer hash the shaders use, emission with the same seed spawns the same particles on both paths
+	uint32_t hash(uint32_t x);
+	// particle index of one emit call, the random values are derived from hash(seed) and index
+	particle spawn(const emitter& source, uint32_t seed, uint32_t index);
+	// explicit euler step, identical to particle_simulate.comp
+	void integrate(particle& p, const forces& forces, float delta_time);
+	// 32 bit key sorting view space depths back to front (farthest first) for a right handed view looking down -z
+	uint32_t depth_key(float view_depth);
+
+	// cpu fallback of the gpu simulation for headless tests and machines without the compute path. particles are kept as
+	// structure of arrays, integrated four at a time with sse and in parallel chunks on the job system, and compacted
+	// every step so the live particles stay contiguous
+	class simulator
+	{
+	public:
+		explicit simulator(uint32_t capacity);
+		simulator(const simulator&) = delete;
+		simulator& operator=(const simulator&) = delete;
+
+		// spawns up to count particles, fewer when the capacity runs out. returns how many were spawned
+		uint32_t emit(const emitter& source, uint32_t count, uint32_t seed);
+		// integrates every particle and removes the ones that died, the survivors keep their relative order
+		void simulate(const forces& forces, float delta_time);
+		// particle indices in back to front order for the view, for alpha blended drawing
+		void sort(const glm::mat4& view, std::vector<uint32_t>& out_order);
+		void clear() { _size = 0; }
+
+		[[nodiscard]] uint32_t size() const { return _size; }
+		[[nodiscard]] uint32_t capacity() const { return _capacity; }
+		[[nodiscard]] particle get(uint32_t index) const;
+
+	private:
+		// position x, y, z, velocity x, y, z, age, lifetime
+		static constexpr uint32_t stream_count{ 8 };
+
+		struct streams
+		{
+			std::vector<float>	data[stream_count];
+		};
+
+		streams					_current{};
+		streams					_next{};			// compaction target, swapped with _current after every step
+		std::vector<uint32_t>	_chunk_offsets{};
+		std::vector<uint64_t>	_keys{};
+		std::vector<uint64_t>	_scratch_keys{};
+		std::vector<uint32_t>	_scratch_values{};
+		uint32_t				_capacity{ 0 };
+		uint32_t				_size{ 0 };
+	};
+}
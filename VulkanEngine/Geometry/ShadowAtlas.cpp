@@ -0,0 +1,199 @@
+#include "ShadowAtlas.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace renderer::geometry::shadows
+{
+	namespace
+	{
+		uint32_t round_up_pow2(uint32_t v)
+		{
+			uint32_t result{ 1 };
+			while (result < v)
+				result <<= 1;
+			return result;
+		}
+
+		bool is_pow2(uint32_t v)
+		{
+			return v && !(v & (v - 1));
+		}
+
+	} // anonymous namespace
+
+	void quadtree_atlas::init(uint32_t atlas_size, uint32_t min_tile_size)
+	{
+		assert(is_pow2(atlas_size) && is_pow2(min_tile_size) && min_tile_size <= atlas_size);
+		_atlas_size = atlas_size;
+		_max_level = 0;
+		while ((atlas_size >> _max_level) > min_tile_size)
+			++_max_level;
+
+		_states.resize(_max_level + 1);
+		_free_nodes.resize(_max_level + 1);
+		for (uint32_t level{ 0 }; level <= _max_level; ++level)
+			_states[level].resize((size_t)1 << (2 * level));
+
+		reset();
+	}
+
+	void quadtree_atlas::reset()
+	{
+		for (uint32_t level{ 0 }; level <= _max_level; ++level)
+		{
+			std::fill(_states[level].begin(), _states[level].end(), unused);
+			_free_nodes[level].clear();
+		}
+
+		if (!_states.empty())
+		{
+			_states[0][0] = free_node;
+			_free_nodes[0].push_back(0);
+		}
+		_used_texels = 0;
+	}
+
+	uint32_t quadtree_atlas::level_for_size(uint32_t size) const
+	{
+		const uint32_t tile_size{ std::clamp(round_up_pow2(size), _atlas_size >> _max_level, _atlas_size) };
+		uint32_t level{ 0 };
+		while ((_atlas_size >> level) > tile_size)
+			++level;
+		return level;
+	}
+
+	bool quadtree_atlas::allocate_node(uint32_t level, uint32_t& out_node)
+	{
+		std::vector<uint32_t>& free_nodes{ _free_nodes[level] };
+		if (!free_nodes.empty())
+		{
+			// the lowest index keeps allocations packed towards one corner, which leaves larger blocks free
+			auto lowest{ std::min_element(free_nodes.begin(), free_nodes.end()) };
+			out_node = *lowest;
+			*lowest = free_nodes.back();
+			free_nodes.pop_back();
+			return true;
+		}
+
+		if (level == 0)
+			return false;
+
+		uint32_t parent{ 0 };
+		if (!allocate_node(level - 1, parent))
+			return false;
+
+		_states[level - 1][parent] = split;
+		const uint32_t parent_width{ 1u << (level - 1) };
+		const uint32_t x{ (parent % parent_width) * 2 }, y{ (parent / parent_width) * 2 };
+		const uint32_t width{ 1u << level };
+
+		out_node = x + y * width;
+		for (uint32_t child : { x + 1 + y * width, x + (y + 1) * width, x + 1 + (y + 1) * width })
+		{
+			_states[level][child] = free_node;
+			_free_nodes[level].push_back(child);
+		}
+		return true;
+	}
+
+	void quadtree_atlas::remove_free(uint32_t level, uint32_t node)
+	{
+		std::vector<uint32_t>& free_nodes{ _free_nodes[level] };
+		auto it{ std::find(free_nodes.begin(), free_nodes.end(), node) };
+		assert(it != free_nodes.end());
+		*it = free_nodes.back();
+		free_nodes.pop_back();
+	}
+
+	void quadtree_atlas::release_node(uint32_t level, uint32_t node)
+	{
+		if (level == 0)
+		{
+			_states[0][0] = free_node;
+			_free_nodes[0].push_back(0);
+			return;
+		}
+
+		const uint32_t width{ 1u << level };
+		const uint32_t x{ (node % width) & ~1u }, y{ (node / width) & ~1u };
+		const uint32_t siblings[4]{ x + y * width, x + 1 + y * width, x + (y + 1) * width, x + 1 + (y + 1) * width };
+
+		bool all_free{ true };
+		for (uint32_t sibling : siblings)
+		{
+			if (sibling != node && _states[level][sibling] != free_node)
+				all_free = false;
+		}
+
+		if (!all_free)
+		{
+			_states[level][node] = free_node;
+			_free_nodes[level].push_back(node);
+			return;
+		}
+
+		// merge the four quadrants back into their parent
+		for (uint32_t sibling : siblings)
+		{
+			if (sibling != node)
+				remove_free(level, sibling);
+			_states[level][sibling] = unused;
+		}
+
+		const uint32_t parent_width{ width / 2 };
+		release_node(level - 1, x / 2 + (y / 2) * parent_width);
+	}
+
+	atlas_tile quadtree_atlas::allocate(uint32_t size)
+	{
+		assert(_atlas_size);
+		const uint32_t level{ level_for_size(size) };
+		uint32_t node{ 0 };
+		if (!allocate_node(level, node))
+			return {};
+
+		_states[level][node] = allocated;
+		const uint32_t width{ 1u << level };
+		const uint32_t tile_size{ _atlas_size >> level };
+		_used_texels += (uint64_t)tile_size * tile_size;
+		return { (node % width) * tile_size, (node / width) * tile_size, tile_size, level };
+	}
+
+	void quadtree_atlas::free(const atlas_tile& tile)
+	{
+		if (!tile.is_valid())
+			return;
+
+		assert(tile.level <= _max_level && tile.size == _atlas_size >> tile.level);
+		const uint32_t width{ 1u << tile.level };
+		const uint32_t node{ tile.x / tile.size + (tile.y / tile.size) * width };
+		assert(_states[tile.level][node] == allocated);
+
+		_used_texels -= (uint64_t)tile.size * tile.size;
+		release_node(tile.level, node);
+	}
+
+	uint32_t get_tile_size(float screen_fraction, uint32_t min_size, uint32_t max_size)
+	{
+		assert(is_pow2(min_size) && is_pow2(max_size) && min_size <= max_size);
+		const float size{ std::clamp(screen_fraction, 0.f, 1.f) * (float)max_size };
+
+		// round to the nearest power of two in log space, so a tile is neither much larger nor smaller than needed
+		uint32_t tile_size{ min_size };
+		while (tile_size < max_size && (float)tile_size * 1.41421356f < size)
+			tile_size <<= 1;
+		return tile_size;
+	}
+
+	float get_screen_fraction(float radius, float distance, float projection_scale)
+	{
+		// the camera is inside the light's volume, its shadows cover the whole screen
+		if (distance <= radius)
+			return 1.f;
+
+		const float projected{ radius * std::abs(projection_scale) / std::sqrt(distance * distance - radius * radius) };
+		return std::min(projected, 1.f);
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace renderer::geometry::shadows
+{
+	// square region of the atlas in texels, sizes are powers of two
+	struct atlas_tile
+	{
+		uint32_t	x{ 0 };
+		uint32_t	y{ 0 };
+		uint32_t	size{ 0 };
+		uint32_t	level{ 0 };		// quadtree depth, the whole atlas is level 0
+
+		[[nodiscard]] bool is_valid() const { return size != 0; }
+	};
+
+	// buddy style quadtree: a node is split into four children on demand and merged again once all four are free.
+	// keeps one free list per level, so allocation and free are O(levels) apart from the free list search on merge
+	class quadtree_atlas
+	{
+	public:
+		quadtree_atlas() = default;
+		quadtree_atlas(const quadtree_atlas&) = delete;
+		quadtree_atlas& operator=(const quadtree_atlas&) = delete;
+
+		// atlas_size and min_tile_size are powers of two
+		void init(uint32_t atlas_size, uint32_t min_tile_size);
+		void reset();
+
+		// size is rounded up to a power of two and clamped to [min_tile_size, atlas_size]. invalid tile when full
+		[[nodiscard]] atlas_tile allocate(uint32_t size);
+		void free(const atlas_tile& tile);
+
+		[[nodiscard]] uint32_t get_atlas_size() const { return _atlas_size; }
+		[[nodiscard]] uint32_t get_min_tile_size() const { return _atlas_size >> _max_level; }
+		[[nodiscard]] uint64_t get_used_texels() const { return _used_texels; }
+
+	private:
+		enum node_state : uint8_t
+		{
+			unused,		// covered by a free or allocated ancestor
+			free_node,
+			split,
+			allocated,
+		};
+
+		[[nodiscard]] uint32_t level_for_size(uint32_t size) const;
+		bool allocate_node(uint32_t level, uint32_t& out_node);
+		void release_node(uint32_t level, uint32_t node);
+		void remove_free(uint32_t level, uint32_t node);
+
+		uint32_t							_atlas_size{ 0 };
+		uint32_t							_max_level{ 0 };
+		uint64_t							_used_texels{ 0 };
+		std::vector<std::vector<uint8_t>>	_states;		// per level, node index is x + y * (1 << level)
+		std::vector<std::vector<uint32_t>>	_free_nodes;	// per level
+	};
+
+	// tile size for a shadow caster covering screen_fraction of the screen height (projected light radius over the
+	// half height), rounded to a power of two in [min_size, max_size]
+	uint32_t get_tile_size(float screen_fraction, uint32_t min_size, uint32_t max_size);
+
+	// projected radius of a bounding sphere as a fraction of the screen height. projection_scale is projection[1][1]
+	float get_screen_fraction(float radius, float distance, float projection_scale);
+}
@@ -0,0 +1,294 @@
+#include "Simplifier.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include <glm/geometric.hpp>
+
+namespace renderer::geometry::simplifier
+{
+	namespace
+	{
+		struct quadric
+		{
+			double a00, a01, a02, a03;
+			double		a11, a12, a13;
+			double			 a22, a23;
+			double				  a33;
+			double weight;
+
+			quadric& operator+=(const quadric& q)
+			{
+				a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+				a11 += q.a11; a12 += q.a12; a13 += q.a13;
+				a22 += q.a22; a23 += q.a23;
+				a33 += q.a33;
+				weight += q.weight;
+				return *this;
+			}
+		};
+
+		quadric plane_quadric(const glm::vec3& n, float d, float weight)
+		{
+			quadric q{};
+			q.a00 = weight * n.x * n.x; q.a01 = weight * n.x * n.y; q.a02 = weight * n.x * n.z; q.a03 = weight * n.x * d;
+			q.a11 = weight * n.y * n.y; q.a12 = weight * n.y * n.z; q.a13 = weight * n.y * d;
+			q.a22 = weight * n.z * n.z; q.a23 = weight * n.z * d;
+			q.a33 = weight * d * d;
+			q.weight = weight;
+			return q;
+		}
+
+		// weighted average squared distance of p to the accumulated planes
+		double evaluate(const quadric& q, const glm::vec3& p)
+		{
+			const double x{ p.x }, y{ p.y }, z{ p.z };
+			const double error{ q.a00 * x * x + 2 * q.a01 * x * y + 2 * q.a02 * x * z + 2 * q.a03 * x +
+								q.a11 * y * y + 2 * q.a12 * y * z + 2 * q.a13 * y +
+								q.a22 * z * z + 2 * q.a23 * z +
+								q.a33 };
+			return q.weight > 0.0 ? std::fabs(error) / q.weight : 0.0;
+		}
+
+		struct collapse
+		{
+			uint32_t	from;
+			uint32_t	to;
+			double		error;
+		};
+
+		struct position_hasher
+		{
+			size_t operator()(const glm::vec3& p) const
+			{
+				uint32_t bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				return (size_t)(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+			}
+		};
+
+		struct position_equal
+		{
+			bool operator()(const glm::vec3& a, const glm::vec3& b) const { return memcmp(&a, &b, sizeof(glm::vec3)) == 0; }
+		};
+
+		uint64_t edge_key(uint32_t a, uint32_t b)
+		{
+			return ((uint64_t)a << 32) | b;
+		}
+
+	} // anonymous namespace
+
+	std::vector<uint32_t> simplify(const std::vector<vertex>& vertices, const std::vector<uint32_t>& indices,
+								   uint32_t target_index_count, float target_error, float* out_error)
+	{
+		assert(indices.size() % 3 == 0);
+		const uint32_t vertex_count{ (uint32_t)vertices.size() };
+		std::vector<uint32_t> result{ indices };
+		double max_error{ 0.0 };
+
+		// vertices that share a position (attribute seams) form one group, quadrics are tracked per group
+		std::vector<uint32_t> position_group(vertex_count);
+		std::vector<uint32_t> group_size(vertex_count, 0);
+		{
+			std::unordered_map<glm::vec3, uint32_t, position_hasher, position_equal> groups{};
+			groups.reserve(vertex_count);
+			for (uint32_t v{ 0 }; v < vertex_count; ++v)
+			{
+				position_group[v] = groups.try_emplace(vertices[v].position, v).first->second;
+				++group_size[position_group[v]];
+			}
+		}
+
+		// a vertex may not move when it sits on a seam or on an open border
+		std::vector<bool> locked(vertex_count, false);
+		{
+			std::unordered_map<uint64_t, uint32_t> directed_edges{};
+			directed_edges.reserve(result.size());
+			for (size_t i{ 0 }; i < result.size(); i += 3)
+			{
+				for (uint32_t k{ 0 }; k < 3; ++k)
+				{
+					const uint32_t a{ position_group[result[i + k]] };
+					const uint32_t b{ position_group[result[i + (k + 1) % 3]] };
+					++directed_edges[edge_key(a, b)];
+				}
+			}
+
+			for (size_t i{ 0 }; i < result.size(); i += 3)
+			{
+				for (uint32_t k{ 0 }; k < 3; ++k)
+				{
+					const uint32_t a{ result[i + k] };
+					const uint32_t b{ result[i + (k + 1) % 3] };
+					if (!directed_edges.count(edge_key(position_group[b], position_group[a])))
+						locked[a] = locked[b] = true;
+				}
+			}
+
+			for (uint32_t v{ 0 }; v < vertex_count; ++v)
+			{
+				if (group_size[position_group[v]] > 1)
+					locked[v] = true;
+			}
+		}
+
+		std::vector<quadric> quadrics(vertex_count, quadric{});
+		for (size_t i{ 0 }; i < result.size(); i += 3)
+		{
+			const glm::vec3& p0{ vertices[result[i]].position };
+			const glm::vec3& p1{ vertices[result[i + 1]].position };
+			const glm::vec3& p2{ vertices[result[i + 2]].position };
+
+			const glm::vec3 n{ glm::cross(p1 - p0, p2 - p0) };
+			const float area{ glm::length(n) };
+			if (area <= 0.f)
+				continue;
+
+			const glm::vec3 normal{ n / area };
+			const quadric q{ plane_quadric(normal, -glm::dot(normal, p0), area) };
+			for (uint32_t k{ 0 }; k < 3; ++k)
+				quadrics[position_group[result[i + k]]] += q;
+		}
+
+		const double error_limit{ (double)target_error * target_error };
+		std::vector<uint32_t> adjacency_offsets(vertex_count + 1);
+		std::vector<uint32_t> adjacency{};
+		std::vector<collapse> collapses{};
+		std::vector<uint32_t> remap(vertex_count);
+		std::vector<bool> touched(vertex_count);
+
+		while (result.size() > target_index_count)
+		{
+			const uint32_t triangle_count{ (uint32_t)result.size() / 3 };
+
+			// triangles around every vertex
+			std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+			for (uint32_t index : result)
+				++adjacency_offsets[index + 1];
+			for (uint32_t v{ 0 }; v < vertex_count; ++v)
+				adjacency_offsets[v + 1] += adjacency_offsets[v];
+
+			adjacency.resize(result.size());
+			{
+				std::vector<uint32_t> cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+				for (uint32_t i{ 0 }; i < (uint32_t)result.size(); ++i)
+					adjacency[cursor[result[i]]++] = i / 3;
+			}
+
+			// cheapest direction of every edge
+			collapses.clear();
+			for (uint32_t i{ 0 }; i < (uint32_t)result.size(); i += 3)
+			{
+				for (uint32_t k{ 0 }; k < 3; ++k)
+				{
+					const uint32_t a{ result[i + k] };
+					const uint32_t b{ result[i + (k + 1) % 3] };
+					if (locked[a] && locked[b])
+						continue;
+
+					quadric q{ quadrics[position_group[a]] };
+					q += quadrics[position_group[b]];
+
+					const double error_ab{ locked[a] ? DBL_MAX : evaluate(q, vertices[b].position) };
+					const double error_ba{ locked[b] ? DBL_MAX : evaluate(q, vertices[a].position) };
+					if (error_ab <= error_ba)
+						collapses.push_back({ a, b, error_ab });
+					else
+						collapses.push_back({ b, a, error_ba });
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const collapse& x, const collapse& y) { return x.error < y.error; });
+
+			for (uint32_t v{ 0 }; v < vertex_count; ++v)
+				remap[v] = v;
+			std::fill(touched.begin(), touched.end(), false);
+
+			uint32_t remaining_triangles{ triangle_count };
+			uint32_t collapse_count{ 0 };
+
+			for (const collapse& c : collapses)
+			{
+				if (c.error > error_limit || remaining_triangles * 3 <= target_index_count)
+					break;
+
+				if (touched[c.from] || touched[c.to])
+					continue;
+
+				const glm::vec3& to_position{ vertices[c.to].position };
+				bool valid{ true };
+				uint32_t removed_triangles{ 0 };
+
+				for (uint32_t j{ adjacency_offsets[c.from] }; j < adjacency_offsets[c.from + 1] && valid; ++j)
+				{
+					const uint32_t* triangle{ &result[adjacency[j] * 3] };
+					if (triangle[0] == c.to || triangle[1] == c.to || triangle[2] == c.to)
+					{
+						++removed_triangles;
+						continue;
+					}
+
+					glm::vec3 before[3], after[3];
+					for (uint32_t k{ 0 }; k < 3; ++k)
+					{
+						// the target must be the wedge that is already used around the source, otherwise attributes would bleed
+						if (triangle[k] != c.to && position_group[triangle[k]] == position_group[c.to])
+							valid = false;
+
+						before[k] = vertices[triangle[k]].position;
+						after[k] = triangle[k] == c.from ? to_position : before[k];
+					}
+
+					// reject collapses that flip a triangle
+					const glm::vec3 n_before{ glm::cross(before[1] - before[0], before[2] - before[0]) };
+					const glm::vec3 n_after{ glm::cross(after[1] - after[0], after[2] - after[0]) };
+					if (glm::dot(n_before, n_after) <= 0.f)
+						valid = false;
+				}
+
+				if (!valid)
+					continue;
+
+				remap[c.from] = c.to;
+				quadrics[position_group[c.to]] += quadrics[position_group[c.from]];
+				max_error = std::max(max_error, c.error);
+				remaining_triangles -= removed_triangles;
+				++collapse_count;
+
+				// everything around the source changed, the cached adjacency is stale for those vertices until the next pass
+				for (uint32_t j{ adjacency_offsets[c.from] }; j < adjacency_offsets[c.from + 1]; ++j)
+				{
+					const uint32_t* triangle{ &result[adjacency[j] * 3] };
+					touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+				}
+			}
+
+			if (!collapse_count)
+				break;
+
+			// apply the collapses and drop the triangles that became degenerate
+			size_t write{ 0 };
+			for (size_t i{ 0 }; i < result.size(); i += 3)
+			{
+				const uint32_t a{ remap[result[i]] }, b{ remap[result[i + 1]] }, c{ remap[result[i + 2]] };
+				if (a == b || b == c || a == c)
+					continue;
+
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+			result.resize(write);
+		}
+
+		if (out_error)
+			*out_error = (float)std::sqrt(max_error);
+
+		return result;
+	}
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include "Mesh.h"
+
+namespace renderer::geometry::simplifier
+{
+	// quadric error metric edge collapse (Garland & Heckbert 1997). vertices are never moved or created, the result
+	// indexes the same vertex buffer. borders and attribute seams are preserved.
+	// target_error is an object space distance, out_error receives the largest error introduced.
+	std::vector<uint32_t> simplify(const std::vector<vertex>& vertices, const std::vector<uint32_t>& indices,
+								   uint32_t target_index_count, float target_error, float* out_error = nullptr);
+}
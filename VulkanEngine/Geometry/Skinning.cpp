@@ -0,0 +1,162 @@
+#include "Skinning.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SKINNING_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace renderer::geometry::skinning
+{
+	namespace
+	{
+		constexpr uint32_t poses_per_job{ 8 };
+
+#if SKINNING_SSE
+		// columns of a * b for column major matrices
+		void multiply(const glm::mat4& a, const glm::mat4& b, __m128 out_columns[4])
+		{
+			const float* pa{ &a[0][0] };
+			const float* pb{ &b[0][0] };
+			const __m128 a0{ _mm_loadu_ps(pa) };
+			const __m128 a1{ _mm_loadu_ps(pa + 4) };
+			const __m128 a2{ _mm_loadu_ps(pa + 8) };
+			const __m128 a3{ _mm_loadu_ps(pa + 12) };
+
+			for (uint32_t j{ 0 }; j < 4; ++j)
+			{
+				__m128 column{ _mm_mul_ps(a0, _mm_set1_ps(pb[j * 4])) };
+				column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(pb[j * 4 + 1])));
+				column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(pb[j * 4 + 2])));
+				column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(pb[j * 4 + 3])));
+				out_columns[j] = column;
+			}
+		}
+#endif
+
+		void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+		{
+#if SKINNING_SSE
+			__m128 columns[4];
+			multiply(a, b, columns);
+			float* po{ &out[0][0] };
+			for (uint32_t j{ 0 }; j < 4; ++j)
+				_mm_storeu_ps(po + j * 4, columns[j]);
+#else
+			out = a * b;
+#endif
+		}
+
+		void multiply(const glm::mat4& a, const glm::mat4& b, joint_matrix& out)
+		{
+#if SKINNING_SSE
+			__m128 columns[4];
+			multiply(a, b, columns);
+			_MM_TRANSPOSE4_PS(columns[0], columns[1], columns[2], columns[3]);
+			_mm_storeu_ps(&out.rows[0].x, columns[0]);
+			_mm_storeu_ps(&out.rows[1].x, columns[1]);
+			_mm_storeu_ps(&out.rows[2].x, columns[2]);
+#else
+			const glm::mat4 m{ a * b };
+			for (uint32_t r{ 0 }; r < 3; ++r)
+				out.rows[r] = glm::vec4{ m[0][r], m[1][r], m[2][r], m[3][r] };
+#endif
+		}
+
+	} // anonymous namespace
+
+	uint32_t pack_joints(uint32_t joint0, uint32_t joint1, uint32_t joint2, uint32_t joint3)
+	{
+		assert(joint0 < max_joints && joint1 < max_joints && joint2 < max_joints && joint3 < max_joints);
+		return joint0 | (joint1 << 8) | (joint2 << 16) | (joint3 << 24);
+	}
+
+	uint32_t pack_weights(const glm::vec4& weights)
+	{
+		const float sum{ weights.x + weights.y + weights.z + weights.w };
+		if (sum <= 0.f)
+			return 255;
+
+		int32_t quantized[4]{};
+		int32_t total{ 0 };
+		uint32_t largest{ 0 };
+		for (uint32_t i{ 0 }; i < 4; ++i)
+		{
+			quantized[i] = (int32_t)std::lround(std::max(weights[i], 0.f) / sum * 255.f);
+			total += quantized[i];
+			if (weights[i] > weights[largest])
+				largest = i;
+		}
+
+		// rounding error goes to the largest influence
+		quantized[largest] = std::clamp(quantized[largest] + 255 - total, 0, 255);
+
+		uint32_t packed{ 0 };
+		for (uint32_t i{ 0 }; i < 4; ++i)
+			packed |= (uint32_t)quantized[i] << (i * 8);
+		return packed;
+	}
+
+	void compute_palette(const pose& pose, glm::mat4* world, joint_matrix* out_palette)
+	{
+		const skeleton& s{ *pose.skeleton };
+		assert(s.joint_count() <= max_joints && s.inverse_bind.size() == s.joint_count());
+
+		for (uint32_t i{ 0 }; i < s.joint_count(); ++i)
+		{
+			const int32_t parent{ s.parents[i] };
+			assert(parent < (int32_t)i && "parents must come before their children");
+			if (parent < 0)
+				world[i] = pose.local[i];
+			else
+				multiply(world[parent], pose.local[i], world[i]);
+
+			multiply(world[i], s.inverse_bind[i], out_palette[i]);
+		}
+	}
+
+	void compute_palettes(const pose* poses, uint32_t count, const uint32_t* palette_offsets, joint_matrix* out_palettes)
+	{
+		jobs::parallel_for(count, [&](uint32_t i) {
+			thread_local std::vector<glm::mat4> world{};
+			world.resize(std::max<size_t>(world.size(), poses[i].skeleton->joint_count()));
+			compute_palette(poses[i], world.data(), out_palettes + palette_offsets[i]);
+		}, poses_per_job);
+	}
+
+	void skin(const skinned_vertex* vertices, uint32_t count, const joint_matrix* palette, vertex* out_vertices)
+	{
+		for (uint32_t i{ 0 }; i < count; ++i)
+		{
+			const skinned_vertex& v{ vertices[i] };
+			glm::vec4 rows[3]{ glm::vec4{ 0.f }, glm::vec4{ 0.f }, glm::vec4{ 0.f } };
+			for (uint32_t k{ 0 }; k < 4; ++k)
+			{
+				const float weight{ (float)((v.weights >> (k * 8)) & 0xff) * (1.f / 255.f) };
+				if (weight == 0.f)
+					continue;
+
+				const joint_matrix& joint{ palette[(v.joints >> (k * 8)) & 0xff] };
+				for (uint32_t r{ 0 }; r < 3; ++r)
+					rows[r] += joint.rows[r] * weight;
+			}
+
+			vertex& out{ out_vertices[i] };
+			glm::vec3 normal{};
+			for (uint32_t r{ 0 }; r < 3; ++r)
+			{
+				out.position[r] = rows[r].x * v.position.x + rows[r].y * v.position.y + rows[r].z * v.position.z + rows[r].w;
+				normal[r] = rows[r].x * v.normal.x + rows[r].y * v.normal.y + rows[r].z * v.normal.z;
+			}
+
+			// assumes no non-uniform scale, like the shader
+			const float length{ std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z) };
+			out.normal = length > 0.f ? normal / length : normal;
+			out.uv = v.uv;
+		}
+	}
+}
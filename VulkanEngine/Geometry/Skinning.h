@@ -0,0 +1,58 @@
+#pragma once
+#include "Mesh.h"
+
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace renderer::geometry::skinning
+{
+	constexpr uint32_t max_joints{ 256 };		// joint indices are stored as bytes
+
+	// std430 compatible rest pose vertex, the input of the skinning pass. up to four influences per vertex with their
+	// joint indices and unorm8 weights packed a byte each, lowest byte first
+	struct skinned_vertex
+	{
+		glm::vec3	position{};
+		uint32_t	joints{ 0 };
+		glm::vec3	normal{};
+		uint32_t	weights{ 0 };
+		glm::vec2	uv{};
+		glm::vec2	padding{};
+	};
+	static_assert(sizeof(skinned_vertex) == 48);
+
+	// joints ordered so every parent comes before its children, roots have parent -1
+	struct skeleton
+	{
+		std::vector<int32_t>	parents;
+		std::vector<glm::mat4>	inverse_bind;	// model space to joint space in the rest pose
+
+		[[nodiscard]] uint32_t joint_count() const { return (uint32_t)parents.size(); }
+	};
+
+	// one joint's skinning matrix as the first three rows of the affine transform, what the skinning shader reads
+	struct joint_matrix
+	{
+		glm::vec4	rows[3];
+	};
+	static_assert(sizeof(joint_matrix) == 48);
+
+	// a skeleton with one parent relative transform per joint, both must outlive the palette computation
+	struct pose
+	{
+		const skinning::skeleton*	skeleton{ nullptr };
+		const glm::mat4*			local{ nullptr };
+	};
+
+	uint32_t pack_joints(uint32_t joint0, uint32_t joint1, uint32_t joint2, uint32_t joint3);
+	// quantizes to unorm8 keeping the sum at exactly 255, the weights are normalized first
+	uint32_t pack_weights(const glm::vec4& weights);
+
+	// world is scratch for joint_count matrices. the matrix products run on sse where available
+	void compute_palette(const pose& pose, glm::mat4* world, joint_matrix* out_palette);
+	// one palette per pose, pose i written at out_palettes + palette_offsets[i], in parallel on the job system
+	void compute_palettes(const pose* poses, uint32_t count, const uint32_t* palette_offsets, joint_matrix* out_palettes);
+
+	// linear blend skinning on the cpu, the same math as skinning.comp, for tests and as the reference
+	void skin(const skinned_vertex* vertices, uint32_t count, const joint_matrix* palette, vertex* out_vertices);
+}
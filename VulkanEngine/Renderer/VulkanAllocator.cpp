@@ -0,0 +1,392 @@
+#include "VulkanAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace renderer::vulkan::allocator
+{
+	namespace
+	{
+		constexpr size_t min_alignment{ 16 };
+		constexpr size_t arena_size{ 256 * 1024 };
+		constexpr size_t pool_chunk_size{ 64 * 1024 };
+		constexpr uint32_t pool_slot_sizes[]{ 64, 128, 256, 512, 1024, 2048 };
+		constexpr uint32_t pool_count{ (uint32_t)std::size(pool_slot_sizes) };
+
+		enum source : uint8_t
+		{
+			source_heap,
+			source_arena,
+			source_pool,
+		};
+
+		// sits right in front of every pointer handed to the driver
+		struct allocation_header
+		{
+			uint64_t	size;
+			uint32_t	offset;		// from the start of the block
+			uint8_t		source;
+			uint8_t		pool_index;
+			uint8_t		scope;
+			uint8_t		type;
+		};
+		static_assert(sizeof(allocation_header) == min_alignment);
+
+		struct atomic_statistics
+		{
+			std::atomic<uint64_t>	current_bytes{ 0 };
+			std::atomic<uint64_t>	peak_bytes{ 0 };
+			std::atomic<uint64_t>	current_count{ 0 };
+			std::atomic<uint64_t>	total_count{ 0 };
+
+			void add(uint64_t size)
+			{
+				const uint64_t current{ current_bytes.fetch_add(size, std::memory_order_relaxed) + size };
+				uint64_t peak{ peak_bytes.load(std::memory_order_relaxed) };
+				while (current > peak && !peak_bytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {}
+
+				current_count.fetch_add(1, std::memory_order_relaxed);
+				total_count.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void remove(uint64_t size)
+			{
+				current_bytes.fetch_sub(size, std::memory_order_relaxed);
+				current_count.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			allocation_statistics load() const
+			{
+				return { current_bytes.load(), peak_bytes.load(), current_count.load(), total_count.load() };
+			}
+		};
+
+		// command scope allocations never outlive the vulkan call that made them and are freed on the same thread
+		struct command_arena
+		{
+			uint8_t*	data{ nullptr };
+			size_t		offset{ 0 };
+			uint32_t	live_count{ 0 };
+
+			~command_arena() { std::free(data); }
+		};
+
+		struct size_class_pool
+		{
+			std::mutex			mutex;
+			void*				free_list{ nullptr };
+			std::vector<void*>	chunks;
+		};
+
+		thread_local command_arena							arena{};
+		std::array<size_class_pool, pool_count>				pools{};
+		std::array<atomic_statistics, scope_count>			scope_stats{};
+		std::array<atomic_statistics, (size_t)object_type::count>	type_stats{};
+		std::atomic<uint64_t>								internal_bytes{ 0 };
+		std::atomic<uint64_t>								arena_allocations{ 0 };
+		std::atomic<uint64_t>								pool_allocations{ 0 };
+		std::atomic<uint64_t>								heap_allocations{ 0 };
+		std::atomic<uint64_t>								pool_reserved_bytes{ 0 };
+
+		void* allocate_from_arena(size_t block_size)
+		{
+			if (!arena.data)
+			{
+				arena.data = static_cast<uint8_t*>(std::malloc(arena_size));
+				if (!arena.data)
+					return nullptr;
+			}
+
+			if (arena.offset + block_size > arena_size)
+				return nullptr;
+
+			void* block{ arena.data + arena.offset };
+			arena.offset += (block_size + min_alignment - 1) & ~(min_alignment - 1);
+			++arena.live_count;
+			return block;
+		}
+
+		void free_to_arena()
+		{
+			assert(arena.live_count);
+			// rewind once every allocation of the current command has been released
+			if (--arena.live_count == 0)
+				arena.offset = 0;
+		}
+
+		void* allocate_from_pool(uint32_t index)
+		{
+			size_class_pool& pool{ pools[index] };
+			std::lock_guard lock{ pool.mutex };
+
+			if (!pool.free_list)
+			{
+				uint8_t* chunk{ static_cast<uint8_t*>(std::malloc(pool_chunk_size)) };
+				if (!chunk)
+					return nullptr;
+
+				pool.chunks.push_back(chunk);
+				pool_reserved_bytes += pool_chunk_size;
+
+				// thread every slot of the new chunk onto the free list
+				const uint32_t slot_size{ pool_slot_sizes[index] };
+				for (size_t offset{ 0 }; offset + slot_size <= pool_chunk_size; offset += slot_size)
+				{
+					void* slot{ chunk + offset };
+					*static_cast<void**>(slot) = pool.free_list;
+					pool.free_list = slot;
+				}
+			}
+
+			void* slot{ pool.free_list };
+			pool.free_list = *static_cast<void**>(slot);
+			return slot;
+		}
+
+		void free_to_pool(uint32_t index, void* slot)
+		{
+			size_class_pool& pool{ pools[index] };
+			std::lock_guard lock{ pool.mutex };
+			*static_cast<void**>(slot) = pool.free_list;
+			pool.free_list = slot;
+		}
+
+		allocation_header* get_header(void* memory)
+		{
+			return reinterpret_cast<allocation_header*>(static_cast<uint8_t*>(memory) - sizeof(allocation_header));
+		}
+
+		void* VKAPI_PTR allocate(void* user_data, size_t size, size_t alignment, VkSystemAllocationScope scope)
+		{
+			if (size == 0)
+				return nullptr;
+
+			alignment = std::max(alignment, min_alignment);
+			// room for the header and for aligning the pointer past it
+			const size_t block_size{ size + sizeof(allocation_header) + alignment - min_alignment };
+
+			uint8_t source{ source_heap };
+			uint8_t pool_index{ 0 };
+			void* block{ nullptr };
+
+			if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND)
+			{
+				block = allocate_from_arena(block_size);
+				source = source_arena;
+			}
+			else
+			{
+				const uint32_t* slot_size{ std::lower_bound(std::begin(pool_slot_sizes), std::end(pool_slot_sizes), (uint32_t)std::min<size_t>(block_size, UINT32_MAX)) };
+				if (slot_size != std::end(pool_slot_sizes))
+				{
+					pool_index = (uint8_t)(slot_size - std::begin(pool_slot_sizes));
+					block = allocate_from_pool(pool_index);
+					source = source_pool;
+				}
+			}
+
+			// arena exhausted or too large for the pools
+			if (!block)
+			{
+				block = std::malloc(block_size);
+				source = source_heap;
+				if (!block)
+					return nullptr;
+			}
+
+			const uintptr_t address{ ((uintptr_t)block + sizeof(allocation_header) + alignment - 1) & ~(uintptr_t)(alignment - 1) };
+			void* memory{ reinterpret_cast<void*>(address) };
+
+			allocation_header* header{ get_header(memory) };
+			header->size = size;
+			header->offset = (uint32_t)(address - (uintptr_t)block);
+			header->source = source;
+			header->pool_index = pool_index;
+			header->scope = (uint8_t)scope;
+			header->type = (uint8_t)(uintptr_t)user_data;
+
+			scope_stats[scope].add(size);
+			type_stats[header->type].add(size);
+			if (source == source_arena)
+				++arena_allocations;
+			else if (source == source_pool)
+				++pool_allocations;
+			else
+				++heap_allocations;
+
+			return memory;
+		}
+
+		void VKAPI_PTR deallocate(void*, void* memory)
+		{
+			if (!memory)
+				return;
+
+			const allocation_header header{ *get_header(memory) };
+			void* block{ static_cast<uint8_t*>(memory) - header.offset };
+
+			scope_stats[header.scope].remove(header.size);
+			type_stats[header.type].remove(header.size);
+
+			if (header.source == source_arena)
+				free_to_arena();
+			else if (header.source == source_pool)
+				free_to_pool(header.pool_index, block);
+			else
+				std::free(block);
+		}
+
+		void* VKAPI_PTR reallocate(void* user_data, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+		{
+			if (!original)
+				return allocate(user_data, size, alignment, scope);
+
+			if (size == 0)
+			{
+				deallocate(user_data, original);
+				return nullptr;
+			}
+
+			void* memory{ allocate(user_data, size, alignment, scope) };
+			if (!memory)
+				return nullptr;
+
+			memcpy(memory, original, std::min<size_t>(size, get_header(original)->size));
+			deallocate(user_data, original);
+			return memory;
+		}
+
+		void VKAPI_PTR internal_allocation(void*, size_t size, VkInternalAllocationType, VkSystemAllocationScope)
+		{
+			internal_bytes += size;
+		}
+
+		void VKAPI_PTR internal_free(void*, size_t size, VkInternalAllocationType, VkSystemAllocationScope)
+		{
+			internal_bytes -= size;
+		}
+
+		std::array<VkAllocationCallbacks, (size_t)object_type::count> create_callbacks()
+		{
+			std::array<VkAllocationCallbacks, (size_t)object_type::count> callbacks{};
+			for (uint32_t i{ 0 }; i < (uint32_t)object_type::count; ++i)
+			{
+				callbacks[i].pUserData = reinterpret_cast<void*>((uintptr_t)i);
+				callbacks[i].pfnAllocation = allocate;
+				callbacks[i].pfnReallocation = reallocate;
+				callbacks[i].pfnFree = deallocate;
+				callbacks[i].pfnInternalAllocation = internal_allocation;
+				callbacks[i].pfnInternalFree = internal_free;
+			}
+			return callbacks;
+		}
+
+		const std::array<VkAllocationCallbacks, (size_t)object_type::count> callbacks{ create_callbacks() };
+
+	} // anonymous namespace
+
+	const VkAllocationCallbacks* get_callbacks(object_type type)
+	{
+		assert(type < object_type::count);
+		return &callbacks[(uint32_t)type];
+	}
+
+	void shutdown()
+	{
+		bool leaked{ false };
+		for (uint32_t i{ 0 }; i < (uint32_t)object_type::count; ++i)
+		{
+			const allocation_statistics stats{ type_stats[i].load() };
+			if (stats.current_count)
+			{
+				std::cout << "vulkan host allocator: " << stats.current_count << " " << get_object_type_name((object_type)i)
+						  << " allocations (" << stats.current_bytes << " bytes) still alive at shutdown!\n";
+				leaked = true;
+			}
+		}
+
+		// live slots would dangle, keep the pools around in that case
+		if (leaked)
+			return;
+
+		for (size_class_pool& pool : pools)
+		{
+			std::lock_guard lock{ pool.mutex };
+			for (void* chunk : pool.chunks)
+				std::free(chunk);
+			pool.chunks.clear();
+			pool.free_list = nullptr;
+		}
+		pool_reserved_bytes = 0;
+	}
+
+	statistics get_statistics()
+	{
+		statistics stats{};
+		for (uint32_t i{ 0 }; i < scope_count; ++i)
+			stats.scopes[i] = scope_stats[i].load();
+		for (uint32_t i{ 0 }; i < (uint32_t)object_type::count; ++i)
+			stats.types[i] = type_stats[i].load();
+
+		stats.internal_bytes = internal_bytes;
+		stats.arena_allocations = arena_allocations;
+		stats.pool_allocations = pool_allocations;
+		stats.heap_allocations = heap_allocations;
+		stats.pool_reserved_bytes = pool_reserved_bytes;
+		return stats;
+	}
+
+	void print_statistics()
+	{
+		const statistics stats{ get_statistics() };
+
+		std::cout << "vulkan host allocations (current bytes / peak bytes / live / total):\n";
+		for (uint32_t i{ 0 }; i < scope_count; ++i)
+		{
+			const allocation_statistics& s{ stats.scopes[i] };
+			std::cout << "  scope " << get_scope_name((VkSystemAllocationScope)i) << ": " << s.current_bytes << " / " << s.peak_bytes
+					  << " / " << s.current_count << " / " << s.total_count << "\n";
+		}
+		for (uint32_t i{ 0 }; i < (uint32_t)object_type::count; ++i)
+		{
+			const allocation_statistics& s{ stats.types[i] };
+			std::cout << "  " << get_object_type_name((object_type)i) << ": " << s.current_bytes << " / " << s.peak_bytes
+					  << " / " << s.current_count << " / " << s.total_count << "\n";
+		}
+
+		std::cout << "  internal: " << stats.internal_bytes << " bytes, arena/pool/heap allocations: " << stats.arena_allocations
+				  << " / " << stats.pool_allocations << " / " << stats.heap_allocations
+				  << ", pool reserve: " << stats.pool_reserved_bytes << " bytes\n";
+	}
+
+	const char* get_object_type_name(object_type type)
+	{
+		switch (type)
+		{
+		case object_type::instance:		return "instance";
+		case object_type::device:		return "device";
+		case object_type::command:		return "command";
+		case object_type::memory:		return "memory";
+		case object_type::pipeline:		return "pipeline";
+		case object_type::descriptor:	return "descriptor";
+		case object_type::sync:			return "sync";
+		case object_type::swap_chain:	return "swap chain";
+		case object_type::other:		return "other";
+		default:						return "unknown";
+		}
+	}
+
+	const char* get_scope_name(VkSystemAllocationScope scope)
+	{
+		switch (scope)
+		{
+		case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:	return "command";
+		case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:		return "object";
+		case VK_SYSTEM_ALLOCATION_SCOPE_CACHE:		return "cache";
+		case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE:		return "device";
+		case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE:	return "instance";
+		default:									return "unknown";
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+namespace renderer::vulkan::allocator
+{
+	// one callback instance per category, vulkan doesn't say which object an allocation belongs to
+	enum class object_type : uint32_t
+	{
+		instance,
+		device,
+		command,	// command pools and buffers
+		memory,		// device memory, buffers and images
+		pipeline,	// pipelines, layouts, caches and shader modules
+		descriptor,
+		sync,		// fences, semaphores and events
+		swap_chain,
+		other,
+
+		count
+	};
+
+	constexpr uint32_t scope_count{ VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1 };
+
+	struct allocation_statistics
+	{
+		uint64_t	current_bytes{ 0 };
+		uint64_t	peak_bytes{ 0 };
+		uint64_t	current_count{ 0 };
+		uint64_t	total_count{ 0 };
+	};
+
+	struct statistics
+	{
+		std::array<allocation_statistics, scope_count>					scopes{};
+		std::array<allocation_statistics, (size_t)object_type::count>	types{};
+		uint64_t	internal_bytes{ 0 };	// driver allocations reported through the internal notifications
+		uint64_t	arena_allocations{ 0 };
+		uint64_t	pool_allocations{ 0 };
+		uint64_t	heap_allocations{ 0 };
+		uint64_t	pool_reserved_bytes{ 0 };
+	};
+
+	// command scope allocations go to a per thread arena that is rewound once all of them are freed,
+	// small allocations of the other scopes to size class pools and everything else to the heap
+	const VkAllocationCallbacks* get_callbacks(object_type type);
+
+	// reports allocations still alive and releases the pools, call after the instance is destroyed
+	void shutdown();
+
+	statistics get_statistics();
+	void print_statistics();
+	const char* get_object_type_name(object_type type);
+	const char* get_scope_name(VkSystemAllocationScope scope);
+}
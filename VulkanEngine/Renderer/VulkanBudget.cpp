@@ -0,0 +1,170 @@
+#include "VulkanBudget.h"
+#include "VulkanCommandCache.h"
+#include "VulkanCore.h"
+#include "VulkanMemory.h"
+#include "VulkanTextureStreaming.h"
+
+#include <algorithm>
+
+namespace renderer::vulkan::budget
+{
+	namespace
+	{
+		struct reported_heap
+		{
+			VkDeviceSize	budget{ 0 };
+			VkDeviceSize	usage{ 0 };
+			VkDeviceSize	own_usage{ 0 };		// memory::get_heap_usage when budget and usage were queried
+		};
+
+		settings											budget_settings{};
+		bool												initialized{ false };
+		PFN_vkGetPhysicalDeviceMemoryProperties2			get_memory_properties2{ nullptr };
+		std::mutex											mutex{};
+		std::array<reported_heap, VK_MAX_MEMORY_HEAPS>		reported{};
+		uint32_t											frames_since_refresh{ 0 };
+		std::atomic<pressure>								current_pressure{ pressure::none };
+
+		void refresh()
+		{
+			VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties{};
+			budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+			VkPhysicalDeviceMemoryProperties2 properties{};
+			properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+			properties.pNext = &budget_properties;
+			get_memory_properties2(core::get_physical_device(), &properties);
+
+			std::lock_guard lock{ mutex };
+			for (uint32_t i{ 0 }; i < properties.memoryProperties.memoryHeapCount; ++i)
+				reported[i] = { budget_properties.heapBudget[i], budget_properties.heapUsage[i], memory::get_heap_usage(i) };
+		}
+
+		const char* get_pressure_name(pressure level)
+		{
+			switch (level)
+			{
+			case pressure::high: return "high";
+			case pressure::critical: return "critical";
+			default: return "none";
+			}
+		}
+
+	} // anonymous namespace
+
+	bool init(const settings& settings)
+	{
+		assert(settings.high_threshold <= settings.critical_threshold);
+		budget_settings = settings;
+
+		// the query needs vulkan 1.1, core only enables the extension then
+		get_memory_properties2 = nullptr;
+		if (core::is_memory_budget_supported())
+			get_memory_properties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2)vkGetInstanceProcAddr(core::get_vulkan_instance(),
+																									   "vkGetPhysicalDeviceMemoryProperties2");
+		if (get_memory_properties2)
+			refresh();
+
+		frames_since_refresh = 0;
+		current_pressure = pressure::none;
+		initialized = true;
+		return true;
+	}
+
+	void shutdown()
+	{
+		if (!initialized)
+			return;
+
+		streaming::set_budget_limit(UINT64_MAX);
+		get_memory_properties2 = nullptr;
+		reported = {};
+		initialized = false;
+	}
+
+	void update()
+	{
+		if (!initialized)
+			return;
+
+		if (get_memory_properties2 && ++frames_since_refresh >= budget_settings.refresh_frames)
+		{
+			refresh();
+			frames_since_refresh = 0;
+		}
+
+		// the fullest device local heap decides, that is where textures and render targets live
+		heap_budget fullest{};
+		float fullest_fraction{ 0.f };
+		for (uint32_t i{ 0 }; i < get_heap_count(); ++i)
+		{
+			const heap_budget heap{ get_heap_budget(i) };
+			const float fraction{ heap.budget ? (float)heap.usage / (float)heap.budget : 0.f };
+			if (heap.device_local && fraction >= fullest_fraction)
+			{
+				fullest = heap;
+				fullest_fraction = fraction;
+			}
+		}
+
+		pressure level{ pressure::none };
+		if (fullest_fraction >= budget_settings.critical_threshold)
+			level = pressure::critical;
+		else if (fullest_fraction >= budget_settings.high_threshold)
+			level = pressure::high;
+
+		if (level != current_pressure.load())
+		{
+			std::cout << "memory pressure " << get_pressure_name(level) << ", " << fullest.usage / (1024 * 1024) << " of "
+					  << fullest.budget / (1024 * 1024) << " MB used\n";
+			current_pressure = level;
+		}
+
+		// lets streaming grow or shrink by the distance to the high threshold, so it gives memory back before
+		// allocations start failing and takes it again once the pressure is gone
+		const double target{ budget_settings.high_threshold * (double)fullest.budget };
+		const streaming::statistics stream_statistics{ streaming::get_statistics() };
+		const double limit{ (double)(stream_statistics.resident_bytes + stream_statistics.pending_bytes) + target - (double)fullest.usage };
+		streaming::set_budget_limit(limit > 0 ? (VkDeviceSize)limit : 0);
+
+		if (level == pressure::high)
+			command_cache::trim(budget_settings.high_pressure_unused_frames);
+		else if (level == pressure::critical)
+			command_cache::trim(1);
+	}
+
+	heap_budget get_heap_budget(uint32_t heap_index)
+	{
+		const VkPhysicalDeviceMemoryProperties& properties{ memory::get_memory_properties() };
+		assert(heap_index < properties.memoryHeapCount);
+
+		heap_budget heap{};
+		heap.own_usage = memory::get_heap_usage(heap_index);
+		heap.device_local = (properties.memoryHeaps[heap_index].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+
+		if (!get_memory_properties2)
+		{
+			heap.budget = (VkDeviceSize)(budget_settings.fallback_budget_fraction * (double)properties.memoryHeaps[heap_index].size);
+			heap.usage = heap.own_usage;
+			return heap;
+		}
+
+		// what was allocated or freed since the last query is added on top of the driver's number
+		std::lock_guard lock{ mutex };
+		const reported_heap& r{ reported[heap_index] };
+		heap.budget = r.budget;
+		heap.usage = heap.own_usage >= r.own_usage ? r.usage + (heap.own_usage - r.own_usage)
+												   : r.usage - std::min(r.usage, r.own_usage - heap.own_usage);
+		return heap;
+	}
+
+	uint32_t get_heap_count()
+	{
+		return memory::get_memory_properties().memoryHeapCount;
+	}
+
+	pressure get_pressure()
+	{
+		return current_pressure;
+	}
+}
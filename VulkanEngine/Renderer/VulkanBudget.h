@@ -0,0 +1,42 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+namespace renderer::vulkan::budget
+{
+	struct heap_budget
+	{
+		VkDeviceSize	budget{ 0 };		// what the process can use before the driver starts paging or allocations fail
+		VkDeviceSize	usage{ 0 };			// by this process, including memory the driver allocated for it
+		VkDeviceSize	own_usage{ 0 };		// allocated through memory
+		bool			device_local{ false };
+	};
+
+	enum class pressure : uint32_t
+	{
+		none,
+		high,		// texture streaming is capped to stay below high_threshold, unused cached command buffers are released
+		critical,	// every cached command buffer not executed last frame is released as well
+	};
+
+	struct settings
+	{
+		float		high_threshold{ 0.85f };			// of the budget of the fullest device local heap
+		float		critical_threshold{ 0.95f };
+		float		fallback_budget_fraction{ 0.8f };	// of the heap size, without VK_EXT_memory_budget
+		uint32_t	refresh_frames{ 30 };				// driver numbers are queried this often, own allocations are added in between
+		uint32_t	high_pressure_unused_frames{ 30 };	// cached command buffers unused for longer are released under high pressure
+	};
+
+	// called by core::init and core::shutdown
+	bool init(const settings& settings = {});
+	void shutdown();
+
+	// refreshes the numbers and reacts to the pressure, called by core::begin_frame. does nothing while not initialized
+	void update();
+
+	// thread safe. the driver's numbers from VK_EXT_memory_budget when enabled, the heap size and the allocations made
+	// through memory otherwise
+	heap_budget get_heap_budget(uint32_t heap_index);
+	uint32_t get_heap_count();
+	pressure get_pressure();
+}
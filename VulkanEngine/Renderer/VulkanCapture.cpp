@@ -0,0 +1,304 @@
+#include "VulkanCapture.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <unordered_map>
+
+namespace renderer::vulkan::capture
+{
+	namespace
+	{
+		using clock = std::chrono::steady_clock;
+
+		constexpr uint32_t	file_magic{ 0x50414352 };	// "RCAP"
+		constexpr uint32_t	file_version{ 1 };
+
+		struct handle_ids
+		{
+			std::unordered_map<uint64_t, uint32_t>	ids;
+
+			// ids start at 1 so 0 can stand for VK_NULL_HANDLE
+			template<typename T>
+			uint32_t get(T handle)
+			{
+				static_assert(sizeof(T) <= sizeof(uint64_t));
+				if (handle == VK_NULL_HANDLE)
+					return 0;
+
+				uint64_t key{ 0 };
+				memcpy(&key, &handle, sizeof(T));
+				return ids.try_emplace(key, (uint32_t)ids.size() + 1).first->second;
+			}
+		};
+
+		// state of the running capture, frames are only touched between on_begin_frame and on_end_frame
+		struct capture_state
+		{
+			std::string				path;
+			uint32_t				frames_left{ 0 };
+			bool					armed{ false };
+			clock::time_point		frame_start{};
+			handle_ids				pipelines;
+			handle_ids				layouts;
+			handle_ids				material_sets;
+			handle_ids				buffers;
+			std::shared_ptr<capture_data>	data;
+		};
+
+		capture_state		state{};
+		std::atomic<bool>	frame_open{ false };
+		std::mutex			mutex{};
+
+		void grow_buffer(capture_data& data, uint32_t id, uint64_t end)
+		{
+			if (!id)
+				return;
+			if (data.buffer_sizes.size() < id)
+				data.buffer_sizes.resize(id, 0);
+			data.buffer_sizes[id - 1] = std::max(data.buffer_sizes[id - 1], end);
+		}
+
+		template<typename T>
+		void write(std::ofstream& file, const T& value)
+		{
+			file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		template<typename T>
+		void write_vector(std::ofstream& file, const std::vector<T>& values)
+		{
+			write(file, (uint64_t)values.size());
+			if (!values.empty())
+				file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+		}
+
+		// the smallest a serialized frame and queue submission can be, counts read from the file are checked against them
+		constexpr uint64_t min_frame_bytes{ sizeof(float) + 2 * sizeof(uint64_t) };
+		constexpr uint64_t min_queue_bytes{ 4 * sizeof(uint32_t) + 2 * sizeof(uint64_t) };
+
+		uint64_t bytes_left(std::ifstream& file)
+		{
+			const std::streampos position{ file.tellg() };
+			file.seekg(0, std::ios::end);
+			const std::streampos end{ file.tellg() };
+			file.seekg(position);
+			return position < 0 || end < position ? 0 : (uint64_t)(end - position);
+		}
+
+		template<typename T>
+		bool read(std::ifstream& file, T& value)
+		{
+			return (bool)file.read(reinterpret_cast<char*>(&value), sizeof(T));
+		}
+
+		template<typename T>
+		bool read_vector(std::ifstream& file, std::vector<T>& values)
+		{
+			uint64_t count{ 0 };
+			if (!read(file, count) || count > bytes_left(file) / sizeof(T))
+				return false;
+
+			values.resize((size_t)count);
+			return values.empty() || (bool)file.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(T));
+		}
+
+	} // anonymous namespace
+
+	bool begin_capture(const std::string& path, uint32_t frame_count)
+	{
+		assert(frame_count);
+		std::lock_guard lock{ mutex };
+		if (state.armed || state.data)
+		{
+			std::cout << "a capture is already running!\n";
+			return false;
+		}
+
+		state = {};
+		state.path = path;
+		state.frames_left = frame_count;
+		state.armed = true;
+		return true;
+	}
+
+	bool is_capturing()
+	{
+		return frame_open.load(std::memory_order_relaxed);
+	}
+
+	void on_begin_frame()
+	{
+		std::lock_guard lock{ mutex };
+		if (state.armed)
+		{
+			state.armed = false;
+			state.data = std::make_shared<capture_data>();
+		}
+		if (!state.data)
+			return;
+
+		state.data->frames.emplace_back();
+		state.frame_start = clock::now();
+		frame_open = true;
+	}
+
+	void on_end_frame()
+	{
+		std::lock_guard lock{ mutex };
+		if (!frame_open)
+			return;
+
+		frame_open = false;
+		state.data->frames.back().captured_ms = std::chrono::duration<float, std::milli>(clock::now() - state.frame_start).count();
+		if (--state.frames_left)
+			return;
+
+		state.data->pipeline_count = (uint32_t)state.pipelines.ids.size();
+		state.data->layout_count = (uint32_t)state.layouts.ids.size();
+		state.data->material_set_count = (uint32_t)state.material_sets.ids.size();
+		state.data->buffer_sizes.resize(state.buffers.ids.size(), 0);
+
+		// the file can be large, don't stall the frame that finished the capture
+		jobs::submit([data = std::move(state.data), path = std::move(state.path)] {
+			if (save_capture(path, *data))
+				std::cout << "captured " << data->frames.size() << " frames to " << path << "\n";
+		});
+		state = {};
+	}
+
+	void record_queue(const uint64_t* keys, const render_queue::draw_item* draws, const uint8_t* instance_data, uint32_t count,
+					  uint32_t capacity, uint32_t instance_stride, uint32_t instance_binding, uint32_t material_set_index)
+	{
+		std::lock_guard lock{ mutex };
+		if (!frame_open)
+			return;
+
+		capture_data& data{ *state.data };
+		queue_submission& submission{ data.frames.back().queues.emplace_back() };
+		submission.capacity = capacity;
+		submission.instance_stride = instance_stride;
+		submission.instance_binding = instance_binding;
+		submission.material_set_index = material_set_index;
+		submission.draws.resize(count);
+		if (instance_stride)
+			submission.instance_data.assign(instance_data, instance_data + (size_t)count * instance_stride);
+		data.max_material_set_index = std::max(data.max_material_set_index, material_set_index);
+
+		for (uint32_t i{ 0 }; i < count; ++i)
+		{
+			const render_queue::draw_item& draw{ draws[i] };
+			captured_draw& c{ submission.draws[i] };
+			c.key = keys[i];
+			c.pipeline = state.pipelines.get(draw.pipeline);
+			c.layout = state.layouts.get(draw.layout);
+			c.material_set = state.material_sets.get(draw.material_set);
+			c.vertex_buffer = state.buffers.get(draw.vertex_buffer);
+			c.vertex_buffer_offset = draw.vertex_buffer_offset;
+			c.index_buffer = state.buffers.get(draw.index_buffer);
+			c.index_buffer_offset = draw.index_buffer_offset;
+			c.index_type = draw.index_type;
+			c.count = draw.count;
+			c.first = draw.first;
+			c.vertex_offset = draw.vertex_offset;
+
+			// the vertex stride isn't known here, replay pipelines don't read vertex attributes anyway
+			grow_buffer(data, c.vertex_buffer, c.vertex_buffer_offset + 1);
+			const uint64_t index_size{ draw.index_type == VK_INDEX_TYPE_UINT16 ? 2ull : 4ull };
+			grow_buffer(data, c.index_buffer, c.index_buffer_offset + ((uint64_t)c.first + c.count) * index_size);
+		}
+	}
+
+	void record_upload(uint64_t bytes)
+	{
+		std::lock_guard lock{ mutex };
+		if (frame_open)
+			state.data->frames.back().uploads.push_back(bytes);
+	}
+
+	bool save_capture(const std::string& path, const capture_data& data)
+	{
+		std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+		if (!file)
+		{
+			std::cout << "failed to create capture file " << path << "!\n";
+			return false;
+		}
+
+		write(file, file_magic);
+		write(file, file_version);
+		write(file, data.pipeline_count);
+		write(file, data.layout_count);
+		write(file, data.material_set_count);
+		write(file, data.max_material_set_index);
+		write_vector(file, data.buffer_sizes);
+
+		write(file, (uint64_t)data.frames.size());
+		for (const frame& f : data.frames)
+		{
+			write(file, f.captured_ms);
+			write_vector(file, f.uploads);
+			write(file, (uint64_t)f.queues.size());
+			for (const queue_submission& q : f.queues)
+			{
+				write(file, q.capacity);
+				write(file, q.instance_stride);
+				write(file, q.instance_binding);
+				write(file, q.material_set_index);
+				write_vector(file, q.draws);
+				write_vector(file, q.instance_data);
+			}
+		}
+
+		return file.good();
+	}
+
+	bool load_capture(const std::string& path, capture_data& out_data)
+	{
+		std::ifstream file{ path, std::ios::binary };
+		if (!file)
+		{
+			std::cout << "failed to open capture file " << path << "!\n";
+			return false;
+		}
+
+		uint32_t magic{ 0 };
+		uint32_t version{ 0 };
+		if (!read(file, magic) || !read(file, version) || magic != file_magic || version != file_version)
+		{
+			std::cout << path << " is not a capture file of version " << file_version << "!\n";
+			return false;
+		}
+
+		out_data = {};
+		uint64_t frame_count{ 0 };
+		if (!read(file, out_data.pipeline_count) || !read(file, out_data.layout_count) || !read(file, out_data.material_set_count) ||
+			!read(file, out_data.max_material_set_index) || !read_vector(file, out_data.buffer_sizes) || !read(file, frame_count) ||
+			frame_count > bytes_left(file) / min_frame_bytes)
+			return false;
+
+		out_data.frames.resize((size_t)frame_count);
+		for (frame& f : out_data.frames)
+		{
+			uint64_t queue_count{ 0 };
+			if (!read(file, f.captured_ms) || !read_vector(file, f.uploads) || !read(file, queue_count) ||
+				queue_count > bytes_left(file) / min_queue_bytes)
+				return false;
+
+			f.queues.resize((size_t)queue_count);
+			for (queue_submission& q : f.queues)
+			{
+				if (!read(file, q.capacity) || !read(file, q.instance_stride) || !read(file, q.instance_binding) ||
+					!read(file, q.material_set_index) || !read_vector(file, q.draws) || !read_vector(file, q.instance_data))
+					return false;
+				if (q.instance_data.size() != q.draws.size() * q.instance_stride)
+					return false;
+			}
+		}
+
+		return true;
+	}
+}
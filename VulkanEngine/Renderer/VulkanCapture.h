@@ -0,0 +1,68 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+#include "VulkanRenderQueue.h"
+
+namespace renderer::vulkan::capture
+{
+	// one render queue draw as captured, handles are replaced by ids that start at 1, 0 stands for VK_NULL_HANDLE.
+	// vertex and index buffers share one id space
+	struct captured_draw
+	{
+		uint64_t		key{ 0 };
+		uint64_t		vertex_buffer_offset{ 0 };
+		uint64_t		index_buffer_offset{ 0 };
+		uint32_t		pipeline{ 0 };
+		uint32_t		layout{ 0 };
+		uint32_t		material_set{ 0 };
+		uint32_t		vertex_buffer{ 0 };
+		uint32_t		index_buffer{ 0 };
+		uint32_t		index_type{ VK_INDEX_TYPE_UINT32 };
+		uint32_t		count{ 0 };
+		uint32_t		first{ 0 };
+		int32_t			vertex_offset{ 0 };
+		uint32_t		padding{ 0 };
+	};
+
+	// everything one render_queue::queue::record call issued
+	struct queue_submission
+	{
+		uint32_t					capacity{ 0 };
+		uint32_t					instance_stride{ 0 };
+		uint32_t					instance_binding{ 0 };
+		uint32_t					material_set_index{ 0 };
+		std::vector<captured_draw>	draws;
+		std::vector<uint8_t>		instance_data;	// draws.size() * instance_stride, in submission order
+	};
+
+	struct frame
+	{
+		float							captured_ms{ 0.f };	// begin_frame to end_frame in the captured application
+		std::vector<uint64_t>			uploads;			// bytes copied from staging memory during the frame
+		std::vector<queue_submission>	queues;
+	};
+
+	struct capture_data
+	{
+		uint32_t					pipeline_count{ 0 };
+		uint32_t					layout_count{ 0 };
+		uint32_t					material_set_count{ 0 };
+		uint32_t					max_material_set_index{ 0 };
+		std::vector<uint64_t>		buffer_sizes;		// bytes the draws read from each buffer id, indexed by id - 1
+		std::vector<frame>			frames;
+	};
+
+	// captures the next frame_count frames, from the next begin_frame. the file is written on the job system once
+	// the last frame ends. returns false if a capture is already running
+	bool begin_capture(const std::string& path, uint32_t frame_count);
+	[[nodiscard]] bool is_capturing();
+
+	// hooks called by core, the render queue and the upload paths
+	void on_begin_frame();
+	void on_end_frame();
+	void record_queue(const uint64_t* keys, const render_queue::draw_item* draws, const uint8_t* instance_data, uint32_t count,
+					  uint32_t capacity, uint32_t instance_stride, uint32_t instance_binding, uint32_t material_set_index);
+	void record_upload(uint64_t bytes);
+
+	bool save_capture(const std::string& path, const capture_data& data);
+	bool load_capture(const std::string& path, capture_data& out_data);
+}
@@ -0,0 +1,251 @@
+#include "VulkanCommandCache.h"
+#include "VulkanAllocator.h"
+#include "VulkanCore.h"
+#include "VulkanHelpers.h"
+
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace renderer::vulkan::command_cache
+{
+	namespace
+	{
+		struct key_hash
+		{
+			size_t operator()(const batch_key& key) const
+			{
+				uint64_t hash{ 14695981039346656037ull };
+				auto combine = [&hash](uint64_t value) { hash = (hash ^ value) * 1099511628211ull; };
+				combine(key.pass);
+				combine((uint64_t)key.pipeline);
+
+				const float values[]{ key.viewport.x, key.viewport.y, key.viewport.width, key.viewport.height, key.viewport.minDepth, key.viewport.maxDepth };
+				for (float value : values)
+				{
+					uint32_t bits{ 0 };
+					memcpy(&bits, &value, sizeof(bits));
+					combine(bits);
+				}
+				return (size_t)hash;
+			}
+		};
+
+		struct batch
+		{
+			VkCommandBuffer		command_buffer{ VK_NULL_HANDLE };
+			VkRenderPass		render_pass{ VK_NULL_HANDLE };
+			uint32_t			subpass{ 0 };
+			uint64_t			version{ 0 };
+			uint64_t			last_used_frame{ 0 };
+			bool				valid{ false };
+		};
+
+		settings												cache_settings{};
+		VkCommandPool											command_pool{ VK_NULL_HANDLE };
+		std::unordered_map<batch_key, batch, key_hash>			batches{};
+		std::vector<VkCommandBuffer>							free_buffers{};
+		// replaced while frames in flight may still execute them, reusable once their frame slot comes around again
+		std::vector<VkCommandBuffer>							retired[core::max_current_frames]{};
+		uint64_t												frame_number{ 0 };
+		uint64_t												swap_chain_generation{ 0 };
+		statistics												cache_statistics{};
+
+		void retire(VkCommandBuffer command_buffer)
+		{
+			if (command_buffer)
+				retired[core::get_current_command_buffer_index()].push_back(command_buffer);
+		}
+
+		VkCommandBuffer acquire()
+		{
+			if (!free_buffers.empty())
+			{
+				VkCommandBuffer command_buffer{ free_buffers.back() };
+				free_buffers.pop_back();
+				return command_buffer;
+			}
+
+			VkCommandBufferAllocateInfo info = vkh::command_buffer_allocate_info(command_pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, 1);
+			VkCommandBuffer command_buffer{ VK_NULL_HANDLE };
+			VKCALL(vkAllocateCommandBuffers(core::get_logical_device(), &info, &command_buffer), "failed to allocate cached command buffer");
+			return command_buffer;
+		}
+
+		bool record_batch(const batch_key& key, batch& b, const record_callback& record)
+		{
+			b.command_buffer = acquire();
+			if (!b.command_buffer)
+				return false;
+
+			// the frame buffer is left out so swap chain images can change without a rerecord, and the buffer may be
+			// pending in several frames in flight at once
+			VkCommandBufferInheritanceInfo inheritance{};
+			inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritance.renderPass = b.render_pass;
+			inheritance.subpass = b.subpass;
+			inheritance.framebuffer = VK_NULL_HANDLE;
+
+			VkCommandBufferBeginInfo begin_info = vkh::command_buffer_begin_info();
+			begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+			begin_info.pInheritanceInfo = &inheritance;
+			VKCALL(vkBeginCommandBuffer(b.command_buffer, &begin_info), "failed to begin cached command buffer");
+
+			const VkViewport& viewport{ key.viewport };
+			VkRect2D scissor = vkh::rect_2d((uint32_t)std::abs(viewport.width), (uint32_t)std::abs(viewport.height),
+											(uint32_t)std::min(viewport.x, viewport.x + viewport.width),
+											(uint32_t)std::min(viewport.y, viewport.y + viewport.height));
+			vkCmdBindPipeline(b.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, key.pipeline);
+			vkCmdSetViewport(b.command_buffer, 0, 1, &viewport);
+			vkCmdSetScissor(b.command_buffer, 0, 1, &scissor);
+
+			if (record)
+				record(b.command_buffer);
+
+			VKCALL(vkEndCommandBuffer(b.command_buffer), "failed to end cached command buffer");
+			b.valid = true;
+			return true;
+		}
+
+	} // anonymous namespace
+
+	bool batch_key::operator==(const batch_key& other) const
+	{
+		return pass == other.pass && pipeline == other.pipeline && !memcmp(&viewport, &other.viewport, sizeof(VkViewport));
+	}
+
+	bool init(const settings& settings)
+	{
+		cache_settings = settings;
+		VkCommandPoolCreateInfo info = vkh::command_pool_create_info(VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, core::get_graphics_queue_family_index());
+		VKCALL(vkCreateCommandPool(core::get_logical_device(), &info, allocator::get_callbacks(allocator::object_type::command), &command_pool),
+			   "failed to create command cache pool");
+
+		frame_number = 0;
+		swap_chain_generation = core::get_swap_chain_generation();
+		cache_statistics = {};
+		return command_pool != VK_NULL_HANDLE;
+	}
+
+	void shutdown()
+	{
+		if (!command_pool)
+			return;
+
+		// destroying the pool frees every buffer it allocated
+		vkDeviceWaitIdle(core::get_logical_device());
+		vkDestroyCommandPool(core::get_logical_device(), command_pool, allocator::get_callbacks(allocator::object_type::command));
+		command_pool = VK_NULL_HANDLE;
+
+		batches.clear();
+		free_buffers.clear();
+		for (std::vector<VkCommandBuffer>& buffers : retired)
+			buffers.clear();
+	}
+
+	void begin_frame(uint32_t frame_index)
+	{
+		if (!command_pool)
+			return;
+
+		assert(frame_index < core::max_current_frames);
+		free_buffers.insert(free_buffers.end(), retired[frame_index].begin(), retired[frame_index].end());
+		retired[frame_index].clear();
+
+		++frame_number;
+		trim(cache_settings.max_unused_frames);
+	}
+
+	VkCommandBuffer get(VkRenderPass render_pass, uint32_t subpass, const batch_key& key, uint64_t version, const record_callback& record)
+	{
+		assert(command_pool && render_pass && key.pipeline);
+
+		// pipelines, render passes and viewports all tend to change with the swap chain
+		if (swap_chain_generation != core::get_swap_chain_generation())
+		{
+			invalidate_all();
+			swap_chain_generation = core::get_swap_chain_generation();
+		}
+
+		auto [it, inserted] = batches.try_emplace(key);
+		batch& b{ it->second };
+		b.last_used_frame = frame_number;
+
+		if (b.valid && b.version == version && b.render_pass == render_pass && b.subpass == subpass)
+		{
+			++cache_statistics.hits;
+			return b.command_buffer;
+		}
+
+		if (inserted)
+			++cache_statistics.records;
+		else
+			++cache_statistics.rerecords;
+
+		retire(b.command_buffer);
+		b.render_pass = render_pass;
+		b.subpass = subpass;
+		b.version = version;
+		if (!record_batch(key, b, record))
+		{
+			batches.erase(it);
+			return VK_NULL_HANDLE;
+		}
+
+		return b.command_buffer;
+	}
+
+	void execute(VkCommandBuffer primary, VkRenderPass render_pass, uint32_t subpass, const batch_key& key, uint64_t version,
+				 const record_callback& record)
+	{
+		VkCommandBuffer command_buffer{ get(render_pass, subpass, key, version, record) };
+		if (command_buffer)
+			vkCmdExecuteCommands(primary, 1, &command_buffer);
+	}
+
+	void invalidate(const batch_key& key)
+	{
+		auto it{ batches.find(key) };
+		if (it != batches.end())
+			it->second.valid = false;
+	}
+
+	void invalidate_pass(uint32_t pass)
+	{
+		for (auto& [key, b] : batches)
+		{
+			if (key.pass == pass)
+				b.valid = false;
+		}
+	}
+
+	void invalidate_all()
+	{
+		for (auto& [key, b] : batches)
+			b.valid = false;
+	}
+
+	void trim(uint32_t max_unused_frames)
+	{
+		for (auto it{ batches.begin() }; it != batches.end();)
+		{
+			if (frame_number - it->second.last_used_frame > max_unused_frames)
+			{
+				retire(it->second.command_buffer);
+				it = batches.erase(it);
+				++cache_statistics.evictions;
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	statistics get_statistics()
+	{
+		statistics result{ cache_statistics };
+		result.cached_batches = (uint32_t)batches.size();
+		return result;
+	}
+}
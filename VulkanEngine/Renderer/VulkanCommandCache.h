@@ -0,0 +1,58 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+#include <functional>
+
+namespace renderer::vulkan::command_cache
+{
+	// what a static batch is recorded against, batches with equal keys share one secondary command buffer
+	struct batch_key
+	{
+		uint32_t		pass{ 0 };
+		VkPipeline		pipeline{ VK_NULL_HANDLE };
+		VkViewport		viewport{};		// the scissor covers the viewport
+
+		bool operator==(const batch_key& other) const;
+	};
+
+	struct settings
+	{
+		uint32_t	max_unused_frames{ 300 };	// batches not executed for this long are released
+	};
+
+	struct statistics
+	{
+		uint64_t	hits{ 0 };			// executed without recording
+		uint64_t	records{ 0 };		// first recording of a key
+		uint64_t	rerecords{ 0 };		// recorded again after a version change, invalidation or swap chain recreation
+		uint64_t	evictions{ 0 };
+		uint32_t	cached_batches{ 0 };
+	};
+
+	// records the batch's draws, the pipeline is bound and viewport and scissor are set
+	using record_callback = std::function<void(VkCommandBuffer)>;
+
+	bool init(const settings& settings = {});
+	void shutdown();
+
+	// recycles the command buffers retired max_current_frames ago and evicts unused batches, called by core::begin_frame.
+	// does nothing while the cache is not initialized
+	void begin_frame(uint32_t frame_index);
+
+	// returns the secondary command buffer of the batch, recorded again when version differs from the one it was
+	// recorded with, it was invalidated or the swap chain was recreated since. main thread only.
+	// execute it inside render_pass and subpass, begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+	VkCommandBuffer get(VkRenderPass render_pass, uint32_t subpass, const batch_key& key, uint64_t version, const record_callback& record);
+
+	// get followed by vkCmdExecuteCommands, collect get results instead to execute several batches in one call
+	void execute(VkCommandBuffer primary, VkRenderPass render_pass, uint32_t subpass, const batch_key& key, uint64_t version,
+				 const record_callback& record);
+
+	void invalidate(const batch_key& key);
+	void invalidate_pass(uint32_t pass);
+	void invalidate_all();
+	// releases every batch not executed within max_unused_frames, e.g. when memory runs low
+	void trim(uint32_t max_unused_frames);
+
+	statistics get_statistics();
+}
@@ -19,6 +19,8 @@
 #include <optional>
 #include <set>
 #include <string>
+#include <atomic>
+#include <mutex>
 
 #ifndef DISABLE_COPY
 #define DISABLE_COPY(T)					      \
@@ -5,6 +5,15 @@
 #include "VulkanResource.h"
 #include "VulkanDescriptors.h"
 #include "VulkanMemory.h"
+#include "VulkanAllocator.h"
+#include "VulkanBudget.h"
+#include "VulkanFrameAllocator.h"
+#include "VulkanDebugLog.h"
+#include "VulkanPipelines.h"
+#include "VulkanCapture.h"
+#include "VulkanReadback.h"
+#include "VulkanCommandCache.h"
+#include "../Utilities/StartupTimer.h"
 
 namespace renderer::vulkan::core
 {
@@ -22,6 +31,13 @@ namespace renderer::vulkan::core
 			}
 		}queue_family_indices{};
 
+		// queues are externally synchronized and the transfer queue may alias the graphics queue,
+		// every submission and present goes through this lock
+		std::mutex queue_mutex;
+
+		// bumped whenever the swap chain is recreated, caches of anything built against it compare against this
+		uint64_t swap_chain_generation{ 0 };
+
 		class vulkan_command
 		{
 		public:
@@ -33,7 +49,7 @@ namespace renderer::vulkan::core
 				VkCommandPoolCreateInfo pool_info = vkh::command_pool_create_info(
 					VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, queue_family_indices.present_family.value());
 
-				VKCALL(vkCreateCommandPool(get_logical_device(), &pool_info, nullptr, &_command_pool), "failed to create command pool");
+				VKCALL(vkCreateCommandPool(get_logical_device(), &pool_info, allocator::get_callbacks(allocator::object_type::command), &_command_pool), "failed to create command pool");
 				assert(_command_pool);
 				if (!_command_pool)
 					return false;
@@ -65,11 +81,11 @@ namespace renderer::vulkan::core
 
 				for (size_t i{ 0 }; i < max_current_frames; ++i)
 				{
-					VKCALL(vkCreateSemaphore(get_logical_device(), &semaphore_info, nullptr, &_image_available_semaphores[i]), "failed to create image available semaphore");
+					VKCALL(vkCreateSemaphore(get_logical_device(), &semaphore_info, allocator::get_callbacks(allocator::object_type::sync), &_image_available_semaphores[i]), "failed to create image available semaphore");
 
-					VKCALL(vkCreateSemaphore(get_logical_device(), &semaphore_info, nullptr, &_render_finished_semaphores[i]), "failed to create render finished semaphore");
+					VKCALL(vkCreateSemaphore(get_logical_device(), &semaphore_info, allocator::get_callbacks(allocator::object_type::sync), &_render_finished_semaphores[i]), "failed to create render finished semaphore");
 
-					VKCALL(vkCreateFence(get_logical_device(), &fence_info, nullptr, &_fences[i]), "failed to create fence");
+					VKCALL(vkCreateFence(get_logical_device(), &fence_info, allocator::get_callbacks(allocator::object_type::sync), &_fences[i]), "failed to create fence");
 
 					assert(_image_available_semaphores[i] && _render_finished_semaphores[i] && _fences[i]);
 					if (!(_image_available_semaphores[i] && _render_finished_semaphores[i] && _fences[i]))
@@ -83,33 +99,43 @@ namespace renderer::vulkan::core
 			{
 				for (size_t i{ 0 }; i < max_current_frames; ++i)
 				{
-					vkDestroySemaphore(get_logical_device(), _image_available_semaphores[i], nullptr);
-					vkDestroySemaphore(get_logical_device(), _render_finished_semaphores[i], nullptr);
-					vkDestroyFence(get_logical_device(), _fences[i], nullptr);
+					vkDestroySemaphore(get_logical_device(), _image_available_semaphores[i], allocator::get_callbacks(allocator::object_type::sync));
+					vkDestroySemaphore(get_logical_device(), _render_finished_semaphores[i], allocator::get_callbacks(allocator::object_type::sync));
+					vkDestroyFence(get_logical_device(), _fences[i], allocator::get_callbacks(allocator::object_type::sync));
 				}
 
-				vkDestroyCommandPool(get_logical_device(), _command_pool, nullptr);
+				vkDestroyCommandPool(get_logical_device(), _command_pool, allocator::get_callbacks(allocator::object_type::command));
 			}
 
+			// vk_surface is null on headless devices, frames are then recorded and submitted without a swap chain
 			void begin_frame(vulkan_surface* vk_surface)
 			{
 				VkDevice logical_device{ get_logical_device() };
-				VkExtent2D swap_chain_extent{ vk_surface->get_swap_chain_extent() };
 
 				vkWaitForFences(logical_device, 1, &_fences[_current_frame], VK_TRUE, UINT64_MAX);
-
-				VkResult result = vkAcquireNextImageKHR(logical_device, vk_surface->get_swap_chain(), UINT64_MAX,
-					_image_available_semaphores[_current_frame], VK_NULL_HANDLE, &_image_index);
-
-				if (result == VK_ERROR_OUT_OF_DATE_KHR)
-				{
-					vk_surface->recreate_swap_chain(queue_family_indices.graphics_family.value(),
-						queue_family_indices.present_family.value());
-					return;
-				}
-				else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+				// the gpu is done with everything this frame slot wrote last time around
+				frame_allocator::begin_frame(_current_frame);
+				readback::begin_frame(_current_frame);
+				resources::begin_frame(_current_frame);
+				command_cache::begin_frame(_current_frame);
+				budget::update();
+
+				if (vk_surface)
 				{
-					throw std::runtime_error("failed to acquire swap chain image!");
+					VkResult result = vkAcquireNextImageKHR(logical_device, vk_surface->get_swap_chain(), UINT64_MAX,
+						_image_available_semaphores[_current_frame], VK_NULL_HANDLE, &_image_index);
+
+					if (result == VK_ERROR_OUT_OF_DATE_KHR)
+					{
+						vk_surface->recreate_swap_chain(queue_family_indices.graphics_family.value(),
+							queue_family_indices.present_family.value());
+						++swap_chain_generation;
+						return;
+					}
+					else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+					{
+						throw std::runtime_error("failed to acquire swap chain image!");
+					}
 				}
 
 				// only reset fence if we are submitting work
@@ -131,17 +157,23 @@ namespace renderer::vulkan::core
 				// in which stages of the pipeline to wait
 				VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 
-				submit_info.waitSemaphoreCount = 1;
+				submit_info.waitSemaphoreCount = vk_surface ? 1 : 0;
 				submit_info.pWaitSemaphores = wait_semaphores;
 				submit_info.pWaitDstStageMask = wait_stages;
 				submit_info.commandBufferCount = 1;
 				submit_info.pCommandBuffers = &_command_buffers[_current_frame];
 
 				VkSemaphore signal_semaphores[] = { _render_finished_semaphores[_current_frame] };
-				submit_info.signalSemaphoreCount = 1;
+				submit_info.signalSemaphoreCount = vk_surface ? 1 : 0;
 				submit_info.pSignalSemaphores = signal_semaphores;
 
-				VKCALL(vkQueueSubmit(graphics_queue, 1, &submit_info, _fences[_current_frame]), "failed to submit draw command buffer!");
+				VKCALL(queue_submit(graphics_queue, 1, &submit_info, _fences[_current_frame]), "failed to submit draw command buffer!");
+
+				if (!vk_surface)
+				{
+					_current_frame = (_current_frame + 1) % max_current_frames;
+					return;
+				}
 
 				VkPresentInfoKHR present_info{};
 				present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -154,13 +186,18 @@ namespace renderer::vulkan::core
 				present_info.pImageIndices = &_image_index;
 				present_info.pResults = nullptr; // Optional
 
-				VkResult result = vkQueuePresentKHR(present_queue, &present_info);
+				VkResult result{ VK_SUCCESS };
+				{
+					std::lock_guard lock{ queue_mutex };
+					result = vkQueuePresentKHR(present_queue, &present_info);
+				}
 
 				if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || _frame_buffer_resized)
 				{
 					_frame_buffer_resized = false;
 					vk_surface->recreate_swap_chain(queue_family_indices.graphics_family.value(),
 						queue_family_indices.present_family.value());
+					++swap_chain_generation;
 				}
 				else if (result != VK_SUCCESS) {
 					throw std::runtime_error("failed to present swap chain image!");
@@ -197,8 +234,11 @@ namespace renderer::vulkan::core
 				submit_info.commandBufferCount = 1;
 				submit_info.pCommandBuffers = &command_buffer;
 
-				vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-				vkQueueWaitIdle(graphics_queue);
+				{
+					std::lock_guard lock{ queue_mutex };
+					vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
+					vkQueueWaitIdle(graphics_queue);
+				}
 
 				vkFreeCommandBuffers(core::get_logical_device(), _command_pool, 1, &command_buffer);
 
@@ -276,6 +316,7 @@ namespace renderer::vulkan::core
 		
 		VkPhysicalDevice			device{ VK_NULL_HANDLE };
 		VkPhysicalDeviceFeatures	device_features;
+		VkPhysicalDeviceFeatures	enabled_device_features{};
 		VkPhysicalDeviceProperties	device_properties;
 
 		VkDevice					logical_device{ VK_NULL_HANDLE };
@@ -283,14 +324,31 @@ namespace renderer::vulkan::core
 		VkQueue						present_queue{ VK_NULL_HANDLE };
 		VkQueue						transfer_queue{ VK_NULL_HANDLE };
 
+		uint32_t					api_version{ VK_API_VERSION_1_0 };
+		// per frame region of the transient uniform/vertex ring
+		constexpr VkDeviceSize		transient_frame_size{ 4 * 1024 * 1024 };
+		// written on shutdown, the next start skips most of the driver's shader compilation
+		constexpr const char*		pipeline_cache_path{ "pipeline_cache.bin" };
+		bool						headless{ false };
+		bool						print_startup_report{ false };
+		bool						mesh_shader_supported{ false };
+		bool						memory_budget_supported{ false };
+
+		// VK_EXT_mesh_shader and the extensions it depends on, only enabled when the device supports all of them
+		const std::vector<const char*> mesh_shader_extensions = {
+			VK_EXT_MESH_SHADER_EXTENSION_NAME,
+			VK_KHR_SPIRV_1_4_EXTENSION_NAME,
+			VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME
+		};
+
 
 		static VKAPI_ATTR VkBool32 VKAPI_CALL debug_callback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity,
 															 VkDebugUtilsMessageTypeFlagsEXT message_type,
 															 const VkDebugUtilsMessengerCallbackDataEXT* callback_data,
 															 void* user_data) 
 		{
-			if (message_severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
-				std::cerr << "validation layer: " << callback_data->pMessage << std::endl;
+			// only copies the message into the debug log queue, printing happens on the logger thread
+			debug_log::push(message_severity, message_type, callback_data);
 			return VK_FALSE;
 		}
 
@@ -335,6 +393,30 @@ namespace renderer::vulkan::core
 			create_dm_info.pUserData = nullptr; // Optional
 		}
 
+		bool check_mesh_shader_support(const VkPhysicalDevice& device)
+		{
+			// the extension requires vulkan 1.1 on both the instance and the device
+			if (api_version < VK_API_VERSION_1_1 || device_properties.apiVersion < VK_API_VERSION_1_1)
+				return false;
+
+			if (!vkh::check_device_extensions_support(device, mesh_shader_extensions))
+				return false;
+
+			auto get_features2 = (PFN_vkGetPhysicalDeviceFeatures2)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2");
+			if (!get_features2)
+				return false;
+
+			VkPhysicalDeviceMeshShaderFeaturesEXT mesh_shader_features{};
+			mesh_shader_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+
+			VkPhysicalDeviceFeatures2 features2{};
+			features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features2.pNext = &mesh_shader_features;
+			get_features2(device, &features2);
+
+			return mesh_shader_features.taskShader && mesh_shader_features.meshShader;
+		}
+
 		bool is_device_suitable(const VkPhysicalDevice& device,
 			const std::vector<const char*>& device_extensions,
 			bool check_queue_families = true)
@@ -345,9 +427,10 @@ namespace renderer::vulkan::core
 			// 64 bit floats and multi viewport rendering (useful for VR)
 			vkGetPhysicalDeviceFeatures(device, &device_features);
 
-			bool graphics_card_adequate{ device_properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU &&
-										 device_features.samplerAnisotropy &&
-										 device_features.geometryShader };
+			// headless runs are meant for software implementations like lavapipe and swiftshader as well
+			bool graphics_card_adequate{ device_features.samplerAnisotropy &&
+										 (headless || (device_properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU &&
+													   device_features.geometryShader)) };
 
 			uint32_t queue_family_count = 0;
 			vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, nullptr);
@@ -377,7 +460,10 @@ namespace renderer::vulkan::core
 				}
 
 				VkBool32 present_support{ false };
-				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, vk_surface.get_surface(), &present_support);
+				if (headless)
+					present_support = (family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+				else
+					vkGetPhysicalDeviceSurfaceSupportKHR(device, i, vk_surface.get_surface(), &present_support);
 				if (present_support)
 					queue_family_indices.present_family = i;
 
@@ -403,13 +489,19 @@ namespace renderer::vulkan::core
 			bool all_extensions_supported{ vkh::check_device_extensions_support(device, device_extensions) };
 
 			// there is at least one supported image format and one supported presentation mode given the window surface
-			bool swap_chain_adequate{ false };
-			if (all_extensions_supported)
+			bool swap_chain_adequate{ headless };
+			if (all_extensions_supported && !headless)
 			{
 				vk_surface.populate_swap_chain_support_details(device);
 				swap_chain_adequate = vk_surface.is_swap_chain_adequate();
 			}
 
+			// optional, the meshlet renderer falls back to cpu culled indexed draws without it
+			mesh_shader_supported = check_mesh_shader_support(device);
+			// optional as well, budget falls back to its own allocation accounting. the query needs vulkan 1.1
+			memory_budget_supported = api_version >= VK_API_VERSION_1_1 && device_properties.apiVersion >= VK_API_VERSION_1_1 &&
+									  vkh::check_device_extensions_support(device, { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME });
+
 			return graphics_card_adequate && found_queue_families && all_extensions_supported && swap_chain_adequate;
 		}
 
@@ -462,19 +554,32 @@ namespace renderer::vulkan::core
 
 	}// anonymous namespace
 
-	bool init(GLFWwindow* window)
+	bool init(GLFWwindow* window, bool print_extensions, bool print_startup)
 	{
+		headless = window == nullptr;
+		print_startup_report = print_startup;
+		startup::scoped_phase phase{ "core: instance" };
+
 		VkApplicationInfo app_info{};
 		app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
 		app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		app_info.apiVersion = VK_API_VERSION_1_0;
+
+		// ask for vulkan 1.1 when the loader has it, optional features like mesh shaders depend on it
+		auto enumerate_instance_version = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+		uint32_t loader_version{ VK_API_VERSION_1_0 };
+		if (enumerate_instance_version)
+			enumerate_instance_version(&loader_version);
+
+		api_version = loader_version >= VK_API_VERSION_1_1 ? VK_API_VERSION_1_1 : VK_API_VERSION_1_0;
+		app_info.apiVersion = api_version;
 
 		VkInstanceCreateInfo create_info{};
 		create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 		create_info.pApplicationInfo = &app_info;
 
 #ifdef _DEBUG
+		debug_log::init();
 		VkDebugUtilsMessengerCreateInfoEXT debug_create_info{};
 		
 		// setting validation layers
@@ -500,37 +605,65 @@ namespace renderer::vulkan::core
 
 #endif
 
-		// check extensions
-		std::vector<const char*> extensions{ vkh::get_required_extensions() };
-		assert(extensions.data());
+		// check extensions, a headless instance doesn't need the window system ones
+		std::vector<const char*> extensions{};
+		if (!headless)
+		{
+			extensions = vkh::get_required_extensions(print_extensions);
+			assert(extensions.data());
+		}
+		else
+		{
+#if _DEBUG
+			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+#endif
+			if (print_extensions)
+				vkh::check_glfw_extensions_support(nullptr, 0, true);
+		}
 
 		create_info.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
 		create_info.ppEnabledExtensionNames = extensions.data();
 
 		// creating vulkan instance
-		VKCALL(vkCreateInstance(&create_info, nullptr, &instance), "failed to create vulkan instance!");
+		VKCALL(vkCreateInstance(&create_info, allocator::get_callbacks(allocator::object_type::instance), &instance), "failed to create vulkan instance!");
 		assert(instance);
 		if (!instance) return false;
 
 #if _DEBUG
 
-		VKCALL(proxy_create_debug_utils_messenger_ext(&debug_create_info, nullptr), "failed to setup debug messenger!");
+		VKCALL(proxy_create_debug_utils_messenger_ext(&debug_create_info, allocator::get_callbacks(allocator::object_type::instance)), "failed to setup debug messenger!");
 #endif
 
 		// create surface
-		if (!vk_surface.create_surface(window))
+		phase.next("core: surface");
+		if (!headless && !vk_surface.create_surface(window))
 			return false;
 
-		const std::vector<const char*> device_extensions = {
-			VK_KHR_SWAPCHAIN_EXTENSION_NAME
-		};
+		std::vector<const char*> device_extensions{};
+		if (!headless)
+			device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
+		phase.next("core: physical device");
 		pick_physical_device(device_extensions);
 		assert(device);
 		if (!device)
 			return false;
 
+		VkPhysicalDeviceMeshShaderFeaturesEXT enabled_mesh_shader_features{};
+		if (mesh_shader_supported)
+		{
+			device_extensions.insert(device_extensions.end(), mesh_shader_extensions.begin(), mesh_shader_extensions.end());
+
+			enabled_mesh_shader_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+			enabled_mesh_shader_features.taskShader = VK_TRUE;
+			enabled_mesh_shader_features.meshShader = VK_TRUE;
+		}
+
+		if (memory_budget_supported)
+			device_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
 		// creating grpahics queue
+		phase.next("core: logical device");
 		float queue_priority{ 1.f };
 		assert(queue_family_indices.is_complete());
 
@@ -549,9 +682,14 @@ namespace renderer::vulkan::core
 			queue_create_infos.push_back(queue_create_info);
 		}
 
-		VkPhysicalDeviceFeatures enabled_device_features{};
+		enabled_device_features = {};
 		enabled_device_features.samplerAnisotropy = VK_TRUE;
 
+		// block compressed textures, the texture loader picks whichever family is enabled
+		enabled_device_features.textureCompressionBC = device_features.textureCompressionBC;
+		enabled_device_features.textureCompressionASTC_LDR = device_features.textureCompressionASTC_LDR;
+		enabled_device_features.textureCompressionETC2 = device_features.textureCompressionETC2;
+
 		// Fill mode non solid is required for wireframe display
 		if (device_features.fillModeNonSolid)
 		{
@@ -570,6 +708,7 @@ namespace renderer::vulkan::core
 		logical_device_create_info.pQueueCreateInfos = queue_create_infos.data();
 		logical_device_create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
 		logical_device_create_info.pEnabledFeatures = &enabled_device_features;
+		logical_device_create_info.pNext = mesh_shader_supported ? &enabled_mesh_shader_features : nullptr;
 
 		// specifying device specific extensions and validation layers
 		logical_device_create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
@@ -583,7 +722,7 @@ namespace renderer::vulkan::core
 #else
 		logical_device_create_info.enabledLayerCount = 0;
 #endif
-		VKCALL(vkCreateDevice(device, &logical_device_create_info, nullptr, &logical_device), "failed to setup logical device!");
+		VKCALL(vkCreateDevice(device, &logical_device_create_info, allocator::get_callbacks(allocator::object_type::device), &logical_device), "failed to setup logical device!");
 		assert(logical_device);
 		if (!logical_device) return false;
 
@@ -592,15 +731,25 @@ namespace renderer::vulkan::core
 		vkGetDeviceQueue(logical_device, queue_family_indices.present_family.value(), 0, &present_queue);
 		vkGetDeviceQueue(logical_device, queue_family_indices.transfer_family.value(), 0, &transfer_queue);
 
+		phase.next("core: memory and resources");
 		memory::init();
 		resources::init();
+		budget::init();
+		if (!frame_allocator::init(transient_frame_size))
+			return false;
+		if (!pipelines::init(pipeline_cache_path))
+			return false;
+		if (!readback::init())
+			return false;
 		// vk_descriptors.init();
 
 		// TODO: remove?!
 		// create swap chain
-		if (!vk_surface.create_swap_chain(queue_family_indices.graphics_family.value(), queue_family_indices.present_family.value()))
+		phase.next("core: swap chain");
+		if (!headless && !vk_surface.create_swap_chain(queue_family_indices.graphics_family.value(), queue_family_indices.present_family.value()))
 			return false;
 		// create command pool and buffers
+		phase.next("core: command buffers");
 		if (!vk_command.create_command_pool() || !vk_command.create_command_buffer())
 			return false;
 
@@ -610,21 +759,34 @@ namespace renderer::vulkan::core
 	void shutdown()
 	{
 #if _DEBUG
-		proxy_destroy_debug_utils_messenger_ext(nullptr);
+		proxy_destroy_debug_utils_messenger_ext(allocator::get_callbacks(allocator::object_type::instance));
 #endif
 		vk_command.destroy();
-		vk_surface.destroy();
+		if (!headless)
+			vk_surface.destroy();
 
+		readback::shutdown();
+		pipelines::shutdown();
+		frame_allocator::shutdown();
+		budget::shutdown();
 		resources::shutdown();
 		memory::shutdown();
-		vkDestroyDevice(logical_device, nullptr);
-		vkDestroyInstance(instance, nullptr);
+		vkDestroyDevice(logical_device, allocator::get_callbacks(allocator::object_type::device));
+		vkDestroyInstance(instance, allocator::get_callbacks(allocator::object_type::instance));
+#if _DEBUG
+		debug_log::shutdown();
+#endif
+		allocator::shutdown();
 	}
 
 	VkInstance get_vulkan_instance() { return instance; }
 	VkPhysicalDevice get_physical_device() { return device; }
 	VkPhysicalDeviceProperties	get_physical_device_properties() { return device_properties; }
 	VkDevice get_logical_device() { return logical_device; }
+	const VkPhysicalDeviceFeatures& get_enabled_device_features() { return enabled_device_features; }
+	bool is_mesh_shader_supported() { return mesh_shader_supported; }
+	bool is_memory_budget_supported() { return memory_budget_supported; }
+	bool is_headless() { return headless; }
 
 	VkQueue get_graphics_queue() { return graphics_queue; }
 	uint32_t get_graphics_queue_family_index() { return queue_family_indices.graphics_family.value(); }
@@ -633,6 +795,12 @@ namespace renderer::vulkan::core
 	VkQueue get_transfer_queue() { return transfer_queue; }
 	uint32_t get_transfer_queue_family_index() { return queue_family_indices.transfer_family.value(); }
 
+	VkResult queue_submit(VkQueue queue, uint32_t submit_count, const VkSubmitInfo* submits, VkFence fence)
+	{
+		std::lock_guard lock{ queue_mutex };
+		return vkQueueSubmit(queue, submit_count, submits, fence);
+	}
+
 	uint32_t get_current_command_buffer_index()
 	{
 		return vk_command.get_current_command_buffer_index();
@@ -668,6 +836,11 @@ namespace renderer::vulkan::core
 		return vk_surface.get_depth_format();
 	}
 
+	uint64_t get_swap_chain_generation()
+	{
+		return swap_chain_generation;
+	}
+
 	bool create_frame_buffers(VkRenderPass render_pass)
 	{
 		return vk_surface.create_frame_buffers(render_pass);
@@ -675,12 +848,16 @@ namespace renderer::vulkan::core
 
 	void begin_frame()
 	{
-		vk_command.begin_frame(&vk_surface);
+		vk_command.begin_frame(headless ? nullptr : &vk_surface);
+		capture::on_begin_frame();
 	}
 
 	void end_frame()
 	{
-		vk_command.end_frame(&vk_surface, graphics_queue, present_queue);
+		vk_command.end_frame(headless ? nullptr : &vk_surface, graphics_queue, present_queue);
+		capture::on_end_frame();
+		if (startup::mark_first_frame() && print_startup_report)
+			startup::print_report();
 	}
 
 	void frame_buffer_resize_callback(GLFWwindow* window, int width, int height)
@@ -693,4 +870,14 @@ namespace renderer::vulkan::core
 		vk_command.transition_image_layout(image, format, old_layout, new_layout, graphics_queue);
 	}
 
+	VkCommandBuffer begin_single_time_commands()
+	{
+		return vk_command.begin_single_time_commands();
+	}
+
+	void end_single_time_commands(VkCommandBuffer command_buffer)
+	{
+		vk_command.end_single_time_commands(command_buffer, graphics_queue);
+	}
+
 }
\ No newline at end of file
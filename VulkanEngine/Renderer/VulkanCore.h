@@ -5,13 +5,22 @@ namespace renderer::vulkan::core
 {
 	constexpr int max_current_frames{ 3 };
 
-	bool init(GLFWwindow* window);
+	// a null window creates a headless device without surface or swap chain, any device type is accepted.
+	// begin_frame/end_frame then only record and submit, the swap chain getters must not be used.
+	// print_extensions dumps every available instance extension. startup stages are timed, print_startup prints
+	// startup::print_report once the first frame has been submitted
+	bool init(GLFWwindow* window, bool print_extensions = false, bool print_startup = false);
 	void shutdown();
 
 	VkInstance get_vulkan_instance();
 	VkPhysicalDevice get_physical_device();
 	VkPhysicalDeviceProperties	get_physical_device_properties();
 	VkDevice get_logical_device();
+	const VkPhysicalDeviceFeatures& get_enabled_device_features();
+	bool is_mesh_shader_supported();
+	// VK_EXT_memory_budget is enabled, see budget::get_heap_budget
+	bool is_memory_budget_supported();
+	bool is_headless();
 
 	VkQueue get_graphics_queue();
 	uint32_t get_graphics_queue_family_index();
@@ -19,6 +28,8 @@ namespace renderer::vulkan::core
 	uint32_t get_present_queue_family_index();
 	VkQueue get_transfer_queue();
 	uint32_t get_transfer_queue_family_index();
+	// thread safe vkQueueSubmit, use it for every submission outside of end_frame
+	VkResult queue_submit(VkQueue queue, uint32_t submit_count, const VkSubmitInfo* submits, VkFence fence);
 
 	uint32_t get_current_command_buffer_index();
 	VkCommandBuffer get_command_buffer();
@@ -27,6 +38,8 @@ namespace renderer::vulkan::core
 	float get_extent_aspect_ratio();
 	VkFormat get_swap_chain_image_format();
 	VkFormat get_swap_chain_depth_format();
+	// changes every time the swap chain is recreated
+	uint64_t get_swap_chain_generation();
 
 	bool create_frame_buffers(VkRenderPass render_pass);
 	void begin_frame();
@@ -34,5 +47,8 @@ namespace renderer::vulkan::core
 
 	void frame_buffer_resize_callback(GLFWwindow* window, int width, int height);
 	void transition_image_layout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout);
+	// records on the graphics queue and blocks until the work is done, main thread only
+	VkCommandBuffer begin_single_time_commands();
+	void end_single_time_commands(VkCommandBuffer command_buffer);
 	
 }
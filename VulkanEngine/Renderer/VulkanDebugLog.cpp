@@ -0,0 +1,350 @@
+#include "VulkanDebugLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+
+namespace renderer::vulkan::debug_log
+{
+	namespace
+	{
+		using clock = std::chrono::steady_clock;
+
+		constexpr size_t	queue_capacity{ 512 };	// power of 2
+		constexpr size_t	max_id_name_length{ 128 };
+		constexpr size_t	max_message_length{ 2048 };
+		static_assert((queue_capacity & (queue_capacity - 1)) == 0);
+
+		struct message
+		{
+			VkDebugUtilsMessageSeverityFlagBitsEXT	severity{};
+			VkDebugUtilsMessageTypeFlagsEXT			type{ 0 };
+			int32_t									id{ 0 };
+			char									id_name[max_id_name_length]{};
+			char									text[max_message_length]{};
+		};
+
+		// bounded multi producer queue (d. vyukov), every cell carries the sequence number it expects next.
+		// the validation layer calls back from whichever thread made the vulkan call, only the logger thread pops
+		struct cell
+		{
+			std::atomic<size_t>		sequence{ 0 };
+			message					data{};
+		};
+
+		struct id_entry
+		{
+			int32_t									id{ 0 };
+			std::string								id_name;
+			std::string								first_message;
+			VkDebugUtilsMessageSeverityFlagBitsEXT	severity{};
+			bool									performance{ false };
+			uint64_t								count{ 0 };
+			uint64_t								printed{ 0 };
+			uint64_t								suppressed{ 0 };
+			uint64_t								suppressed_since_summary{ 0 };
+		};
+
+		cell							queue[queue_capacity]{};
+		alignas(64) std::atomic<size_t>	enqueue_pos{ 0 };
+		alignas(64) std::atomic<size_t>	dequeue_pos{ 0 };
+		std::atomic<size_t>				processed_pos{ 0 };	// dequeue_pos once the popped messages are written out
+
+		std::atomic<uint64_t>			received{ 0 };
+		std::atomic<uint64_t>			dropped{ 0 };
+		std::atomic<uint64_t>			printed{ 0 };
+		std::atomic<uint64_t>			suppressed{ 0 };
+
+		settings						log_settings{};
+		std::thread						logger_thread{};
+		std::atomic<bool>				running{ false };
+		std::mutex						wake_mutex{};
+		std::condition_variable			wake_condition{};
+		std::condition_variable			flushed_condition{};
+
+		// owned by the logger thread, the getters lock entries_mutex for reading
+		std::unordered_map<uint64_t, id_entry>	entries{};
+		std::mutex								entries_mutex{};
+
+		void initialize_queue()
+		{
+			for (size_t i{ 0 }; i < queue_capacity; ++i)
+				queue[i].sequence.store(i, std::memory_order_relaxed);
+			enqueue_pos.store(0, std::memory_order_relaxed);
+			dequeue_pos.store(0, std::memory_order_relaxed);
+			processed_pos.store(0, std::memory_order_relaxed);
+		}
+
+		// the queue is also usable before init, the create info chained on vkCreateInstance can call back that early
+		struct queue_initializer
+		{
+			queue_initializer() { initialize_queue(); }
+		} initializer{};
+
+		bool try_pop(message& out)
+		{
+			const size_t pos{ dequeue_pos.load(std::memory_order_relaxed) };
+			cell& c{ queue[pos & (queue_capacity - 1)] };
+			if (c.sequence.load(std::memory_order_acquire) != pos + 1)
+				return false;
+
+			out = c.data;
+			c.sequence.store(pos + queue_capacity, std::memory_order_release);
+			dequeue_pos.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		void copy_string(char* dst, const char* src, size_t capacity)
+		{
+			if (!src)
+			{
+				dst[0] = 0;
+				return;
+			}
+			const size_t length{ std::min(strlen(src), capacity - 1) };
+			memcpy(dst, src, length);
+			dst[length] = 0;
+		}
+
+		// loader messages often have no id number, fall back to the id name and then to the text itself
+		uint64_t make_key(const message& m)
+		{
+			if (m.id)
+				return (uint64_t)(uint32_t)m.id;
+
+			const char* str{ m.id_name[0] ? m.id_name : m.text };
+			uint64_t hash{ 14695981039346656037ull };
+			for (; *str; ++str)
+				hash = (hash ^ (uint8_t)*str) * 1099511628211ull;
+			return hash | (1ull << 63);
+		}
+
+		const char* severity_name(VkDebugUtilsMessageSeverityFlagBitsEXT severity)
+		{
+			if (severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) return "error";
+			if (severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) return "warning";
+			if (severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) return "info";
+			return "verbose";
+		}
+
+		void process(const message& m, std::string& out)
+		{
+			id_entry& entry{ entries[make_key(m)] };
+			if (!entry.count)
+			{
+				entry.id = m.id;
+				entry.id_name = m.id_name;
+				entry.performance = m.type & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+				if (entry.performance)
+					entry.first_message = m.text;
+			}
+			entry.severity = std::max(entry.severity, m.severity);
+			++entry.count;
+
+			if (m.severity < log_settings.min_print_severity)
+				return;
+
+			if (entry.printed >= log_settings.burst_per_id)
+			{
+				++entry.suppressed;
+				++entry.suppressed_since_summary;
+				++suppressed;
+				return;
+			}
+
+			out += "validation layer ";
+			out += severity_name(m.severity);
+			out += ": ";
+			out += m.text;
+			out += '\n';
+			if (++entry.printed == log_settings.burst_per_id)
+			{
+				out += "validation layer: further occurrences of ";
+				out += entry.id_name.empty() ? std::to_string(entry.id) : entry.id_name;
+				out += " are suppressed\n";
+			}
+			++printed;
+		}
+
+		void print_summary(std::string& out)
+		{
+			for (auto& [key, entry] : entries)
+			{
+				if (!entry.suppressed_since_summary)
+					continue;
+
+				out += "validation layer: ";
+				out += entry.id_name.empty() ? std::to_string(entry.id) : entry.id_name;
+				out += " repeated " + std::to_string(entry.suppressed_since_summary) + " more times\n";
+				entry.suppressed_since_summary = 0;
+			}
+		}
+
+		void logger_loop()
+		{
+			message m{};
+			std::string out{};
+			clock::time_point last_summary{ clock::now() };
+
+			while (true)
+			{
+				const bool stop{ !running.load(std::memory_order_acquire) };
+
+				{
+					std::lock_guard lock{ entries_mutex };
+					while (try_pop(m))
+						process(m, out);
+
+					const clock::time_point now{ clock::now() };
+					if (stop || now - last_summary >= std::chrono::milliseconds{ log_settings.summary_interval_ms })
+					{
+						print_summary(out);
+						last_summary = now;
+					}
+				}
+
+				if (!out.empty())
+				{
+					std::cerr << out;
+					std::cerr.flush();
+					out.clear();
+				}
+				// under the mutex so a flush can't check the position and then miss the notify before it waits
+				{
+					std::lock_guard lock{ wake_mutex };
+					processed_pos.store(dequeue_pos.load(std::memory_order_relaxed), std::memory_order_release);
+					flushed_condition.notify_all();
+				}
+
+				if (stop)
+					return;
+
+				// producers don't take the mutex, a missed notify only delays the message until the timeout
+				std::unique_lock lock{ wake_mutex };
+				wake_condition.wait_for(lock, std::chrono::milliseconds{ 50 });
+			}
+		}
+
+	} // anonymous namespace
+
+	void init(const settings& settings)
+	{
+		assert(!running);
+		assert(settings.burst_per_id > 0);
+		log_settings = settings;
+		received = 0;
+		dropped = 0;
+		printed = 0;
+		suppressed = 0;
+
+		running.store(true, std::memory_order_release);
+		logger_thread = std::thread{ logger_loop };
+	}
+
+	void shutdown()
+	{
+		if (!running)
+			return;
+
+		{
+			std::lock_guard lock{ wake_mutex };
+			running.store(false, std::memory_order_release);
+		}
+		wake_condition.notify_one();
+		logger_thread.join();
+
+		if (dropped)
+			std::cerr << "validation layer: " << dropped << " messages were dropped, the debug log queue was full\n";
+
+		std::lock_guard lock{ entries_mutex };
+		entries.clear();
+	}
+
+	void push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type,
+			  const VkDebugUtilsMessengerCallbackDataEXT* callback_data)
+	{
+		assert(callback_data);
+		received.fetch_add(1, std::memory_order_relaxed);
+
+		size_t pos{ enqueue_pos.load(std::memory_order_relaxed) };
+		cell* c{ nullptr };
+		while (true)
+		{
+			c = &queue[pos & (queue_capacity - 1)];
+			const size_t sequence{ c->sequence.load(std::memory_order_acquire) };
+			const intptr_t diff{ (intptr_t)sequence - (intptr_t)pos };
+			if (diff == 0)
+			{
+				if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				// full, dropping is better than stalling the thread that made the vulkan call
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			else
+			{
+				pos = enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+
+		message& m{ c->data };
+		m.severity = severity;
+		m.type = type;
+		m.id = callback_data->messageIdNumber;
+		copy_string(m.id_name, callback_data->pMessageIdName, max_id_name_length);
+		copy_string(m.text, callback_data->pMessage, max_message_length);
+		c->sequence.store(pos + 1, std::memory_order_release);
+
+		wake_condition.notify_one();
+	}
+
+	void flush()
+	{
+		if (!running)
+			return;
+
+		const size_t target{ enqueue_pos.load(std::memory_order_acquire) };
+		wake_condition.notify_one();
+
+		std::unique_lock lock{ wake_mutex };
+		flushed_condition.wait_for(lock, std::chrono::seconds{ 5 }, [target] {
+			return processed_pos.load(std::memory_order_acquire) >= target || !running; });
+	}
+
+	std::vector<performance_hint> get_performance_hints()
+	{
+		std::vector<performance_hint> hints{};
+		std::lock_guard lock{ entries_mutex };
+		for (const auto& [key, entry] : entries)
+		{
+			if (entry.performance)
+				hints.push_back({ entry.id, entry.id_name, entry.first_message, entry.count });
+		}
+
+		std::sort(hints.begin(), hints.end(), [](const performance_hint& a, const performance_hint& b) { return a.count > b.count; });
+		return hints;
+	}
+
+	std::vector<message_count> get_message_counts()
+	{
+		std::vector<message_count> counts{};
+		std::lock_guard lock{ entries_mutex };
+		counts.reserve(entries.size());
+		for (const auto& [key, entry] : entries)
+			counts.push_back({ entry.id, entry.id_name, entry.severity, entry.count, entry.suppressed });
+
+		std::sort(counts.begin(), counts.end(), [](const message_count& a, const message_count& b) { return a.count > b.count; });
+		return counts;
+	}
+
+	statistics get_statistics()
+	{
+		return { received.load(), printed.load(), suppressed.load(), dropped.load() };
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+namespace renderer::vulkan::debug_log
+{
+	struct settings
+	{
+		// messages per id printed in full before the id is only counted
+		uint32_t	burst_per_id{ 5 };
+		// how often the logger prints "repeated n times" for suppressed ids, in milliseconds
+		uint32_t	summary_interval_ms{ 2000 };
+		VkDebugUtilsMessageSeverityFlagBitsEXT min_print_severity{ VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT };
+	};
+
+	// a VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT message, one entry per message id
+	struct performance_hint
+	{
+		int32_t			message_id{ 0 };
+		std::string		message_id_name;
+		std::string		message;		// first occurrence
+		uint64_t		count{ 0 };
+	};
+
+	struct message_count
+	{
+		int32_t			message_id{ 0 };
+		std::string		message_id_name;
+		VkDebugUtilsMessageSeverityFlagBitsEXT severity{};
+		uint64_t		count{ 0 };
+		uint64_t		suppressed{ 0 };
+	};
+
+	struct statistics
+	{
+		uint64_t		received{ 0 };
+		uint64_t		printed{ 0 };
+		uint64_t		suppressed{ 0 };
+		uint64_t		dropped{ 0 };		// queue was full
+	};
+
+	// starts the logger thread, called by core::init before the instance is created
+	void init(const settings& settings = {});
+	// drains what is left in the queue and joins the logger thread, called by core::shutdown after the instance is gone
+	void shutdown();
+
+	// lock free, safe from any thread. the message is copied (and truncated) into the queue, never blocks
+	void push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type,
+			  const VkDebugUtilsMessengerCallbackDataEXT* callback_data);
+
+	// blocks until every message pushed before the call has been processed
+	void flush();
+
+	std::vector<performance_hint> get_performance_hints();
+	std::vector<message_count> get_message_counts();
+	statistics get_statistics();
+}
@@ -0,0 +1,226 @@
+#include "VulkanDefragmenter.h"
+#include "VulkanMemory.h"
+#include "VulkanResource.h"
+
+#include <algorithm>
+
+namespace renderer::vulkan::defragmenter
+{
+	namespace
+	{
+		struct resource_entry
+		{
+			uint32_t		index{ 0 };
+			uint32_t		generation{ 0 };
+			uint32_t		block{ memory::dedicated_block };
+			VkDeviceSize	size{ 0 };
+			bool			image{ false };
+		};
+
+		// what the resource pools keep in one block, a block holding anything else can't be emptied
+		struct block_contents
+		{
+			uint32_t		movable_count{ 0 };
+			VkDeviceSize	largest{ 0 };
+		};
+
+		settings							defrag_settings{};
+		bool								initialized{ false };
+		std::vector<uint32_t>				evacuating{};
+		std::vector<memory::block_info>		blocks{};
+		std::vector<resource_entry>			entries{};
+		std::vector<block_contents>			contents{};
+		statistics							stats{};
+
+		const memory::block_info* find_block(uint32_t id)
+		{
+			for (const memory::block_info& info : blocks)
+			{
+				if (info.id == id)
+					return &info;
+			}
+			return nullptr;
+		}
+
+		bool is_evacuating(uint32_t id)
+		{
+			return std::find(evacuating.begin(), evacuating.end(), id) != evacuating.end();
+		}
+
+		// every sub-allocated resource in the pools, movable or not
+		void collect_entries()
+		{
+			entries.clear();
+			resources::for_each_buffer([](resources::buffer_handle h, const memory::buffer& buffer) {
+				if (buffer.block != memory::dedicated_block)
+					entries.push_back({ h.index, h.generation, buffer.block, buffer.allocation_size, false });
+			});
+			resources::for_each_image([](resources::image_handle h, const memory::image& image) {
+				if (image.block != memory::dedicated_block)
+					entries.push_back({ h.index, h.generation, image.block, image.allocation_size, true });
+			});
+
+			// the pool locks are released again, for_each callbacks must not look anything up
+			uint32_t max_id{ 0 };
+			for (const memory::block_info& info : blocks)
+				max_id = std::max(max_id, info.id + 1);
+			contents.assign(max_id, {});
+
+			auto is_fixed = [max_id](const resource_entry& entry) {
+				const bool movable{ entry.image ? resources::is_movable(resources::image_handle{ entry.index, entry.generation })
+												: resources::is_movable(resources::buffer_handle{ entry.index, entry.generation }) };
+				return !movable || entry.block >= max_id;
+			};
+			entries.erase(std::remove_if(entries.begin(), entries.end(), is_fixed), entries.end());
+
+			for (const resource_entry& entry : entries)
+			{
+				block_contents& c{ contents[entry.block] };
+				++c.movable_count;
+				c.largest = std::max(c.largest, entry.size);
+			}
+		}
+
+		// the sparsest non-empty block whose resources all fit into the holes of the other blocks of its kind, so the evacuation
+		// doesn't just allocate a new block
+		uint32_t pick_block()
+		{
+			uint32_t best{ memory::dedicated_block };
+			float best_occupancy{ defrag_settings.max_occupancy };
+			for (const memory::block_info& info : blocks)
+			{
+				const float occupancy{ (float)info.used / (float)info.size };
+				if (info.evacuating || !info.allocation_count || occupancy >= best_occupancy || info.id >= contents.size() ||
+					contents[info.id].movable_count != info.allocation_count)
+					continue;
+
+				VkDeviceSize free_bytes{ 0 };
+				VkDeviceSize largest_free_range{ 0 };
+				for (const memory::block_info& other : blocks)
+				{
+					// the spare empty block of the memory type takes either kind
+					if (other.id == info.id || other.evacuating || other.memory_type != info.memory_type ||
+						(other.optimal != info.optimal && other.allocation_count))
+						continue;
+					free_bytes += other.size - other.used;
+					largest_free_range = std::max(largest_free_range, other.largest_free_range);
+				}
+
+				if (free_bytes < info.used || largest_free_range < contents[info.id].largest)
+					continue;
+
+				best = info.id;
+				best_occupancy = occupancy;
+			}
+			return best;
+		}
+
+	} // anonymous namespace
+
+	bool init(const settings& settings)
+	{
+		defrag_settings = settings;
+		evacuating.clear();
+		stats = {};
+		initialized = true;
+		return true;
+	}
+
+	void shutdown()
+	{
+		for (uint32_t id : evacuating)
+			memory::set_block_evacuating(id, false);
+
+		evacuating.clear();
+		blocks.clear();
+		entries.clear();
+		contents.clear();
+		initialized = false;
+	}
+
+	void update(VkCommandBuffer command_buffer)
+	{
+		if (!initialized)
+			return;
+
+		memory::get_blocks(blocks);
+
+		// emptied blocks were freed, their ids may already belong to new blocks, which never start out evacuating
+		for (auto it{ evacuating.begin() }; it != evacuating.end();)
+		{
+			const memory::block_info* info{ find_block(*it) };
+			if (!info || !info->evacuating)
+			{
+				++stats.blocks_freed;
+				it = evacuating.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		bool sparse_blocks{ false };
+		for (const memory::block_info& info : blocks)
+			sparse_blocks |= !info.evacuating && info.allocation_count && (float)info.used < defrag_settings.max_occupancy * (float)info.size;
+		if (evacuating.empty() && !sparse_blocks)
+		{
+			stats.evacuating_blocks = 0;
+			return;
+		}
+
+		collect_entries();
+
+		if (evacuating.size() < defrag_settings.max_evacuating_blocks)
+		{
+			const uint32_t id{ pick_block() };
+			if (id != memory::dedicated_block)
+			{
+				memory::set_block_evacuating(id, true);
+				evacuating.push_back(id);
+			}
+		}
+
+		std::vector<resources::buffer_handle> buffers;
+		std::vector<resources::image_handle> images;
+		VkDeviceSize budget{ 0 };
+		for (const resource_entry& entry : entries)
+		{
+			if (!is_evacuating(entry.block))
+				continue;
+			if (budget && budget + entry.size > defrag_settings.max_bytes_per_frame)
+				break;
+
+			if (entry.image)
+				images.push_back({ entry.index, entry.generation });
+			else
+				buffers.push_back({ entry.index, entry.generation });
+			budget += entry.size;
+		}
+
+		if (budget)
+		{
+			const VkDeviceSize moved{ resources::relocate(command_buffer, buffers, images) };
+			if (moved)
+			{
+				stats.moves += buffers.size() + images.size();
+				stats.bytes_moved += moved;
+			}
+			else
+			{
+				// nothing could be allocated outside of the evacuating blocks, try again with other blocks later
+				for (uint32_t id : evacuating)
+					memory::set_block_evacuating(id, false);
+				stats.blocks_abandoned += (uint32_t)evacuating.size();
+				evacuating.clear();
+			}
+		}
+
+		stats.evacuating_blocks = (uint32_t)evacuating.size();
+	}
+
+	statistics get_statistics()
+	{
+		return stats;
+	}
+}
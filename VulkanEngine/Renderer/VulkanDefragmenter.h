@@ -0,0 +1,32 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+namespace renderer::vulkan::defragmenter
+{
+	// moves movable resources (see resources::create_buffer) out of sparsely used device memory blocks until the blocks
+	// are empty and go back to the driver
+	struct settings
+	{
+		VkDeviceSize	max_bytes_per_frame{ 4ull << 20 };	// at least one resource moves per frame while a block is evacuated
+		float			max_occupancy{ 0.5f };				// only blocks used less than this are evacuated
+		uint32_t		max_evacuating_blocks{ 1 };
+	};
+
+	struct statistics
+	{
+		uint64_t		moves{ 0 };
+		uint64_t		bytes_moved{ 0 };
+		uint32_t		blocks_freed{ 0 };
+		uint32_t		blocks_abandoned{ 0 };		// evacuations given up because their resources failed to move
+		uint32_t		evacuating_blocks{ 0 };
+	};
+
+	bool init(const settings& settings = {});
+	void shutdown();
+
+	// picks blocks to evacuate and records copies of up to max_bytes_per_frame of their resources. call it once per frame
+	// on the frame command buffer, outside of a render pass and before anything looks resources up. main thread only
+	void update(VkCommandBuffer command_buffer);
+
+	statistics get_statistics();
+}
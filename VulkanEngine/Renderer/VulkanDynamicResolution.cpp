@@ -0,0 +1,401 @@
+#include "VulkanDynamicResolution.h"
+#include "VulkanAllocator.h"
+#include "VulkanCore.h"
+#include "VulkanHelpers.h"
+#include "VulkanMemory.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace renderer::vulkan::dynamic_resolution
+{
+	namespace
+	{
+		// measurements are smoothed so one slow frame does not halve the resolution
+		constexpr double smoothing{ 0.2 };
+		// over budget the scale moves most of the way at once, under budget it recovers slowly
+		constexpr float decrease_rate{ 0.5f };
+		constexpr float increase_rate{ 0.1f };
+
+		struct target
+		{
+			memory::image	image{};
+			VkImageView		view{ VK_NULL_HANDLE };
+		};
+
+		settings				resolution_settings{};
+		VkExtent2D				max_extent{};
+		VkFormat				color_format{ VK_FORMAT_UNDEFINED };
+		VkFormat				depth_format{ VK_FORMAT_UNDEFINED };
+		VkFilter				blit_filter{ VK_FILTER_LINEAR };
+		VkRenderPass			render_pass{ VK_NULL_HANDLE };
+		VkFramebuffer			frame_buffer{ VK_NULL_HANDLE };
+		target					color{};
+		target					depth{};
+
+		VkQueryPool				query_pool{ VK_NULL_HANDLE };
+		float					timestamp_period{ 0 };
+		bool					query_pending[core::max_current_frames]{};
+		float					query_scale[core::max_current_frames]{};	// scale the queried frame was rendered at
+
+		float					scale{ 1.f };
+		VkExtent2D				render_extent{};
+		statistics				frame_statistics{};
+
+		VkFormat select_depth_format()
+		{
+			try
+			{
+				return vkh::find_supported_format(core::get_physical_device(), { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+												  VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+			}
+			catch (const std::runtime_error&)
+			{
+				return VK_FORMAT_UNDEFINED;
+			}
+		}
+
+		uint32_t scaled_size(uint32_t size, float s)
+		{
+			const uint32_t granularity{ std::max(resolution_settings.granularity, 1u) };
+			const uint32_t scaled{ (uint32_t)((float)size * s) / granularity * granularity };
+			return std::clamp(scaled, std::min(granularity, size), size);
+		}
+
+		void apply_scale(float new_scale)
+		{
+			scale = std::clamp(new_scale, resolution_settings.min_scale, resolution_settings.max_scale);
+			const VkExtent2D extent{ scaled_size(max_extent.width, scale), scaled_size(max_extent.height, scale) };
+			if (extent.width != render_extent.width || extent.height != render_extent.height)
+				++frame_statistics.adjustments;
+
+			render_extent = extent;
+			frame_statistics.scale = scale;
+			frame_statistics.render_extent = render_extent;
+		}
+
+		bool create_render_pass()
+		{
+			VkAttachmentDescription attachments[2]{};
+			attachments[0].format = color_format;
+			attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+			attachments[1].format = depth_format;
+			attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+			VkAttachmentReference color_reference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+			VkAttachmentReference depth_reference{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+			VkSubpassDescription subpass{};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = 1;
+			subpass.pColorAttachments = &color_reference;
+			subpass.pDepthStencilAttachment = &depth_reference;
+
+			// last frame's blit has to finish reading the color target before it is cleared, and the blit after this
+			// pass has to wait for the color writes
+			VkSubpassDependency dependencies[2]{};
+			dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+			dependencies[0].dstSubpass = 0;
+			dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+			dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			dependencies[1].srcSubpass = 0;
+			dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+			dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+			VkRenderPassCreateInfo info{};
+			info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			info.attachmentCount = 2;
+			info.pAttachments = attachments;
+			info.subpassCount = 1;
+			info.pSubpasses = &subpass;
+			info.dependencyCount = 2;
+			info.pDependencies = dependencies;
+			VKCALL(vkCreateRenderPass(core::get_logical_device(), &info, allocator::get_callbacks(allocator::object_type::pipeline), &render_pass),
+				   "failed to create dynamic resolution render pass");
+			return render_pass != VK_NULL_HANDLE;
+		}
+
+		bool create_target(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, target& out_target)
+		{
+			VkImageCreateInfo image_info = vkh::image_2d(format, max_extent.width, max_extent.height, 1, usage);
+			if (!memory::create_image(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, out_target.image))
+				return false;
+
+			VkImageViewCreateInfo view_info = vkh::image_view_2d(out_target.image.image, format, aspect, 1);
+			VKCALL(vkCreateImageView(core::get_logical_device(), &view_info, allocator::get_callbacks(allocator::object_type::memory), &out_target.view),
+				   "failed to create dynamic resolution target view");
+			return out_target.view != VK_NULL_HANDLE;
+		}
+
+		void destroy_target(target& t)
+		{
+			if (t.view)
+				vkDestroyImageView(core::get_logical_device(), t.view, allocator::get_callbacks(allocator::object_type::memory));
+			memory::destroy_image(t.image);
+			t = {};
+		}
+
+		bool create_frame_buffer()
+		{
+			const VkImageView views[2]{ color.view, depth.view };
+			VkFramebufferCreateInfo info{};
+			info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			info.renderPass = render_pass;
+			info.attachmentCount = 2;
+			info.pAttachments = views;
+			info.width = max_extent.width;
+			info.height = max_extent.height;
+			info.layers = 1;
+			VKCALL(vkCreateFramebuffer(core::get_logical_device(), &info, allocator::get_callbacks(allocator::object_type::other), &frame_buffer),
+				   "failed to create dynamic resolution frame buffer");
+			return frame_buffer != VK_NULL_HANDLE;
+		}
+
+		bool create_query_pool()
+		{
+			const VkPhysicalDeviceLimits limits{ core::get_physical_device_properties().limits };
+			if (!limits.timestampComputeAndGraphics)
+				return false;
+
+			VkQueryPoolCreateInfo info{};
+			info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			info.queryCount = core::max_current_frames * 2;
+			VKCALL(vkCreateQueryPool(core::get_logical_device(), &info, allocator::get_callbacks(allocator::object_type::other), &query_pool),
+				   "failed to create dynamic resolution query pool");
+			timestamp_period = limits.timestampPeriod;
+			return query_pool != VK_NULL_HANDLE;
+		}
+
+		// the frame slot's fence has signaled, so the queries it wrote last time around are available without waiting
+		void read_timestamps(uint32_t slot)
+		{
+			if (!query_pending[slot])
+				return;
+			query_pending[slot] = false;
+
+			uint64_t results[4]{};	// value and availability for both queries
+			const VkResult result{ vkGetQueryPoolResults(core::get_logical_device(), query_pool, slot * 2, 2, sizeof(results), results,
+														  sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) };
+			if (result != VK_SUCCESS || !results[1] || !results[3] || results[2] < results[0])
+				return;
+
+			frame_statistics.gpu_ms = (double)(results[2] - results[0]) * timestamp_period / 1e6;
+
+			// gpu time mostly follows the pixel count, so it is tracked as the cost of a frame at full max_extent.
+			// that keeps the estimate valid across scale changes
+			const double fraction{ (double)query_scale[slot] * query_scale[slot] };
+			const double cost{ frame_statistics.gpu_ms / std::max(fraction, 1e-3) };
+			double& smoothed{ frame_statistics.cost_per_full_frame_ms };
+			smoothed = smoothed > 0 ? smoothed + (cost - smoothed) * smoothing : cost;
+
+			if (!resolution_settings.adaptive || smoothed <= 0)
+				return;
+
+			const double budget{ resolution_settings.target_frame_ms * resolution_settings.headroom };
+			const float desired{ (float)std::sqrt(budget / smoothed) };
+			const float rate{ desired < scale ? decrease_rate : increase_rate };
+			apply_scale(scale + (desired - scale) * rate);
+		}
+
+	} // anonymous namespace
+
+	bool init(const settings& settings)
+	{
+		assert(settings.min_scale > 0.f && settings.min_scale <= settings.max_scale);
+		resolution_settings = settings;
+
+		const bool headless{ core::is_headless() };
+		max_extent = settings.max_extent;
+		if (!max_extent.width || !max_extent.height)
+		{
+			assert(!headless);
+			if (headless)
+			{
+				std::cout << "dynamic resolution: headless devices need settings.max_extent!\n";
+				return false;
+			}
+			max_extent = core::get_swap_chain_extent();
+		}
+
+		color_format = settings.color_format;
+		if (color_format == VK_FORMAT_UNDEFINED)
+			color_format = headless ? VK_FORMAT_R8G8B8A8_UNORM : core::get_swap_chain_image_format();
+
+		depth_format = select_depth_format();
+		if (depth_format == VK_FORMAT_UNDEFINED)
+		{
+			std::cout << "dynamic resolution: no depth format!\n";
+			return false;
+		}
+
+		// blits from formats without linear filtering have to use nearest
+		VkFormatProperties format_properties{};
+		vkGetPhysicalDeviceFormatProperties(core::get_physical_device(), color_format, &format_properties);
+		if (!(format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT))
+		{
+			std::cout << "dynamic resolution: color format cannot be blitted!\n";
+			return false;
+		}
+		blit_filter = format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+		if (!create_render_pass() ||
+			!create_target(color_format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+						   VK_IMAGE_ASPECT_COLOR_BIT, color) ||
+			!create_target(depth_format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, depth) ||
+			!create_frame_buffer())
+			return false;
+
+		frame_statistics = {};
+		frame_statistics.timestamps = create_query_pool();
+		std::fill(std::begin(query_pending), std::end(query_pending), false);
+		render_extent = {};
+		apply_scale(settings.max_scale);
+		frame_statistics.adjustments = 0;
+		return true;
+	}
+
+	void shutdown()
+	{
+		VkDevice device{ core::get_logical_device() };
+		vkDeviceWaitIdle(device);
+
+		if (query_pool)
+			vkDestroyQueryPool(device, query_pool, allocator::get_callbacks(allocator::object_type::other));
+		if (frame_buffer)
+			vkDestroyFramebuffer(device, frame_buffer, allocator::get_callbacks(allocator::object_type::other));
+		destroy_target(depth);
+		destroy_target(color);
+		if (render_pass)
+			vkDestroyRenderPass(device, render_pass, allocator::get_callbacks(allocator::object_type::pipeline));
+
+		query_pool = VK_NULL_HANDLE;
+		frame_buffer = VK_NULL_HANDLE;
+		render_pass = VK_NULL_HANDLE;
+		frame_statistics = {};
+	}
+
+	void begin(VkCommandBuffer command_buffer, const VkClearColorValue& clear_color)
+	{
+		assert(render_pass);
+		const uint32_t slot{ core::get_current_command_buffer_index() };
+		if (query_pool)
+		{
+			read_timestamps(slot);
+			vkCmdResetQueryPool(command_buffer, query_pool, slot * 2, 2);
+			vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, slot * 2);
+			query_scale[slot] = scale;
+		}
+
+		VkClearValue clear_values[2]{};
+		clear_values[0].color = clear_color;
+		clear_values[1].depthStencil = { 1.f, 0 };
+
+		const VkRect2D rect{ vkh::rect_2d(render_extent.width, render_extent.height, 0, 0) };
+		VkRenderPassBeginInfo begin_info{};
+		begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		begin_info.renderPass = render_pass;
+		begin_info.framebuffer = frame_buffer;
+		begin_info.renderArea = rect;
+		begin_info.clearValueCount = 2;
+		begin_info.pClearValues = clear_values;
+		vkCmdBeginRenderPass(command_buffer, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+
+		const VkViewport viewport{ vkh::viewport((float)render_extent.width, (float)render_extent.height, 0.f, 1.f) };
+		vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+		vkCmdSetScissor(command_buffer, 0, 1, &rect);
+	}
+
+	void end(VkCommandBuffer command_buffer)
+	{
+		vkCmdEndRenderPass(command_buffer);
+	}
+
+	void upscale(VkCommandBuffer command_buffer, VkImage target, VkExtent2D target_extent, VkImageLayout old_layout, VkImageLayout new_layout)
+	{
+		VkImageMemoryBarrier barrier = vkh::image_memory_barrier(target, old_layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+																 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+							 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkImageBlit blit{};
+		blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		blit.srcOffsets[1] = { (int32_t)render_extent.width, (int32_t)render_extent.height, 1 };
+		blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		blit.dstOffsets[1] = { (int32_t)target_extent.width, (int32_t)target_extent.height, 1 };
+		vkCmdBlitImage(command_buffer, color.image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					   1, &blit, blit_filter);
+
+		barrier = vkh::image_memory_barrier(target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, new_layout,
+											VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+							 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		if (query_pool)
+		{
+			const uint32_t slot{ core::get_current_command_buffer_index() };
+			vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, slot * 2 + 1);
+			query_pending[slot] = true;
+		}
+	}
+
+	void set_scale(float new_scale)
+	{
+		apply_scale(new_scale);
+	}
+
+	void set_target_frame_ms(float target_frame_ms)
+	{
+		assert(target_frame_ms > 0.f);
+		resolution_settings.target_frame_ms = target_frame_ms;
+	}
+
+	VkRenderPass get_render_pass()
+	{
+		return render_pass;
+	}
+
+	VkExtent2D get_render_extent()
+	{
+		return render_extent;
+	}
+
+	glm::vec2 get_uv_scale()
+	{
+		if (!max_extent.width || !max_extent.height)
+			return glm::vec2{ 1.f };
+		return glm::vec2{ (float)render_extent.width / max_extent.width, (float)render_extent.height / max_extent.height };
+	}
+
+	VkImageView get_color_view()
+	{
+		return color.view;
+	}
+
+	VkImageView get_depth_view()
+	{
+		return depth.view;
+	}
+
+	statistics get_statistics()
+	{
+		return frame_statistics;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+#include <glm/vec2.hpp>
+
+namespace renderer::vulkan::dynamic_resolution
+{
+	struct settings
+	{
+		float		target_frame_ms{ 16.6f };
+		float		headroom{ 0.9f };			// aim this fraction below the target so spikes do not drop frames
+		float		min_scale{ 0.5f };			// per axis, relative to max_extent
+		float		max_scale{ 1.f };
+		uint32_t	granularity{ 8 };			// render extents are multiples of this, small changes are ignored
+		bool		adaptive{ true };			// false keeps the scale given to set_scale
+		// size the targets are created at, zero uses the swap chain extent. larger swap chains upscale from this size
+		VkExtent2D	max_extent{};
+		// undefined uses the swap chain format, or rgba8 on headless devices
+		VkFormat	color_format{ VK_FORMAT_UNDEFINED };
+	};
+
+	struct statistics
+	{
+		float		scale{ 1.f };
+		VkExtent2D	render_extent{};
+		double		gpu_ms{ 0 };				// from begin to upscale, measured max_current_frames ago
+		double		cost_per_full_frame_ms{ 0 };	// smoothed gpu_ms divided by the rendered fraction of max_extent
+		uint32_t	adjustments{ 0 };
+		bool		timestamps{ false };		// false when the queue cannot write timestamps, the scale is then fixed
+	};
+
+	// creates a color and depth target at max_extent once, the scene is rendered into a sub-rect of them
+	bool init(const settings& settings = {});
+	void shutdown();
+
+	// reads the timestamps of the frame that last used this frame slot, adjusts the render extent, then begins the
+	// render pass with viewport and scissor set to the render extent. pipelines use dynamic viewport and scissor
+	void begin(VkCommandBuffer command_buffer, const VkClearColorValue& clear_color = {});
+	// ends the render pass, the color target is left in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+	void end(VkCommandBuffer command_buffer);
+
+	// blits the render extent to the whole target image, usually the swap chain image, outside a render pass. the target
+	// needs VK_IMAGE_USAGE_TRANSFER_DST_BIT, it is transitioned from old_layout to new_layout
+	void upscale(VkCommandBuffer command_buffer, VkImage target, VkExtent2D target_extent, VkImageLayout old_layout, VkImageLayout new_layout);
+
+	// overrides the controller until its next adjustment, or for good when settings.adaptive is false
+	void set_scale(float scale);
+	void set_target_frame_ms(float target_frame_ms);
+
+	VkRenderPass get_render_pass();
+	VkExtent2D get_render_extent();
+	// render extent over max_extent, for passes that sample the targets with normalized coordinates
+	glm::vec2 get_uv_scale();
+	VkImageView get_color_view();
+	VkImageView get_depth_view();
+	statistics get_statistics();
+}
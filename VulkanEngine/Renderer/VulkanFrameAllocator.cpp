@@ -0,0 +1,116 @@
+#include "VulkanFrameAllocator.h"
+#include "VulkanCore.h"
+#include "VulkanMemory.h"
+
+#include <algorithm>
+
+namespace renderer::vulkan::frame_allocator
+{
+	namespace
+	{
+		// transfer source so per frame data can also be staged into device local buffers
+		constexpr VkBufferUsageFlags buffer_usage{ VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+												   VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+												   VK_BUFFER_USAGE_TRANSFER_SRC_BIT };
+
+		memory::buffer				ring{};
+		VkDeviceSize				frame_size{ 0 };
+		VkDeviceSize				default_alignment{ 0 };
+
+		// offsets are relative to the active region, its base only changes in begin_frame on the render thread
+		VkDeviceSize				region_base{ 0 };
+		std::atomic<VkDeviceSize>	head{ 0 };
+		std::atomic<uint64_t>		allocation_count{ 0 };
+		std::atomic<uint64_t>		failed_allocations{ 0 };
+		VkDeviceSize				peak_used_bytes{ 0 };
+
+	} // anonymous namespace
+
+	bool init(VkDeviceSize size)
+	{
+		const VkPhysicalDeviceLimits limits{ core::get_physical_device_properties().limits };
+		default_alignment = std::max<VkDeviceSize>({ limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment, 16 });
+
+		// keep every region aligned so region relative and absolute alignment agree
+		frame_size = (size + default_alignment - 1) & ~(default_alignment - 1);
+
+		// prefer memory the gpu reads directly (resizable bar / unified memory), plain host memory otherwise
+		constexpr VkMemoryPropertyFlags host_flags{ VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+		const bool has_device_local_host_memory{ memory::find_memory_type(UINT32_MAX, host_flags | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != UINT32_MAX };
+
+		const VkDeviceSize total_size{ frame_size * core::max_current_frames };
+		if (!(has_device_local_host_memory && memory::create_buffer(total_size, buffer_usage, host_flags | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ring)) &&
+			!memory::create_buffer(total_size, buffer_usage, host_flags, ring))
+		{
+			std::cout << "failed to create the per frame ring buffer!\n";
+			return false;
+		}
+
+		region_base = 0;
+		head = 0;
+		return true;
+	}
+
+	void shutdown()
+	{
+		memory::destroy_buffer(ring);
+		frame_size = 0;
+	}
+
+	void begin_frame(uint32_t frame_index)
+	{
+		assert(frame_index < core::max_current_frames);
+
+		peak_used_bytes = std::max(peak_used_bytes, head.load(std::memory_order_relaxed));
+		region_base = frame_index * frame_size;
+		head.store(0, std::memory_order_relaxed);
+		allocation_count.store(0, std::memory_order_relaxed);
+	}
+
+	allocation allocate(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		assert(ring.mapped);
+		alignment = alignment ? alignment : default_alignment;
+		assert((alignment & (alignment - 1)) == 0);
+
+		// regions are only default aligned, a larger alignment has to hold for the offset into the whole buffer
+		const VkDeviceSize base{ region_base };
+		VkDeviceSize offset{ head.load(std::memory_order_relaxed) };
+		VkDeviceSize aligned{ 0 };
+		do
+		{
+			aligned = ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+			if (aligned + size > frame_size)
+			{
+				failed_allocations.fetch_add(1, std::memory_order_relaxed);
+				return {};
+			}
+		} while (!head.compare_exchange_weak(offset, aligned + size, std::memory_order_relaxed));
+
+		allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+		const VkDeviceSize absolute_offset{ base + aligned };
+		return { ring.buffer, absolute_offset, size, static_cast<uint8_t*>(ring.mapped) + absolute_offset };
+	}
+
+	VkBuffer get_buffer()
+	{
+		return ring.buffer;
+	}
+
+	VkDescriptorBufferInfo get_descriptor_info(VkDeviceSize range)
+	{
+		return { ring.buffer, 0, range };
+	}
+
+	statistics get_statistics()
+	{
+		statistics stats{};
+		stats.frame_size = frame_size;
+		stats.used_bytes = head.load(std::memory_order_relaxed);
+		stats.peak_used_bytes = std::max(peak_used_bytes, stats.used_bytes);
+		stats.allocation_count = allocation_count.load(std::memory_order_relaxed);
+		stats.failed_allocations = failed_allocations.load(std::memory_order_relaxed);
+		return stats;
+	}
+}
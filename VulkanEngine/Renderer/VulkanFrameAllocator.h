@@ -0,0 +1,54 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+#include <cstring>
+
+namespace renderer::vulkan::frame_allocator
+{
+	// transient sub-allocation, only valid until the frame it was made in is recycled max_current_frames later.
+	// offset is from the start of the shared buffer, use it as the dynamic offset or the vertex/index buffer offset
+	struct allocation
+	{
+		VkBuffer		buffer{ VK_NULL_HANDLE };
+		VkDeviceSize	offset{ 0 };
+		VkDeviceSize	size{ 0 };
+		void*			mapped{ nullptr };
+
+		[[nodiscard]] bool is_valid() const { return mapped != nullptr; }
+	};
+
+	struct statistics
+	{
+		VkDeviceSize	frame_size{ 0 };
+		VkDeviceSize	used_bytes{ 0 };		// current frame
+		VkDeviceSize	peak_used_bytes{ 0 };
+		uint64_t		allocation_count{ 0 };	// current frame
+		uint64_t		failed_allocations{ 0 };
+	};
+
+	// one persistently mapped buffer split into max_current_frames regions of frame_size bytes
+	bool init(VkDeviceSize frame_size);
+	void shutdown();
+
+	// rewinds the region of frame_index, only once that frame's fence has signaled. called by core::begin_frame
+	void begin_frame(uint32_t frame_index);
+
+	// lock free, safe from any recording thread. alignment 0 uses minUniformBufferOffsetAlignment.
+	// returns an invalid allocation when the frame region is exhausted
+	allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+
+	template<typename T>
+	allocation push(const T& data, VkDeviceSize alignment = 0)
+	{
+		allocation a{ allocate(sizeof(T), alignment) };
+		if (a.is_valid())
+			memcpy(a.mapped, &data, sizeof(T));
+		return a;
+	}
+
+	VkBuffer get_buffer();
+	// for VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC / STORAGE_BUFFER_DYNAMIC bindings, the allocation offset is bound at draw time
+	VkDescriptorBufferInfo get_descriptor_info(VkDeviceSize range);
+
+	statistics get_statistics();
+}
@@ -16,14 +16,15 @@ namespace renderer::vulkan::vkh
 		}
 	}
 
-	bool check_glfw_extensions_support(const char** glfw_extensions, const uint32_t glfw_extension_count)
+	bool check_glfw_extensions_support(const char** glfw_extensions, const uint32_t glfw_extension_count, bool print_available)
 	{
 		uint32_t extension_count = 0;
 		vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
 		std::vector<VkExtensionProperties> vk_extensions{extension_count};
 		vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, vk_extensions.data());
 
-		print_available_extensions(vk_extensions);
+		if (print_available)
+			print_available_extensions(vk_extensions);
 
 		for (uint32_t i{ 0 }; i < glfw_extension_count; ++i)
 		{
@@ -86,13 +87,13 @@ namespace renderer::vulkan::vkh
 		return required_extensions.empty();
 	}
 
-	std::vector<const char*> get_required_extensions() 
+	std::vector<const char*> get_required_extensions(bool print_available)
 	{
 		uint32_t glfw_extension_count = 0;
 		const char** glfw_extensions;
 		glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
 
-		if (!check_glfw_extensions_support(glfw_extensions, glfw_extension_count))
+		if (!check_glfw_extensions_support(glfw_extensions, glfw_extension_count, print_available))
 		{
 			std::cout << "glfw extensions are not supported!\n";
 			return {};
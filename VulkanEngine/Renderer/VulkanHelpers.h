@@ -145,6 +145,42 @@ namespace renderer::vulkan::vkh
 		return shader_stage;
 	}
 
+	inline VkPushConstantRange push_constant_range(VkShaderStageFlags stages, uint32_t size, uint32_t offset = 0)
+	{
+		VkPushConstantRange range{};
+		range.stageFlags = stages;
+		range.offset = offset;
+		range.size = size;
+		return range;
+	}
+
+	inline VkPipelineLayoutCreateInfo pipeline_layout(uint32_t set_layout_count, const VkDescriptorSetLayout* set_layouts,
+													  uint32_t push_constant_range_count = 0, const VkPushConstantRange* push_constant_ranges = nullptr)
+	{
+		VkPipelineLayoutCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		info.setLayoutCount = set_layout_count;
+		info.pSetLayouts = set_layouts;
+		info.pushConstantRangeCount = push_constant_range_count;
+		info.pPushConstantRanges = push_constant_ranges;
+		return info;
+	}
+
+	inline VkComputePipelineCreateInfo compute_pipeline(VkShaderModule module, VkPipelineLayout layout, const char* entry = "main")
+	{
+		VkComputePipelineCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		info.stage = pipeline_shader_stage(module, VK_SHADER_STAGE_COMPUTE_BIT, entry);
+		info.layout = layout;
+		return info;
+	}
+
+	// group count covering count invocations of group_size
+	inline uint32_t dispatch_size(uint32_t count, uint32_t group_size)
+	{
+		return (count + group_size - 1) / group_size;
+	}
+
 	inline VkPipelineDynamicStateCreateInfo pipeline_dynamic_state(const std::vector<VkDynamicState>& dynamic_states)
 	{
 		VkPipelineDynamicStateCreateInfo info{};
@@ -203,6 +239,59 @@ namespace renderer::vulkan::vkh
 		return info;
 	}
 
+	inline VkImageCreateInfo image_2d(VkFormat format, uint32_t width, uint32_t height, uint32_t mip_levels, VkImageUsageFlags usage)
+	{
+		VkImageCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		info.imageType = VK_IMAGE_TYPE_2D;
+		info.format = format;
+		info.extent = { width, height, 1 };
+		info.mipLevels = mip_levels;
+		info.arrayLayers = 1;
+		info.samples = VK_SAMPLE_COUNT_1_BIT;
+		info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		info.usage = usage;
+		info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		return info;
+	}
+
+	inline VkImageViewCreateInfo image_view_2d(VkImage image, VkFormat format, VkImageAspectFlags aspect_mask, uint32_t mip_levels)
+	{
+		VkImageViewCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		info.image = image;
+		info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		info.format = format;
+		info.subresourceRange.aspectMask = aspect_mask;
+		info.subresourceRange.baseMipLevel = 0;
+		info.subresourceRange.levelCount = mip_levels;
+		info.subresourceRange.baseArrayLayer = 0;
+		info.subresourceRange.layerCount = 1;
+		return info;
+	}
+
+	inline VkImageMemoryBarrier image_memory_barrier(VkImage image, VkImageLayout old_layout, VkImageLayout new_layout,
+													 VkAccessFlags src_access_mask, VkAccessFlags dst_access_mask,
+													 VkImageAspectFlags aspect_mask, uint32_t base_mip_level, uint32_t level_count)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = old_layout;
+		barrier.newLayout = new_layout;
+		barrier.srcAccessMask = src_access_mask;
+		barrier.dstAccessMask = dst_access_mask;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = aspect_mask;
+		barrier.subresourceRange.baseMipLevel = base_mip_level;
+		barrier.subresourceRange.levelCount = level_count;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		return barrier;
+	}
+
 	inline VkPipelineColorBlendAttachmentState pipeline_color_blend_attachment_state(
 		VkColorComponentFlags color_write_mask,
 		VkBool32 blend_enable)
@@ -251,10 +340,11 @@ namespace renderer::vulkan::vkh
 	}
 
 	void print_available_extensions(const std::vector<VkExtensionProperties>& extensions);
-	bool check_glfw_extensions_support(const char** glfw_extensions, const uint32_t glfw_extension_count);
+	// print_available dumps every instance extension, only useful when diagnosing a missing one
+	bool check_glfw_extensions_support(const char** glfw_extensions, const uint32_t glfw_extension_count, bool print_available = false);
 	bool check_validation_layers_support(const std::vector<const char*>& requested_layers);
 	bool check_device_extensions_support(const VkPhysicalDevice& device, const std::vector<const char*>& device_extensions);
-	std::vector<const char*> get_required_extensions();
+	std::vector<const char*> get_required_extensions(bool print_available = false);
 
 	VkFormat find_supported_format(VkPhysicalDevice device, const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
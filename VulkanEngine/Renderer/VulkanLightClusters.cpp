@@ -0,0 +1,361 @@
+#include "VulkanLightClusters.h"
+#include "VulkanAllocator.h"
+#include "VulkanCore.h"
+#include "VulkanFrameAllocator.h"
+#include "VulkanHelpers.h"
+#include "VulkanMemory.h"
+#include "VulkanPipelines.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace renderer::vulkan::light_clusters
+{
+	namespace
+	{
+		constexpr uint32_t binding_count{ 5 };
+		constexpr uint32_t clusters_per_group{ 64 };	// local_size_x of the binning shader
+		constexpr VkPipelineStageFlags reader_stages{ VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };
+
+		// matches the push constant block of cluster_light_binning.comp
+		struct push_constants
+		{
+			glm::mat4	view;
+			float		projection[4];		// [0][0], [1][1], [2][0], [2][1]
+			uint32_t	grid_size[4];		// width, height, depth, light count
+			uint32_t	extent[4];			// width, height, tile size, index capacity
+			float		depth_range[2];
+		};
+		static_assert(sizeof(push_constants) <= 128, "push constants beyond the guaranteed minimum");
+
+		enum buffer_binding : uint32_t
+		{
+			lights_binding,
+			aabbs_binding,
+			grid_binding,
+			indices_binding,
+			counter_binding,
+		};
+
+		settings							cluster_settings{};
+		geometry::lights::cluster_grid		grid{};
+		geometry::lights::cluster_lights	cpu_clusters{};
+		uint32_t							cluster_capacity{ 0 };
+		statistics							frame_statistics{};
+
+		std::array<memory::buffer, binding_count>	buffers{};
+		VkDescriptorSetLayout						set_layout{ VK_NULL_HANDLE };
+		VkDescriptorPool							descriptor_pool{ VK_NULL_HANDLE };
+		VkDescriptorSet								descriptor_set{ VK_NULL_HANDLE };
+		VkPipelineLayout							pipeline_layout{ VK_NULL_HANDLE };
+		VkPipeline									pipeline{ VK_NULL_HANDLE };
+
+		bool create_storage_buffer(VkDeviceSize size, memory::buffer& out_buffer)
+		{
+			return memory::create_buffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+										 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, out_buffer);
+		}
+
+		void write_descriptors()
+		{
+			std::array<VkDescriptorBufferInfo, binding_count> infos{};
+			std::array<VkWriteDescriptorSet, binding_count> writes{};
+			for (uint32_t i{ 0 }; i < binding_count; ++i)
+			{
+				infos[i] = { buffers[i].buffer, 0, VK_WHOLE_SIZE };
+				writes[i] = vkh::write_descriptor_set(descriptor_set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, i, &infos[i]);
+			}
+			vkUpdateDescriptorSets(core::get_logical_device(), binding_count, writes.data(), 0, nullptr);
+		}
+
+		void memory_barrier(VkCommandBuffer command_buffer, VkPipelineStageFlags src_stages, VkAccessFlags src_access,
+							VkPipelineStageFlags dst_stages, VkAccessFlags dst_access)
+		{
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = src_access;
+			barrier.dstAccessMask = dst_access;
+			vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		// stages data in the frame allocator and records a copy into the device local buffer
+		bool upload(VkCommandBuffer command_buffer, const void* data, VkDeviceSize size, const memory::buffer& destination)
+		{
+			if (!size)
+				return true;
+
+			const frame_allocator::allocation staging{ frame_allocator::allocate(size, 16) };
+			if (!staging.is_valid())
+			{
+				std::cout << "light clusters: frame allocator exhausted, " << size << " bytes of light data dropped!\n";
+				return false;
+			}
+
+			memcpy(staging.mapped, data, size);
+			const VkBufferCopy region{ staging.offset, 0, size };
+			vkCmdCopyBuffer(command_buffer, staging.buffer, destination.buffer, 1, &region);
+			return true;
+		}
+
+		bool upload_lights(VkCommandBuffer command_buffer, const geometry::lights::light* lights, uint32_t light_count)
+		{
+			if (light_count > cluster_settings.max_lights)
+			{
+				std::cout << "light clusters: " << light_count << " lights exceed max_lights!\n";
+				return false;
+			}
+
+			frame_statistics.light_count = light_count;
+			return upload(command_buffer, lights, (VkDeviceSize)light_count * sizeof(geometry::lights::light), buffers[lights_binding]);
+		}
+
+		bool create_pipeline()
+		{
+			const VkPushConstantRange push_constant_range{ vkh::push_constant_range(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(push_constants)) };
+			VkPipelineLayoutCreateInfo layout_info = vkh::pipeline_layout(1, &set_layout, 1, &push_constant_range);
+			VKCALL(vkCreatePipelineLayout(core::get_logical_device(), &layout_info, allocator::get_callbacks(allocator::object_type::pipeline), &pipeline_layout),
+				   "failed to create light binning pipeline layout");
+			if (!pipeline_layout)
+				return false;
+
+			pipeline = pipelines::create_compute_pipeline(cluster_settings.shader_path, pipeline_layout);
+			return pipeline != VK_NULL_HANDLE;
+		}
+
+	} // anonymous namespace
+
+	bool init(const settings& settings)
+	{
+		assert(settings.max_lights && settings.max_indices);
+		cluster_settings = settings;
+		VkDevice device{ core::get_logical_device() };
+
+		std::array<VkDescriptorSetLayoutBinding, binding_count> bindings{};
+		for (uint32_t i{ 0 }; i < binding_count; ++i)
+			bindings[i] = vkh::descriptor_set_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, i);
+		VkDescriptorSetLayoutCreateInfo set_layout_info = vkh::descriptor_set_layout(binding_count, bindings.data());
+		VKCALL(vkCreateDescriptorSetLayout(device, &set_layout_info, allocator::get_callbacks(allocator::object_type::descriptor), &set_layout),
+			   "failed to create light cluster descriptor set layout");
+
+		VkDescriptorPoolSize pool_size{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, binding_count };
+		VkDescriptorPoolCreateInfo pool_info = vkh::descriptor_pool(1, &pool_size, 1);
+		VKCALL(vkCreateDescriptorPool(device, &pool_info, allocator::get_callbacks(allocator::object_type::descriptor), &descriptor_pool),
+			   "failed to create light cluster descriptor pool");
+
+		VkDescriptorSetAllocateInfo alloc_info = vkh::descriptor_set_alloc_info(descriptor_pool, &set_layout, 1);
+		VKCALL(vkAllocateDescriptorSets(device, &alloc_info, &descriptor_set), "failed to allocate light cluster descriptor set");
+		if (!set_layout || !descriptor_pool || !descriptor_set)
+			return false;
+
+		// the grid sized buffers are created by update_grid, a single cluster keeps the descriptors valid until then
+		cluster_capacity = 1;
+		if (!create_storage_buffer((VkDeviceSize)settings.max_lights * sizeof(geometry::lights::light), buffers[lights_binding]) ||
+			!create_storage_buffer(2 * sizeof(glm::vec4), buffers[aabbs_binding]) ||
+			!create_storage_buffer(2 * sizeof(uint32_t), buffers[grid_binding]) ||
+			!create_storage_buffer((VkDeviceSize)settings.max_indices * sizeof(uint32_t), buffers[indices_binding]) ||
+			!create_storage_buffer(sizeof(uint32_t), buffers[counter_binding]))
+			return false;
+		write_descriptors();
+
+		if (!create_pipeline())
+			std::cout << "light clusters: gpu binning unavailable, using the cpu path\n";
+
+		return true;
+	}
+
+	void shutdown()
+	{
+		VkDevice device{ core::get_logical_device() };
+		pipelines::destroy_pipeline(pipeline);
+		if (pipeline_layout)
+			vkDestroyPipelineLayout(device, pipeline_layout, allocator::get_callbacks(allocator::object_type::pipeline));
+		if (descriptor_pool)
+			vkDestroyDescriptorPool(device, descriptor_pool, allocator::get_callbacks(allocator::object_type::descriptor));
+		if (set_layout)
+			vkDestroyDescriptorSetLayout(device, set_layout, allocator::get_callbacks(allocator::object_type::descriptor));
+
+		for (memory::buffer& buffer : buffers)
+			memory::destroy_buffer(buffer);
+
+		pipeline_layout = VK_NULL_HANDLE;
+		descriptor_pool = VK_NULL_HANDLE;
+		descriptor_set = VK_NULL_HANDLE;
+		set_layout = VK_NULL_HANDLE;
+		grid = {};
+		cpu_clusters = {};
+		cluster_capacity = 0;
+		frame_statistics = {};
+	}
+
+	bool update_grid(const glm::mat4& projection, VkExtent2D extent)
+	{
+		if (!extent.width || !extent.height)
+			extent = core::get_swap_chain_extent();
+		assert(extent.width && extent.height);
+
+		geometry::lights::build_grid(projection, extent.width, extent.height, cluster_settings.clusters, grid);
+		const uint32_t cluster_count{ grid.cluster_count() };
+
+		// previous frames may still read the bounds and the grid
+		VkDevice device{ core::get_logical_device() };
+		vkDeviceWaitIdle(device);
+
+		if (cluster_count > cluster_capacity)
+		{
+			memory::destroy_buffer(buffers[aabbs_binding]);
+			memory::destroy_buffer(buffers[grid_binding]);
+			if (!create_storage_buffer((VkDeviceSize)cluster_count * 2 * sizeof(glm::vec4), buffers[aabbs_binding]) ||
+				!create_storage_buffer((VkDeviceSize)cluster_count * 2 * sizeof(uint32_t), buffers[grid_binding]))
+				return false;
+
+			cluster_capacity = cluster_count;
+			write_descriptors();
+		}
+
+		// interleaved min, max as the shaders read them
+		const VkDeviceSize size{ (VkDeviceSize)cluster_count * 2 * sizeof(glm::vec4) };
+		memory::buffer staging{};
+		if (!memory::create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging))
+			return false;
+
+		glm::vec4* destination{ static_cast<glm::vec4*>(staging.mapped) };
+		for (uint32_t i{ 0 }; i < cluster_count; ++i)
+		{
+			destination[i * 2] = grid.aabb_min[i];
+			destination[i * 2 + 1] = grid.aabb_max[i];
+		}
+
+		VkCommandBuffer command_buffer{ core::begin_single_time_commands() };
+		const VkBufferCopy region{ 0, 0, size };
+		vkCmdCopyBuffer(command_buffer, staging.buffer, buffers[aabbs_binding].buffer, 1, &region);
+		memory_barrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, reader_stages, VK_ACCESS_SHADER_READ_BIT);
+		core::end_single_time_commands(command_buffer);
+
+		memory::destroy_buffer(staging);
+		return true;
+	}
+
+	bool bin_cpu(VkCommandBuffer command_buffer, const glm::mat4& view, const glm::mat4& projection,
+				 const geometry::lights::light* lights, uint32_t light_count)
+	{
+		assert(grid.cluster_count() && "update_grid must run before binning");
+		frame_statistics.gpu_binning = false;
+
+		const auto start{ std::chrono::steady_clock::now() };
+		geometry::lights::bin_lights(grid, view, projection, lights, light_count, cpu_clusters);
+		frame_statistics.cpu_binning_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		const uint32_t index_count{ (uint32_t)cpu_clusters.indices.size() };
+		frame_statistics.index_count = index_count;
+		if (index_count > cluster_settings.max_indices)
+		{
+			std::cout << "light clusters: " << index_count << " light indices exceed max_indices!\n";
+			return false;
+		}
+
+		// the grid is written straight into the staging memory in the layout the shaders read
+		const uint32_t cluster_count{ grid.cluster_count() };
+		const VkDeviceSize grid_size{ (VkDeviceSize)cluster_count * 2 * sizeof(uint32_t) };
+		const frame_allocator::allocation grid_staging{ frame_allocator::allocate(grid_size, 16) };
+		if (!grid_staging.is_valid())
+		{
+			std::cout << "light clusters: frame allocator exhausted, " << grid_size << " bytes of light data dropped!\n";
+			return false;
+		}
+
+		uint32_t* grid_data{ static_cast<uint32_t*>(grid_staging.mapped) };
+		for (uint32_t i{ 0 }; i < cluster_count; ++i)
+		{
+			grid_data[i * 2] = cpu_clusters.offsets[i];
+			grid_data[i * 2 + 1] = cpu_clusters.counts[i];
+		}
+
+		// earlier frames and passes may still read the buffers that are about to be replaced
+		memory_barrier(command_buffer, reader_stages, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+		const VkBufferCopy grid_region{ grid_staging.offset, 0, grid_size };
+		vkCmdCopyBuffer(command_buffer, grid_staging.buffer, buffers[grid_binding].buffer, 1, &grid_region);
+		if (!upload_lights(command_buffer, lights, light_count) ||
+			!upload(command_buffer, cpu_clusters.indices.data(), (VkDeviceSize)index_count * sizeof(uint32_t), buffers[indices_binding]) ||
+			!upload(command_buffer, &index_count, sizeof(uint32_t), buffers[counter_binding]))
+			return false;
+
+		memory_barrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, reader_stages, VK_ACCESS_SHADER_READ_BIT);
+		return true;
+	}
+
+	bool bin_gpu(VkCommandBuffer command_buffer, const glm::mat4& view, const glm::mat4& projection,
+				 const geometry::lights::light* lights, uint32_t light_count)
+	{
+		assert(grid.cluster_count() && "update_grid must run before binning");
+		if (!pipeline)
+			return false;
+
+		frame_statistics.gpu_binning = true;
+		frame_statistics.index_count = 0;
+		frame_statistics.cpu_binning_ms = 0;
+
+		memory_barrier(command_buffer, reader_stages, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+		if (!upload_lights(command_buffer, lights, light_count))
+			return false;
+		vkCmdFillBuffer(command_buffer, buffers[counter_binding].buffer, 0, sizeof(uint32_t), 0);
+		memory_barrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+					   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+		const geometry::lights::cluster_settings& clusters{ grid.settings };
+		push_constants constants{};
+		constants.view = view;
+		constants.projection[0] = projection[0][0];
+		constants.projection[1] = projection[1][1];
+		constants.projection[2] = projection[2][0];
+		constants.projection[3] = projection[2][1];
+		constants.grid_size[0] = grid.width;
+		constants.grid_size[1] = grid.height;
+		constants.grid_size[2] = grid.depth;
+		constants.grid_size[3] = light_count;
+		constants.extent[0] = grid.extent_width;
+		constants.extent[1] = grid.extent_height;
+		constants.extent[2] = clusters.tile_size;
+		constants.extent[3] = cluster_settings.max_indices;
+		constants.depth_range[0] = clusters.near_depth;
+		constants.depth_range[1] = clusters.far_depth;
+
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+		vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &constants);
+		vkCmdDispatch(command_buffer, (grid.cluster_count() + clusters_per_group - 1) / clusters_per_group, 1, 1);
+
+		memory_barrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, reader_stages, VK_ACCESS_SHADER_READ_BIT);
+		return true;
+	}
+
+	bool is_gpu_binning_supported()
+	{
+		return pipeline != VK_NULL_HANDLE;
+	}
+
+	VkDescriptorSetLayout get_descriptor_set_layout()
+	{
+		return set_layout;
+	}
+
+	VkDescriptorSet get_descriptor_set()
+	{
+		return descriptor_set;
+	}
+
+	const geometry::lights::cluster_grid& get_grid()
+	{
+		return grid;
+	}
+
+	const geometry::lights::cluster_lights& get_cpu_clusters()
+	{
+		return cpu_clusters;
+	}
+
+	statistics get_statistics()
+	{
+		return frame_statistics;
+	}
+}
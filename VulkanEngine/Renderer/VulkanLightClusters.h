@@ -0,0 +1,49 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+#include "../Geometry/LightClusters.h"
+
+namespace renderer::vulkan::light_clusters
+{
+	struct settings
+	{
+		geometry::lights::cluster_settings	clusters{};
+		uint32_t							max_lights{ 16384 };
+		uint32_t							max_indices{ 1 << 20 };	// light index list capacity shared by every cluster
+		// spir-v of Shaders/cluster_light_binning.comp, without it only the cpu path is available
+		std::string							shader_path{ "Shaders/cluster_light_binning.comp.spv" };
+	};
+
+	struct statistics
+	{
+		uint32_t	light_count{ 0 };
+		uint32_t	index_count{ 0 };		// cpu path only, the gpu path keeps its count on the device
+		double		cpu_binning_ms{ 0 };
+		bool		gpu_binning{ false };
+	};
+
+	// the set shading passes and the binning pass share. bindings, all storage buffers:
+	// 0 lights, 1 cluster aabbs (min, max), 2 grid (offset, count per cluster), 3 light indices, 4 index counter
+	bool init(const settings& settings = {});
+	void shutdown();
+
+	// rebuilds the cluster bounds, call on swap chain recreation and whenever the projection changes.
+	// a zero extent uses core::get_swap_chain_extent(). waits for the device before replacing the buffers
+	bool update_grid(const glm::mat4& projection, VkExtent2D extent = {});
+
+	// bins on the cpu (geometry::lights::bin_lights) and records copies of the lights, grid and indices from the frame
+	// allocator into the device local buffers, followed by a barrier for compute and fragment shader reads
+	bool bin_cpu(VkCommandBuffer command_buffer, const glm::mat4& view, const glm::mat4& projection,
+				 const geometry::lights::light* lights, uint32_t light_count);
+
+	// uploads the lights the same way and records the binning dispatch. false when the shader could not be loaded
+	bool bin_gpu(VkCommandBuffer command_buffer, const glm::mat4& view, const glm::mat4& projection,
+				 const geometry::lights::light* lights, uint32_t light_count);
+
+	bool is_gpu_binning_supported();
+
+	VkDescriptorSetLayout get_descriptor_set_layout();
+	VkDescriptorSet get_descriptor_set();
+	const geometry::lights::cluster_grid& get_grid();
+	const geometry::lights::cluster_lights& get_cpu_clusters();
+	statistics get_statistics();
+}
@@ -0,0 +1,65 @@
+#include "VulkanLod.h"
+#include "VulkanCore.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/geometric.hpp>
+
+namespace renderer::vulkan::lod
+{
+	namespace
+	{
+		constexpr uint32_t instances_per_job{ 512 };
+
+		float max_axis_scale(const glm::mat4& m)
+		{
+			return std::max({ glm::length(glm::vec3{ m[0].x, m[0].y, m[0].z }),
+							  glm::length(glm::vec3{ m[1].x, m[1].y, m[1].z }),
+							  glm::length(glm::vec3{ m[2].x, m[2].y, m[2].z }) });
+		}
+
+	} // anonymous namespace
+
+	lod_view make_view(const glm::vec3& camera_position, float fov, bool fov_is_horizontal, float threshold_pixels, float hysteresis)
+	{
+		const VkExtent2D extent{ core::get_swap_chain_extent() };
+
+		float tan_half_fov_y{ std::tan(fov * 0.5f) };
+		if (fov_is_horizontal)
+			tan_half_fov_y /= core::get_extent_aspect_ratio();
+
+		lod_view view{};
+		view.camera_position = camera_position;
+		view.pixels_per_unit = (float)extent.height / (2.f * tan_half_fov_y);
+		view.threshold_pixels = threshold_pixels;
+		view.hysteresis = hysteresis;
+		return view;
+	}
+
+	void select_lods(std::vector<lod_instance>& instances, const lod_view& view)
+	{
+		const uint32_t instance_count{ (uint32_t)instances.size() };
+		const uint32_t job_count{ (instance_count + instances_per_job - 1) / instances_per_job };
+
+		jobs::parallel_for(job_count, [&](uint32_t job) {
+			const uint32_t end{ std::min(instance_count, (job + 1) * instances_per_job) };
+			for (uint32_t i{ job * instances_per_job }; i < end; ++i)
+			{
+				lod_instance& instance{ instances[i] };
+				if (!instance.lods)
+					continue;
+
+				const glm::vec4 center{ instance.model * glm::vec4{ instance.bounds_center, 1.f } };
+				const float scale{ max_axis_scale(instance.model) };
+				// distance to the bounding sphere, the closest any part of the mesh can be
+				const float distance{ glm::distance(glm::vec3{ center.x, center.y, center.z }, view.camera_position) -
+									  instance.bounds_radius * scale };
+
+				instance.current_lod = geometry::select_lod(*instance.lods, distance, view.pixels_per_unit * scale,
+															view.threshold_pixels, view.hysteresis, instance.current_lod);
+			}
+		});
+	}
+}
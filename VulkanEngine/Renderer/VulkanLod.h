@@ -0,0 +1,33 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+#include "../Geometry/Lod.h"
+
+#include <glm/mat4x4.hpp>
+
+namespace renderer::vulkan::lod
+{
+	struct lod_instance
+	{
+		const std::vector<geometry::mesh_lod>*	lods{ nullptr };
+		glm::mat4								model{ 1.f };
+		glm::vec3								bounds_center{ 0.f };	// object space bounding sphere
+		float									bounds_radius{ 0.f };
+		uint32_t								current_lod{ 0 };		// persists between frames for the hysteresis
+	};
+
+	struct lod_view
+	{
+		glm::vec3	camera_position;
+		float		pixels_per_unit;
+		float		threshold_pixels;
+		float		hysteresis;
+	};
+
+	// fov in radians. the projected pixel size comes from the current swap chain extent,
+	// for a horizontal fov the vertical one is derived from the extent aspect ratio.
+	lod_view make_view(const glm::vec3& camera_position, float fov, bool fov_is_horizontal,
+					   float threshold_pixels = 1.f, float hysteresis = 0.25f);
+
+	// updates current_lod of every instance, runs on the job system
+	void select_lods(std::vector<lod_instance>& instances, const lod_view& view);
+}
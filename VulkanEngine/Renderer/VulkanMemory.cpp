@@ -0,0 +1,479 @@
+#include "VulkanMemory.h"
+#include "VulkanCore.h"
+#include "VulkanHelpers.h"
+#include "VulkanAllocator.h"
+
+#include <algorithm>
+
+namespace renderer::vulkan::memory
+{
+	namespace
+	{
+		// smaller heaps, e.g. the device local host visible one, get blocks of an eighth of their size
+		constexpr VkDeviceSize max_block_size{ 64ull << 20 };
+
+		struct free_range
+		{
+			VkDeviceSize	offset{ 0 };
+			VkDeviceSize	size{ 0 };
+		};
+
+		struct block
+		{
+			VkDeviceMemory				memory{ VK_NULL_HANDLE };
+			VkDeviceSize				size{ 0 };
+			VkDeviceSize				used{ 0 };
+			uint32_t					memory_type{ 0 };
+			uint32_t					allocation_count{ 0 };
+			bool						optimal{ false };
+			bool						evacuating{ false };
+			std::vector<free_range>		free_ranges;	// sorted by offset, neighbours are always merged
+		};
+
+		// where a resource lives, copied into buffer and image
+		struct allocation
+		{
+			VkDeviceMemory	memory{ VK_NULL_HANDLE };
+			VkDeviceSize	offset{ 0 };
+			VkDeviceSize	size{ 0 };
+			uint32_t		block{ dedicated_block };
+			uint32_t		heap_index{ 0 };
+		};
+
+		VkPhysicalDeviceMemoryProperties				memory_properties{};
+		std::array<std::atomic<VkDeviceSize>, VK_MAX_MEMORY_HEAPS>	heap_usage{};
+		std::mutex										block_mutex{};
+		std::vector<block>								blocks{};
+		std::vector<uint32_t>							free_block_ids{};
+		std::atomic<uint32_t>							dedicated_count{ 0 };
+		std::atomic<VkDeviceSize>						dedicated_bytes{ 0 };
+
+		VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+		}
+
+		VkDeviceSize get_block_size(uint32_t memory_type)
+		{
+			const VkDeviceSize heap_size{ memory_properties.memoryHeaps[memory_properties.memoryTypes[memory_type].heapIndex].size };
+			return std::min(max_block_size, heap_size / 8);
+		}
+
+		VkDeviceMemory allocate_memory(VkDeviceSize size, uint32_t memory_type)
+		{
+			VkMemoryAllocateInfo alloc_info{};
+			alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			alloc_info.allocationSize = size;
+			alloc_info.memoryTypeIndex = memory_type;
+
+			VkDeviceMemory memory{ VK_NULL_HANDLE };
+			if (vkAllocateMemory(core::get_logical_device(), &alloc_info, allocator::get_callbacks(allocator::object_type::memory), &memory) != VK_SUCCESS)
+				return VK_NULL_HANDLE;
+
+			heap_usage[memory_properties.memoryTypes[memory_type].heapIndex] += size;
+			return memory;
+		}
+
+		void free_memory(VkDeviceMemory memory, VkDeviceSize size, uint32_t heap_index)
+		{
+			vkFreeMemory(core::get_logical_device(), memory, allocator::get_callbacks(allocator::object_type::memory));
+			heap_usage[heap_index] -= size;
+		}
+
+		uint32_t create_block(uint32_t memory_type, bool optimal)
+		{
+			const VkDeviceSize size{ get_block_size(memory_type) };
+			VkDeviceMemory memory{ allocate_memory(size, memory_type) };
+			if (!memory)
+				return dedicated_block;
+
+			uint32_t id{ (uint32_t)blocks.size() };
+			if (!free_block_ids.empty())
+			{
+				id = free_block_ids.back();
+				free_block_ids.pop_back();
+			}
+			else
+			{
+				blocks.emplace_back();
+			}
+
+			block& b{ blocks[id] };
+			b.memory = memory;
+			b.size = size;
+			b.used = 0;
+			b.memory_type = memory_type;
+			b.allocation_count = 0;
+			b.optimal = optimal;
+			b.evacuating = false;
+			b.free_ranges.assign(1, { 0, size });
+			return id;
+		}
+
+		// best fit over every block of the memory type, the smallest hole that fits keeps large holes for large resources.
+		// optimally tiled images get blocks of their own so bufferImageGranularity never has to be respected
+		bool suballocate(const VkMemoryRequirements& requirements, uint32_t memory_type, bool optimal, allocation& out_allocation)
+		{
+			std::lock_guard lock{ block_mutex };
+
+			uint32_t best_block{ dedicated_block };
+			size_t best_range{ 0 };
+			VkDeviceSize best_size{ UINT64_MAX };
+			for (uint32_t id{ 0 }; id < blocks.size(); ++id)
+			{
+				// the empty block kept around for the memory type can take either kind of resource
+				const block& b{ blocks[id] };
+				if (!b.memory || b.evacuating || b.memory_type != memory_type || (b.optimal != optimal && b.allocation_count) ||
+					b.size - b.used < requirements.size)
+					continue;
+
+				for (size_t i{ 0 }; i < b.free_ranges.size(); ++i)
+				{
+					const free_range& range{ b.free_ranges[i] };
+					const VkDeviceSize offset{ align_up(range.offset, requirements.alignment) };
+					if (offset + requirements.size <= range.offset + range.size && range.size < best_size)
+					{
+						best_block = id;
+						best_range = i;
+						best_size = range.size;
+					}
+				}
+			}
+
+			if (best_block == dedicated_block)
+			{
+				best_block = create_block(memory_type, optimal);
+				if (best_block == dedicated_block)
+					return false;
+			}
+
+			block& b{ blocks[best_block] };
+			b.optimal = optimal;
+			free_range& range{ b.free_ranges[best_range] };
+			const VkDeviceSize offset{ align_up(range.offset, requirements.alignment) };
+			const free_range tail{ offset + requirements.size, range.offset + range.size - offset - requirements.size };
+
+			// the alignment padding in front stays free
+			if (offset > range.offset)
+			{
+				range.size = offset - range.offset;
+				if (tail.size)
+					b.free_ranges.insert(b.free_ranges.begin() + best_range + 1, tail);
+			}
+			else if (tail.size)
+			{
+				range = tail;
+			}
+			else
+			{
+				b.free_ranges.erase(b.free_ranges.begin() + best_range);
+			}
+
+			b.used += requirements.size;
+			++b.allocation_count;
+
+			out_allocation.memory = b.memory;
+			out_allocation.offset = offset;
+			out_allocation.size = requirements.size;
+			out_allocation.block = best_block;
+			out_allocation.heap_index = memory_properties.memoryTypes[memory_type].heapIndex;
+			return true;
+		}
+
+		void free_block(uint32_t id)
+		{
+			block& b{ blocks[id] };
+			free_memory(b.memory, b.size, memory_properties.memoryTypes[b.memory_type].heapIndex);
+			b = {};
+			free_block_ids.push_back(id);
+		}
+
+		// one empty block per memory type is kept so a resource churning at a block boundary doesn't allocate and free
+		// device memory every time, further empty blocks and evacuated ones go back to the driver
+		void release(uint32_t id, VkDeviceSize offset, VkDeviceSize size)
+		{
+			std::lock_guard lock{ block_mutex };
+			assert(id < blocks.size() && blocks[id].memory);
+			block& b{ blocks[id] };
+
+			b.used -= size;
+			if (--b.allocation_count == 0)
+			{
+				const bool spare_exists{ std::any_of(blocks.begin(), blocks.end(), [&b](const block& other) {
+					return &other != &b && other.memory && !other.allocation_count && other.memory_type == b.memory_type;
+				}) };
+				if (b.evacuating || spare_exists)
+				{
+					free_block(id);
+					return;
+				}
+
+				b.free_ranges.assign(1, { 0, b.size });
+				return;
+			}
+
+			auto it{ std::lower_bound(b.free_ranges.begin(), b.free_ranges.end(), offset,
+									  [](const free_range& range, VkDeviceSize value) { return range.offset < value; }) };
+			it = b.free_ranges.insert(it, { offset, size });
+
+			if (it + 1 != b.free_ranges.end() && it->offset + it->size == (it + 1)->offset)
+			{
+				it->size += (it + 1)->size;
+				b.free_ranges.erase(it + 1);
+			}
+			if (it != b.free_ranges.begin() && (it - 1)->offset + (it - 1)->size == it->offset)
+			{
+				(it - 1)->size += it->size;
+				b.free_ranges.erase(it);
+			}
+		}
+
+		bool allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool optimal, allocation& out_allocation)
+		{
+			const uint32_t memory_type{ find_memory_type(requirements.memoryTypeBits, properties) };
+			if (memory_type == UINT32_MAX)
+			{
+				std::cout << "failed to find a suitable memory type!\n";
+				return false;
+			}
+
+			// host visible memory stays dedicated so every resource maps and flushes its own allocation
+			const bool host_visible{ (memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0 };
+			if (!host_visible && requirements.size <= get_block_size(memory_type) / 2 &&
+				suballocate(requirements, memory_type, optimal, out_allocation))
+				return true;
+
+			out_allocation = {};
+			out_allocation.memory = allocate_memory(requirements.size, memory_type);
+			if (!out_allocation.memory)
+				return false;
+
+			out_allocation.size = requirements.size;
+			out_allocation.heap_index = memory_properties.memoryTypes[memory_type].heapIndex;
+			++dedicated_count;
+			dedicated_bytes += requirements.size;
+			return true;
+		}
+
+		void free(VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size, uint32_t block, uint32_t heap_index)
+		{
+			if (block != dedicated_block)
+			{
+				release(block, offset, size);
+				return;
+			}
+
+			free_memory(memory, size, heap_index);
+			--dedicated_count;
+			dedicated_bytes -= size;
+		}
+
+	} // anonymous namespace
+
+	bool init()
+	{
+		assert(core::get_physical_device());
+		vkGetPhysicalDeviceMemoryProperties(core::get_physical_device(), &memory_properties);
+		return memory_properties.memoryTypeCount > 0;
+	}
+
+	void shutdown()
+	{
+		{
+			std::lock_guard lock{ block_mutex };
+			for (uint32_t id{ 0 }; id < blocks.size(); ++id)
+			{
+				if (blocks[id].memory && !blocks[id].allocation_count)
+					free_block(id);
+			}
+			for (const block& b : blocks)
+			{
+				if (b.memory)
+					std::cout << "memory block still holds " << b.allocation_count << " allocations at shutdown!\n";
+			}
+			blocks.clear();
+			free_block_ids.clear();
+		}
+
+		for (uint32_t i{ 0 }; i < memory_properties.memoryHeapCount; ++i)
+		{
+			if (heap_usage[i])
+				std::cout << "memory heap " << i << " still has " << heap_usage[i] << " bytes allocated at shutdown!\n";
+			heap_usage[i] = 0;
+		}
+
+		memory_properties = {};
+	}
+
+	const VkPhysicalDeviceMemoryProperties& get_memory_properties()
+	{
+		return memory_properties;
+	}
+
+	uint32_t find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags properties)
+	{
+		for (uint32_t i{ 0 }; i < memory_properties.memoryTypeCount; ++i)
+		{
+			if ((type_filter & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+				return i;
+		}
+
+		return UINT32_MAX;
+	}
+
+	VkDeviceSize get_device_local_heap_size()
+	{
+		VkDeviceSize size{ 0 };
+		for (uint32_t i{ 0 }; i < memory_properties.memoryHeapCount; ++i)
+		{
+			if (memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+				size = std::max(size, memory_properties.memoryHeaps[i].size);
+		}
+		return size;
+	}
+
+	VkDeviceSize get_heap_usage(uint32_t heap_index)
+	{
+		assert(heap_index < VK_MAX_MEMORY_HEAPS);
+		return heap_usage[heap_index];
+	}
+
+	bool create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, buffer& out_buffer)
+	{
+		assert(!out_buffer.buffer);
+		VkDevice device{ core::get_logical_device() };
+
+		VkBufferCreateInfo buffer_info = vkh::buffer(size, VK_SHARING_MODE_EXCLUSIVE, usage);
+		VKCALL(vkCreateBuffer(device, &buffer_info, allocator::get_callbacks(allocator::object_type::memory), &out_buffer.buffer), "failed to create buffer");
+		if (!out_buffer.buffer)
+			return false;
+
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(device, out_buffer.buffer, &requirements);
+
+		allocation memory{};
+		if (!allocate(requirements, properties, false, memory))
+		{
+			std::cout << "failed to allocate buffer memory!\n";
+			destroy_buffer(out_buffer);
+			return false;
+		}
+
+		out_buffer.memory = memory.memory;
+		out_buffer.offset = memory.offset;
+		out_buffer.block = memory.block;
+		out_buffer.heap_index = memory.heap_index;
+		out_buffer.allocation_size = memory.size;
+		out_buffer.size = size;
+		vkBindBufferMemory(device, out_buffer.buffer, out_buffer.memory, out_buffer.offset);
+
+		if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+			VKCALL(vkMapMemory(device, out_buffer.memory, 0, size, 0, &out_buffer.mapped), "failed to map buffer memory");
+
+		return true;
+	}
+
+	void destroy_buffer(buffer& buffer)
+	{
+		VkDevice device{ core::get_logical_device() };
+
+		if (buffer.mapped)
+			vkUnmapMemory(device, buffer.memory);
+		if (buffer.buffer)
+			vkDestroyBuffer(device, buffer.buffer, allocator::get_callbacks(allocator::object_type::memory));
+		if (buffer.memory)
+			free(buffer.memory, buffer.offset, buffer.allocation_size, buffer.block, buffer.heap_index);
+
+		buffer = {};
+	}
+
+	bool create_image(const VkImageCreateInfo& info, VkMemoryPropertyFlags properties, image& out_image)
+	{
+		assert(!out_image.image);
+		VkDevice device{ core::get_logical_device() };
+
+		VKCALL(vkCreateImage(device, &info, allocator::get_callbacks(allocator::object_type::memory), &out_image.image), "failed to create image");
+		if (!out_image.image)
+			return false;
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(device, out_image.image, &requirements);
+
+		allocation memory{};
+		if (!allocate(requirements, properties, info.tiling == VK_IMAGE_TILING_OPTIMAL, memory))
+		{
+			std::cout << "failed to allocate image memory!\n";
+			destroy_image(out_image);
+			return false;
+		}
+
+		out_image.memory = memory.memory;
+		out_image.offset = memory.offset;
+		out_image.block = memory.block;
+		out_image.heap_index = memory.heap_index;
+		out_image.allocation_size = memory.size;
+		vkBindImageMemory(device, out_image.image, out_image.memory, out_image.offset);
+		return true;
+	}
+
+	void destroy_image(image& image)
+	{
+		if (image.image)
+			vkDestroyImage(core::get_logical_device(), image.image, allocator::get_callbacks(allocator::object_type::memory));
+		if (image.memory)
+			free(image.memory, image.offset, image.allocation_size, image.block, image.heap_index);
+
+		image = {};
+	}
+
+	void get_blocks(std::vector<block_info>& out_blocks)
+	{
+		out_blocks.clear();
+		std::lock_guard lock{ block_mutex };
+		for (uint32_t id{ 0 }; id < blocks.size(); ++id)
+		{
+			const block& b{ blocks[id] };
+			if (!b.memory)
+				continue;
+
+			block_info info{};
+			info.id = id;
+			info.memory_type = b.memory_type;
+			info.heap_index = memory_properties.memoryTypes[b.memory_type].heapIndex;
+			info.size = b.size;
+			info.used = b.used;
+			info.allocation_count = b.allocation_count;
+			info.optimal = b.optimal;
+			info.evacuating = b.evacuating;
+			for (const free_range& range : b.free_ranges)
+				info.largest_free_range = std::max(info.largest_free_range, range.size);
+			out_blocks.push_back(info);
+		}
+	}
+
+	void set_block_evacuating(uint32_t block, bool evacuating)
+	{
+		std::lock_guard lock{ block_mutex };
+		if (block < blocks.size() && blocks[block].memory)
+			blocks[block].evacuating = evacuating;
+	}
+
+	statistics get_statistics()
+	{
+		statistics result{};
+		{
+			std::lock_guard lock{ block_mutex };
+			for (const block& b : blocks)
+			{
+				if (!b.memory)
+					continue;
+				++result.block_count;
+				result.block_bytes += b.size;
+				result.block_used_bytes += b.used;
+			}
+		}
+		result.dedicated_count = dedicated_count;
+		result.dedicated_bytes = dedicated_bytes;
+		return result;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+namespace renderer::vulkan::memory
+{
+	// resources that are not host visible and at most half a block large share device memory blocks,
+	// everything else gets its own allocation
+	constexpr uint32_t dedicated_block{ UINT32_MAX };
+
+	struct buffer
+	{
+		VkBuffer		buffer{ VK_NULL_HANDLE };
+		VkDeviceMemory	memory{ VK_NULL_HANDLE };
+		VkDeviceSize	size{ 0 };
+		void*			mapped{ nullptr };	// persistently mapped when created host visible
+		VkDeviceSize	allocation_size{ 0 };
+		uint32_t		heap_index{ 0 };
+		VkDeviceSize	offset{ 0 };		// into memory
+		uint32_t		block{ dedicated_block };
+	};
+
+	struct image
+	{
+		VkImage			image{ VK_NULL_HANDLE };
+		VkDeviceMemory	memory{ VK_NULL_HANDLE };
+		VkDeviceSize	allocation_size{ 0 };
+		uint32_t		heap_index{ 0 };
+		VkDeviceSize	offset{ 0 };
+		uint32_t		block{ dedicated_block };
+	};
+
+	struct block_info
+	{
+		uint32_t		id{ dedicated_block };
+		uint32_t		memory_type{ 0 };
+		uint32_t		heap_index{ 0 };
+		VkDeviceSize	size{ 0 };
+		VkDeviceSize	used{ 0 };
+		VkDeviceSize	largest_free_range{ 0 };
+		uint32_t		allocation_count{ 0 };
+		bool			optimal{ false };		// holds optimally tiled images only, never shared with buffers
+		bool			evacuating{ false };
+	};
+
+	struct statistics
+	{
+		uint32_t		block_count{ 0 };
+		VkDeviceSize	block_bytes{ 0 };			// allocated from the driver for blocks
+		VkDeviceSize	block_used_bytes{ 0 };		// handed out of those blocks
+		uint32_t		dedicated_count{ 0 };
+		VkDeviceSize	dedicated_bytes{ 0 };
+	};
+
+	bool init();
+	void shutdown();
+
+	const VkPhysicalDeviceMemoryProperties& get_memory_properties();
+	// returns UINT32_MAX when no memory type matches
+	uint32_t find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags properties);
+
+	// size of the largest device local heap
+	VkDeviceSize get_device_local_heap_size();
+	// bytes currently allocated through this module in the given heap, safe to call from any thread
+	VkDeviceSize get_heap_usage(uint32_t heap_index);
+
+	// thread safe, may be called from streaming threads
+	bool create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, buffer& out_buffer);
+	void destroy_buffer(buffer& buffer);
+	bool create_image(const VkImageCreateInfo& info, VkMemoryPropertyFlags properties, image& out_image);
+	void destroy_image(image& image);
+
+	// for the defragmenter. block ids are reused once a block is freed, a reused block never starts out evacuating
+	void get_blocks(std::vector<block_info>& out_blocks);
+	// new allocations skip evacuating blocks, an evacuating block is freed back to the driver as soon as it holds nothing.
+	// other empty blocks are kept, one per memory type
+	void set_block_evacuating(uint32_t block, bool evacuating);
+
+	statistics get_statistics();
+}
@@ -0,0 +1,417 @@
+#include "VulkanMeshlets.h"
+#include "VulkanAllocator.h"
+#include "VulkanCore.h"
+#include "VulkanFrameAllocator.h"
+#include "VulkanHelpers.h"
+#include "VulkanMemory.h"
+#include "VulkanPipelines.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace renderer::vulkan::meshlets
+{
+	namespace
+	{
+		constexpr uint32_t meshlets_per_task_group{ 32 };	// local_size_x of meshlet.task
+		constexpr VkShaderStageFlags mesh_stages{ VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT };
+		constexpr VkPipelineStageFlags mesh_pipeline_stages{ VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT };
+
+		enum buffer_binding : uint32_t
+		{
+			mesh_binding,		// shared mesh buffer
+			view_binding,		// frame allocator buffer
+			binding_count,
+		};
+
+		// matches the view block of meshlet.task and meshlet.mesh, read from the frame allocator buffer
+		struct view_data
+		{
+			glm::mat4	view_projection;
+			glm::vec4	planes[6];
+			glm::vec4	camera_position;
+		};
+
+		// matches the push constant block of meshlet.task and meshlet.mesh
+		struct mesh_constants
+		{
+			glm::mat4	model;
+			uint32_t	view_base;				// in vec4s from the start of the frame allocator buffer
+			uint32_t	meshlet_count;
+			uint32_t	vertices_base;			// the rest in uints from the start of the mesh buffer
+			uint32_t	meshlets_base;
+			uint32_t	bounds_base;
+			uint32_t	meshlet_vertices_base;
+			uint32_t	triangles_base;
+			float		max_scale;				// largest axis scale of model, for the bounding spheres
+		};
+		static_assert(sizeof(mesh_constants) <= 128, "push constants beyond the guaranteed minimum");
+
+		// sections of one mesh in the shared mesh buffer, in uints
+		struct gpu_mesh
+		{
+			uint32_t	vertices_base;
+			uint32_t	meshlets_base;
+			uint32_t	bounds_base;
+			uint32_t	meshlet_vertices_base;
+			uint32_t	triangles_base;
+			uint32_t	meshlet_count;
+		};
+
+		settings												meshlet_settings{};
+
+		// one host visible index buffer per frame in flight, written by the cpu culler
+		std::array<memory::buffer, core::max_current_frames>	index_buffers{};
+		uint32_t												index_count{ 0 };
+		std::vector<uint32_t>									scratch_indices{};
+
+		geometry::culling::cluster_statistics					frame_statistics{};
+		geometry::culling::cluster_statistics					last_frame_statistics{};
+
+		// mesh shader path
+		PFN_vkCmdDrawMeshTasksEXT								cmd_draw_mesh_tasks{ nullptr };
+		memory::buffer											mesh_buffer{};
+		VkDeviceSize											mesh_bytes{ 0 };
+		std::vector<gpu_mesh>									meshes{};
+		uint32_t												view_base{ UINT32_MAX };
+		VkBuffer												bound_frame_buffer{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout									set_layout{ VK_NULL_HANDLE };
+		VkDescriptorPool										descriptor_pool{ VK_NULL_HANDLE };
+		VkDescriptorSet											descriptor_set{ VK_NULL_HANDLE };
+		VkPipelineLayout										pipeline_layout{ VK_NULL_HANDLE };
+		VkPipeline												pipeline{ VK_NULL_HANDLE };
+
+		void memory_barrier(VkCommandBuffer command_buffer, VkPipelineStageFlags src_stages, VkAccessFlags src_access,
+							VkPipelineStageFlags dst_stages, VkAccessFlags dst_access)
+		{
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = src_access;
+			barrier.dstAccessMask = dst_access;
+			vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		// the view is read where the frame allocator put it, its offset goes in the push constants
+		void bind_frame_buffer()
+		{
+			VkBuffer frame_buffer{ frame_allocator::get_buffer() };
+			if (frame_buffer == bound_frame_buffer)
+				return;
+
+			VkDescriptorBufferInfo info{ frame_buffer, 0, VK_WHOLE_SIZE };
+			VkWriteDescriptorSet write = vkh::write_descriptor_set(descriptor_set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, view_binding, &info);
+			vkUpdateDescriptorSets(core::get_logical_device(), 1, &write, 0, nullptr);
+			bound_frame_buffer = frame_buffer;
+		}
+
+		bool create_descriptors()
+		{
+			VkDevice device{ core::get_logical_device() };
+
+			std::array<VkDescriptorSetLayoutBinding, binding_count> bindings{};
+			for (uint32_t i{ 0 }; i < binding_count; ++i)
+				bindings[i] = vkh::descriptor_set_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, mesh_stages, i);
+			VkDescriptorSetLayoutCreateInfo set_layout_info = vkh::descriptor_set_layout(binding_count, bindings.data());
+			VKCALL(vkCreateDescriptorSetLayout(device, &set_layout_info, allocator::get_callbacks(allocator::object_type::descriptor), &set_layout),
+				   "failed to create meshlet descriptor set layout");
+
+			VkDescriptorPoolSize pool_size{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, binding_count };
+			VkDescriptorPoolCreateInfo pool_info = vkh::descriptor_pool(1, &pool_size, 1);
+			VKCALL(vkCreateDescriptorPool(device, &pool_info, allocator::get_callbacks(allocator::object_type::descriptor), &descriptor_pool),
+				   "failed to create meshlet descriptor pool");
+			if (!set_layout || !descriptor_pool)
+				return false;
+
+			VkDescriptorSetAllocateInfo alloc_info = vkh::descriptor_set_alloc_info(descriptor_pool, &set_layout, 1);
+			VKCALL(vkAllocateDescriptorSets(device, &alloc_info, &descriptor_set), "failed to allocate meshlet descriptor set");
+			return descriptor_set != VK_NULL_HANDLE;
+		}
+
+		bool create_pipeline()
+		{
+			const VkPushConstantRange push_constant_range{ vkh::push_constant_range(mesh_stages, sizeof(mesh_constants)) };
+			VkPipelineLayoutCreateInfo layout_info = vkh::pipeline_layout(1, &set_layout, 1, &push_constant_range);
+			VKCALL(vkCreatePipelineLayout(core::get_logical_device(), &layout_info, allocator::get_callbacks(allocator::object_type::pipeline), &pipeline_layout),
+				   "failed to create meshlet pipeline layout");
+			if (!pipeline_layout)
+				return false;
+
+			std::vector<VkShaderModule> modules{};
+			const bool loaded{ pipelines::load_shader_modules({ meshlet_settings.shader_directory + "meshlet.task.spv",
+																meshlet_settings.shader_directory + "meshlet.mesh.spv",
+																meshlet_settings.shader_directory + "meshlet.frag.spv" }, modules) };
+			if (loaded)
+			{
+				const VkPipelineShaderStageCreateInfo stages[]{
+					vkh::pipeline_shader_stage(modules[0], VK_SHADER_STAGE_TASK_BIT_EXT, "main"),
+					vkh::pipeline_shader_stage(modules[1], VK_SHADER_STAGE_MESH_BIT_EXT, "main"),
+					vkh::pipeline_shader_stage(modules[2], VK_SHADER_STAGE_FRAGMENT_BIT, "main")
+				};
+
+				// mesh pipelines have no vertex input and input assembly state
+				VkPipelineViewportStateCreateInfo viewport_state = vkh::viewport_state_dynamic();
+				VkPipelineRasterizationStateCreateInfo rasterization = vkh::pipeline_rasterization_state(VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+				VkPipelineMultisampleStateCreateInfo multisample = vkh::pipeline_multisample_state();
+				VkPipelineDepthStencilStateCreateInfo depth_stencil = vkh::pipeline_depth_stencil_state(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS);
+
+				VkPipelineColorBlendAttachmentState blend_attachment = vkh::pipeline_color_blend_attachment_state(
+					VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT, VK_FALSE);
+				VkPipelineColorBlendStateCreateInfo color_blend = vkh::pipeline_color_blend_state(1, &blend_attachment);
+
+				const std::vector<VkDynamicState> dynamic_states{ VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+				VkPipelineDynamicStateCreateInfo dynamic_state = vkh::pipeline_dynamic_state(dynamic_states);
+
+				VkGraphicsPipelineCreateInfo info{};
+				info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+				info.stageCount = 3;
+				info.pStages = stages;
+				info.pViewportState = &viewport_state;
+				info.pRasterizationState = &rasterization;
+				info.pMultisampleState = &multisample;
+				info.pDepthStencilState = &depth_stencil;
+				info.pColorBlendState = &color_blend;
+				info.pDynamicState = &dynamic_state;
+				info.layout = pipeline_layout;
+				info.renderPass = meshlet_settings.render_pass;
+				info.subpass = meshlet_settings.subpass;
+
+				std::vector<VkPipeline> created{};
+				pipelines::create_graphics_pipelines({ info }, created);
+				pipeline = created[0];
+			}
+
+			for (VkShaderModule& module : modules)
+				pipelines::destroy_shader_module(module);
+			return pipeline != VK_NULL_HANDLE;
+		}
+
+		void destroy_mesh_shader_path()
+		{
+			VkDevice device{ core::get_logical_device() };
+			pipelines::destroy_pipeline(pipeline);
+			if (pipeline_layout)
+				vkDestroyPipelineLayout(device, pipeline_layout, allocator::get_callbacks(allocator::object_type::pipeline));
+			if (descriptor_pool)
+				vkDestroyDescriptorPool(device, descriptor_pool, allocator::get_callbacks(allocator::object_type::descriptor));
+			if (set_layout)
+				vkDestroyDescriptorSetLayout(device, set_layout, allocator::get_callbacks(allocator::object_type::descriptor));
+			memory::destroy_buffer(mesh_buffer);
+
+			pipeline_layout = VK_NULL_HANDLE;
+			descriptor_pool = VK_NULL_HANDLE;
+			descriptor_set = VK_NULL_HANDLE;
+			set_layout = VK_NULL_HANDLE;
+			bound_frame_buffer = VK_NULL_HANDLE;
+			cmd_draw_mesh_tasks = nullptr;
+			meshes.clear();
+			mesh_bytes = 0;
+		}
+
+		// the mesh shader path is optional, any failure leaves the cpu path running
+		bool init_mesh_shader_path()
+		{
+			if (!core::is_mesh_shader_supported() || !meshlet_settings.render_pass)
+				return false;
+
+			// sections are addressed in uints from the shaders
+			assert(meshlet_settings.max_mesh_bytes <= (VkDeviceSize)UINT32_MAX * sizeof(uint32_t));
+			cmd_draw_mesh_tasks = (PFN_vkCmdDrawMeshTasksEXT)vkGetDeviceProcAddr(core::get_logical_device(), "vkCmdDrawMeshTasksEXT");
+			if (!cmd_draw_mesh_tasks || !create_descriptors() || !create_pipeline() ||
+				!memory::create_buffer(meshlet_settings.max_mesh_bytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+									   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh_buffer))
+				return false;
+
+			VkDescriptorBufferInfo info{ mesh_buffer.buffer, 0, VK_WHOLE_SIZE };
+			VkWriteDescriptorSet write = vkh::write_descriptor_set(descriptor_set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, mesh_binding, &info);
+			vkUpdateDescriptorSets(core::get_logical_device(), 1, &write, 0, nullptr);
+			bind_frame_buffer();
+			return true;
+		}
+
+	} // anonymous namespace
+
+	bool init(const settings& settings)
+	{
+		meshlet_settings = settings;
+		for (auto& index_buffer : index_buffers)
+		{
+			if (!memory::create_buffer((VkDeviceSize)settings.max_indices_per_frame * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+									   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, index_buffer))
+				return false;
+		}
+
+		if (core::is_mesh_shader_supported() && !init_mesh_shader_path())
+		{
+			if (settings.render_pass)
+				std::cout << "meshlets: mesh shaders unavailable, culling stays on the cpu\n";
+			destroy_mesh_shader_path();
+		}
+
+		return true;
+	}
+
+	void shutdown()
+	{
+		for (auto& index_buffer : index_buffers)
+			memory::destroy_buffer(index_buffer);
+
+		destroy_mesh_shader_path();
+		meshlet_settings = {};
+		view_base = UINT32_MAX;
+	}
+
+	void begin_frame()
+	{
+		last_frame_statistics = frame_statistics;
+		frame_statistics = {};
+		index_count = 0;
+		view_base = UINT32_MAX;
+	}
+
+	bool draw(VkCommandBuffer command_buffer, const geometry::meshlet_data& data, const glm::mat4& model,
+			  const geometry::culling::frustum& frustum, const glm::vec3& camera_position)
+	{
+		scratch_indices.clear();
+		geometry::culling::cull_meshlets(data, model, frustum, camera_position, scratch_indices, frame_statistics);
+		if (scratch_indices.empty())
+			return true;
+
+		if (index_count + scratch_indices.size() > meshlet_settings.max_indices_per_frame)
+		{
+			std::cout << "meshlet index buffer overflow, increase max_indices_per_frame!\n";
+			return false;
+		}
+
+		// the frame fence guarantees the gpu finished reading this region
+		memory::buffer& index_buffer{ index_buffers[core::get_current_command_buffer_index()] };
+		uint32_t* destination{ static_cast<uint32_t*>(index_buffer.mapped) + index_count };
+		memcpy(destination, scratch_indices.data(), scratch_indices.size() * sizeof(uint32_t));
+
+		vkCmdBindIndexBuffer(command_buffer, index_buffer.buffer, (VkDeviceSize)index_count * sizeof(uint32_t), VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(command_buffer, (uint32_t)scratch_indices.size(), 1, 0, 0, 0);
+
+		index_count += (uint32_t)scratch_indices.size();
+		return true;
+	}
+
+	bool is_mesh_shader_path_available()
+	{
+		return pipeline != VK_NULL_HANDLE;
+	}
+
+	uint32_t add_mesh(const geometry::mesh& m, const geometry::meshlet_data& data)
+	{
+		if (!pipeline || data.meshlets.empty())
+			return invalid_mesh;
+		assert(data.bounds.size() == data.meshlets.size());
+
+		// every section starts on a uint, the triangle bytes are padded to one
+		const VkDeviceSize vertices_size{ m.vertices.size() * sizeof(geometry::vertex) };
+		const VkDeviceSize meshlets_size{ data.meshlets.size() * sizeof(geometry::meshlet) };
+		const VkDeviceSize bounds_size{ data.bounds.size() * sizeof(geometry::meshlet_bounds) };
+		const VkDeviceSize meshlet_vertices_size{ data.vertices.size() * sizeof(uint32_t) };
+		const VkDeviceSize triangles_size{ (data.triangles.size() + 3) & ~VkDeviceSize{ 3 } };
+		const VkDeviceSize size{ vertices_size + meshlets_size + bounds_size + meshlet_vertices_size + triangles_size };
+		if (size > meshlet_settings.max_mesh_bytes - mesh_bytes)
+		{
+			std::cout << "meshlets: " << size << " bytes of mesh data exceed max_mesh_bytes!\n";
+			return invalid_mesh;
+		}
+
+		memory::buffer staging{};
+		if (!memory::create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging))
+			return invalid_mesh;
+
+		uint8_t* destination{ static_cast<uint8_t*>(staging.mapped) };
+		memset(destination, 0, size);
+		gpu_mesh mesh{};
+		mesh.meshlet_count = (uint32_t)data.meshlets.size();
+		VkDeviceSize offset{ 0 };
+		auto write_section = [&](const void* source, VkDeviceSize section_size, uint32_t& out_base) {
+			out_base = (uint32_t)((mesh_bytes + offset) / sizeof(uint32_t));
+			if (section_size)
+				memcpy(destination + offset, source, section_size);
+			offset += section_size;
+		};
+		write_section(m.vertices.data(), vertices_size, mesh.vertices_base);
+		write_section(data.meshlets.data(), meshlets_size, mesh.meshlets_base);
+		write_section(data.bounds.data(), bounds_size, mesh.bounds_base);
+		write_section(data.vertices.data(), meshlet_vertices_size, mesh.meshlet_vertices_base);
+		write_section(data.triangles.data(), data.triangles.size(), mesh.triangles_base);
+
+		VkCommandBuffer command_buffer{ core::begin_single_time_commands() };
+		const VkBufferCopy region{ 0, mesh_bytes, size };
+		vkCmdCopyBuffer(command_buffer, staging.buffer, mesh_buffer.buffer, 1, &region);
+		memory_barrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, mesh_pipeline_stages, VK_ACCESS_SHADER_READ_BIT);
+		core::end_single_time_commands(command_buffer);
+		memory::destroy_buffer(staging);
+
+		mesh_bytes += size;
+		meshes.push_back(mesh);
+		return (uint32_t)meshes.size() - 1;
+	}
+
+	bool set_view(const glm::mat4& view_projection, const glm::vec3& camera_position)
+	{
+		if (!pipeline)
+			return false;
+
+		const geometry::culling::frustum frustum{ geometry::culling::extract_frustum(view_projection) };
+		view_data view{};
+		view.view_projection = view_projection;
+		for (uint32_t i{ 0 }; i < 6; ++i)
+			view.planes[i] = frustum.planes[i];
+		view.camera_position = glm::vec4{ camera_position, 1.f };
+
+		const frame_allocator::allocation allocation{ frame_allocator::push(view, 16) };
+		if (!allocation.is_valid())
+		{
+			std::cout << "meshlets: frame allocator exhausted, view dropped!\n";
+			return false;
+		}
+
+		view_base = (uint32_t)(allocation.offset / 16);
+		return true;
+	}
+
+	bool draw_mesh_tasks(VkCommandBuffer command_buffer, uint32_t mesh, const glm::mat4& model)
+	{
+		assert(mesh < meshes.size() && view_base != UINT32_MAX && "set_view has to come first in the frame");
+		if (!pipeline || mesh >= meshes.size() || view_base == UINT32_MAX)
+			return false;
+
+		const gpu_mesh& m{ meshes[mesh] };
+		auto axis_length = [&model](uint32_t column) {
+			return std::sqrt(model[column].x * model[column].x + model[column].y * model[column].y + model[column].z * model[column].z);
+		};
+
+		mesh_constants constants{};
+		constants.model = model;
+		constants.view_base = view_base;
+		constants.meshlet_count = m.meshlet_count;
+		constants.vertices_base = m.vertices_base;
+		constants.meshlets_base = m.meshlets_base;
+		constants.bounds_base = m.bounds_base;
+		constants.meshlet_vertices_base = m.meshlet_vertices_base;
+		constants.triangles_base = m.triangles_base;
+		constants.max_scale = std::max({ axis_length(0), axis_length(1), axis_length(2) });
+
+		bind_frame_buffer();
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+		vkCmdPushConstants(command_buffer, pipeline_layout, mesh_stages, 0, sizeof(mesh_constants), &constants);
+		cmd_draw_mesh_tasks(command_buffer, vkh::dispatch_size(m.meshlet_count, meshlets_per_task_group), 1, 1);
+		return true;
+	}
+
+	const geometry::culling::cluster_statistics& get_frame_statistics()
+	{
+		return frame_statistics;
+	}
+
+	const geometry::culling::cluster_statistics& get_last_frame_statistics()
+	{
+		return last_frame_statistics;
+	}
+}
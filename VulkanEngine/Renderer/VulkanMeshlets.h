@@ -0,0 +1,49 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+#include "../Geometry/ClusterCuller.h"
+
+namespace renderer::vulkan::meshlets
+{
+	constexpr uint32_t invalid_mesh{ UINT32_MAX };
+
+	struct settings
+	{
+		uint32_t		max_indices_per_frame{ 1 << 22 };	// cpu culled index data of all meshlet draws of one frame
+		// vertices and meshlet data of every mesh added for the mesh shader path, only allocated when that path is available
+		VkDeviceSize	max_mesh_bytes{ 64ull << 20 };
+		// the mesh shader pipeline is only created when a render pass is given and the device supports VK_EXT_mesh_shader
+		VkRenderPass	render_pass{ VK_NULL_HANDLE };
+		uint32_t		subpass{ 0 };
+		// spir-v of Shaders/meshlet.task, meshlet.mesh and meshlet.frag
+		std::string		shader_directory{ "Shaders/" };
+	};
+
+	bool init(const settings& settings = {});
+	void shutdown();
+
+	// resets the index ring region and the statistics of the current frame, call after core::begin_frame
+	void begin_frame();
+
+	// cpu reference path (vulkan 1.0): culls the instance and records one indexed draw of the surviving clusters.
+	// the caller binds the pipeline and the mesh vertex buffer.
+	bool draw(VkCommandBuffer command_buffer, const geometry::meshlet_data& data, const glm::mat4& model,
+			  const geometry::culling::frustum& frustum, const glm::vec3& camera_position);
+
+	// true when the device has VK_EXT_mesh_shader and the task, mesh and fragment shaders built into a pipeline
+	bool is_mesh_shader_path_available();
+
+	// copies the vertices and meshlet data of m into the shared mesh buffer the task and mesh shaders read, and waits
+	// for the copy. invalid_mesh without the mesh shader path or when the buffer is full
+	uint32_t add_mesh(const geometry::mesh& m, const geometry::meshlet_data& data);
+
+	// camera of the following draw_mesh_tasks calls, written to frame allocator memory. once per frame and view
+	bool set_view(const glm::mat4& view_projection, const glm::vec3& camera_position);
+
+	// VK_EXT_mesh_shader path, inside settings.render_pass: one task workgroup per 32 meshlets of the mesh. the task shader
+	// runs the frustum and cone tests of the cpu path and launches mesh workgroups for the survivors only. the pipeline
+	// and its descriptor sets are bound here. the statistics only count the cpu path, culling stays on the gpu
+	bool draw_mesh_tasks(VkCommandBuffer command_buffer, uint32_t mesh, const glm::mat4& model);
+
+	const geometry::culling::cluster_statistics& get_frame_statistics();
+	const geometry::culling::cluster_statistics& get_last_frame_statistics();
+}
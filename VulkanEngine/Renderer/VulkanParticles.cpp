@@ -0,0 +1,504 @@
+#include "VulkanParticles.h"
+#include "VulkanAllocator.h"
+#include "VulkanCore.h"
+#include "VulkanHelpers.h"
+#include "VulkanMemory.h"
+#include "VulkanPipelines.h"
+
+#include <cstring>
+
+namespace renderer::vulkan::particles
+{
+	namespace
+	{
+		constexpr uint32_t binding_count{ 6 };
+		constexpr uint32_t sort_block{ 1024 };		// keys per group of particle_sort.comp
+
+		// byte offsets into the counter buffer
+		constexpr VkDeviceSize dispatch_offset{ 16 };
+		constexpr VkDeviceSize draw_offset{ 32 };
+		constexpr VkDeviceSize sort_dispatch_offset{ 48 };
+
+		// matches the counter block of the compute shaders
+		struct counters
+		{
+			uint32_t	alive_count[2];
+			uint32_t	dead_count;
+			uint32_t	emit_count;
+			uint32_t	dispatch[4];
+			uint32_t	draw[4];
+			uint32_t	sort_dispatch[4];
+		};
+		static_assert(sizeof(counters) == 64);
+
+		// matches the push constant block of the compute shaders
+		struct compute_constants
+		{
+			glm::vec4	view_depth;			// third row of the view matrix
+			glm::vec4	gravity;			// xyz gravity, w delta time
+			glm::vec4	emitter_position;	// xyz position, w radius
+			glm::vec4	emitter_velocity;	// xyz velocity, w spread
+			float		simulation[4];		// min lifetime, max lifetime, drag, unused
+			uint32_t	counts[4];			// requested emit count, capacity, current alive list, seed
+			uint32_t	stage[4];			// args stage or sort mode, k, j, unused
+		};
+		static_assert(sizeof(compute_constants) <= 128, "push constants beyond the guaranteed minimum");
+
+		// matches particle.vert and particle.frag
+		struct draw_constants
+		{
+			glm::mat4	view_projection;
+			glm::vec4	right;				// xyz camera right, w half size
+			glm::vec4	up;
+			glm::vec4	color;
+		};
+		static_assert(sizeof(draw_constants) <= 128, "push constants beyond the guaranteed minimum");
+
+		enum buffer_binding : uint32_t
+		{
+			particles_binding,
+			alive_binding,
+			dead_binding,
+			counter_binding,
+			keys_binding,
+			order_binding,
+		};
+
+		enum compute_pass : uint32_t
+		{
+			args_pass,
+			emit_pass,
+			simulate_pass,
+			compact_pass,
+			sort_pass,
+			compute_pass_count,
+		};
+
+		enum sort_mode : uint32_t
+		{
+			sort_local,
+			sort_global_step,
+			sort_local_merge,
+		};
+
+		constexpr const char* compute_shaders[compute_pass_count]{
+			"particle_args.comp.spv", "particle_emit.comp.spv", "particle_simulate.comp.spv", "particle_compact.comp.spv", "particle_sort.comp.spv"
+		};
+
+		settings									particle_settings{};
+		statistics									frame_statistics{};
+		uint32_t									sort_capacity{ 0 };
+		uint32_t									current_list{ 0 };
+		uint32_t									seed{ 0 };
+
+		std::array<memory::buffer, binding_count>	buffers{};
+		VkDescriptorSetLayout						set_layout{ VK_NULL_HANDLE };
+		VkDescriptorPool							descriptor_pool{ VK_NULL_HANDLE };
+		VkDescriptorSet								descriptor_set{ VK_NULL_HANDLE };
+		VkPipelineLayout							compute_layout{ VK_NULL_HANDLE };
+		VkPipelineLayout							draw_layout{ VK_NULL_HANDLE };
+		std::vector<VkPipeline>						compute_pipelines{};
+		VkPipeline									draw_pipeline{ VK_NULL_HANDLE };
+
+		bool create_storage_buffer(VkDeviceSize size, VkBufferUsageFlags extra_usage, memory::buffer& out_buffer)
+		{
+			frame_statistics.memory_bytes += size;
+			return memory::create_buffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | extra_usage,
+										 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, out_buffer);
+		}
+
+		void memory_barrier(VkCommandBuffer command_buffer, VkPipelineStageFlags src_stages, VkAccessFlags src_access,
+							VkPipelineStageFlags dst_stages, VkAccessFlags dst_access)
+		{
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = src_access;
+			barrier.dstAccessMask = dst_access;
+			vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		// every pass reads what the previous one wrote, counters included, some of them as indirect arguments
+		void compute_barrier(VkCommandBuffer command_buffer)
+		{
+			memory_barrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+						   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+						   VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+		}
+
+		void push(VkCommandBuffer command_buffer, compute_pass pass, compute_constants& constants, uint32_t stage, uint32_t k = 0, uint32_t j = 0)
+		{
+			constants.stage[0] = stage;
+			constants.stage[1] = k;
+			constants.stage[2] = j;
+			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipelines[pass]);
+			vkCmdPushConstants(command_buffer, compute_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(compute_constants), &constants);
+		}
+
+		void dispatch_args(VkCommandBuffer command_buffer, compute_constants& constants, uint32_t stage)
+		{
+			push(command_buffer, args_pass, constants, stage);
+			vkCmdDispatch(command_buffer, 1, 1, 1);
+			compute_barrier(command_buffer);
+			++frame_statistics.dispatches;
+		}
+
+		void dispatch_indirect(VkCommandBuffer command_buffer, compute_pass pass, compute_constants& constants, VkDeviceSize offset,
+							   uint32_t stage = 0, uint32_t k = 0, uint32_t j = 0)
+		{
+			push(command_buffer, pass, constants, stage, k, j);
+			vkCmdDispatchIndirect(command_buffer, buffers[counter_binding].buffer, offset);
+			compute_barrier(command_buffer);
+			++frame_statistics.dispatches;
+		}
+
+		// the whole sort key range is swept, the dispatches only cover the next power of two of the live count
+		void sort(VkCommandBuffer command_buffer, compute_constants& constants)
+		{
+			dispatch_indirect(command_buffer, sort_pass, constants, sort_dispatch_offset, sort_local);
+			for (uint32_t k{ sort_block * 2 }; k <= sort_capacity; k <<= 1)
+			{
+				for (uint32_t j{ k >> 1 }; j >= sort_block; j >>= 1)
+					dispatch_indirect(command_buffer, sort_pass, constants, sort_dispatch_offset, sort_global_step, k, j);
+				dispatch_indirect(command_buffer, sort_pass, constants, sort_dispatch_offset, sort_local_merge, k);
+			}
+		}
+
+		// every slot starts on the dead list, nothing is alive
+		bool upload_initial_state()
+		{
+			const uint32_t capacity{ particle_settings.capacity };
+			const VkDeviceSize dead_size{ (VkDeviceSize)capacity * sizeof(uint32_t) };
+			memory::buffer staging{};
+			if (!memory::create_buffer(dead_size + sizeof(counters), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+									   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging))
+				return false;
+
+			uint32_t* dead{ static_cast<uint32_t*>(staging.mapped) };
+			for (uint32_t i{ 0 }; i < capacity; ++i)
+				dead[i] = capacity - 1 - i;		// popped from the top, so the low slots are used first
+
+			counters initial{};
+			initial.dead_count = capacity;
+			initial.dispatch[1] = initial.dispatch[2] = 1;
+			initial.draw[0] = 6;
+			initial.sort_dispatch[0] = initial.sort_dispatch[1] = initial.sort_dispatch[2] = 1;
+			memcpy(static_cast<uint8_t*>(staging.mapped) + dead_size, &initial, sizeof(counters));
+
+			VkCommandBuffer command_buffer{ core::begin_single_time_commands() };
+			const VkBufferCopy dead_region{ 0, 0, dead_size };
+			const VkBufferCopy counter_region{ dead_size, 0, sizeof(counters) };
+			vkCmdCopyBuffer(command_buffer, staging.buffer, buffers[dead_binding].buffer, 1, &dead_region);
+			vkCmdCopyBuffer(command_buffer, staging.buffer, buffers[counter_binding].buffer, 1, &counter_region);
+			vkCmdFillBuffer(command_buffer, buffers[keys_binding].buffer, 0, VK_WHOLE_SIZE, 0xffffffffu);
+			memory_barrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+						   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+						   VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+			core::end_single_time_commands(command_buffer);
+
+			memory::destroy_buffer(staging);
+			return true;
+		}
+
+		bool create_compute_pipelines()
+		{
+			const VkPushConstantRange push_constant_range{ vkh::push_constant_range(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(compute_constants)) };
+			VkPipelineLayoutCreateInfo layout_info = vkh::pipeline_layout(1, &set_layout, 1, &push_constant_range);
+			VKCALL(vkCreatePipelineLayout(core::get_logical_device(), &layout_info, allocator::get_callbacks(allocator::object_type::pipeline), &compute_layout),
+				   "failed to create particle compute pipeline layout");
+			if (!compute_layout)
+				return false;
+
+			std::vector<std::string> paths{};
+			for (const char* shader : compute_shaders)
+				paths.push_back(particle_settings.shader_directory + shader);
+
+			// all or nothing, a partial set of passes can't run a frame
+			if (!pipelines::create_compute_pipelines(paths, compute_layout, compute_pipelines))
+			{
+				for (VkPipeline& pipeline : compute_pipelines)
+					pipelines::destroy_pipeline(pipeline);
+				compute_pipelines.clear();
+				return false;
+			}
+			return true;
+		}
+
+		bool create_draw_pipeline()
+		{
+			const VkPushConstantRange push_constant_range{ vkh::push_constant_range(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(draw_constants)) };
+			VkPipelineLayoutCreateInfo layout_info = vkh::pipeline_layout(1, &set_layout, 1, &push_constant_range);
+			VKCALL(vkCreatePipelineLayout(core::get_logical_device(), &layout_info, allocator::get_callbacks(allocator::object_type::pipeline), &draw_layout),
+				   "failed to create particle draw pipeline layout");
+			if (!draw_layout)
+				return false;
+
+			std::vector<VkShaderModule> modules{};
+			const bool loaded{ pipelines::load_shader_modules({ particle_settings.shader_directory + "particle.vert.spv",
+																particle_settings.shader_directory + "particle.frag.spv" }, modules) };
+			if (loaded)
+			{
+				const VkPipelineShaderStageCreateInfo stages[]{
+					vkh::pipeline_shader_stage(modules[0], VK_SHADER_STAGE_VERTEX_BIT, "main"),
+					vkh::pipeline_shader_stage(modules[1], VK_SHADER_STAGE_FRAGMENT_BIT, "main")
+				};
+
+				// quads are expanded from gl_VertexIndex, no vertex input
+				VkPipelineVertexInputStateCreateInfo vertex_input{};
+				vertex_input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+				VkPipelineInputAssemblyStateCreateInfo input_assembly = vkh::pipeline_input_assembly_state(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+				VkPipelineViewportStateCreateInfo viewport_state = vkh::viewport_state_dynamic();
+				VkPipelineRasterizationStateCreateInfo rasterization = vkh::pipeline_rasterization_state(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+				VkPipelineMultisampleStateCreateInfo multisample = vkh::pipeline_multisample_state();
+				VkPipelineDepthStencilStateCreateInfo depth_stencil = vkh::pipeline_depth_stencil_state(VK_TRUE, VK_FALSE, particle_settings.depth_compare_op);
+
+				VkPipelineColorBlendAttachmentState blend_attachment = vkh::pipeline_color_blend_attachment_state(
+					VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT, VK_TRUE);
+				blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+				blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+				blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+				VkPipelineColorBlendStateCreateInfo color_blend = vkh::pipeline_color_blend_state(1, &blend_attachment);
+
+				const std::vector<VkDynamicState> dynamic_states{ VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+				VkPipelineDynamicStateCreateInfo dynamic_state = vkh::pipeline_dynamic_state(dynamic_states);
+
+				VkGraphicsPipelineCreateInfo info{};
+				info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+				info.stageCount = 2;
+				info.pStages = stages;
+				info.pVertexInputState = &vertex_input;
+				info.pInputAssemblyState = &input_assembly;
+				info.pViewportState = &viewport_state;
+				info.pRasterizationState = &rasterization;
+				info.pMultisampleState = &multisample;
+				info.pDepthStencilState = &depth_stencil;
+				info.pColorBlendState = &color_blend;
+				info.pDynamicState = &dynamic_state;
+				info.layout = draw_layout;
+				info.renderPass = particle_settings.render_pass;
+				info.subpass = particle_settings.subpass;
+
+				std::vector<VkPipeline> created{};
+				pipelines::create_graphics_pipelines({ info }, created);
+				draw_pipeline = created[0];
+			}
+
+			for (VkShaderModule& module : modules)
+				pipelines::destroy_shader_module(module);
+			return draw_pipeline != VK_NULL_HANDLE;
+		}
+
+	} // anonymous namespace
+
+	bool init(const settings& settings)
+	{
+		assert(settings.capacity);
+		particle_settings = settings;
+		frame_statistics = {};
+		frame_statistics.capacity = settings.capacity;
+		current_list = 0;
+		seed = 0;
+		VkDevice device{ core::get_logical_device() };
+
+		// the sort runs over whole blocks and powers of two, the padding keeps the cleared maximum key
+		sort_capacity = sort_block;
+		while (sort_capacity < settings.capacity)
+			sort_capacity <<= 1;
+
+		std::array<VkDescriptorSetLayoutBinding, binding_count> bindings{};
+		for (uint32_t i{ 0 }; i < binding_count; ++i)
+			bindings[i] = vkh::descriptor_set_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, i);
+		VkDescriptorSetLayoutCreateInfo set_layout_info = vkh::descriptor_set_layout(binding_count, bindings.data());
+		VKCALL(vkCreateDescriptorSetLayout(device, &set_layout_info, allocator::get_callbacks(allocator::object_type::descriptor), &set_layout),
+			   "failed to create particle descriptor set layout");
+
+		VkDescriptorPoolSize pool_size{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, binding_count };
+		VkDescriptorPoolCreateInfo pool_info = vkh::descriptor_pool(1, &pool_size, 1);
+		VKCALL(vkCreateDescriptorPool(device, &pool_info, allocator::get_callbacks(allocator::object_type::descriptor), &descriptor_pool),
+			   "failed to create particle descriptor pool");
+
+		VkDescriptorSetAllocateInfo alloc_info = vkh::descriptor_set_alloc_info(descriptor_pool, &set_layout, 1);
+		VKCALL(vkAllocateDescriptorSets(device, &alloc_info, &descriptor_set), "failed to allocate particle descriptor set");
+		if (!set_layout || !descriptor_pool || !descriptor_set)
+			return false;
+
+		// without the compute passes there is nothing to draw, the buffers are not worth their memory
+		if (!create_compute_pipelines())
+		{
+			std::cout << "particles: compute shaders unavailable, gpu particles disabled\n";
+			return true;
+		}
+
+		const VkDeviceSize capacity{ settings.capacity };
+		if (!create_storage_buffer(capacity * sizeof(geometry::particles::particle), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, buffers[particles_binding]) ||
+			!create_storage_buffer(capacity * 2 * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, buffers[alive_binding]) ||
+			!create_storage_buffer(capacity * sizeof(uint32_t), 0, buffers[dead_binding]) ||
+			!create_storage_buffer(sizeof(counters), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, buffers[counter_binding]) ||
+			!create_storage_buffer((VkDeviceSize)sort_capacity * sizeof(uint32_t), 0, buffers[keys_binding]) ||
+			!create_storage_buffer((VkDeviceSize)sort_capacity * sizeof(uint32_t), 0, buffers[order_binding]))
+			return false;
+
+		std::array<VkDescriptorBufferInfo, binding_count> infos{};
+		std::array<VkWriteDescriptorSet, binding_count> writes{};
+		for (uint32_t i{ 0 }; i < binding_count; ++i)
+		{
+			infos[i] = { buffers[i].buffer, 0, VK_WHOLE_SIZE };
+			writes[i] = vkh::write_descriptor_set(descriptor_set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, i, &infos[i]);
+		}
+		vkUpdateDescriptorSets(device, binding_count, writes.data(), 0, nullptr);
+
+		if (!upload_initial_state())
+			return false;
+		frame_statistics.gpu_simulation = true;
+
+		if (settings.render_pass)
+		{
+			if (create_draw_pipeline())
+				frame_statistics.gpu_drawing = true;
+			else
+				std::cout << "particles: draw shaders unavailable, particles are simulated but not drawn\n";
+		}
+
+		return true;
+	}
+
+	void shutdown()
+	{
+		VkDevice device{ core::get_logical_device() };
+		for (VkPipeline& pipeline : compute_pipelines)
+			pipelines::destroy_pipeline(pipeline);
+		compute_pipelines.clear();
+		pipelines::destroy_pipeline(draw_pipeline);
+		if (compute_layout)
+			vkDestroyPipelineLayout(device, compute_layout, allocator::get_callbacks(allocator::object_type::pipeline));
+		if (draw_layout)
+			vkDestroyPipelineLayout(device, draw_layout, allocator::get_callbacks(allocator::object_type::pipeline));
+		if (descriptor_pool)
+			vkDestroyDescriptorPool(device, descriptor_pool, allocator::get_callbacks(allocator::object_type::descriptor));
+		if (set_layout)
+			vkDestroyDescriptorSetLayout(device, set_layout, allocator::get_callbacks(allocator::object_type::descriptor));
+
+		for (memory::buffer& buffer : buffers)
+			memory::destroy_buffer(buffer);
+
+		compute_layout = VK_NULL_HANDLE;
+		draw_layout = VK_NULL_HANDLE;
+		descriptor_pool = VK_NULL_HANDLE;
+		descriptor_set = VK_NULL_HANDLE;
+		set_layout = VK_NULL_HANDLE;
+		sort_capacity = 0;
+		frame_statistics = {};
+	}
+
+	bool is_supported()
+	{
+		return !compute_pipelines.empty();
+	}
+
+	bool simulate(VkCommandBuffer command_buffer, const geometry::particles::emitter& source, uint32_t emit_count,
+				  const geometry::particles::forces& forces, float delta_time, const glm::mat4& view)
+	{
+		if (compute_pipelines.empty())
+			return false;
+
+		frame_statistics.requested_emits = emit_count;
+		frame_statistics.dispatches = 0;
+
+		compute_constants constants{};
+		constants.view_depth = { view[0][2], view[1][2], view[2][2], view[3][2] };
+		constants.gravity = { forces.gravity, delta_time };
+		constants.emitter_position = { source.position, source.radius };
+		constants.emitter_velocity = { source.velocity, source.velocity_spread };
+		constants.simulation[0] = source.min_lifetime;
+		constants.simulation[1] = source.max_lifetime;
+		constants.simulation[2] = forces.drag;
+		constants.counts[0] = emit_count;
+		constants.counts[1] = particle_settings.capacity;
+		constants.counts[2] = current_list;
+		constants.counts[3] = seed++;
+
+		// the previous frame's draw still reads the particles, the draw order and the draw arguments, and its sort wrote the keys
+		memory_barrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+					   VK_ACCESS_SHADER_WRITE_BIT,
+					   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+		if (particle_settings.sort)
+		{
+			vkCmdFillBuffer(command_buffer, buffers[keys_binding].buffer, 0, VK_WHOLE_SIZE, 0xffffffffu);
+			memory_barrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+						   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+		}
+
+		// the passes share one layout, the set stays bound across pipeline changes
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_layout, 0, 1, &descriptor_set, 0, nullptr);
+
+		dispatch_args(command_buffer, constants, 0);
+		dispatch_indirect(command_buffer, emit_pass, constants, dispatch_offset);
+		dispatch_args(command_buffer, constants, 1);
+		dispatch_indirect(command_buffer, simulate_pass, constants, dispatch_offset);
+		dispatch_indirect(command_buffer, compact_pass, constants, dispatch_offset);
+		dispatch_args(command_buffer, constants, 2);
+		if (particle_settings.sort)
+			sort(command_buffer, constants);
+
+		memory_barrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+					   VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+					   VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+
+		current_list ^= 1;
+		return true;
+	}
+
+	bool draw(VkCommandBuffer command_buffer, const draw_parameters& parameters)
+	{
+		if (!draw_pipeline)
+			return false;
+
+		const draw_constants constants{
+			parameters.view_projection,
+			glm::vec4{ parameters.camera_right, parameters.half_size },
+			glm::vec4{ parameters.camera_up, 0.f },
+			parameters.color
+		};
+
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw_pipeline);
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw_layout, 0, 1, &descriptor_set, 0, nullptr);
+		vkCmdPushConstants(command_buffer, draw_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(draw_constants), &constants);
+		vkCmdDrawIndirect(command_buffer, buffers[counter_binding].buffer, draw_offset, 1, sizeof(VkDrawIndirectCommand));
+		return true;
+	}
+
+	VkDescriptorSetLayout get_descriptor_set_layout()
+	{
+		return set_layout;
+	}
+
+	VkDescriptorSet get_descriptor_set()
+	{
+		return descriptor_set;
+	}
+
+	VkBuffer get_counter_buffer()
+	{
+		return buffers[counter_binding].buffer;
+	}
+
+	VkBuffer get_particle_buffer()
+	{
+		return buffers[particles_binding].buffer;
+	}
+
+	VkBuffer get_alive_buffer()
+	{
+		return buffers[alive_binding].buffer;
+	}
+
+	uint32_t get_current_alive_list()
+	{
+		return current_list;
+	}
+
+	statistics get_statistics()
+	{
+		return frame_statistics;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+#include "../Geometry/Particles.h"
+
+namespace renderer::vulkan::particles
+{
+	struct settings
+	{
+		uint32_t		capacity{ 1 << 20 };
+		bool			sort{ true };		// back to front for alpha blending, costs log2 of the live count squared steps
+		// the draw pipeline is only created when a render pass is given, its depth attachment is tested but not written
+		VkRenderPass	render_pass{ VK_NULL_HANDLE };
+		uint32_t		subpass{ 0 };
+		VkCompareOp		depth_compare_op{ VK_COMPARE_OP_LESS_OR_EQUAL };
+		// spir-v of the particle_*.comp, particle.vert and particle.frag shaders, without them the system stays off
+		std::string		shader_directory{ "Shaders/" };
+	};
+
+	struct statistics
+	{
+		uint32_t		capacity{ 0 };
+		uint32_t		requested_emits{ 0 };	// last simulate, the gpu clamps it to the free slots
+		uint32_t		dispatches{ 0 };		// last simulate, including the sort steps
+		VkDeviceSize	memory_bytes{ 0 };
+		bool			gpu_simulation{ false };
+		bool			gpu_drawing{ false };
+	};
+
+	struct draw_parameters
+	{
+		glm::mat4	view_projection{ 1.f };
+		glm::vec3	camera_right{ 1.f, 0.f, 0.f };
+		float		half_size{ 0.05f };
+		glm::vec3	camera_up{ 0.f, 1.f, 0.f };
+		glm::vec4	color{ 1.f };
+	};
+
+	// gpu particle system. particles live in device local storage buffers and every per particle step runs in compute:
+	// emission pops slots off a dead list, simulation and compaction walk a ping-pong pair of alive lists, and a bitonic
+	// sort orders the survivors back to front. the counts stay on the device, the passes after emission are dispatched
+	// indirectly and the draw count is written by compute, so the cpu records the same commands whatever the live count.
+	// bindings, all storage buffers: 0 particles, 1 alive lists, 2 dead list, 3 counters, 4 sort keys, 5 draw order
+	bool init(const settings& settings = {});
+	void shutdown();
+
+	// false when the compute shaders could not be loaded, geometry::particles::simulator is the cpu fallback then
+	bool is_supported();
+
+	// records one frame of emission, simulation, compaction and, when enabled, sorting for view. the first emit_count
+	// particles of the frame that fit spawn from source before the step. ends with a barrier for the vertex shader
+	// and indirect draw reads
+	bool simulate(VkCommandBuffer command_buffer, const geometry::particles::emitter& source, uint32_t emit_count,
+				  const geometry::particles::forces& forces, float delta_time, const glm::mat4& view);
+
+	// one indirect draw of every live particle, inside settings.render_pass. false without a draw pipeline
+	bool draw(VkCommandBuffer command_buffer, const draw_parameters& parameters);
+
+	VkDescriptorSetLayout get_descriptor_set_layout();
+	VkDescriptorSet get_descriptor_set();
+	// alive counts, dead count, emit count, then the dispatch, draw and sort arguments at 16, 32 and 48
+	VkBuffer get_counter_buffer();
+	// for readback in tests. the alive lists are capacity entries apart, the survivors of the last simulate are in the
+	// list get_current_alive_list returns and their count in that alive count
+	VkBuffer get_particle_buffer();
+	VkBuffer get_alive_buffer();
+	uint32_t get_current_alive_list();
+	statistics get_statistics();
+}
@@ -0,0 +1,245 @@
+#include "VulkanPipelines.h"
+#include "VulkanCore.h"
+#include "VulkanAllocator.h"
+#include "VulkanHelpers.h"
+#include "../Utilities/JobSystem.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace renderer::vulkan::pipelines
+{
+	namespace
+	{
+		// VK_PIPELINE_CACHE_HEADER_VERSION_ONE layout at the start of the cache data
+		struct cache_header
+		{
+			uint32_t	header_size;
+			uint32_t	header_version;
+			uint32_t	vendor_id;
+			uint32_t	device_id;
+			uint8_t		uuid[VK_UUID_SIZE];
+		};
+
+		VkPipelineCache		pipeline_cache{ VK_NULL_HANDLE };
+		std::string			cache_file_path{};
+
+		bool read_file(const std::string& path, std::vector<char>& out_bytes)
+		{
+			std::ifstream file{ path, std::ios::binary | std::ios::ate };
+			if (!file)
+				return false;
+
+			out_bytes.resize((size_t)file.tellg());
+			file.seekg(0);
+			file.read(out_bytes.data(), out_bytes.size());
+			return file.good();
+		}
+
+		// the driver rejects a foreign cache anyway, but some drivers crash on one instead
+		bool is_cache_compatible(const std::vector<char>& data)
+		{
+			cache_header header{};
+			if (data.size() < sizeof(header))
+				return false;
+
+			memcpy(&header, data.data(), sizeof(header));
+			const VkPhysicalDeviceProperties properties{ core::get_physical_device_properties() };
+			return header.header_version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+				   header.vendor_id == properties.vendorID &&
+				   header.device_id == properties.deviceID &&
+				   memcmp(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		}
+
+		void save_cache()
+		{
+			size_t size{ 0 };
+			if (vkGetPipelineCacheData(core::get_logical_device(), pipeline_cache, &size, nullptr) != VK_SUCCESS || !size)
+				return;
+
+			std::vector<char> data(size);
+			if (vkGetPipelineCacheData(core::get_logical_device(), pipeline_cache, &size, data.data()) != VK_SUCCESS)
+				return;
+
+			std::ofstream file{ cache_file_path, std::ios::binary | std::ios::trunc };
+			if (!file)
+			{
+				std::cout << "failed to write pipeline cache " << cache_file_path << "!\n";
+				return;
+			}
+			file.write(data.data(), size);
+		}
+
+	} // anonymous namespace
+
+	bool init(const std::string& cache_path)
+	{
+		assert(!pipeline_cache);
+		cache_file_path = cache_path;
+
+		std::vector<char> data{};
+		if (!cache_path.empty() && read_file(cache_path, data) && !is_cache_compatible(data))
+		{
+			std::cout << "pipeline cache " << cache_path << " belongs to another device or driver, starting empty\n";
+			data.clear();
+		}
+
+		VkPipelineCacheCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		info.initialDataSize = data.size();
+		info.pInitialData = data.empty() ? nullptr : data.data();
+		VKCALL(vkCreatePipelineCache(core::get_logical_device(), &info, allocator::get_callbacks(allocator::object_type::pipeline), &pipeline_cache), "failed to create pipeline cache");
+		return pipeline_cache != VK_NULL_HANDLE;
+	}
+
+	void shutdown()
+	{
+		if (!pipeline_cache)
+			return;
+
+		if (!cache_file_path.empty())
+			save_cache();
+
+		vkDestroyPipelineCache(core::get_logical_device(), pipeline_cache, allocator::get_callbacks(allocator::object_type::pipeline));
+		pipeline_cache = VK_NULL_HANDLE;
+		cache_file_path.clear();
+	}
+
+	VkPipelineCache get_cache()
+	{
+		return pipeline_cache;
+	}
+
+	VkShaderModule create_shader_module(const uint32_t* code, size_t code_size)
+	{
+		assert(code && code_size && !(code_size % sizeof(uint32_t)));
+
+		VkShaderModuleCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		info.codeSize = code_size;
+		info.pCode = code;
+
+		VkShaderModule module{ VK_NULL_HANDLE };
+		VKCALL(vkCreateShaderModule(core::get_logical_device(), &info, allocator::get_callbacks(allocator::object_type::pipeline), &module), "failed to create shader module");
+		return module;
+	}
+
+	VkShaderModule load_shader_module(const std::string& path)
+	{
+		std::vector<char> bytes{};
+		if (!read_file(path, bytes) || bytes.empty() || bytes.size() % sizeof(uint32_t))
+		{
+			std::cout << "failed to read shader " << path << "!\n";
+			return VK_NULL_HANDLE;
+		}
+
+		// vector<char> storage comes from operator new, which is suitably aligned for uint32_t
+		return create_shader_module(reinterpret_cast<const uint32_t*>(bytes.data()), bytes.size());
+	}
+
+	void destroy_shader_module(VkShaderModule& module)
+	{
+		if (module)
+			vkDestroyShaderModule(core::get_logical_device(), module, allocator::get_callbacks(allocator::object_type::pipeline));
+		module = VK_NULL_HANDLE;
+	}
+
+	bool load_shader_modules(const std::vector<std::string>& paths, std::vector<VkShaderModule>& out_modules)
+	{
+		out_modules.assign(paths.size(), VK_NULL_HANDLE);
+		std::atomic<bool> succeeded{ true };
+
+		// vkCreateShaderModule only needs the device, which is internally synchronized
+		jobs::parallel_for((uint32_t)paths.size(), [&](uint32_t i) {
+			out_modules[i] = load_shader_module(paths[i]);
+			if (!out_modules[i])
+				succeeded = false;
+		});
+
+		return succeeded;
+	}
+
+	bool create_graphics_pipelines(const std::vector<VkGraphicsPipelineCreateInfo>& infos, std::vector<VkPipeline>& out_pipelines)
+	{
+		assert(pipeline_cache);
+		out_pipelines.assign(infos.size(), VK_NULL_HANDLE);
+		std::atomic<bool> succeeded{ true };
+
+		// pipeline caches are internally synchronized unless created with the externally synchronized flag
+		jobs::parallel_for((uint32_t)infos.size(), [&](uint32_t i) {
+			if (vkCreateGraphicsPipelines(core::get_logical_device(), pipeline_cache, 1, &infos[i],
+										  allocator::get_callbacks(allocator::object_type::pipeline), &out_pipelines[i]) != VK_SUCCESS)
+			{
+				out_pipelines[i] = VK_NULL_HANDLE;
+				succeeded = false;
+			}
+		});
+
+		if (!succeeded)
+			std::cout << "failed to create one or more graphics pipelines!\n";
+		return succeeded;
+	}
+
+	bool create_compute_pipelines(const std::vector<VkComputePipelineCreateInfo>& infos, std::vector<VkPipeline>& out_pipelines)
+	{
+		assert(pipeline_cache);
+		out_pipelines.assign(infos.size(), VK_NULL_HANDLE);
+		std::atomic<bool> succeeded{ true };
+
+		jobs::parallel_for((uint32_t)infos.size(), [&](uint32_t i) {
+			if (vkCreateComputePipelines(core::get_logical_device(), pipeline_cache, 1, &infos[i],
+										 allocator::get_callbacks(allocator::object_type::pipeline), &out_pipelines[i]) != VK_SUCCESS)
+			{
+				out_pipelines[i] = VK_NULL_HANDLE;
+				succeeded = false;
+			}
+		});
+
+		if (!succeeded)
+			std::cout << "failed to create one or more compute pipelines!\n";
+		return succeeded;
+	}
+
+	VkPipeline create_compute_pipeline(const std::string& shader_path, VkPipelineLayout layout)
+	{
+		std::vector<VkPipeline> pipelines{};
+		create_compute_pipelines(std::vector<std::string>{ shader_path }, layout, pipelines);
+		return pipelines[0];
+	}
+
+	bool create_compute_pipelines(const std::vector<std::string>& shader_paths, VkPipelineLayout layout, std::vector<VkPipeline>& out_pipelines)
+	{
+		assert(layout);
+		out_pipelines.assign(shader_paths.size(), VK_NULL_HANDLE);
+
+		std::vector<VkShaderModule> modules{};
+		bool succeeded{ load_shader_modules(shader_paths, modules) };
+
+		// only the shaders that loaded are compiled, out_pipelines keeps its order
+		std::vector<VkComputePipelineCreateInfo> infos{};
+		std::vector<uint32_t> indices{};
+		for (uint32_t i{ 0 }; i < modules.size(); ++i)
+		{
+			if (!modules[i])
+				continue;
+			infos.push_back(vkh::compute_pipeline(modules[i], layout));
+			indices.push_back(i);
+		}
+
+		std::vector<VkPipeline> created{};
+		succeeded &= create_compute_pipelines(infos, created);
+		for (uint32_t i{ 0 }; i < created.size(); ++i)
+			out_pipelines[indices[i]] = created[i];
+
+		for (VkShaderModule& module : modules)
+			destroy_shader_module(module);
+		return succeeded;
+	}
+
+	void destroy_pipeline(VkPipeline& pipeline)
+	{
+		if (pipeline)
+			vkDestroyPipeline(core::get_logical_device(), pipeline, allocator::get_callbacks(allocator::object_type::pipeline));
+		pipeline = VK_NULL_HANDLE;
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+namespace renderer::vulkan::pipelines
+{
+	// creates the shared pipeline cache, seeded from cache_path when the file was written by the same driver and device.
+	// an empty path keeps the cache in memory only
+	bool init(const std::string& cache_path = {});
+	// writes the cache back to the path given to init
+	void shutdown();
+
+	VkPipelineCache get_cache();
+
+	// code_size in bytes, as in VkShaderModuleCreateInfo
+	VkShaderModule create_shader_module(const uint32_t* code, size_t code_size);
+	VkShaderModule load_shader_module(const std::string& path);
+	void destroy_shader_module(VkShaderModule& module);
+
+	// reads and creates every module on the job system. out_modules matches paths, failed entries are VK_NULL_HANDLE
+	bool load_shader_modules(const std::vector<std::string>& paths, std::vector<VkShaderModule>& out_modules);
+
+	// compiles each pipeline as its own job against the shared cache, the driver does the expensive work inside
+	// vkCreateGraphicsPipelines so one call per job scales with cores. out_pipelines matches infos
+	bool create_graphics_pipelines(const std::vector<VkGraphicsPipelineCreateInfo>& infos, std::vector<VkPipeline>& out_pipelines);
+	// compute counterpart of create_graphics_pipelines
+	bool create_compute_pipelines(const std::vector<VkComputePipelineCreateInfo>& infos, std::vector<VkPipeline>& out_pipelines);
+	// loads the shader, creates the pipeline against the shared cache and destroys the module again.
+	// VK_NULL_HANDLE when the shader is missing or fails to compile
+	VkPipeline create_compute_pipeline(const std::string& shader_path, VkPipelineLayout layout);
+	// one pipeline per shader with a shared layout, modules are loaded and pipelines compiled on the job system.
+	// out_pipelines matches shader_paths, failed entries are VK_NULL_HANDLE
+	bool create_compute_pipelines(const std::vector<std::string>& shader_paths, VkPipelineLayout layout, std::vector<VkPipeline>& out_pipelines);
+	void destroy_pipeline(VkPipeline& pipeline);
+}
@@ -0,0 +1,341 @@
+#include "VulkanReadback.h"
+#include "VulkanCore.h"
+#include "VulkanHelpers.h"
+#include "VulkanMemory.h"
+#include "VulkanTextures.h"
+#include "../Utilities/PngWriter.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <thread>
+
+namespace renderer::vulkan::readback
+{
+	namespace
+	{
+		// host visible copy target, reused until a larger image is captured
+		struct slot
+		{
+			memory::buffer		buffer{};
+			bool				coherent{ false };
+			bool				pending{ false };
+			uint64_t			frame_number{ 0 };
+			uint32_t			width{ 0 };
+			uint32_t			height{ 0 };
+			VkFormat			format{ VK_FORMAT_UNDEFINED };
+			uint32_t			bytes_per_pixel{ 0 };
+		};
+
+		settings												readback_settings{};
+		std::array<std::vector<slot>, core::max_current_frames>	slots{};
+		uint32_t												current_frame{ 0 };
+		uint64_t												frame_number{ 0 };
+		bool													initialized{ false };
+
+		// writer thread state
+		std::thread									writer{};
+		std::deque<frame>							queued{};
+		std::vector<std::vector<uint8_t>>			free_pixels{};		// recycled pixel storage
+		uint32_t									writing{ 0 };
+		bool										stop{ false };
+		std::mutex									mutex{};
+		std::condition_variable						wake{};
+		std::condition_variable						idle{};
+		consumer									frame_consumer{};
+		std::string									output_directory{};
+		file_format									output_format{ file_format::none };
+
+		std::atomic<uint64_t>						requested{ 0 };
+		std::atomic<uint64_t>						delivered{ 0 };
+		std::atomic<uint64_t>						dropped{ 0 };
+		std::atomic<uint64_t>						bytes_read{ 0 };
+
+		bool is_bgra(VkFormat format)
+		{
+			return format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+		}
+
+		bool is_rgba(VkFormat format)
+		{
+			return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB;
+		}
+
+		void write_file(frame& f, const std::string& directory, file_format format)
+		{
+			char name[96];
+			if (format == file_format::png && (is_rgba(f.format) || is_bgra(f.format)))
+			{
+				// swap chains are usually bgra, png is always rgba
+				if (is_bgra(f.format))
+				{
+					for (size_t i{ 0 }; i < f.pixels.size(); i += 4)
+						std::swap(f.pixels[i], f.pixels[i + 2]);
+				}
+
+				snprintf(name, sizeof(name), "/frame_%06llu.png", (unsigned long long)f.frame_number);
+				png::write(directory + name, f.width, f.height, 4, f.pixels.data());
+				return;
+			}
+
+			snprintf(name, sizeof(name), "/frame_%06llu_%ux%u_%u.raw", (unsigned long long)f.frame_number, f.width, f.height, (uint32_t)f.format);
+			std::ofstream file{ directory + name, std::ios::binary | std::ios::trunc };
+			file.write(reinterpret_cast<const char*>(f.pixels.data()), f.pixels.size());
+			if (!file)
+				std::cout << "failed to write " << directory << name << "!\n";
+		}
+
+		void writer_loop()
+		{
+			std::unique_lock lock{ mutex };
+			while (true)
+			{
+				wake.wait(lock, [] { return stop || !queued.empty(); });
+				if (queued.empty())
+					return;
+
+				frame f{ std::move(queued.front()) };
+				queued.pop_front();
+				const consumer callback{ frame_consumer };
+				const std::string directory{ output_directory };
+				const file_format format{ output_format };
+				++writing;
+				lock.unlock();
+
+				if (callback)
+					callback(f);
+				if (format != file_format::none)
+					write_file(f, directory, format);
+				++delivered;
+
+				lock.lock();
+				free_pixels.push_back(std::move(f.pixels));
+				--writing;
+				if (queued.empty() && !writing)
+					idle.notify_all();
+			}
+		}
+
+		// copies the finished capture out of the slot, the slot is free again afterwards
+		void deliver(slot& s)
+		{
+			s.pending = false;
+			const size_t size{ (size_t)s.width * s.height * s.bytes_per_pixel };
+
+			if (!s.coherent)
+			{
+				VkMappedMemoryRange range{};
+				range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+				range.memory = s.buffer.memory;
+				range.offset = 0;
+				range.size = VK_WHOLE_SIZE;
+				vkInvalidateMappedMemoryRanges(core::get_logical_device(), 1, &range);
+			}
+
+			frame f{ s.frame_number, s.width, s.height, s.format, s.bytes_per_pixel, {} };
+			{
+				std::lock_guard lock{ mutex };
+				if (queued.size() >= readback_settings.max_queued_frames)
+				{
+					++dropped;
+					return;
+				}
+				if (!free_pixels.empty())
+				{
+					f.pixels = std::move(free_pixels.back());
+					free_pixels.pop_back();
+				}
+			}
+
+			f.pixels.resize(size);
+			memcpy(f.pixels.data(), s.buffer.mapped, size);
+			bytes_read += size;
+
+			{
+				std::lock_guard lock{ mutex };
+				queued.push_back(std::move(f));
+			}
+			wake.notify_one();
+		}
+
+		bool prepare_buffer(slot& s, VkDeviceSize size)
+		{
+			if (s.buffer.buffer && s.buffer.size >= size)
+				return true;
+
+			memory::destroy_buffer(s.buffer);
+
+			// cached memory makes the cpu copy several times faster than write combined memory, it needs an invalidate
+			constexpr VkBufferUsageFlags usage{ VK_BUFFER_USAGE_TRANSFER_DST_BIT };
+			if (memory::find_memory_type(UINT32_MAX, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT) != UINT32_MAX &&
+				memory::create_buffer(size, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, s.buffer))
+			{
+				s.coherent = false;
+				return true;
+			}
+
+			s.coherent = true;
+			return memory::create_buffer(size, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, s.buffer);
+		}
+
+	} // anonymous namespace
+
+	bool init(const settings& settings)
+	{
+		assert(!initialized);
+		assert(settings.max_captures_per_frame && settings.max_queued_frames);
+		readback_settings = settings;
+		for (auto& frame_slots : slots)
+			frame_slots.resize(settings.max_captures_per_frame);
+
+		current_frame = 0;
+		frame_number = 0;
+		stop = false;
+		writer = std::thread{ writer_loop };
+		initialized = true;
+		return true;
+	}
+
+	void shutdown()
+	{
+		if (!initialized)
+			return;
+
+		vkDeviceWaitIdle(core::get_logical_device());
+		for (auto& frame_slots : slots)
+		{
+			for (slot& s : frame_slots)
+			{
+				if (s.pending)
+					deliver(s);
+			}
+		}
+
+		{
+			std::lock_guard lock{ mutex };
+			stop = true;
+		}
+		wake.notify_one();
+		writer.join();
+
+		for (auto& frame_slots : slots)
+		{
+			for (slot& s : frame_slots)
+				memory::destroy_buffer(s.buffer);
+			frame_slots.clear();
+		}
+
+		free_pixels.clear();
+		frame_consumer = {};
+		output_directory.clear();
+		output_format = file_format::none;
+		initialized = false;
+	}
+
+	void begin_frame(uint32_t frame_index)
+	{
+		assert(frame_index < core::max_current_frames);
+		if (!initialized)
+			return;
+
+		for (slot& s : slots[frame_index])
+		{
+			if (s.pending)
+				deliver(s);
+		}
+
+		current_frame = frame_index;
+		++frame_number;
+	}
+
+	bool capture(VkCommandBuffer command_buffer, VkImage image, VkFormat format, uint32_t width, uint32_t height, VkImageLayout layout)
+	{
+		assert(initialized && command_buffer && image && width && height);
+		assert(layout != VK_IMAGE_LAYOUT_UNDEFINED);
+		++requested;
+
+		const textures::format_info info{ textures::get_format_info(format) };
+		if (info.compressed || !info.block_bytes)
+		{
+			std::cout << "readback: format " << format << " can't be read back!\n";
+			++dropped;
+			return false;
+		}
+
+		slot* s{ nullptr };
+		for (slot& candidate : slots[current_frame])
+		{
+			if (!candidate.pending)
+			{
+				s = &candidate;
+				break;
+			}
+		}
+
+		// the slot's previous copy completed before this frame's fence wait, so its buffer can be replaced
+		const VkDeviceSize size{ (VkDeviceSize)width * height * info.block_bytes };
+		if (!s || !prepare_buffer(*s, size))
+		{
+			++dropped;
+			return false;
+		}
+
+		s->pending = true;
+		s->frame_number = frame_number;
+		s->width = width;
+		s->height = height;
+		s->format = format;
+		s->bytes_per_pixel = info.block_bytes;
+
+		VkImageMemoryBarrier to_transfer = vkh::image_memory_barrier(image, layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+																	 VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+							 0, nullptr, 0, nullptr, 1, &to_transfer);
+
+		VkBufferImageCopy region{};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageExtent = { width, height, 1 };
+		vkCmdCopyImageToBuffer(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, s->buffer.buffer, 1, &region);
+
+		VkImageMemoryBarrier to_layout = vkh::image_memory_barrier(image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, layout,
+																   VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+																   VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+		VkBufferMemoryBarrier to_host{};
+		to_host.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		to_host.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		to_host.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		to_host.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		to_host.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		to_host.buffer = s->buffer.buffer;
+		to_host.offset = 0;
+		to_host.size = size;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+							 0, nullptr, 1, &to_host, 1, &to_layout);
+		return true;
+	}
+
+	void set_consumer(consumer consumer)
+	{
+		std::lock_guard lock{ mutex };
+		frame_consumer = std::move(consumer);
+	}
+
+	void set_file_output(const std::string& directory, file_format format)
+	{
+		std::lock_guard lock{ mutex };
+		output_directory = directory.empty() ? "." : directory;
+		output_format = format;
+	}
+
+	void flush()
+	{
+		std::unique_lock lock{ mutex };
+		idle.wait(lock, [] { return queued.empty() && !writing; });
+	}
+
+	statistics get_statistics()
+	{
+		return { requested.load(), delivered.load(), dropped.load(), bytes_read.load() };
+	}
+}
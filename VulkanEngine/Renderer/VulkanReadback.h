@@ -0,0 +1,63 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+#include <functional>
+
+namespace renderer::vulkan::readback
+{
+	enum class file_format : uint32_t
+	{
+		none,
+		png,	// 8 bit rgba/bgra formats, anything else falls back to raw
+		raw,	// tightly packed texels, size and format are in the file name
+	};
+
+	// tightly packed copy of the captured image, rows are width * bytes_per_pixel apart
+	struct frame
+	{
+		uint64_t				frame_number{ 0 };
+		uint32_t				width{ 0 };
+		uint32_t				height{ 0 };
+		VkFormat				format{ VK_FORMAT_UNDEFINED };
+		uint32_t				bytes_per_pixel{ 0 };
+		std::vector<uint8_t>	pixels;
+	};
+
+	using consumer = std::function<void(const frame&)>;
+
+	struct settings
+	{
+		uint32_t	max_captures_per_frame{ 2 };
+		// frames waiting for the writer thread, further frames are dropped instead of growing memory without bound
+		uint32_t	max_queued_frames{ 8 };
+	};
+
+	struct statistics
+	{
+		uint64_t	requested{ 0 };
+		uint64_t	delivered{ 0 };		// handed to the consumer or written to disk
+		uint64_t	dropped{ 0 };		// no free slot, or the writer queue was full
+		uint64_t	bytes_read{ 0 };
+	};
+
+	bool init(const settings& settings = {});
+	// waits for the device and the writer thread, pending captures are still delivered
+	void shutdown();
+
+	// delivers the captures recorded max_current_frames ago, called by core::begin_frame once the frame fence has signaled
+	void begin_frame(uint32_t frame_index);
+
+	// records a copy of mip 0 into command_buffer, the image needs VK_IMAGE_USAGE_TRANSFER_SRC_BIT and is left in layout.
+	// never waits, the pixels arrive on the writer thread max_current_frames frames later. false if the capture was dropped
+	bool capture(VkCommandBuffer command_buffer, VkImage image, VkFormat format, uint32_t width, uint32_t height, VkImageLayout layout);
+
+	// both run on the writer thread, the consumer first
+	void set_consumer(consumer consumer);
+	// writes frame_<number>.png or frame_<number>_<width>x<height>_<vkformat>.raw into directory
+	void set_file_output(const std::string& directory, file_format format);
+
+	// blocks until every delivered frame has passed through the writer thread
+	void flush();
+
+	statistics get_statistics();
+}
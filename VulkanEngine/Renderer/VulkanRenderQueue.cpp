@@ -0,0 +1,226 @@
+#include "VulkanRenderQueue.h"
+#include "VulkanCore.h"
+#include "VulkanFrameAllocator.h"
+#include "VulkanCapture.h"
+#include "../Utilities/RadixSort.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace renderer::vulkan::render_queue
+{
+	namespace
+	{
+		// non negative floats compare like their bit patterns
+		uint32_t depth_bits(float view_depth)
+		{
+			view_depth = std::max(view_depth, 0.f);
+			uint32_t bits;
+			memcpy(&bits, &view_depth, sizeof(bits));
+			return bits;
+		}
+
+		double elapsed_ms(std::chrono::steady_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		// last bound state, recording only issues a bind when it changes
+		struct bound_state
+		{
+			VkPipeline			pipeline{ VK_NULL_HANDLE };
+			VkPipelineLayout	layout{ VK_NULL_HANDLE };
+			VkDescriptorSet		material_set{ VK_NULL_HANDLE };
+			VkBuffer			vertex_buffer{ VK_NULL_HANDLE };
+			VkDeviceSize		vertex_buffer_offset{ 0 };
+			VkBuffer			index_buffer{ VK_NULL_HANDLE };
+			VkDeviceSize		index_buffer_offset{ 0 };
+			VkIndexType			index_type{ VK_INDEX_TYPE_UINT32 };
+		};
+
+	} // anonymous namespace
+
+	uint64_t make_opaque_key(uint32_t pass, uint32_t pipeline, uint32_t material, float view_depth)
+	{
+		assert(pass < max_passes && pipeline < max_pipelines && material < max_materials);
+		return ((uint64_t)pass << 60) | ((uint64_t)pipeline << 48) | ((uint64_t)material << 32) | depth_bits(view_depth);
+	}
+
+	uint64_t make_translucent_key(uint32_t pass, uint32_t pipeline, uint32_t material, float view_depth)
+	{
+		assert(pass < max_passes && pipeline < max_pipelines && material < max_materials);
+		return ((uint64_t)pass << 60) | ((uint64_t)(~depth_bits(view_depth)) << 28) | ((uint64_t)pipeline << 16) | material;
+	}
+
+	bool draw_item::operator==(const draw_item& other) const
+	{
+		return pipeline == other.pipeline && layout == other.layout && material_set == other.material_set &&
+			   vertex_buffer == other.vertex_buffer && vertex_buffer_offset == other.vertex_buffer_offset &&
+			   index_buffer == other.index_buffer && index_buffer_offset == other.index_buffer_offset &&
+			   index_type == other.index_type && count == other.count && first == other.first && vertex_offset == other.vertex_offset;
+	}
+
+	queue::queue(uint32_t max_draws, uint32_t instance_stride, uint32_t instance_binding, uint32_t material_set_index)
+		: _capacity{ max_draws }, _instance_stride{ instance_stride }, _instance_binding{ instance_binding }, _material_set_index{ material_set_index },
+		  _keys(max_draws), _order(max_draws), _scratch_keys(max_draws), _scratch_order(max_draws), _draws(max_draws),
+		  _instance_data((size_t)max_draws * instance_stride)
+	{
+	}
+
+	void queue::reset()
+	{
+		_count.store(0, std::memory_order_relaxed);
+		_dropped.store(0, std::memory_order_relaxed);
+	}
+
+	bool queue::submit(uint64_t key, const draw_item& draw, const void* instance_data)
+	{
+		assert(draw.pipeline && draw.layout && draw.count);
+		assert(!_instance_stride || instance_data);
+
+		const uint32_t slot{ _count.fetch_add(1, std::memory_order_relaxed) };
+		if (slot >= _capacity)
+		{
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		_keys[slot] = key;
+		_order[slot] = slot;
+		_draws[slot] = draw;
+		if (_instance_stride)
+			memcpy(_instance_data.data() + (size_t)slot * _instance_stride, instance_data, _instance_stride);
+
+		return true;
+	}
+
+	uint32_t queue::get_draw_count() const
+	{
+		return std::min(_count.load(std::memory_order_relaxed), _capacity);
+	}
+
+	bool queue::record()
+	{
+		return record(core::get_command_buffer());
+	}
+
+	bool queue::record(VkCommandBuffer command_buffer)
+	{
+		const uint32_t count{ get_draw_count() };
+		_statistics = {};
+		_statistics.submitted_draws = count;
+		_statistics.dropped_draws = _dropped.load(std::memory_order_relaxed);
+		if (!count)
+			return true;
+
+		// before sorting, replay submits the draws again in their original order
+		if (capture::is_capturing())
+			capture::record_queue(_keys.data(), _draws.data(), _instance_data.data(), count, _capacity, _instance_stride, _instance_binding, _material_set_index);
+
+		std::chrono::steady_clock::time_point start{ std::chrono::steady_clock::now() };
+		sorting::radix_sort(_keys.data(), _order.data(), count, _scratch_keys.data(), _scratch_order.data());
+		_statistics.sort_ms = elapsed_ms(start);
+
+		start = std::chrono::steady_clock::now();
+
+		// instance data in sorted order, merged draws then read a contiguous range starting at firstInstance
+		if (_instance_stride)
+		{
+			frame_allocator::allocation instances{ frame_allocator::allocate((VkDeviceSize)count * _instance_stride, 16) };
+			if (!instances.is_valid())
+			{
+				std::cout << "render queue: not enough transient memory for " << count << " instances!\n";
+				return false;
+			}
+
+			uint8_t* destination{ static_cast<uint8_t*>(instances.mapped) };
+			for (uint32_t i{ 0 }; i < count; ++i)
+				memcpy(destination + (size_t)i * _instance_stride, _instance_data.data() + (size_t)_order[i] * _instance_stride, _instance_stride);
+
+			vkCmdBindVertexBuffers(command_buffer, _instance_binding, 1, &instances.buffer, &instances.offset);
+		}
+
+		bound_state bound{};
+		uint32_t i{ 0 };
+		while (i < count)
+		{
+			const draw_item& draw{ _draws[_order[i]] };
+
+			// fold every following identical draw into the instance count
+			uint32_t instance_count{ 1 };
+			while (i + instance_count < count && _draws[_order[i + instance_count]] == draw)
+				++instance_count;
+
+			if (draw.pipeline != bound.pipeline)
+			{
+				vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+				bound.pipeline = draw.pipeline;
+				++_statistics.pipeline_binds;
+			}
+			else
+			{
+				++_statistics.pipeline_binds_skipped;
+			}
+
+			// a different layout may disturb the set bindings, rebind the material in that case
+			if (draw.layout != bound.layout)
+			{
+				bound.layout = draw.layout;
+				bound.material_set = VK_NULL_HANDLE;
+			}
+
+			if (draw.material_set && draw.material_set != bound.material_set)
+			{
+				vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.layout, _material_set_index, 1, &draw.material_set, 0, nullptr);
+				bound.material_set = draw.material_set;
+				++_statistics.descriptor_binds;
+			}
+			else if (draw.material_set)
+			{
+				++_statistics.descriptor_binds_skipped;
+			}
+
+			if (draw.vertex_buffer && (draw.vertex_buffer != bound.vertex_buffer || draw.vertex_buffer_offset != bound.vertex_buffer_offset))
+			{
+				vkCmdBindVertexBuffers(command_buffer, 0, 1, &draw.vertex_buffer, &draw.vertex_buffer_offset);
+				bound.vertex_buffer = draw.vertex_buffer;
+				bound.vertex_buffer_offset = draw.vertex_buffer_offset;
+				++_statistics.vertex_buffer_binds;
+			}
+			else if (draw.vertex_buffer)
+			{
+				++_statistics.vertex_buffer_binds_skipped;
+			}
+
+			if (draw.index_buffer)
+			{
+				if (draw.index_buffer != bound.index_buffer || draw.index_buffer_offset != bound.index_buffer_offset || draw.index_type != bound.index_type)
+				{
+					vkCmdBindIndexBuffer(command_buffer, draw.index_buffer, draw.index_buffer_offset, draw.index_type);
+					bound.index_buffer = draw.index_buffer;
+					bound.index_buffer_offset = draw.index_buffer_offset;
+					bound.index_type = draw.index_type;
+					++_statistics.index_buffer_binds;
+				}
+				else
+				{
+					++_statistics.index_buffer_binds_skipped;
+				}
+
+				vkCmdDrawIndexed(command_buffer, draw.count, instance_count, draw.first, draw.vertex_offset, i);
+			}
+			else
+			{
+				vkCmdDraw(command_buffer, draw.count, instance_count, draw.first, i);
+			}
+
+			++_statistics.issued_draws;
+			_statistics.merged_draws += instance_count - 1;
+			i += instance_count;
+		}
+
+		_statistics.record_ms = elapsed_ms(start);
+		return true;
+	}
+}
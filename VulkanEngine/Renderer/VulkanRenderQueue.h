@@ -0,0 +1,87 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+namespace renderer::vulkan::render_queue
+{
+	constexpr uint32_t max_passes{ 1 << 4 };
+	constexpr uint32_t max_pipelines{ 1 << 12 };
+	constexpr uint32_t max_materials{ 1 << 16 };
+
+	// pass | pipeline | material | depth, opaque draws are grouped by state and then sorted front to back
+	uint64_t make_opaque_key(uint32_t pass, uint32_t pipeline, uint32_t material, float view_depth);
+	// pass | inverted depth | pipeline | material, blended draws must be drawn back to front before state grouping
+	uint64_t make_translucent_key(uint32_t pass, uint32_t pipeline, uint32_t material, float view_depth);
+
+	// everything one draw binds, draws with equal items and adjacent keys are merged into one instanced draw
+	struct draw_item
+	{
+		VkPipeline			pipeline{ VK_NULL_HANDLE };
+		VkPipelineLayout	layout{ VK_NULL_HANDLE };
+		VkDescriptorSet		material_set{ VK_NULL_HANDLE };
+		VkBuffer			vertex_buffer{ VK_NULL_HANDLE };
+		VkDeviceSize		vertex_buffer_offset{ 0 };
+		VkBuffer			index_buffer{ VK_NULL_HANDLE };	// null records vkCmdDraw
+		VkDeviceSize		index_buffer_offset{ 0 };
+		VkIndexType			index_type{ VK_INDEX_TYPE_UINT32 };
+		uint32_t			count{ 0 };						// index or vertex count
+		uint32_t			first{ 0 };						// first index or first vertex
+		int32_t				vertex_offset{ 0 };
+
+		bool operator==(const draw_item& other) const;
+	};
+
+	struct statistics
+	{
+		uint32_t	submitted_draws{ 0 };
+		uint32_t	issued_draws{ 0 };
+		uint32_t	merged_draws{ 0 };		// submitted draws folded into the instance count of another draw
+		uint32_t	dropped_draws{ 0 };		// submitted past the capacity of the queue
+		uint32_t	pipeline_binds{ 0 };
+		uint32_t	pipeline_binds_skipped{ 0 };
+		uint32_t	descriptor_binds{ 0 };
+		uint32_t	descriptor_binds_skipped{ 0 };
+		uint32_t	vertex_buffer_binds{ 0 };
+		uint32_t	vertex_buffer_binds_skipped{ 0 };
+		uint32_t	index_buffer_binds{ 0 };
+		uint32_t	index_buffer_binds_skipped{ 0 };
+		double		sort_ms{ 0 };
+		double		record_ms{ 0 };
+	};
+
+	class queue
+	{
+	public:
+		// instance_stride bytes per draw are copied at submit and streamed through the frame allocator in sorted order,
+		// bound at instance_binding. material sets are bound at material_set_index
+		explicit queue(uint32_t max_draws, uint32_t instance_stride, uint32_t instance_binding = 1, uint32_t material_set_index = 1);
+		DISABLE_COPY_AND_MOVE(queue);
+
+		// call once per frame before submitting
+		void reset();
+
+		// lock free, draws can be submitted from several threads between reset and record
+		bool submit(uint64_t key, const draw_item& draw, const void* instance_data = nullptr);
+
+		// sorts and records into core::get_command_buffer() inside the active render pass
+		bool record();
+		bool record(VkCommandBuffer command_buffer);
+
+		[[nodiscard]] uint32_t get_draw_count() const;
+		[[nodiscard]] const statistics& get_statistics() const { return _statistics; }
+
+	private:
+		uint32_t					_capacity;
+		uint32_t					_instance_stride;
+		uint32_t					_instance_binding;
+		uint32_t					_material_set_index;
+		std::atomic<uint32_t>		_count{ 0 };
+		std::atomic<uint32_t>		_dropped{ 0 };
+		std::vector<uint64_t>		_keys;
+		std::vector<uint32_t>		_order;
+		std::vector<uint64_t>		_scratch_keys;
+		std::vector<uint32_t>		_scratch_order;
+		std::vector<draw_item>		_draws;
+		std::vector<uint8_t>		_instance_data;
+		statistics					_statistics{};
+	};
+}
@@ -0,0 +1,772 @@
+#include "VulkanResource.h"
+#include "VulkanAllocator.h"
+#include "VulkanCore.h"
+#include "VulkanHelpers.h"
+
+#include <algorithm>
+#include <array>
+#include <shared_mutex>
+
+namespace renderer::vulkan::resources
+{
+	namespace
+	{
+		constexpr uint32_t invalid_slot{ UINT32_MAX };
+
+		// maps handle indices to dense storage slots. freeing a slot moves the last dense entry into it, so every pool
+		// stays packed and its columns are erased the same way with erase_at
+		class slot_map
+		{
+		public:
+			uint32_t insert(uint32_t& out_generation)
+			{
+				uint32_t index{ (uint32_t)_sparse.size() };
+				if (!_free_indices.empty())
+				{
+					index = _free_indices.back();
+					_free_indices.pop_back();
+				}
+				else
+				{
+					_sparse.emplace_back();
+				}
+
+				_sparse[index].slot = (uint32_t)_dense_indices.size();
+				_dense_indices.push_back(index);
+				out_generation = _sparse[index].generation;
+				return index;
+			}
+
+			// dense slot of a live handle, invalid_slot for null and stale handles
+			[[nodiscard]] uint32_t find(uint32_t index, uint32_t generation) const
+			{
+				if (index >= _sparse.size() || _sparse[index].generation != generation)
+					return invalid_slot;
+				return _sparse[index].slot;
+			}
+
+			// returns the freed dense slot, which the last entry moves into
+			uint32_t erase(uint32_t index)
+			{
+				entry& e{ _sparse[index] };
+				const uint32_t slot{ e.slot };
+				const uint32_t moved_index{ _dense_indices.back() };
+				_dense_indices[slot] = moved_index;
+				_sparse[moved_index].slot = slot;
+				_dense_indices.pop_back();
+
+				e.slot = invalid_slot;
+				++e.generation;
+				_free_indices.push_back(index);
+				return slot;
+			}
+
+			template<typename handle_type>
+			[[nodiscard]] handle_type get_handle(uint32_t slot) const
+			{
+				const uint32_t index{ _dense_indices[slot] };
+				return { index, _sparse[index].generation };
+			}
+
+			[[nodiscard]] uint32_t size() const { return (uint32_t)_dense_indices.size(); }
+
+			void clear()
+			{
+				_sparse.clear();
+				_dense_indices.clear();
+				_free_indices.clear();
+			}
+
+		private:
+			struct entry
+			{
+				uint32_t	slot{ invalid_slot };
+				uint32_t	generation{ 0 };
+			};
+
+			std::vector<entry>		_sparse;
+			std::vector<uint32_t>	_dense_indices;
+			std::vector<uint32_t>	_free_indices;
+		};
+
+		template<typename T>
+		void erase_at(std::vector<T>& column, uint32_t slot)
+		{
+			column[slot] = std::move(column.back());
+			column.pop_back();
+		}
+
+		// one column per field, the ones read while recording come first
+		struct buffer_pool
+		{
+			std::shared_mutex				mutex;
+			slot_map						slots;
+			std::vector<VkBuffer>			buffers;
+			std::vector<memory::buffer>		allocations;
+			std::vector<uint32_t>			versions;
+			std::vector<VkBufferUsageFlags>	usages;
+			std::vector<VkMemoryPropertyFlags>	properties;
+			std::vector<uint8_t>			movable;
+		};
+
+		struct image_pool
+		{
+			std::shared_mutex				mutex;
+			slot_map						slots;
+			std::vector<VkImage>			images;
+			std::vector<VkImageView>		views;
+			std::vector<memory::image>		allocations;
+			std::vector<VkFormat>			formats;
+			std::vector<VkExtent3D>			extents;
+			std::vector<uint32_t>			versions;
+			std::vector<VkImageCreateInfo>	infos;			// without pNext, what relocate recreates the image from
+			std::vector<std::array<uint32_t, 2>>	queue_families;	// of concurrent images, infos point nowhere
+			std::vector<VkMemoryPropertyFlags>	properties;
+			std::vector<VkImageAspectFlags>	view_aspects;
+			std::vector<VkImageLayout>		layouts;		// the layout a movable image is in between uses
+			std::vector<uint8_t>			movable;
+			std::vector<uint8_t>			pinned;
+		};
+
+		struct sampler_pool
+		{
+			std::shared_mutex				mutex;
+			slot_map						slots;
+			std::vector<VkSampler>			samplers;
+		};
+
+		struct pipeline_pool
+		{
+			std::shared_mutex				mutex;
+			slot_map						slots;
+			std::vector<VkPipeline>			pipelines;
+			std::vector<VkPipelineLayout>	layouts;
+			std::vector<VkPipelineBindPoint>	bind_points;
+		};
+
+		// objects destroyed while frame_index was recording, freed once that frame slot comes around again
+		struct deferred_frame
+		{
+			std::vector<memory::buffer>		buffers;
+			std::vector<memory::image>		images;
+			std::vector<VkImageView>		views;
+			std::vector<VkSampler>			samplers;
+			std::vector<VkPipeline>			pipelines;
+		};
+
+		buffer_pool					buffers{};
+		image_pool					images{};
+		sampler_pool				samplers{};
+		pipeline_pool				pipelines{};
+		std::mutex					deferred_mutex{};
+		deferred_frame				deferred[core::max_current_frames]{};
+		std::atomic<uint64_t>		stale_lookups{ 0 };
+
+		// reads one column entry of a live handle, fallback for stale handles
+		template<typename pool_type, typename tag, typename T>
+		T read(pool_type& pool, handle<tag> h, std::vector<T> pool_type::* column, T fallback = {})
+		{
+			std::shared_lock lock{ pool.mutex };
+			const uint32_t slot{ pool.slots.find(h.index, h.generation) };
+			if (slot == invalid_slot)
+			{
+				if (h.is_valid())
+					stale_lookups.fetch_add(1, std::memory_order_relaxed);
+				return fallback;
+			}
+			return (pool.*column)[slot];
+		}
+
+		template<typename pool_type, typename tag>
+		bool is_live(pool_type& pool, handle<tag> h)
+		{
+			std::shared_lock lock{ pool.mutex };
+			return pool.slots.find(h.index, h.generation) != invalid_slot;
+		}
+
+		// removes a live handle from its pool and returns the slot its columns have to be erased at
+		template<typename pool_type, typename tag>
+		uint32_t release(pool_type& pool, handle<tag> h)
+		{
+			const uint32_t slot{ pool.slots.find(h.index, h.generation) };
+			if (slot == invalid_slot)
+			{
+				if (h.is_valid())
+					stale_lookups.fetch_add(1, std::memory_order_relaxed);
+				return invalid_slot;
+			}
+			return pool.slots.erase(h.index);
+		}
+
+		deferred_frame& current_deferred_frame()
+		{
+			return deferred[core::get_current_command_buffer_index()];
+		}
+
+		void destroy_now(deferred_frame& frame)
+		{
+			VkDevice device{ core::get_logical_device() };
+			for (memory::buffer& buffer : frame.buffers)
+				memory::destroy_buffer(buffer);
+			// null views are fine here, images created without one keep VK_NULL_HANDLE in their column
+			for (VkImageView view : frame.views)
+				vkDestroyImageView(device, view, allocator::get_callbacks(allocator::object_type::memory));
+			for (memory::image& image : frame.images)
+				memory::destroy_image(image);
+			for (VkSampler sampler : frame.samplers)
+				vkDestroySampler(device, sampler, allocator::get_callbacks(allocator::object_type::other));
+			for (VkPipeline pipeline : frame.pipelines)
+				vkDestroyPipeline(device, pipeline, allocator::get_callbacks(allocator::object_type::pipeline));
+			frame = {};
+		}
+
+		VkImageViewType get_view_type(VkImageType type)
+		{
+			switch (type)
+			{
+			case VK_IMAGE_TYPE_1D: return VK_IMAGE_VIEW_TYPE_1D;
+			case VK_IMAGE_TYPE_3D: return VK_IMAGE_VIEW_TYPE_3D;
+			default: return VK_IMAGE_VIEW_TYPE_2D;
+			}
+		}
+
+		VkImageView create_view(VkImage image, const VkImageCreateInfo& info, VkImageAspectFlags view_aspect)
+		{
+			VkImageViewCreateInfo view_info = vkh::image_view_2d(image, info.format, view_aspect, info.mipLevels);
+			view_info.viewType = get_view_type(info.imageType);
+
+			VkImageView view{ VK_NULL_HANDLE };
+			VKCALL(vkCreateImageView(core::get_logical_device(), &view_info, allocator::get_callbacks(allocator::object_type::memory), &view),
+				   "failed to create resource image view");
+			return view;
+		}
+
+		struct buffer_move
+		{
+			buffer_handle		handle;
+			memory::buffer		source;
+			memory::buffer		target;
+		};
+
+		struct image_move
+		{
+			image_handle		handle;
+			memory::image		source;
+			memory::image		target;
+			VkImageView			view;
+			VkImageCreateInfo	info;
+			VkImageAspectFlags	aspect;
+			VkImageLayout		layout;
+			std::array<uint32_t, 2>	queue_families;
+		};
+
+		VkImageAspectFlags get_copy_aspect(VkFormat format)
+		{
+			switch (format)
+			{
+			case VK_FORMAT_D16_UNORM:
+			case VK_FORMAT_D32_SFLOAT:
+				return VK_IMAGE_ASPECT_DEPTH_BIT;
+			case VK_FORMAT_D24_UNORM_S8_UINT:
+			case VK_FORMAT_D32_SFLOAT_S8_UINT:
+				return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+			default:
+				return VK_IMAGE_ASPECT_COLOR_BIT;
+			}
+		}
+
+		void record_copies(VkCommandBuffer command_buffer, const std::vector<buffer_move>& buffer_moves, const std::vector<image_move>& image_moves)
+		{
+			// one barrier orders the copies after everything earlier frames did with the sources. general layout sources
+			// are copied as they are, other queues may be reading them
+			std::vector<VkImageMemoryBarrier> barriers;
+			for (const image_move& move : image_moves)
+			{
+				if (move.layout != VK_IMAGE_LAYOUT_GENERAL)
+				{
+					barriers.push_back(vkh::image_memory_barrier(move.source.image, move.layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+																 VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, move.aspect, 0, move.info.mipLevels));
+					barriers.back().subresourceRange.layerCount = move.info.arrayLayers;
+				}
+				barriers.push_back(vkh::image_memory_barrier(move.target.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+															 0, VK_ACCESS_TRANSFER_WRITE_BIT, move.aspect, 0, move.info.mipLevels));
+				barriers.back().subresourceRange.layerCount = move.info.arrayLayers;
+			}
+
+			VkMemoryBarrier memory_barrier{};
+			memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memory_barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+			memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+								 1, &memory_barrier, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+
+			for (const buffer_move& move : buffer_moves)
+			{
+				VkBufferCopy region{ 0, 0, move.source.size };
+				vkCmdCopyBuffer(command_buffer, move.source.buffer, move.target.buffer, 1, &region);
+			}
+
+			std::vector<VkImageCopy> regions;
+			for (const image_move& move : image_moves)
+			{
+				regions.clear();
+				for (uint32_t mip{ 0 }; mip < move.info.mipLevels; ++mip)
+				{
+					VkImageCopy region{};
+					region.srcSubresource = { move.aspect, mip, 0, move.info.arrayLayers };
+					region.dstSubresource = region.srcSubresource;
+					region.extent = { std::max(1u, move.info.extent.width >> mip), std::max(1u, move.info.extent.height >> mip),
+									  std::max(1u, move.info.extent.depth >> mip) };
+					regions.push_back(region);
+				}
+				const VkImageLayout source_layout{ move.layout == VK_IMAGE_LAYOUT_GENERAL ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+				vkCmdCopyImage(command_buffer, move.source.image, source_layout, move.target.image,
+							   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+			}
+
+			barriers.clear();
+			for (const image_move& move : image_moves)
+			{
+				barriers.push_back(vkh::image_memory_barrier(move.target.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, move.layout,
+															 VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT, move.aspect, 0, move.info.mipLevels));
+				barriers.back().subresourceRange.layerCount = move.info.arrayLayers;
+			}
+
+			memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memory_barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+								 1, &memory_barrier, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+		}
+
+	} // anonymous namespace
+
+	bool init()
+	{
+		stale_lookups = 0;
+		return true;
+	}
+
+	void shutdown()
+	{
+		vkDeviceWaitIdle(core::get_logical_device());
+
+		deferred_frame remaining{};
+		remaining.buffers = std::move(buffers.allocations);
+		remaining.views = std::move(images.views);
+		remaining.images = std::move(images.allocations);
+		remaining.samplers = std::move(samplers.samplers);
+		remaining.pipelines = std::move(pipelines.pipelines);
+		destroy_now(remaining);
+
+		for (deferred_frame& frame : deferred)
+			destroy_now(frame);
+
+		buffers.slots.clear();
+		buffers.buffers.clear();
+		buffers.allocations.clear();
+		buffers.versions.clear();
+		buffers.usages.clear();
+		buffers.properties.clear();
+		buffers.movable.clear();
+		images.slots.clear();
+		images.images.clear();
+		images.views.clear();
+		images.allocations.clear();
+		images.formats.clear();
+		images.extents.clear();
+		images.versions.clear();
+		images.infos.clear();
+		images.queue_families.clear();
+		images.properties.clear();
+		images.view_aspects.clear();
+		images.layouts.clear();
+		images.movable.clear();
+		images.pinned.clear();
+		samplers.slots.clear();
+		samplers.samplers.clear();
+		pipelines.slots.clear();
+		pipelines.pipelines.clear();
+		pipelines.layouts.clear();
+		pipelines.bind_points.clear();
+	}
+
+	void begin_frame(uint32_t frame_index)
+	{
+		assert(frame_index < core::max_current_frames);
+		deferred_frame frame{};
+		{
+			std::lock_guard lock{ deferred_mutex };
+			std::swap(frame, deferred[frame_index]);
+		}
+		destroy_now(frame);
+	}
+
+	buffer_handle create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool movable)
+	{
+		if (movable)
+			usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+		memory::buffer buffer{};
+		if (!memory::create_buffer(size, usage, properties, buffer))
+			return {};
+
+		std::unique_lock lock{ buffers.mutex };
+		buffer_handle h{};
+		h.index = buffers.slots.insert(h.generation);
+		buffers.buffers.push_back(buffer.buffer);
+		buffers.allocations.push_back(buffer);
+		buffers.versions.push_back(0);
+		buffers.usages.push_back(usage);
+		buffers.properties.push_back(properties);
+		buffers.movable.push_back(movable);
+		return h;
+	}
+
+	image_handle create_image(const VkImageCreateInfo& info, VkMemoryPropertyFlags properties, VkImageAspectFlags view_aspect, bool movable,
+							  VkImageLayout layout, bool pinned)
+	{
+		VkImageCreateInfo image_info{ info };
+		std::array<uint32_t, 2> queue_families{};
+		if (movable)
+		{
+			assert(info.sharingMode == VK_SHARING_MODE_EXCLUSIVE || info.queueFamilyIndexCount <= queue_families.size());
+			image_info.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		}
+		if (info.sharingMode == VK_SHARING_MODE_CONCURRENT)
+			std::copy_n(info.pQueueFamilyIndices, std::min<uint32_t>(info.queueFamilyIndexCount, (uint32_t)queue_families.size()), queue_families.begin());
+
+		memory::image image{};
+		if (!memory::create_image(image_info, properties, image))
+			return {};
+
+		VkImageView view{ VK_NULL_HANDLE };
+		if (view_aspect)
+		{
+			view = create_view(image.image, image_info, view_aspect);
+			if (!view)
+			{
+				memory::destroy_image(image);
+				return {};
+			}
+		}
+
+		image_info.pNext = nullptr;
+		image_info.queueFamilyIndexCount = image_info.sharingMode == VK_SHARING_MODE_CONCURRENT ? std::min<uint32_t>(info.queueFamilyIndexCount, 2) : 0;
+		image_info.pQueueFamilyIndices = nullptr;
+
+		std::unique_lock lock{ images.mutex };
+		image_handle h{};
+		h.index = images.slots.insert(h.generation);
+		images.images.push_back(image.image);
+		images.views.push_back(view);
+		images.allocations.push_back(image);
+		images.formats.push_back(info.format);
+		images.extents.push_back(info.extent);
+		images.versions.push_back(0);
+		images.infos.push_back(image_info);
+		images.queue_families.push_back(queue_families);
+		images.properties.push_back(properties);
+		images.view_aspects.push_back(view_aspect);
+		images.layouts.push_back(layout);
+		images.movable.push_back(movable);
+		images.pinned.push_back(pinned);
+		return h;
+	}
+
+	sampler_handle create_sampler(const VkSamplerCreateInfo& info)
+	{
+		VkSampler sampler{ VK_NULL_HANDLE };
+		VKCALL(vkCreateSampler(core::get_logical_device(), &info, allocator::get_callbacks(allocator::object_type::other), &sampler),
+			   "failed to create resource sampler");
+		if (!sampler)
+			return {};
+
+		std::unique_lock lock{ samplers.mutex };
+		sampler_handle h{};
+		h.index = samplers.slots.insert(h.generation);
+		samplers.samplers.push_back(sampler);
+		return h;
+	}
+
+	pipeline_handle add_pipeline(VkPipeline pipeline, VkPipelineLayout layout, VkPipelineBindPoint bind_point)
+	{
+		assert(pipeline);
+		std::unique_lock lock{ pipelines.mutex };
+		pipeline_handle h{};
+		h.index = pipelines.slots.insert(h.generation);
+		pipelines.pipelines.push_back(pipeline);
+		pipelines.layouts.push_back(layout);
+		pipelines.bind_points.push_back(bind_point);
+		return h;
+	}
+
+	void destroy(buffer_handle h)
+	{
+		std::unique_lock lock{ buffers.mutex };
+		const uint32_t slot{ release(buffers, h) };
+		if (slot == invalid_slot)
+			return;
+
+		{
+			std::lock_guard deferred_lock{ deferred_mutex };
+			current_deferred_frame().buffers.push_back(buffers.allocations[slot]);
+		}
+		erase_at(buffers.buffers, slot);
+		erase_at(buffers.allocations, slot);
+		erase_at(buffers.versions, slot);
+		erase_at(buffers.usages, slot);
+		erase_at(buffers.properties, slot);
+		erase_at(buffers.movable, slot);
+	}
+
+	void destroy(image_handle h)
+	{
+		std::unique_lock lock{ images.mutex };
+		const uint32_t slot{ release(images, h) };
+		if (slot == invalid_slot)
+			return;
+
+		{
+			std::lock_guard deferred_lock{ deferred_mutex };
+			deferred_frame& frame{ current_deferred_frame() };
+			if (images.views[slot])
+				frame.views.push_back(images.views[slot]);
+			frame.images.push_back(images.allocations[slot]);
+		}
+		erase_at(images.images, slot);
+		erase_at(images.views, slot);
+		erase_at(images.allocations, slot);
+		erase_at(images.formats, slot);
+		erase_at(images.extents, slot);
+		erase_at(images.versions, slot);
+		erase_at(images.infos, slot);
+		erase_at(images.queue_families, slot);
+		erase_at(images.properties, slot);
+		erase_at(images.view_aspects, slot);
+		erase_at(images.layouts, slot);
+		erase_at(images.movable, slot);
+		erase_at(images.pinned, slot);
+	}
+
+	void destroy(sampler_handle h)
+	{
+		std::unique_lock lock{ samplers.mutex };
+		const uint32_t slot{ release(samplers, h) };
+		if (slot == invalid_slot)
+			return;
+
+		{
+			std::lock_guard deferred_lock{ deferred_mutex };
+			current_deferred_frame().samplers.push_back(samplers.samplers[slot]);
+		}
+		erase_at(samplers.samplers, slot);
+	}
+
+	void destroy(pipeline_handle h)
+	{
+		std::unique_lock lock{ pipelines.mutex };
+		const uint32_t slot{ release(pipelines, h) };
+		if (slot == invalid_slot)
+			return;
+
+		{
+			std::lock_guard deferred_lock{ deferred_mutex };
+			current_deferred_frame().pipelines.push_back(pipelines.pipelines[slot]);
+		}
+		erase_at(pipelines.pipelines, slot);
+		erase_at(pipelines.layouts, slot);
+		erase_at(pipelines.bind_points, slot);
+	}
+
+	bool is_alive(buffer_handle h) { return is_live(buffers, h); }
+	bool is_alive(image_handle h) { return is_live(images, h); }
+	bool is_alive(sampler_handle h) { return is_live(samplers, h); }
+	bool is_alive(pipeline_handle h) { return is_live(pipelines, h); }
+
+	VkBuffer get_buffer(buffer_handle h) { return read(buffers, h, &buffer_pool::buffers); }
+	VkDeviceSize get_buffer_size(buffer_handle h) { return read(buffers, h, &buffer_pool::allocations).size; }
+	void* get_buffer_mapped(buffer_handle h) { return read(buffers, h, &buffer_pool::allocations).mapped; }
+	VkImage get_image(image_handle h) { return read(images, h, &image_pool::images); }
+	VkImageView get_image_view(image_handle h) { return read(images, h, &image_pool::views); }
+	VkFormat get_image_format(image_handle h) { return read(images, h, &image_pool::formats, VK_FORMAT_UNDEFINED); }
+	VkExtent3D get_image_extent(image_handle h) { return read(images, h, &image_pool::extents); }
+	VkDeviceSize get_image_size(image_handle h) { return read(images, h, &image_pool::allocations).allocation_size; }
+	VkSampler get_sampler(sampler_handle h) { return read(samplers, h, &sampler_pool::samplers); }
+	VkPipeline get_pipeline(pipeline_handle h) { return read(pipelines, h, &pipeline_pool::pipelines); }
+	VkPipelineLayout get_pipeline_layout(pipeline_handle h) { return read(pipelines, h, &pipeline_pool::layouts); }
+	VkPipelineBindPoint get_pipeline_bind_point(pipeline_handle h) { return read(pipelines, h, &pipeline_pool::bind_points, VK_PIPELINE_BIND_POINT_GRAPHICS); }
+
+	bool is_movable(buffer_handle h) { return read(buffers, h, &buffer_pool::movable) != 0; }
+	bool is_movable(image_handle h)
+	{
+		std::shared_lock lock{ images.mutex };
+		const uint32_t slot{ images.slots.find(h.index, h.generation) };
+		return slot != invalid_slot && images.movable[slot] && !images.pinned[slot];
+	}
+
+	void pin(image_handle h, bool pinned)
+	{
+		std::unique_lock lock{ images.mutex };
+		const uint32_t slot{ images.slots.find(h.index, h.generation) };
+		if (slot != invalid_slot)
+			images.pinned[slot] = pinned;
+	}
+	uint32_t get_version(buffer_handle h) { return read(buffers, h, &buffer_pool::versions); }
+	uint32_t get_version(image_handle h) { return read(images, h, &image_pool::versions); }
+
+	VkDeviceSize relocate(VkCommandBuffer command_buffer, const std::vector<buffer_handle>& buffer_handles, const std::vector<image_handle>& image_handles)
+	{
+		// the new objects are created without holding a pool lock, lookups keep returning the old ones until the swap
+		std::vector<buffer_move> buffer_moves;
+		for (buffer_handle h : buffer_handles)
+		{
+			buffer_move move{ h, {}, {} };
+			VkBufferUsageFlags usage{ 0 };
+			VkMemoryPropertyFlags properties{ 0 };
+			{
+				std::shared_lock lock{ buffers.mutex };
+				const uint32_t slot{ buffers.slots.find(h.index, h.generation) };
+				if (slot == invalid_slot || !buffers.movable[slot])
+					continue;
+				move.source = buffers.allocations[slot];
+				usage = buffers.usages[slot];
+				properties = buffers.properties[slot];
+			}
+
+			if (memory::create_buffer(move.source.size, usage, properties, move.target))
+				buffer_moves.push_back(move);
+		}
+
+		std::vector<image_move> image_moves;
+		for (image_handle h : image_handles)
+		{
+			image_move move{ h, {}, {}, VK_NULL_HANDLE, {}, 0, VK_IMAGE_LAYOUT_UNDEFINED, {} };
+			VkMemoryPropertyFlags properties{ 0 };
+			VkImageAspectFlags view_aspect{ 0 };
+			{
+				std::shared_lock lock{ images.mutex };
+				const uint32_t slot{ images.slots.find(h.index, h.generation) };
+				if (slot == invalid_slot || !images.movable[slot] || images.pinned[slot])
+					continue;
+				move.source = images.allocations[slot];
+				move.info = images.infos[slot];
+				move.layout = images.layouts[slot];
+				move.queue_families = images.queue_families[slot];
+				properties = images.properties[slot];
+				view_aspect = images.view_aspects[slot];
+			}
+
+			move.aspect = get_copy_aspect(move.info.format);
+			if (move.info.sharingMode == VK_SHARING_MODE_CONCURRENT)
+				move.info.pQueueFamilyIndices = move.queue_families.data();
+			if (!memory::create_image(move.info, properties, move.target))
+				continue;
+			if (view_aspect)
+			{
+				move.view = create_view(move.target.image, move.info, view_aspect);
+				if (!move.view)
+				{
+					memory::destroy_image(move.target);
+					continue;
+				}
+			}
+			image_moves.push_back(move);
+		}
+
+		if (buffer_moves.empty() && image_moves.empty())
+			return 0;
+
+		record_copies(command_buffer, buffer_moves, image_moves);
+
+		// resources destroyed in the meantime release their new copy instead, the copy already recorded still needs it
+		VkDeviceSize bytes{ 0 };
+		{
+			std::unique_lock lock{ buffers.mutex };
+			std::lock_guard deferred_lock{ deferred_mutex };
+			deferred_frame& frame{ current_deferred_frame() };
+			for (buffer_move& move : buffer_moves)
+			{
+				const uint32_t slot{ buffers.slots.find(move.handle.index, move.handle.generation) };
+				if (slot == invalid_slot)
+				{
+					frame.buffers.push_back(move.target);
+					continue;
+				}
+
+				frame.buffers.push_back(move.source);
+				buffers.buffers[slot] = move.target.buffer;
+				buffers.allocations[slot] = move.target;
+				++buffers.versions[slot];
+				bytes += move.source.size;
+			}
+		}
+		{
+			std::unique_lock lock{ images.mutex };
+			std::lock_guard deferred_lock{ deferred_mutex };
+			deferred_frame& frame{ current_deferred_frame() };
+			for (image_move& move : image_moves)
+			{
+				const uint32_t slot{ images.slots.find(move.handle.index, move.handle.generation) };
+				if (slot == invalid_slot)
+				{
+					if (move.view)
+						frame.views.push_back(move.view);
+					frame.images.push_back(move.target);
+					continue;
+				}
+
+				if (images.views[slot])
+					frame.views.push_back(images.views[slot]);
+				frame.images.push_back(move.source);
+				images.images[slot] = move.target.image;
+				images.views[slot] = move.view;
+				images.allocations[slot] = move.target;
+				++images.versions[slot];
+				bytes += move.source.allocation_size;
+			}
+		}
+		return bytes;
+	}
+
+	void for_each_buffer(const std::function<void(buffer_handle, const memory::buffer&)>& callback)
+	{
+		std::shared_lock lock{ buffers.mutex };
+		for (uint32_t slot{ 0 }; slot < buffers.slots.size(); ++slot)
+			callback(buffers.slots.get_handle<buffer_handle>(slot), buffers.allocations[slot]);
+	}
+
+	void for_each_image(const std::function<void(image_handle, const memory::image&)>& callback)
+	{
+		std::shared_lock lock{ images.mutex };
+		for (uint32_t slot{ 0 }; slot < images.slots.size(); ++slot)
+			callback(images.slots.get_handle<image_handle>(slot), images.allocations[slot]);
+	}
+
+	statistics get_statistics()
+	{
+		statistics result{};
+		{
+			std::shared_lock lock{ buffers.mutex };
+			result.buffers = buffers.slots.size();
+		}
+		{
+			std::shared_lock lock{ images.mutex };
+			result.images = images.slots.size();
+		}
+		{
+			std::shared_lock lock{ samplers.mutex };
+			result.samplers = samplers.slots.size();
+		}
+		{
+			std::shared_lock lock{ pipelines.mutex };
+			result.pipelines = pipelines.slots.size();
+		}
+		{
+			std::lock_guard lock{ deferred_mutex };
+			for (const deferred_frame& frame : deferred)
+				result.deferred += (uint32_t)(frame.buffers.size() + frame.images.size() + frame.samplers.size() + frame.pipelines.size());
+		}
+		result.stale_lookups = stale_lookups.load(std::memory_order_relaxed);
+		return result;
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+#include "VulkanMemory.h"
+
+#include <functional>
+
+namespace renderer::vulkan::resources
+{
+	// index into a pool plus the generation of that slot when the handle was made. the generation of a slot changes
+	// every time it is freed, so handles to destroyed resources are detected instead of aliasing a newer resource
+	template<typename tag>
+	struct handle
+	{
+		uint32_t	index{ UINT32_MAX };
+		uint32_t	generation{ 0 };
+
+		// non-null, the resource may still have been destroyed since, see resources::is_alive
+		[[nodiscard]] bool is_valid() const { return index != UINT32_MAX; }
+		bool operator==(const handle& other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(const handle& other) const { return !(*this == other); }
+	};
+
+	using buffer_handle = handle<struct buffer_tag>;
+	using image_handle = handle<struct image_tag>;
+	using sampler_handle = handle<struct sampler_tag>;
+	using pipeline_handle = handle<struct pipeline_tag>;
+
+	struct statistics
+	{
+		uint32_t	buffers{ 0 };
+		uint32_t	images{ 0 };
+		uint32_t	samplers{ 0 };
+		uint32_t	pipelines{ 0 };
+		uint32_t	deferred{ 0 };			// destroyed, waiting for the frames that may still use them
+		uint64_t	stale_lookups{ 0 };		// lookups with a handle whose resource was already destroyed
+	};
+
+	// called by core::init and core::shutdown, shutdown destroys everything still alive
+	bool init();
+	void shutdown();
+
+	// destroys what was released max_current_frames ago, called by core::begin_frame once the frame fence has signaled
+	void begin_frame(uint32_t frame_index);
+
+	// every function below is thread safe. lookups take a shared lock and may run concurrently with each other.
+	// destroy only invalidates the handle right away, the vulkan objects live on until no frame in flight can use them.
+	// movable resources get transfer usage added and may be moved to other memory by relocate: the gpu must only read
+	// them after their upload, and movable images must be in the layout they were created with by then
+	buffer_handle create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool movable = false);
+	// view_aspect 0 creates no view, otherwise a view of every mip of the first layer. movable images are exclusive or
+	// shared by at most two queue families. general layout images are copied while other queues may still read them
+	image_handle create_image(const VkImageCreateInfo& info, VkMemoryPropertyFlags properties, VkImageAspectFlags view_aspect,
+							  bool movable = false, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, bool pinned = false);
+	sampler_handle create_sampler(const VkSamplerCreateInfo& info);
+	// takes ownership of the pipeline, the layout is only referenced since layouts are usually shared
+	pipeline_handle add_pipeline(VkPipeline pipeline, VkPipelineLayout layout, VkPipelineBindPoint bind_point);
+
+	void destroy(buffer_handle handle);
+	void destroy(image_handle handle);
+	void destroy(sampler_handle handle);
+	void destroy(pipeline_handle handle);
+
+	bool is_alive(buffer_handle handle);
+	bool is_alive(image_handle handle);
+	bool is_alive(sampler_handle handle);
+	bool is_alive(pipeline_handle handle);
+
+	// null handles, or VK_NULL_HANDLE and null pointers, for stale handles
+	VkBuffer get_buffer(buffer_handle handle);
+	VkDeviceSize get_buffer_size(buffer_handle handle);
+	void* get_buffer_mapped(buffer_handle handle);
+	VkImage get_image(image_handle handle);
+	VkImageView get_image_view(image_handle handle);
+	VkFormat get_image_format(image_handle handle);
+	VkExtent3D get_image_extent(image_handle handle);
+	VkDeviceSize get_image_size(image_handle handle);
+	VkSampler get_sampler(sampler_handle handle);
+	VkPipeline get_pipeline(pipeline_handle handle);
+	VkPipelineLayout get_pipeline_layout(pipeline_handle handle);
+	VkPipelineBindPoint get_pipeline_bind_point(pipeline_handle handle);
+
+	bool is_movable(buffer_handle handle);
+	bool is_movable(image_handle handle);
+	// pinned images are left where they are until unpinned, for while another queue writes or copies them
+	void pin(image_handle handle, bool pinned);
+	// changes every time relocate moves the resource, descriptors holding its buffer or view have to be rewritten then.
+	// the old objects stay valid for the frames already recorded
+	uint32_t get_version(buffer_handle handle);
+	uint32_t get_version(image_handle handle);
+
+	// records copies of the movable resources into freshly allocated memory and swaps them in, returns the bytes copied.
+	// record it outside of a render pass before anything this frame looks the resources up. stale and fixed handles are
+	// skipped, the old memory is released max_current_frames later
+	VkDeviceSize relocate(VkCommandBuffer command_buffer, const std::vector<buffer_handle>& buffers, const std::vector<image_handle>& images);
+
+	// walks the densely packed pool in storage order under a shared lock, the callback must not create or destroy
+	void for_each_buffer(const std::function<void(buffer_handle, const memory::buffer&)>& callback);
+	void for_each_image(const std::function<void(image_handle, const memory::image&)>& callback);
+
+	statistics get_statistics();
+}
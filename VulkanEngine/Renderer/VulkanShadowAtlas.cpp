@@ -0,0 +1,485 @@
+#include "VulkanShadowAtlas.h"
+#include "VulkanAllocator.h"
+#include "VulkanCore.h"
+#include "VulkanHelpers.h"
+#include "VulkanMemory.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <glm/geometric.hpp>
+
+namespace renderer::vulkan::shadow_atlas
+{
+	namespace
+	{
+		struct shadow
+		{
+			bool					active{ false };
+			glm::mat4				view_projection{ 1.f };
+			glm::vec3				light_position{};
+			float					light_range{ 0.f };
+			bool					has_dynamic_casters{ false };
+			bool					had_dynamic_casters{ false };	// the atlas tile still holds last frame's dynamic depth
+			bool					static_dirty{ true };
+			uint32_t				desired_size{ 0 };
+			uint32_t				requested_size{ 0 };	// desired size the tile was allocated for, larger than the tile when the atlas was full
+			geometry::shadows::atlas_tile	tile{};
+		};
+
+		// depth target plus the frame buffer used to render into it
+		struct depth_target
+		{
+			memory::image	image{};
+			VkImageView		view{ VK_NULL_HANDLE };
+			VkFramebuffer	frame_buffer{ VK_NULL_HANDLE };
+		};
+
+		settings							atlas_settings{};
+		geometry::shadows::quadtree_atlas	quadtree{};
+		std::vector<shadow>					shadows{};
+		std::vector<uint32_t>				free_ids{};
+		VkFormat							depth_format{ VK_FORMAT_UNDEFINED };
+		VkImageAspectFlags					barrier_aspect{ 0 };
+		VkRenderPass						render_pass{ VK_NULL_HANDLE };
+		depth_target						static_cache{};		// static casters only, rests in TRANSFER_SRC_OPTIMAL
+		depth_target						atlas{};			// static plus dynamic, rests in SHADER_READ_ONLY_OPTIMAL
+		statistics							frame_statistics{};
+
+		// scratch reused by record
+		std::vector<uint32_t>				static_list{};
+		std::vector<uint32_t>				composite_list{};
+		std::vector<VkImageCopy>			copies{};
+
+		VkFormat select_depth_format()
+		{
+			// same candidates the swap chain depth buffer is picked from, the atlas is also sampled
+			try
+			{
+				return vkh::find_supported_format(core::get_physical_device(), { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+												  VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+			}
+			catch (const std::runtime_error&)
+			{
+				return VK_FORMAT_UNDEFINED;
+			}
+		}
+
+		bool create_render_pass()
+		{
+			// tiles are cleared individually with vkCmdClearAttachments, the rest of the atlas has to survive the pass
+			VkAttachmentDescription attachment{};
+			attachment.format = depth_format;
+			attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+			VkAttachmentReference depth_reference{ 0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+			VkSubpassDescription subpass{};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.pDepthStencilAttachment = &depth_reference;
+
+			VkRenderPassCreateInfo info{};
+			info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			info.attachmentCount = 1;
+			info.pAttachments = &attachment;
+			info.subpassCount = 1;
+			info.pSubpasses = &subpass;
+			VKCALL(vkCreateRenderPass(core::get_logical_device(), &info, allocator::get_callbacks(allocator::object_type::pipeline), &render_pass),
+				   "failed to create shadow atlas render pass");
+			return render_pass != VK_NULL_HANDLE;
+		}
+
+		bool create_target(VkImageUsageFlags usage, depth_target& out_target)
+		{
+			VkDevice device{ core::get_logical_device() };
+			const uint32_t size{ atlas_settings.atlas_size };
+
+			VkImageCreateInfo image_info = vkh::image_2d(depth_format, size, size, 1, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | usage);
+			if (!memory::create_image(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, out_target.image))
+				return false;
+
+			VkImageViewCreateInfo view_info = vkh::image_view_2d(out_target.image.image, depth_format, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+			VKCALL(vkCreateImageView(device, &view_info, allocator::get_callbacks(allocator::object_type::memory), &out_target.view),
+				   "failed to create shadow atlas view");
+
+			VkFramebufferCreateInfo frame_buffer_info{};
+			frame_buffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			frame_buffer_info.renderPass = render_pass;
+			frame_buffer_info.attachmentCount = 1;
+			frame_buffer_info.pAttachments = &out_target.view;
+			frame_buffer_info.width = size;
+			frame_buffer_info.height = size;
+			frame_buffer_info.layers = 1;
+			VKCALL(vkCreateFramebuffer(device, &frame_buffer_info, allocator::get_callbacks(allocator::object_type::other), &out_target.frame_buffer),
+				   "failed to create shadow atlas frame buffer");
+
+			return out_target.view && out_target.frame_buffer;
+		}
+
+		void destroy_target(depth_target& target)
+		{
+			VkDevice device{ core::get_logical_device() };
+			if (target.frame_buffer)
+				vkDestroyFramebuffer(device, target.frame_buffer, allocator::get_callbacks(allocator::object_type::other));
+			if (target.view)
+				vkDestroyImageView(device, target.view, allocator::get_callbacks(allocator::object_type::memory));
+			memory::destroy_image(target.image);
+			target = {};
+		}
+
+		void transition(VkCommandBuffer command_buffer, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout,
+						VkAccessFlags src_access, VkAccessFlags dst_access, VkPipelineStageFlags src_stages, VkPipelineStageFlags dst_stages)
+		{
+			VkImageMemoryBarrier barrier = vkh::image_memory_barrier(image, old_layout, new_layout, src_access, dst_access, barrier_aspect, 0, 1);
+			vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+
+		shadow_view make_view(uint32_t id)
+		{
+			const shadow& s{ shadows[id] };
+			const float inverse_size{ 1.f / (float)atlas_settings.atlas_size };
+
+			shadow_view view{};
+			view.id = id;
+			view.view_projection = s.view_projection;
+			view.rect = vkh::rect_2d(s.tile.size, s.tile.size, s.tile.x, s.tile.y);
+			view.uv_rect = glm::vec4{ s.tile.x * inverse_size, s.tile.y * inverse_size, s.tile.size * inverse_size, s.tile.size * inverse_size };
+			return view;
+		}
+
+		// clears (static pass only) and draws every listed tile inside one render pass
+		void render_tiles(VkCommandBuffer command_buffer, const depth_target& target, const std::vector<uint32_t>& ids, bool clear,
+						  const draw_callback& draw)
+		{
+			VkRenderPassBeginInfo begin_info{};
+			begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			begin_info.renderPass = render_pass;
+			begin_info.framebuffer = target.frame_buffer;
+			begin_info.renderArea = vkh::rect_2d(atlas_settings.atlas_size, atlas_settings.atlas_size, 0, 0);
+			vkCmdBeginRenderPass(command_buffer, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+
+			for (uint32_t id : ids)
+			{
+				const shadow_view view{ make_view(id) };
+				if (clear)
+				{
+					VkClearAttachment attachment{};
+					attachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+					attachment.clearValue.depthStencil = { 1.f, 0 };
+					VkClearRect clear_rect{ view.rect, 0, 1 };
+					vkCmdClearAttachments(command_buffer, 1, &attachment, 1, &clear_rect);
+				}
+
+				VkViewport viewport = vkh::viewport((float)view.rect.extent.width, (float)view.rect.extent.height, 0.f, 1.f);
+				viewport.x = (float)view.rect.offset.x;
+				viewport.y = (float)view.rect.offset.y;
+				vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+				vkCmdSetScissor(command_buffer, 0, 1, &view.rect);
+
+				if (draw)
+					draw(command_buffer, view);
+			}
+
+			vkCmdEndRenderPass(command_buffer);
+		}
+
+	} // anonymous namespace
+
+	bool init(const settings& settings)
+	{
+		assert(settings.min_tile_size <= settings.max_tile_size && settings.max_tile_size <= settings.atlas_size);
+		atlas_settings = settings;
+
+		depth_format = select_depth_format();
+		if (depth_format == VK_FORMAT_UNDEFINED)
+		{
+			std::cout << "shadow atlas: no sampleable depth format!\n";
+			return false;
+		}
+
+		barrier_aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+		if (depth_format == VK_FORMAT_D32_SFLOAT_S8_UINT || depth_format == VK_FORMAT_D24_UNORM_S8_UINT)
+			barrier_aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+		if (!create_render_pass() ||
+			!create_target(VK_IMAGE_USAGE_TRANSFER_SRC_BIT, static_cache) ||
+			!create_target(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, atlas))
+			return false;
+
+		quadtree.init(settings.atlas_size, settings.min_tile_size);
+
+		// put both images into their resting layouts, every tile is cleared before its first use
+		VkCommandBuffer command_buffer{ core::begin_single_time_commands() };
+		transition(command_buffer, static_cache.image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				   0, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+		transition(command_buffer, atlas.image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				   0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+		core::end_single_time_commands(command_buffer);
+		return true;
+	}
+
+	void shutdown()
+	{
+		vkDeviceWaitIdle(core::get_logical_device());
+		destroy_target(atlas);
+		destroy_target(static_cache);
+		if (render_pass)
+			vkDestroyRenderPass(core::get_logical_device(), render_pass, allocator::get_callbacks(allocator::object_type::pipeline));
+
+		render_pass = VK_NULL_HANDLE;
+		depth_format = VK_FORMAT_UNDEFINED;
+		shadows.clear();
+		free_ids.clear();
+		frame_statistics = {};
+	}
+
+	uint32_t add_shadow()
+	{
+		uint32_t id{ (uint32_t)shadows.size() };
+		if (!free_ids.empty())
+		{
+			id = free_ids.back();
+			free_ids.pop_back();
+		}
+		else
+		{
+			shadows.emplace_back();
+		}
+
+		shadows[id] = {};
+		shadows[id].active = true;
+		return id;
+	}
+
+	void remove_shadow(uint32_t id)
+	{
+		assert(id < shadows.size() && shadows[id].active);
+		quadtree.free(shadows[id].tile);
+		shadows[id] = {};
+		free_ids.push_back(id);
+	}
+
+	void update_shadow(uint32_t id, const glm::mat4& view_projection, const glm::vec3& light_position, float light_range, bool has_dynamic_casters)
+	{
+		assert(id < shadows.size() && shadows[id].active);
+		shadow& s{ shadows[id] };
+		if (memcmp(&s.view_projection, &view_projection, sizeof(glm::mat4)))
+			s.static_dirty = true;
+
+		s.view_projection = view_projection;
+		s.light_position = light_position;
+		s.light_range = light_range;
+		s.has_dynamic_casters = has_dynamic_casters;
+	}
+
+	void invalidate_static(const glm::vec3& center, float radius)
+	{
+		for (shadow& s : shadows)
+		{
+			if (s.active && glm::length(s.light_position - center) < s.light_range + radius)
+				s.static_dirty = true;
+		}
+	}
+
+	void invalidate_all()
+	{
+		for (shadow& s : shadows)
+			s.static_dirty = true;
+	}
+
+	void update_tiles(const glm::vec3& camera_position, float projection_scale)
+	{
+		std::vector<uint32_t>& pending{ static_list };
+		pending.clear();
+		frame_statistics.failed_allocations = 0;
+
+		for (uint32_t id{ 0 }; id < (uint32_t)shadows.size(); ++id)
+		{
+			shadow& s{ shadows[id] };
+			if (!s.active)
+				continue;
+
+			const float distance{ glm::length(s.light_position - camera_position) };
+			const float fraction{ geometry::shadows::get_screen_fraction(s.light_range, distance, projection_scale) };
+			s.desired_size = geometry::shadows::get_tile_size(fraction, atlas_settings.min_tile_size, atlas_settings.max_tile_size);
+
+			// a single step either way is not worth re-rendering the cached depth, it also stops tiles from flipping
+			// between two sizes while a light sits on the boundary. compared against the requested size so a smaller
+			// tile handed out by the fallback below is kept until a larger one can actually be allocated
+			const uint32_t requested{ s.requested_size };
+			if (s.tile.is_valid() && (s.desired_size == requested || s.desired_size * 2 == requested || s.desired_size == requested * 2))
+				continue;
+
+			quadtree.free(s.tile);
+			s.tile = {};
+			pending.push_back(id);
+		}
+
+		// largest first packs the quadtree tighter
+		std::sort(pending.begin(), pending.end(), [](uint32_t a, uint32_t b) { return shadows[a].desired_size > shadows[b].desired_size; });
+
+		for (uint32_t id : pending)
+		{
+			shadow& s{ shadows[id] };
+			for (uint32_t size{ s.desired_size }; size >= atlas_settings.min_tile_size && !s.tile.is_valid(); size /= 2)
+				s.tile = quadtree.allocate(size);
+
+			if (!s.tile.is_valid())
+			{
+				++frame_statistics.failed_allocations;
+				continue;
+			}
+
+			s.requested_size = s.desired_size;
+			s.static_dirty = true;
+		}
+
+		// fallback tiles grow once space frees up, the old tile is only given back when the larger one succeeded
+		for (shadow& s : shadows)
+		{
+			if (!s.active || !s.tile.is_valid() || s.tile.size >= s.requested_size)
+				continue;
+
+			geometry::shadows::atlas_tile larger{};
+			for (uint32_t size{ s.desired_size }; size > s.tile.size && !larger.is_valid(); size /= 2)
+				larger = quadtree.allocate(size);
+
+			if (!larger.is_valid())
+				continue;
+
+			quadtree.free(s.tile);
+			s.tile = larger;
+			s.requested_size = s.desired_size;
+			s.static_dirty = true;
+		}
+	}
+
+	void record(VkCommandBuffer command_buffer, const draw_callback& draw_static, const draw_callback& draw_dynamic)
+	{
+		static_list.clear();
+		composite_list.clear();
+		copies.clear();
+
+		uint32_t shadow_count{ 0 };
+		uint32_t tile_count{ 0 };
+		uint32_t dynamic_count{ 0 };
+		for (uint32_t id{ 0 }; id < (uint32_t)shadows.size(); ++id)
+		{
+			shadow& s{ shadows[id] };
+			shadow_count += s.active;
+			if (!s.active || !s.tile.is_valid())
+				continue;
+
+			++tile_count;
+			if (s.static_dirty)
+				static_list.push_back(id);
+
+			// the atlas tile must be rebuilt when its static depth changed or dynamic casters were or are drawn into it
+			if (s.static_dirty || s.has_dynamic_casters || s.had_dynamic_casters)
+			{
+				composite_list.push_back(id);
+				dynamic_count += s.has_dynamic_casters;
+
+				VkImageCopy copy{};
+				copy.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 };
+				copy.dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 };
+				copy.srcOffset = { (int32_t)s.tile.x, (int32_t)s.tile.y, 0 };
+				copy.dstOffset = copy.srcOffset;
+				copy.extent = { s.tile.size, s.tile.size, 1 };
+				copies.push_back(copy);
+			}
+		}
+
+		constexpr VkPipelineStageFlags depth_stages{ VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT };
+		constexpr VkAccessFlags depth_access{ VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+
+		if (!static_list.empty())
+		{
+			transition(command_buffer, static_cache.image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+					   VK_ACCESS_TRANSFER_READ_BIT, depth_access, VK_PIPELINE_STAGE_TRANSFER_BIT, depth_stages);
+			render_tiles(command_buffer, static_cache, static_list, true, draw_static);
+			transition(command_buffer, static_cache.image.image, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, depth_stages, VK_PIPELINE_STAGE_TRANSFER_BIT);
+		}
+
+		if (!composite_list.empty())
+		{
+			transition(command_buffer, atlas.image.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					   VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+			vkCmdCopyImage(command_buffer, static_cache.image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, atlas.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+						   (uint32_t)copies.size(), copies.data());
+
+			if (dynamic_count)
+			{
+				// dynamic casters test against and write over the copied static depth
+				std::vector<uint32_t>& dynamic_list{ static_list };
+				dynamic_list.clear();
+				for (uint32_t id : composite_list)
+				{
+					if (shadows[id].has_dynamic_casters)
+						dynamic_list.push_back(id);
+				}
+
+				transition(command_buffer, atlas.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+						   VK_ACCESS_TRANSFER_WRITE_BIT, depth_access, VK_PIPELINE_STAGE_TRANSFER_BIT, depth_stages);
+				render_tiles(command_buffer, atlas, dynamic_list, false, draw_dynamic);
+				transition(command_buffer, atlas.image.image, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+						   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, depth_stages, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+			}
+			else
+			{
+				transition(command_buffer, atlas.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+						   VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+			}
+		}
+
+		frame_statistics.shadows = shadow_count;
+		frame_statistics.tiles = tile_count;
+		frame_statistics.static_renders = 0;
+		frame_statistics.dynamic_renders = dynamic_count;
+		frame_statistics.cached = tile_count - (uint32_t)composite_list.size();
+		frame_statistics.atlas_usage = (float)((double)quadtree.get_used_texels() / ((double)atlas_settings.atlas_size * atlas_settings.atlas_size));
+
+		for (uint32_t id : composite_list)
+		{
+			shadow& s{ shadows[id] };
+			frame_statistics.static_renders += s.static_dirty;
+			s.static_dirty = false;
+			s.had_dynamic_casters = s.has_dynamic_casters;
+		}
+	}
+
+	bool get_shadow_view(uint32_t id, shadow_view& out_view)
+	{
+		if (id >= shadows.size() || !shadows[id].active || !shadows[id].tile.is_valid())
+			return false;
+
+		out_view = make_view(id);
+		return true;
+	}
+
+	VkFormat get_depth_format()
+	{
+		return depth_format;
+	}
+
+	VkRenderPass get_render_pass()
+	{
+		return render_pass;
+	}
+
+	VkImageView get_image_view()
+	{
+		return atlas.view;
+	}
+
+	statistics get_statistics()
+	{
+		return frame_statistics;
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+#include "../Geometry/ShadowAtlas.h"
+
+#include <functional>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace renderer::vulkan::shadow_atlas
+{
+	constexpr uint32_t invalid_id{ UINT32_MAX };
+
+	struct settings
+	{
+		uint32_t	atlas_size{ 4096 };
+		uint32_t	min_tile_size{ 128 };
+		uint32_t	max_tile_size{ 2048 };
+	};
+
+	// one shadow map: a spot light, or one face of a point light
+	struct shadow_view
+	{
+		uint32_t	id{ invalid_id };
+		glm::mat4	view_projection{ 1.f };
+		VkRect2D	rect{};			// viewport and scissor in the atlas
+		glm::vec4	uv_rect{};		// offset xy and scale zw of the tile in atlas uv, for the shading passes
+	};
+
+	struct statistics
+	{
+		uint32_t	shadows{ 0 };
+		uint32_t	tiles{ 0 };
+		uint32_t	static_renders{ 0 };		// tiles whose static caster depth was re-rendered this frame
+		uint32_t	dynamic_renders{ 0 };		// tiles composited with dynamic casters this frame
+		uint32_t	cached{ 0 };				// tiles left untouched this frame
+		uint32_t	failed_allocations{ 0 };	// shadows without a tile because the atlas is full
+		float		atlas_usage{ 0 };			// fraction of the atlas texels in use
+	};
+
+	// draws the casters of one view, the render pass, viewport and scissor are set up. pipelines must be compatible
+	// with get_render_pass() and test and write depth
+	using draw_callback = std::function<void(VkCommandBuffer, const shadow_view&)>;
+
+	// creates the static cache and the atlas the shading passes sample, both atlas_size squared in the depth format
+	bool init(const settings& settings = {});
+	void shutdown();
+
+	uint32_t add_shadow();
+	void remove_shadow(uint32_t id);
+
+	// the static depth is re-rendered when view_projection changes. light_position and light_range bound the caster
+	// volume for tile sizing and static invalidation
+	void update_shadow(uint32_t id, const glm::mat4& view_projection, const glm::vec3& light_position, float light_range, bool has_dynamic_casters);
+
+	// a static caster inside the sphere moved, appeared or disappeared
+	void invalidate_static(const glm::vec3& center, float radius);
+	void invalidate_all();
+
+	// sizes tiles by the screen coverage of each light's volume and repacks the ones whose size changed by more than one step.
+	// projection_scale is projection[1][1]. call once per frame before record
+	void update_tiles(const glm::vec3& camera_position, float projection_scale);
+
+	// records the static refreshes, copies cached static depth into the atlas and draws dynamic casters on top. outside
+	// a render pass, the atlas is left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	void record(VkCommandBuffer command_buffer, const draw_callback& draw_static, const draw_callback& draw_dynamic);
+
+	// false while the shadow has no tile
+	bool get_shadow_view(uint32_t id, shadow_view& out_view);
+
+	VkFormat get_depth_format();
+	VkRenderPass get_render_pass();
+	VkImageView get_image_view();
+	statistics get_statistics();
+}
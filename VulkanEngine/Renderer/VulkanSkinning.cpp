@@ -0,0 +1,303 @@
+#include "VulkanSkinning.h"
+#include "VulkanAllocator.h"
+#include "VulkanCore.h"
+#include "VulkanHelpers.h"
+#include "VulkanMemory.h"
+#include "VulkanPipelines.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace renderer::vulkan::skinning
+{
+	namespace
+	{
+		constexpr uint32_t binding_count{ 4 };
+		constexpr uint32_t vertices_per_group{ 64 };	// local_size_x of the skinning shader
+
+		// matches the push constant block of skinning.comp
+		struct push_constants
+		{
+			uint32_t	palette_base;		// in vec4s from the start of the palette buffer
+			uint32_t	character_base;		// in uvec4s
+			uint32_t	character_count;
+			uint32_t	vertex_count;
+			uint32_t	output_base;		// in vertices
+		};
+
+		// one uvec4 of the character table
+		struct character_entry
+		{
+			uint32_t	input_first;
+			uint32_t	vertex_count;
+			uint32_t	output_first;
+			uint32_t	palette_first;
+		};
+		static_assert(sizeof(character_entry) == 16);
+
+		struct mesh_range
+		{
+			uint32_t	first_vertex{ 0 };
+			uint32_t	vertex_count{ 0 };
+		};
+
+		enum buffer_binding : uint32_t
+		{
+			input_binding,
+			palette_binding,		// palette buffer
+			character_binding,		// palette buffer, after the palettes of the frame slot
+			output_binding,
+		};
+
+		settings									skinning_settings{};
+		statistics									frame_statistics{};
+		std::vector<mesh_range>						meshes{};
+		uint32_t									input_vertex_count{ 0 };
+
+		memory::buffer								input_buffer{};
+		memory::buffer								output_buffer{};
+		// persistently mapped, one region of palettes and character table per frame slot
+		memory::buffer								palette_buffer{};
+		VkDeviceSize								palette_region_size{ 0 };
+		VkDescriptorSetLayout						set_layout{ VK_NULL_HANDLE };
+		VkDescriptorPool							descriptor_pool{ VK_NULL_HANDLE };
+		VkDescriptorSet								descriptor_set{ VK_NULL_HANDLE };
+		VkPipelineLayout							pipeline_layout{ VK_NULL_HANDLE };
+		VkPipeline									pipeline{ VK_NULL_HANDLE };
+
+		// reused between frames
+		std::vector<geometry::skinning::pose>		poses{};
+		std::vector<uint32_t>						palette_offsets{};
+
+		void memory_barrier(VkCommandBuffer command_buffer, VkPipelineStageFlags src_stages, VkAccessFlags src_access,
+							VkPipelineStageFlags dst_stages, VkAccessFlags dst_access)
+		{
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = src_access;
+			barrier.dstAccessMask = dst_access;
+			vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		// like the frame allocator ring, memory the gpu reads directly when there is some, plain host memory otherwise
+		bool create_palette_buffer(VkDeviceSize size)
+		{
+			constexpr VkMemoryPropertyFlags host_flags{ VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+			const bool has_device_local_host_memory{ memory::find_memory_type(UINT32_MAX, host_flags | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != UINT32_MAX };
+			return (has_device_local_host_memory &&
+					memory::create_buffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, host_flags | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, palette_buffer)) ||
+				   memory::create_buffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, host_flags, palette_buffer);
+		}
+
+		bool create_pipeline()
+		{
+			const VkPushConstantRange push_constant_range{ vkh::push_constant_range(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(push_constants)) };
+			VkPipelineLayoutCreateInfo layout_info = vkh::pipeline_layout(1, &set_layout, 1, &push_constant_range);
+			VKCALL(vkCreatePipelineLayout(core::get_logical_device(), &layout_info, allocator::get_callbacks(allocator::object_type::pipeline), &pipeline_layout),
+				   "failed to create skinning pipeline layout");
+			if (!pipeline_layout)
+				return false;
+
+			pipeline = pipelines::create_compute_pipeline(skinning_settings.shader_path, pipeline_layout);
+			return pipeline != VK_NULL_HANDLE;
+		}
+
+	} // anonymous namespace
+
+	bool init(const settings& settings)
+	{
+		assert(settings.max_input_vertices && settings.max_output_vertices && settings.max_joints && settings.max_characters);
+		skinning_settings = settings;
+		frame_statistics = {};
+		VkDevice device{ core::get_logical_device() };
+
+		std::array<VkDescriptorSetLayoutBinding, binding_count> bindings{};
+		for (uint32_t i{ 0 }; i < binding_count; ++i)
+			bindings[i] = vkh::descriptor_set_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, i);
+		VkDescriptorSetLayoutCreateInfo set_layout_info = vkh::descriptor_set_layout(binding_count, bindings.data());
+		VKCALL(vkCreateDescriptorSetLayout(device, &set_layout_info, allocator::get_callbacks(allocator::object_type::descriptor), &set_layout),
+			   "failed to create skinning descriptor set layout");
+
+		VkDescriptorPoolSize pool_size{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, binding_count };
+		VkDescriptorPoolCreateInfo pool_info = vkh::descriptor_pool(1, &pool_size, 1);
+		VKCALL(vkCreateDescriptorPool(device, &pool_info, allocator::get_callbacks(allocator::object_type::descriptor), &descriptor_pool),
+			   "failed to create skinning descriptor pool");
+
+		VkDescriptorSetAllocateInfo alloc_info = vkh::descriptor_set_alloc_info(descriptor_pool, &set_layout, 1);
+		VKCALL(vkAllocateDescriptorSets(device, &alloc_info, &descriptor_set), "failed to allocate skinning descriptor set");
+		if (!set_layout || !descriptor_pool || !descriptor_set)
+			return false;
+
+		// the character table follows the palettes, both are read as vec4s so the region stays 16 byte aligned
+		palette_region_size = (VkDeviceSize)settings.max_joints * sizeof(geometry::skinning::joint_matrix) +
+							  (VkDeviceSize)settings.max_characters * sizeof(character_entry);
+		if (!memory::create_buffer((VkDeviceSize)settings.max_input_vertices * sizeof(geometry::skinning::skinned_vertex),
+								   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, input_buffer) ||
+			!memory::create_buffer((VkDeviceSize)settings.max_output_vertices * core::max_current_frames * sizeof(geometry::vertex),
+								   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, output_buffer) ||
+			!create_palette_buffer(palette_region_size * core::max_current_frames))
+			return false;
+
+		VkDescriptorBufferInfo input_info{ input_buffer.buffer, 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo palette_info{ palette_buffer.buffer, 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo output_info{ output_buffer.buffer, 0, VK_WHOLE_SIZE };
+		const VkWriteDescriptorSet writes[]{
+			vkh::write_descriptor_set(descriptor_set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, input_binding, &input_info),
+			vkh::write_descriptor_set(descriptor_set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, palette_binding, &palette_info),
+			vkh::write_descriptor_set(descriptor_set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, character_binding, &palette_info),
+			vkh::write_descriptor_set(descriptor_set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, output_binding, &output_info)
+		};
+		vkUpdateDescriptorSets(device, binding_count, writes, 0, nullptr);
+
+		if (create_pipeline())
+			frame_statistics.gpu_skinning = true;
+		else
+			std::cout << "skinning: compute shader unavailable, gpu skinning disabled\n";
+
+		return true;
+	}
+
+	void shutdown()
+	{
+		VkDevice device{ core::get_logical_device() };
+		pipelines::destroy_pipeline(pipeline);
+		if (pipeline_layout)
+			vkDestroyPipelineLayout(device, pipeline_layout, allocator::get_callbacks(allocator::object_type::pipeline));
+		if (descriptor_pool)
+			vkDestroyDescriptorPool(device, descriptor_pool, allocator::get_callbacks(allocator::object_type::descriptor));
+		if (set_layout)
+			vkDestroyDescriptorSetLayout(device, set_layout, allocator::get_callbacks(allocator::object_type::descriptor));
+
+		memory::destroy_buffer(input_buffer);
+		memory::destroy_buffer(output_buffer);
+		memory::destroy_buffer(palette_buffer);
+
+		pipeline_layout = VK_NULL_HANDLE;
+		descriptor_pool = VK_NULL_HANDLE;
+		descriptor_set = VK_NULL_HANDLE;
+		set_layout = VK_NULL_HANDLE;
+		palette_region_size = 0;
+		meshes.clear();
+		input_vertex_count = 0;
+		frame_statistics = {};
+	}
+
+	bool is_supported()
+	{
+		return pipeline != VK_NULL_HANDLE;
+	}
+
+	uint32_t add_mesh(const geometry::skinning::skinned_vertex* vertices, uint32_t vertex_count)
+	{
+		assert(input_buffer.buffer && vertices && vertex_count);
+		if (vertex_count > skinning_settings.max_input_vertices - input_vertex_count)
+		{
+			std::cout << "skinning: " << vertex_count << " vertices exceed max_input_vertices!\n";
+			return invalid_mesh;
+		}
+
+		const VkDeviceSize size{ (VkDeviceSize)vertex_count * sizeof(geometry::skinning::skinned_vertex) };
+		memory::buffer staging{};
+		if (!memory::create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging))
+			return invalid_mesh;
+		memcpy(staging.mapped, vertices, size);
+
+		VkCommandBuffer command_buffer{ core::begin_single_time_commands() };
+		const VkBufferCopy region{ 0, (VkDeviceSize)input_vertex_count * sizeof(geometry::skinning::skinned_vertex), size };
+		vkCmdCopyBuffer(command_buffer, staging.buffer, input_buffer.buffer, 1, &region);
+		memory_barrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		core::end_single_time_commands(command_buffer);
+		memory::destroy_buffer(staging);
+
+		meshes.push_back({ input_vertex_count, vertex_count });
+		input_vertex_count += vertex_count;
+		frame_statistics.meshes = (uint32_t)meshes.size();
+		frame_statistics.input_vertices = input_vertex_count;
+		return (uint32_t)meshes.size() - 1;
+	}
+
+	bool skin(VkCommandBuffer command_buffer, const character* characters, uint32_t count, uint32_t* out_first_vertices)
+	{
+		if (!pipeline || !count)
+			return false;
+
+		// characters are packed back to back in the output region of the frame slot, palettes back to back in its palette region
+		const uint32_t frame_index{ core::get_current_command_buffer_index() };
+		const uint32_t output_base{ frame_index * skinning_settings.max_output_vertices };
+		// sizes are checked before anything is written, a failed call leaves out_first_vertices untouched
+		uint64_t vertex_total{ 0 };
+		uint64_t joint_total{ 0 };
+		for (uint32_t i{ 0 }; i < count; ++i)
+		{
+			const character& c{ characters[i] };
+			assert(c.mesh < meshes.size() && c.pose.skeleton && c.pose.local);
+			vertex_total += meshes[c.mesh].vertex_count;
+			joint_total += c.pose.skeleton->joint_count();
+		}
+
+		if (vertex_total > skinning_settings.max_output_vertices || joint_total > skinning_settings.max_joints || count > skinning_settings.max_characters)
+		{
+			std::cout << "skinning: " << count << " characters with " << vertex_total << " vertices and " << joint_total
+					  << " joints exceed max_characters, max_output_vertices or max_joints!\n";
+			return false;
+		}
+
+		const uint32_t vertex_count{ (uint32_t)vertex_total };
+		const uint32_t joint_count{ (uint32_t)joint_total };
+		poses.resize(count);
+		palette_offsets.resize(count);
+		uint32_t first_joint{ 0 };
+		uint32_t first_vertex{ 0 };
+		for (uint32_t i{ 0 }; i < count; ++i)
+		{
+			const character& c{ characters[i] };
+			poses[i] = c.pose;
+			palette_offsets[i] = first_joint;
+			out_first_vertices[i] = output_base + first_vertex;
+			first_vertex += meshes[c.mesh].vertex_count;
+			first_joint += c.pose.skeleton->joint_count();
+		}
+
+		// the fence of the frame slot has signaled, the gpu is done with its region
+		const VkDeviceSize palette_offset{ frame_index * palette_region_size };
+		const VkDeviceSize table_offset{ palette_offset + (VkDeviceSize)skinning_settings.max_joints * sizeof(geometry::skinning::joint_matrix) };
+		uint8_t* region{ static_cast<uint8_t*>(palette_buffer.mapped) };
+
+		character_entry* entries{ reinterpret_cast<character_entry*>(region + table_offset) };
+		for (uint32_t i{ 0 }; i < count; ++i)
+		{
+			const mesh_range& mesh{ meshes[characters[i].mesh] };
+			entries[i] = { mesh.first_vertex, mesh.vertex_count, out_first_vertices[i] - output_base, palette_offsets[i] };
+		}
+
+		const auto start{ std::chrono::steady_clock::now() };
+		geometry::skinning::compute_palettes(poses.data(), count, palette_offsets.data(),
+											 reinterpret_cast<geometry::skinning::joint_matrix*>(region + palette_offset));
+		frame_statistics.palette_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		frame_statistics.characters = count;
+		frame_statistics.skinned_vertices = vertex_count;
+		frame_statistics.joints = joint_count;
+
+		// no barrier in front, the frames still in flight draw from the regions of their own slots
+		const push_constants constants{ (uint32_t)(palette_offset / 16), (uint32_t)(table_offset / 16), count, vertex_count, output_base };
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+		vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &constants);
+		vkCmdDispatch(command_buffer, vkh::dispatch_size(vertex_count, vertices_per_group), 1, 1);
+
+		memory_barrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+					   VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+					   VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+		return true;
+	}
+
+	VkBuffer get_output_buffer()
+	{
+		return output_buffer.buffer;
+	}
+
+	statistics get_statistics()
+	{
+		return frame_statistics;
+	}
+}
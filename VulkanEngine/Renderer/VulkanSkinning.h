@@ -0,0 +1,58 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+#include "../Geometry/Skinning.h"
+
+namespace renderer::vulkan::skinning
+{
+	constexpr uint32_t invalid_mesh{ UINT32_MAX };
+
+	struct settings
+	{
+		uint32_t		max_input_vertices{ 1 << 22 };		// rest pose vertices of every registered mesh
+		// per frame, every frame slot gets an output region and a palette region of its own
+		uint32_t		max_output_vertices{ 1 << 20 };		// skinned vertices of every character
+		uint32_t		max_joints{ 1 << 16 };				// joints of every character
+		uint32_t		max_characters{ 1 << 12 };
+		// spir-v of Shaders/skinning.comp, without it skin fails and geometry::skinning::skin is the fallback
+		std::string		shader_path{ "Shaders/skinning.comp.spv" };
+	};
+
+	struct statistics
+	{
+		uint32_t	meshes{ 0 };
+		uint32_t	input_vertices{ 0 };
+		uint32_t	characters{ 0 };			// last skin call
+		uint32_t	skinned_vertices{ 0 };
+		uint32_t	joints{ 0 };
+		double		palette_ms{ 0 };			// cpu time of the joint palettes, wall clock across the job system
+		bool		gpu_skinning{ false };
+	};
+
+	// one skinned instance of a registered mesh, its pose must stay alive until skin returns
+	struct character
+	{
+		uint32_t						mesh{ invalid_mesh };
+		geometry::skinning::pose		pose{};
+	};
+
+	bool init(const settings& settings = {});
+	void shutdown();
+
+	bool is_supported();
+
+	// appends the rest pose vertices to the shared input buffer and waits for the copy, invalid_mesh when it is full.
+	// indices stay with the caller, skinning keeps the vertex order
+	uint32_t add_mesh(const geometry::skinning::skinned_vertex* vertices, uint32_t vertex_count);
+
+	// computes every character's joint palette on the job system straight into the palette region of the current frame
+	// slot and records a single dispatch that skins all of them into the output region of that slot, followed by a
+	// barrier for vertex input and vertex shader reads. character i starts at out_first_vertices[i] in the output buffer,
+	// every pass of the frame (depth, shadows, main) draws from there instead of skinning again. once per frame, call it
+	// after core::begin_frame: the region is reused max_current_frames frames later, once the frame fence has signaled
+	bool skin(VkCommandBuffer command_buffer, const character* characters, uint32_t count, uint32_t* out_first_vertices);
+
+	// geometry::vertex layout. bind it as the vertex buffer and pass first_vertex as the vertex offset of the draw,
+	// or bind it at first_vertex * sizeof(geometry::vertex)
+	VkBuffer get_output_buffer();
+	statistics get_statistics();
+}
@@ -0,0 +1,605 @@
+#include "VulkanTextureStreaming.h"
+#include "VulkanAllocator.h"
+#include "VulkanCore.h"
+#include "VulkanHelpers.h"
+#include "VulkanMemory.h"
+#include "VulkanResource.h"
+#include "VulkanCapture.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <future>
+#include <memory>
+
+namespace renderer::vulkan::streaming
+{
+	namespace
+	{
+		// keeps every copy region offset valid for block compressed formats
+		constexpr VkDeviceSize staging_alignment{ 16 };
+
+		// command pool, command buffer and fence of one job in flight, only touched by the thread running that job
+		struct upload_context
+		{
+			VkCommandPool		command_pool{ VK_NULL_HANDLE };
+			VkCommandBuffer		command_buffer{ VK_NULL_HANDLE };
+			VkFence				fence{ VK_NULL_HANDLE };
+		};
+
+		struct stream_job
+		{
+			texture_id			id{ invalid_texture };
+			uint32_t			top_mip{ 0 };
+			bool				eviction{ false };
+			texture_source		source{};
+			// the resident image the kept levels are copied from, it starts at source_mip of the source mip chain. both
+			// images stay pinned while the job runs so the defragmenter doesn't move them under the transfer queue
+			resources::image_handle	source_image{};
+			uint32_t			source_mip{ 0 };
+			resources::image_handle	image{};
+			memory::buffer		staging{};
+			upload_context*		context{ nullptr };
+			VkDeviceSize		estimated_bytes{ 0 };
+			std::future<void>	submitted;
+			bool				failed{ false };	// written by the streaming thread before submitted becomes ready
+		};
+
+		struct texture
+		{
+			texture_source		source{};
+			// movable, the defragmenter may relocate it between jobs and bump its version
+			resources::image_handle	image{};
+			VkDeviceSize		resident_bytes{ 0 };
+			uint32_t			resident_mip{ 0 };
+			uint32_t			tail_mip{ 0 };
+			uint32_t			wanted_mip{ 0 };
+			uint32_t			version{ 0 };
+			uint64_t			last_requested_frame{ 0 };
+			bool				job_pending{ false };
+			bool				alive{ false };
+		};
+
+		settings									options{};
+		VkDeviceSize								budget{ 0 };
+		VkDeviceSize								budget_limit{ UINT64_MAX };
+		std::vector<texture>						textures{};
+		// sized once in init, recording threads write it while create_texture grows textures
+		std::unique_ptr<std::atomic<uint32_t>[]>	requested_mips{};
+		std::vector<texture_id>						free_ids{};
+		std::vector<upload_context>					upload_contexts{};
+		std::vector<upload_context*>				free_upload_contexts{};
+		std::vector<std::unique_ptr<stream_job>>	jobs_in_flight{};
+		uint64_t									frame_number{ 0 };
+		statistics									stats{};
+
+		uint32_t mip_dimension(uint32_t size, uint32_t mip)
+		{
+			return std::max(1u, size >> mip);
+		}
+
+		VkDeviceSize get_budget()
+		{
+			return std::min(budget, budget_limit);
+		}
+
+		VkDeviceSize estimate_bytes(const texture_source& source, uint32_t top_mip)
+		{
+			VkDeviceSize size{ 0 };
+			for (uint32_t mip{ top_mip }; mip < source.mip_count; ++mip)
+				size += source.mip_size(mip);
+			return size;
+		}
+
+		void destroy_job_resources(stream_job& job, bool keep_image)
+		{
+			if (keep_image)
+				resources::pin(job.image, false);
+			else if (job.image.is_valid())
+				resources::destroy(job.image);
+
+			memory::destroy_buffer(job.staging);
+			free_upload_contexts.push_back(job.context);
+		}
+
+		bool create_upload_context(upload_context& context)
+		{
+			VkDevice device{ core::get_logical_device() };
+
+			VkCommandPoolCreateInfo pool_info = vkh::command_pool_create_info(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+																			  core::get_transfer_queue_family_index());
+			VKCALL(vkCreateCommandPool(device, &pool_info, allocator::get_callbacks(allocator::object_type::command), &context.command_pool),
+				   "failed to create streaming command pool");
+			if (!context.command_pool)
+				return false;
+
+			VkCommandBufferAllocateInfo alloc_info = vkh::command_buffer_allocate_info(context.command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+			VKCALL(vkAllocateCommandBuffers(device, &alloc_info, &context.command_buffer), "failed to allocate streaming command buffer");
+
+			VkFenceCreateInfo fence_info{};
+			fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			VKCALL(vkCreateFence(device, &fence_info, allocator::get_callbacks(allocator::object_type::sync), &context.fence),
+				   "failed to create streaming fence");
+
+			return context.command_buffer && context.fence;
+		}
+
+		void destroy_upload_context(upload_context& context)
+		{
+			VkDevice device{ core::get_logical_device() };
+			if (context.fence)
+				vkDestroyFence(device, context.fence, allocator::get_callbacks(allocator::object_type::sync));
+			if (context.command_pool)
+				vkDestroyCommandPool(device, context.command_pool, allocator::get_callbacks(allocator::object_type::command));
+			context = {};
+		}
+
+		// runs on a streaming thread: copies the levels both images hold from the resident image, reads only the finer
+		// mips it lacks and submits everything to the transfer queue. an eviction reads nothing
+		bool record_and_submit(stream_job& job)
+		{
+			VkDevice device{ core::get_logical_device() };
+			const texture_source& source{ job.source };
+			const uint32_t level_count{ source.mip_count - job.top_mip };
+			const uint32_t first_kept_mip{ std::max(job.top_mip, job.source_mip) };
+
+			std::vector<VkBufferImageCopy> regions{};
+			VkDeviceSize staging_size{ 0 };
+			for (uint32_t mip{ job.top_mip }; mip < first_kept_mip; ++mip)
+			{
+				VkBufferImageCopy region{};
+				region.bufferOffset = staging_size;
+				region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - job.top_mip, 0, 1 };
+				region.imageExtent = { mip_dimension(source.width, mip), mip_dimension(source.height, mip), 1 };
+				regions.push_back(region);
+
+				staging_size = (staging_size + source.mip_size(mip) + staging_alignment - 1) & ~(staging_alignment - 1);
+			}
+
+			std::vector<VkImageCopy> kept_levels{};
+			for (uint32_t mip{ first_kept_mip }; mip < source.mip_count; ++mip)
+			{
+				VkImageCopy copy{};
+				copy.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - job.source_mip, 0, 1 };
+				copy.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - job.top_mip, 0, 1 };
+				copy.extent = { mip_dimension(source.width, mip), mip_dimension(source.height, mip), 1 };
+				kept_levels.push_back(copy);
+			}
+
+			if (staging_size && !memory::create_buffer(staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+													   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, job.staging))
+				return false;
+
+			for (const VkBufferImageCopy& region : regions)
+			{
+				if (!source.read_mip(job.top_mip + region.imageSubresource.mipLevel, static_cast<uint8_t*>(job.staging.mapped) + region.bufferOffset))
+					return false;
+			}
+
+			// sampled on the graphics queue, written and copied from on the transfer queue
+			const uint32_t queue_families[]{ core::get_graphics_queue_family_index(), core::get_transfer_queue_family_index() };
+			VkImageCreateInfo image_info = vkh::image_2d(source.format, mip_dimension(source.width, job.top_mip),
+														 mip_dimension(source.height, job.top_mip), level_count,
+														 VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+			if (queue_families[0] != queue_families[1])
+			{
+				image_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+				image_info.queueFamilyIndexCount = 2;
+				image_info.pQueueFamilyIndices = queue_families;
+			}
+
+			// pinned from the start, it is unpinned when the job is published
+			job.image = resources::create_image(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT, true,
+												VK_IMAGE_LAYOUT_GENERAL, true);
+			if (!job.image.is_valid())
+				return false;
+			VkImage image{ resources::get_image(job.image) };
+
+			// the context is owned by this job until it retires, a failed job may have left its fence unsignaled
+			VkCommandBuffer command_buffer{ job.context->command_buffer };
+			vkResetFences(device, 1, &job.context->fence);
+			vkResetCommandPool(device, job.context->command_pool, 0);
+
+			VkCommandBufferBeginInfo begin_info = vkh::command_buffer_begin_info();
+			begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			vkBeginCommandBuffer(command_buffer, &begin_info);
+
+			VkImageMemoryBarrier to_transfer = vkh::image_memory_barrier(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+																		 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 0, level_count);
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+								 0, nullptr, 0, nullptr, 1, &to_transfer);
+
+			if (!regions.empty())
+			{
+				vkCmdCopyBufferToImage(command_buffer, job.staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+									   (uint32_t)regions.size(), regions.data());
+				capture::record_upload(job.staging.size);
+			}
+
+			// resident images stay in the general layout, frames in flight keep sampling them while they are copied from
+			if (!kept_levels.empty())
+				vkCmdCopyImage(command_buffer, resources::get_image(job.source_image), VK_IMAGE_LAYOUT_GENERAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+							   (uint32_t)kept_levels.size(), kept_levels.data());
+
+			// the transfer queue can't name fragment shader stages, the fence wait before publishing orders the reads
+			VkImageMemoryBarrier to_shader = vkh::image_memory_barrier(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
+																	   VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_IMAGE_ASPECT_COLOR_BIT, 0, level_count);
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+								 0, nullptr, 0, nullptr, 1, &to_shader);
+
+			vkEndCommandBuffer(command_buffer);
+
+			VkSubmitInfo submit_info{};
+			submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submit_info.commandBufferCount = 1;
+			submit_info.pCommandBuffers = &command_buffer;
+
+			return core::queue_submit(core::get_transfer_queue(), 1, &submit_info, job.context->fence) == VK_SUCCESS;
+		}
+
+		void start_job(texture_id id, uint32_t top_mip, bool eviction)
+		{
+			texture& t{ textures[id] };
+			assert(!t.job_pending);
+
+			auto job = std::make_unique<stream_job>();
+			job->id = id;
+			job->top_mip = top_mip;
+			job->eviction = eviction;
+			job->source = t.source;
+			job->source_image = t.image;
+			job->source_mip = t.image.is_valid() ? t.resident_mip : t.source.mip_count;
+			job->estimated_bytes = estimate_bytes(t.source, top_mip);
+			// max_jobs_in_flight plus the synchronous tail upload of create_texture
+			assert(!free_upload_contexts.empty());
+			job->context = free_upload_contexts.back();
+			free_upload_contexts.pop_back();
+
+			stream_job* job_ptr{ job.get() };
+			if (t.image.is_valid())
+				resources::pin(t.image, true);
+			job->submitted = jobs::submit([job_ptr] { job_ptr->failed = !record_and_submit(*job_ptr); });
+
+			t.job_pending = true;
+			stats.pending_bytes += job->estimated_bytes;
+			jobs_in_flight.push_back(std::move(job));
+		}
+
+		// resources::destroy keeps the image alive for the frames in flight that may still sample it
+		void retire_image(texture& t)
+		{
+			if (t.image.is_valid())
+				resources::destroy(t.image);
+
+			stats.resident_bytes -= t.resident_bytes;
+			t.image = {};
+			t.resident_bytes = 0;
+		}
+
+		// applies a finished job, returns false while the gpu is still copying
+		bool try_complete_job(stream_job& job, bool wait)
+		{
+			if (wait)
+				job.submitted.wait();
+			else if (job.submitted.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready)
+				return false;
+
+			if (!job.failed)
+			{
+				if (wait)
+					vkWaitForFences(core::get_logical_device(), 1, &job.context->fence, VK_TRUE, UINT64_MAX);
+				else if (vkGetFenceStatus(core::get_logical_device(), job.context->fence) != VK_SUCCESS)
+					return false;
+			}
+
+			texture& t{ textures[job.id] };
+			const bool publish{ !job.failed && t.alive };
+			if (publish)
+			{
+				const uint32_t mip_delta{ job.top_mip > t.resident_mip ? job.top_mip - t.resident_mip : t.resident_mip - job.top_mip };
+				if (job.eviction)
+					stats.mips_evicted += mip_delta;
+				else
+					stats.mips_streamed_in += mip_delta;
+
+				// the relocations of the old image are folded in so the version never goes back
+				t.version += resources::get_version(t.image) + 1;
+				retire_image(t);
+				t.image = job.image;
+				t.resident_bytes = resources::get_image_size(t.image);
+				t.resident_mip = job.top_mip;
+
+				stats.resident_bytes += t.resident_bytes;
+				stats.bytes_uploaded += job.staging.size;
+			}
+			else if (job.failed)
+			{
+				std::cout << "failed to stream texture " << job.id << " mip " << job.top_mip << "!\n";
+			}
+
+			stats.pending_bytes -= job.estimated_bytes;
+			t.job_pending = false;
+			// destroy_texture leaves the image the job copied from to here
+			if (!t.alive)
+			{
+				retire_image(t);
+				free_ids.push_back(job.id);
+			}
+			else if (!publish && t.image.is_valid())
+			{
+				resources::pin(t.image, false);
+			}
+
+			destroy_job_resources(job, publish);
+			return true;
+		}
+
+		// schedules eviction jobs until at least required bytes will be freed, least recently requested first.
+		// below_wanted also drops mips that are still requested, one level per texture
+		void evict(VkDeviceSize required, bool below_wanted = false)
+		{
+			std::vector<texture_id> candidates{};
+			for (texture_id id{ 0 }; id < (texture_id)textures.size(); ++id)
+			{
+				const texture& t{ textures[id] };
+				if (t.alive && !t.job_pending && t.resident_mip < t.tail_mip &&
+					(below_wanted || t.resident_mip < t.wanted_mip || t.last_requested_frame + options.eviction_grace_frames < frame_number))
+					candidates.push_back(id);
+			}
+
+			std::sort(candidates.begin(), candidates.end(), [](texture_id a, texture_id b) {
+				return textures[a].last_requested_frame < textures[b].last_requested_frame;
+			});
+
+			VkDeviceSize freed{ 0 };
+			for (texture_id id : candidates)
+			{
+				if (freed >= required || jobs_in_flight.size() >= options.max_jobs_in_flight)
+					break;
+
+				texture& t{ textures[id] };
+				const bool unused{ t.last_requested_frame + options.eviction_grace_frames < frame_number };
+				uint32_t top_mip{ unused ? t.tail_mip : std::min(t.wanted_mip, t.tail_mip) };
+				if (below_wanted)
+					top_mip = std::max(top_mip, t.resident_mip + 1);
+
+				freed += estimate_bytes(t.source, t.resident_mip) - estimate_bytes(t.source, top_mip);
+				start_job(id, top_mip, true);
+			}
+		}
+
+	} // anonymous namespace
+
+	bool init(const settings& init_options)
+	{
+		options = init_options;
+
+		// never plan for more than the device local heap can hold
+		const VkDeviceSize heap_size{ memory::get_device_local_heap_size() };
+		budget = options.budget ? std::min(options.budget, heap_size) : (VkDeviceSize)(heap_size * options.budget_heap_fraction);
+		stats = {};
+		budget_limit = UINT64_MAX;
+		stats.budget = budget;
+		frame_number = 0;
+
+		requested_mips = std::make_unique<std::atomic<uint32_t>[]>(options.max_textures);
+		for (uint32_t i{ 0 }; i < options.max_textures; ++i)
+			requested_mips[i] = no_mip_requested;
+
+		upload_contexts.resize(options.max_jobs_in_flight + 1);
+		for (upload_context& context : upload_contexts)
+		{
+			if (!create_upload_context(context))
+				return false;
+			free_upload_contexts.push_back(&context);
+		}
+
+		return budget > 0;
+	}
+
+	void shutdown()
+	{
+		for (auto& job : jobs_in_flight)
+			try_complete_job(*job, true);
+		jobs_in_flight.clear();
+
+		for (texture_id id{ 0 }; id < (texture_id)textures.size(); ++id)
+		{
+			if (textures[id].alive)
+				destroy_texture(id);
+		}
+
+		textures.clear();
+		free_ids.clear();
+		requested_mips.reset();
+
+		free_upload_contexts.clear();
+		for (upload_context& context : upload_contexts)
+			destroy_upload_context(context);
+		upload_contexts.clear();
+	}
+
+	texture_id create_texture(texture_source source)
+	{
+		assert(source.mip_count && source.mip_size && source.read_mip);
+
+		texture_id id{ invalid_texture };
+		if (!free_ids.empty())
+		{
+			id = free_ids.back();
+			free_ids.pop_back();
+		}
+		else if (textures.size() < options.max_textures)
+		{
+			id = (texture_id)textures.size();
+			textures.emplace_back();
+		}
+		else
+		{
+			std::cout << "texture streaming is out of texture ids, raise settings::max_textures!\n";
+			return invalid_texture;
+		}
+
+		texture& t{ textures[id] };
+		t.source = std::move(source);
+		t.image = {};
+		t.resident_bytes = 0;
+		t.tail_mip = t.source.mip_count - 1;
+		while (t.tail_mip > 0 &&
+			   std::max(mip_dimension(t.source.width, t.tail_mip - 1), mip_dimension(t.source.height, t.tail_mip - 1)) <= options.tail_size)
+			--t.tail_mip;
+		t.resident_mip = t.tail_mip;
+		t.wanted_mip = t.tail_mip;
+		requested_mips[id] = no_mip_requested;
+		t.last_requested_frame = frame_number;
+		t.job_pending = false;
+		t.alive = true;
+		++stats.texture_count;
+
+		// the tail is small, upload it right away so the texture is always valid
+		start_job(id, t.tail_mip, false);
+		auto& job = jobs_in_flight.back();
+		try_complete_job(*job, true);
+		jobs_in_flight.pop_back();
+
+		if (!t.image.is_valid())
+		{
+			destroy_texture(id);
+			return invalid_texture;
+		}
+
+		return id;
+	}
+
+	void destroy_texture(texture_id id)
+	{
+		assert(id < textures.size() && textures[id].alive);
+		texture& t{ textures[id] };
+
+		t.alive = false;
+		t.source = {};
+		--stats.texture_count;
+
+		// a pending job may still copy from the image, the image and the id are released once it retires
+		if (!t.job_pending)
+		{
+			retire_image(t);
+			free_ids.push_back(id);
+		}
+	}
+
+	void request_mip(texture_id id, uint32_t mip)
+	{
+		assert(id < options.max_textures);
+		std::atomic<uint32_t>& requested{ requested_mips[id] };
+
+		uint32_t current{ requested.load(std::memory_order_relaxed) };
+		while (mip < current && !requested.compare_exchange_weak(current, mip, std::memory_order_relaxed)) {}
+	}
+
+	void submit_feedback(const uint32_t* requested_mips, uint32_t count)
+	{
+		count = std::min(count, options.max_textures);
+		for (texture_id id{ 0 }; id < count; ++id)
+		{
+			if (requested_mips[id] != no_mip_requested)
+				request_mip(id, requested_mips[id]);
+		}
+	}
+
+	void update()
+	{
+		++frame_number;
+
+		auto done = std::remove_if(jobs_in_flight.begin(), jobs_in_flight.end(),
+								   [](std::unique_ptr<stream_job>& job) { return try_complete_job(*job, false); });
+		jobs_in_flight.erase(done, jobs_in_flight.end());
+
+		// fold this frame's feedback
+		std::vector<texture_id> stream_in{};
+		for (texture_id id{ 0 }; id < (texture_id)textures.size(); ++id)
+		{
+			texture& t{ textures[id] };
+			if (!t.alive)
+				continue;
+
+			const uint32_t requested{ requested_mips[id].exchange(no_mip_requested, std::memory_order_relaxed) };
+			if (requested != no_mip_requested)
+			{
+				t.wanted_mip = std::min(requested, t.tail_mip);
+				t.last_requested_frame = frame_number;
+			}
+
+			if (!t.job_pending && t.wanted_mip < t.resident_mip)
+				stream_in.push_back(id);
+		}
+
+		// a lowered limit takes back mips that are still wanted, waiting for one round of evictions to land before the next
+		const VkDeviceSize limit{ get_budget() };
+		stats.budget = limit;
+		if (stats.resident_bytes + stats.pending_bytes > limit)
+		{
+			const bool evicting{ std::any_of(jobs_in_flight.begin(), jobs_in_flight.end(),
+											 [](const std::unique_ptr<stream_job>& job) { return job->eviction; }) };
+			if (!evicting)
+				evict(stats.resident_bytes + stats.pending_bytes - limit, true);
+
+			stats.jobs_in_flight = (uint32_t)jobs_in_flight.size();
+			return;
+		}
+
+		// the textures that are the furthest from what is wanted first
+		std::sort(stream_in.begin(), stream_in.end(), [](texture_id a, texture_id b) {
+			return textures[a].resident_mip - textures[a].wanted_mip > textures[b].resident_mip - textures[b].wanted_mip;
+		});
+
+		for (texture_id id : stream_in)
+		{
+			if (jobs_in_flight.size() >= options.max_jobs_in_flight)
+				break;
+
+			// one level at a time, coarse mips arrive first and the budget is checked per level
+			texture& t{ textures[id] };
+			const uint32_t top_mip{ t.resident_mip - 1 };
+			const VkDeviceSize required{ estimate_bytes(t.source, top_mip) };
+
+			if (stats.resident_bytes + stats.pending_bytes + required > limit)
+			{
+				evict(stats.resident_bytes + stats.pending_bytes + required - limit);
+				break;
+			}
+
+			start_job(id, top_mip, false);
+		}
+
+		stats.jobs_in_flight = (uint32_t)jobs_in_flight.size();
+	}
+
+	void set_budget_limit(VkDeviceSize limit)
+	{
+		budget_limit = limit;
+	}
+
+	VkImageView get_view(texture_id id)
+	{
+		assert(id < textures.size());
+		return resources::get_image_view(textures[id].image);
+	}
+
+	uint32_t get_version(texture_id id)
+	{
+		assert(id < textures.size());
+		const texture& t{ textures[id] };
+		return t.version + resources::get_version(t.image);
+	}
+
+	uint32_t get_resident_mip(texture_id id)
+	{
+		assert(id < textures.size());
+		return textures[id].resident_mip;
+	}
+
+	statistics get_statistics()
+	{
+		return stats;
+	}
+}
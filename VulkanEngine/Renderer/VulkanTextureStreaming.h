@@ -0,0 +1,74 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+#include <functional>
+
+namespace renderer::vulkan::streaming
+{
+	using texture_id = uint32_t;
+	constexpr texture_id invalid_texture{ UINT32_MAX };
+	constexpr uint32_t no_mip_requested{ UINT32_MAX };
+
+	// cpu side mip chain, read_mip is called from streaming threads and writes mip_size(mip) tightly packed bytes
+	struct texture_source
+	{
+		VkFormat										format{ VK_FORMAT_UNDEFINED };
+		uint32_t										width{ 0 };
+		uint32_t										height{ 0 };
+		uint32_t										mip_count{ 0 };
+		std::function<VkDeviceSize(uint32_t mip)>		mip_size;
+		std::function<bool(uint32_t mip, void* data)>	read_mip;
+	};
+
+	struct settings
+	{
+		VkDeviceSize	budget{ 0 };					// 0 uses budget_heap_fraction of the largest device local heap
+		float			budget_heap_fraction{ 0.5f };
+		uint32_t		tail_size{ 128 };				// mips of at most this size are always resident
+		uint32_t		max_textures{ 4096 };			// live textures, request_mip needs storage that never moves
+		uint32_t		max_jobs_in_flight{ 4 };
+		uint32_t		eviction_grace_frames{ 30 };	// textures requested more recently are only trimmed to what they request
+	};
+
+	struct statistics
+	{
+		VkDeviceSize	budget{ 0 };				// the configured budget or the limit below it
+		VkDeviceSize	resident_bytes{ 0 };
+		VkDeviceSize	pending_bytes{ 0 };
+		uint32_t		texture_count{ 0 };
+		uint32_t		jobs_in_flight{ 0 };
+		uint64_t		mips_streamed_in{ 0 };
+		uint64_t		mips_evicted{ 0 };
+		uint64_t		bytes_uploaded{ 0 };
+	};
+
+	bool init(const settings& options = {});
+	void shutdown();
+
+	// uploads the mip tail before returning so the texture can be sampled right away, finer mips stream in on request.
+	// create, destroy and update must be called from the same thread.
+	texture_id create_texture(texture_source source);
+	void destroy_texture(texture_id id);
+
+	// finest mip the renderer wants to sample this frame, safe to call from recording threads
+	void request_mip(texture_id id, uint32_t mip);
+	// gpu feedback, one entry per texture id with the finest requested mip or no_mip_requested
+	void submit_feedback(const uint32_t* requested_mips, uint32_t count);
+
+	// once per frame: retires finished uploads, evicts least recently used mips when over budget and schedules new uploads
+	void update();
+
+	// caps the budget below the configured one while device memory runs short, see budget::update. under the cap even
+	// mips that are still requested are evicted, one level at a time. UINT64_MAX lifts it
+	void set_budget_limit(VkDeviceSize limit);
+
+	// the view is replaced whenever the residency changes or the defragmenter moves the image, the version tells when
+	// descriptors have to be rewritten. streamed images stay in VK_IMAGE_LAYOUT_GENERAL so the next residency change can
+	// copy from them while they are sampled
+	VkImageView get_view(texture_id id);
+	uint32_t get_version(texture_id id);
+	// finest resident level of the source mip chain
+	uint32_t get_resident_mip(texture_id id);
+
+	statistics get_statistics();
+}
@@ -0,0 +1,672 @@
+#include "VulkanTextures.h"
+#include "VulkanAllocator.h"
+#include "VulkanCore.h"
+#include "VulkanHelpers.h"
+#include "VulkanCapture.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+
+namespace renderer::vulkan::textures
+{
+	namespace
+	{
+		// every region offset in the staging buffer has to be a multiple of the block size and of 4
+		constexpr VkDeviceSize mip_alignment{ 16 };
+		// beyond any device's maxImageDimension2D, keeps the mip size math far from overflowing
+		constexpr uint32_t max_dimension{ 1 << 16 };
+
+		constexpr uint8_t ktx2_identifier[12]{ 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+		constexpr uint32_t dds_magic{ 0x20534444 }; // "DDS "
+
+		constexpr uint32_t make_fourcc(char a, char b, char c, char d)
+		{
+			return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+		}
+
+		struct ktx2_header
+		{
+			uint8_t		identifier[12];
+			uint32_t	vk_format;
+			uint32_t	type_size;
+			uint32_t	pixel_width;
+			uint32_t	pixel_height;
+			uint32_t	pixel_depth;
+			uint32_t	layer_count;
+			uint32_t	face_count;
+			uint32_t	level_count;
+			uint32_t	supercompression_scheme;
+			uint32_t	dfd_byte_offset;
+			uint32_t	dfd_byte_length;
+			uint32_t	kvd_byte_offset;
+			uint32_t	kvd_byte_length;
+			uint64_t	sgd_byte_offset;
+			uint64_t	sgd_byte_length;
+		};
+
+		struct ktx2_level
+		{
+			uint64_t	byte_offset;
+			uint64_t	byte_length;
+			uint64_t	uncompressed_byte_length;
+		};
+
+		struct dds_pixel_format
+		{
+			uint32_t	size;
+			uint32_t	flags;
+			uint32_t	fourcc;
+			uint32_t	rgb_bit_count;
+			uint32_t	r_mask;
+			uint32_t	g_mask;
+			uint32_t	b_mask;
+			uint32_t	a_mask;
+		};
+
+		struct dds_header
+		{
+			uint32_t			size;
+			uint32_t			flags;
+			uint32_t			height;
+			uint32_t			width;
+			uint32_t			pitch_or_linear_size;
+			uint32_t			depth;
+			uint32_t			mip_map_count;
+			uint32_t			reserved1[11];
+			dds_pixel_format	pixel_format;
+			uint32_t			caps;
+			uint32_t			caps2;
+			uint32_t			caps3;
+			uint32_t			caps4;
+			uint32_t			reserved2;
+		};
+
+		struct dds_header_dx10
+		{
+			uint32_t	dxgi_format;
+			uint32_t	resource_dimension;
+			uint32_t	misc_flag;
+			uint32_t	array_size;
+			uint32_t	misc_flags2;
+		};
+
+		constexpr uint32_t dds_fourcc_flag{ 0x4 };
+		constexpr uint32_t dds_rgb_flag{ 0x40 };
+		constexpr uint32_t dds_caps2_cubemap{ 0x200 };
+		constexpr uint32_t dds_caps2_volume{ 0x200000 };
+
+		VkFormat dxgi_to_vk_format(uint32_t dxgi_format)
+		{
+			switch (dxgi_format)
+			{
+			case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+			case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+			case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+			case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+			case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+			case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+			case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+			case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+			case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+			case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+			case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+			case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+			case 87: return VK_FORMAT_B8G8R8A8_UNORM;
+			case 91: return VK_FORMAT_B8G8R8A8_SRGB;
+			case 95: return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+			case 96: return VK_FORMAT_BC6H_SFLOAT_BLOCK;
+			case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+			case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+			default: return VK_FORMAT_UNDEFINED;
+			}
+		}
+
+		VkFormat dds_legacy_format(const dds_pixel_format& pixel_format)
+		{
+			if (pixel_format.flags & dds_fourcc_flag)
+			{
+				switch (pixel_format.fourcc)
+				{
+				case make_fourcc('D', 'X', 'T', '1'): return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+				case make_fourcc('D', 'X', 'T', '3'): return VK_FORMAT_BC2_UNORM_BLOCK;
+				case make_fourcc('D', 'X', 'T', '5'): return VK_FORMAT_BC3_UNORM_BLOCK;
+				case make_fourcc('A', 'T', 'I', '1'):
+				case make_fourcc('B', 'C', '4', 'U'): return VK_FORMAT_BC4_UNORM_BLOCK;
+				case make_fourcc('A', 'T', 'I', '2'):
+				case make_fourcc('B', 'C', '5', 'U'): return VK_FORMAT_BC5_UNORM_BLOCK;
+				default: return VK_FORMAT_UNDEFINED;
+				}
+			}
+
+			if ((pixel_format.flags & dds_rgb_flag) && pixel_format.rgb_bit_count == 32)
+			{
+				if (pixel_format.r_mask == 0x000000ff && pixel_format.b_mask == 0x00ff0000)
+					return VK_FORMAT_R8G8B8A8_UNORM;
+				if (pixel_format.r_mask == 0x00ff0000 && pixel_format.b_mask == 0x000000ff)
+					return VK_FORMAT_B8G8R8A8_UNORM;
+			}
+
+			return VK_FORMAT_UNDEFINED;
+		}
+
+		bool read_file(const std::string& path, std::vector<uint8_t>& out_bytes)
+		{
+			std::ifstream file{ path, std::ios::binary | std::ios::ate };
+			if (!file)
+			{
+				std::cout << "failed to open " << path << "!\n";
+				return false;
+			}
+
+			out_bytes.resize((size_t)file.tellg());
+			file.seekg(0);
+			file.read(reinterpret_cast<char*>(out_bytes.data()), (std::streamsize)out_bytes.size());
+			return (bool)file;
+		}
+
+		// sets up format, size and mip layout, bytes is sized but not filled. the header is checked against the
+		// available bytes of pixel data in the file first, so a corrupt header can't make it allocate gigabytes
+		bool allocate_texture_data(const std::string& path, VkFormat format, uint32_t width, uint32_t height, uint32_t mip_count,
+								   VkDeviceSize available, texture_data& out_data)
+		{
+			if (get_format_info(format).block_bytes == 0 || width == 0 || height == 0 || width > max_dimension || height > max_dimension)
+			{
+				std::cout << path << " uses an unsupported format or size!\n";
+				return false;
+			}
+
+			mip_count = std::clamp(mip_count, 1u, get_full_mip_count(width, height));
+			VkDeviceSize chain_size{ 0 };
+			for (uint32_t mip{ 0 }; mip < mip_count; ++mip)
+				chain_size += get_mip_size(format, width, height, mip);
+			if (chain_size > available)
+			{
+				std::cout << path << " is truncated!\n";
+				return false;
+			}
+
+			out_data.format = format;
+			out_data.width = width;
+			out_data.height = height;
+			out_data.mip_count = mip_count;
+			out_data.mip_offsets.resize(out_data.mip_count);
+
+			VkDeviceSize size{ 0 };
+			for (uint32_t mip{ 0 }; mip < out_data.mip_count; ++mip)
+			{
+				out_data.mip_offsets[mip] = size;
+				size = (size + get_mip_size(format, width, height, mip) + mip_alignment - 1) & ~(mip_alignment - 1);
+			}
+
+			out_data.bytes.resize(size);
+			return true;
+		}
+
+		bool is_format_enabled(VkFormat format)
+		{
+			const VkPhysicalDeviceFeatures& features{ core::get_enabled_device_features() };
+
+			if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK)
+				return features.textureCompressionBC;
+			if (format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK)
+				return features.textureCompressionETC2;
+			if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK)
+				return features.textureCompressionASTC_LDR;
+			return true;
+		}
+
+	} // anonymous namespace
+
+	format_info get_format_info(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8_UNORM:
+			return { 1, 1, 1, false };
+		case VK_FORMAT_R8G8_UNORM:
+			return { 1, 1, 2, false };
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_UNORM:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+			return { 1, 1, 4, false };
+		case VK_FORMAT_R16G16B16A16_SFLOAT:
+			return { 1, 1, 8, false };
+		case VK_FORMAT_R32G32B32A32_SFLOAT:
+			return { 1, 1, 16, false };
+
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+		case VK_FORMAT_BC4_SNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+			return { 4, 4, 8, true };
+		case VK_FORMAT_BC2_UNORM_BLOCK:
+		case VK_FORMAT_BC2_SRGB_BLOCK:
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC5_SNORM_BLOCK:
+		case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+		case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+			return { 4, 4, 16, true };
+
+		case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:	case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:		return { 4, 4, 16, true };
+		case VK_FORMAT_ASTC_5x4_UNORM_BLOCK:	case VK_FORMAT_ASTC_5x4_SRGB_BLOCK:		return { 5, 4, 16, true };
+		case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:	case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:		return { 5, 5, 16, true };
+		case VK_FORMAT_ASTC_6x5_UNORM_BLOCK:	case VK_FORMAT_ASTC_6x5_SRGB_BLOCK:		return { 6, 5, 16, true };
+		case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:	case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:		return { 6, 6, 16, true };
+		case VK_FORMAT_ASTC_8x5_UNORM_BLOCK:	case VK_FORMAT_ASTC_8x5_SRGB_BLOCK:		return { 8, 5, 16, true };
+		case VK_FORMAT_ASTC_8x6_UNORM_BLOCK:	case VK_FORMAT_ASTC_8x6_SRGB_BLOCK:		return { 8, 6, 16, true };
+		case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:	case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:		return { 8, 8, 16, true };
+		case VK_FORMAT_ASTC_10x5_UNORM_BLOCK:	case VK_FORMAT_ASTC_10x5_SRGB_BLOCK:	return { 10, 5, 16, true };
+		case VK_FORMAT_ASTC_10x6_UNORM_BLOCK:	case VK_FORMAT_ASTC_10x6_SRGB_BLOCK:	return { 10, 6, 16, true };
+		case VK_FORMAT_ASTC_10x8_UNORM_BLOCK:	case VK_FORMAT_ASTC_10x8_SRGB_BLOCK:	return { 10, 8, 16, true };
+		case VK_FORMAT_ASTC_10x10_UNORM_BLOCK:	case VK_FORMAT_ASTC_10x10_SRGB_BLOCK:	return { 10, 10, 16, true };
+		case VK_FORMAT_ASTC_12x10_UNORM_BLOCK:	case VK_FORMAT_ASTC_12x10_SRGB_BLOCK:	return { 12, 10, 16, true };
+		case VK_FORMAT_ASTC_12x12_UNORM_BLOCK:	case VK_FORMAT_ASTC_12x12_SRGB_BLOCK:	return { 12, 12, 16, true };
+
+		default:
+			return {};
+		}
+	}
+
+	VkDeviceSize get_mip_size(VkFormat format, uint32_t width, uint32_t height, uint32_t mip)
+	{
+		const format_info info{ get_format_info(format) };
+		const uint32_t mip_width{ std::max(1u, width >> mip) };
+		const uint32_t mip_height{ std::max(1u, height >> mip) };
+
+		const VkDeviceSize blocks_x{ (mip_width + info.block_width - 1) / info.block_width };
+		const VkDeviceSize blocks_y{ (mip_height + info.block_height - 1) / info.block_height };
+		return blocks_x * blocks_y * info.block_bytes;
+	}
+
+	uint32_t get_full_mip_count(uint32_t width, uint32_t height)
+	{
+		uint32_t mip_count{ 1 };
+		for (uint32_t size{ std::max(width, height) }; size > 1; size >>= 1)
+			++mip_count;
+		return mip_count;
+	}
+
+	VkFormat select_format(const std::vector<VkFormat>& candidates, VkFormatFeatureFlags features)
+	{
+		std::vector<VkFormat> enabled{};
+		for (VkFormat format : candidates)
+		{
+			if (is_format_enabled(format))
+				enabled.push_back(format);
+		}
+
+		if (enabled.empty())
+			return VK_FORMAT_UNDEFINED;
+
+		try
+		{
+			return vkh::find_supported_format(core::get_physical_device(), enabled, VK_IMAGE_TILING_OPTIMAL, features);
+		}
+		catch (const std::runtime_error&)
+		{
+			return VK_FORMAT_UNDEFINED;
+		}
+	}
+
+	VkFormat get_preferred_color_format(bool srgb)
+	{
+		const std::vector<VkFormat> candidates{ srgb ?
+			std::vector<VkFormat>{ VK_FORMAT_BC7_SRGB_BLOCK, VK_FORMAT_ASTC_4x4_SRGB_BLOCK, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK, VK_FORMAT_R8G8B8A8_SRGB } :
+			std::vector<VkFormat>{ VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, VK_FORMAT_R8G8B8A8_UNORM } };
+
+		return select_format(candidates, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+	}
+
+	bool load_ktx2(const std::string& path, texture_data& out_data)
+	{
+		std::vector<uint8_t> file{};
+		if (!read_file(path, file))
+			return false;
+
+		ktx2_header header{};
+		if (file.size() < sizeof(header) || memcmp(file.data(), ktx2_identifier, sizeof(ktx2_identifier)) != 0)
+		{
+			std::cout << path << " is not a ktx2 file!\n";
+			return false;
+		}
+		memcpy(&header, file.data(), sizeof(header));
+
+		// basis universal and zstd payloads need a transcoder, only raw vulkan formats are loaded
+		if (header.supercompression_scheme != 0 || header.vk_format == VK_FORMAT_UNDEFINED)
+		{
+			std::cout << path << " is supercompressed, only raw ktx2 textures are supported!\n";
+			return false;
+		}
+
+		if (header.pixel_depth > 1 || header.layer_count > 1 || header.face_count > 1)
+		{
+			std::cout << path << " is not a 2d texture!\n";
+			return false;
+		}
+
+		// a level count of 0 asks the loader to generate the mips
+		const uint32_t level_count{ std::max(header.level_count, 1u) };
+		if (file.size() < sizeof(header) + (VkDeviceSize)level_count * sizeof(ktx2_level))
+		{
+			std::cout << path << " is truncated!\n";
+			return false;
+		}
+
+		const VkDeviceSize index_end{ sizeof(header) + (VkDeviceSize)level_count * sizeof(ktx2_level) };
+		if (!allocate_texture_data(path, (VkFormat)header.vk_format, header.pixel_width, header.pixel_height, level_count,
+								   file.size() - index_end, out_data))
+			return false;
+
+		for (uint32_t mip{ 0 }; mip < out_data.mip_count; ++mip)
+		{
+			ktx2_level level{};
+			memcpy(&level, file.data() + sizeof(header) + mip * sizeof(ktx2_level), sizeof(level));
+
+			const VkDeviceSize size{ get_mip_size(out_data.format, out_data.width, out_data.height, mip) };
+			if (level.byte_length < size || level.byte_offset > file.size() || size > file.size() - level.byte_offset)
+			{
+				std::cout << path << " is truncated!\n";
+				return false;
+			}
+
+			memcpy(out_data.bytes.data() + out_data.mip_offsets[mip], file.data() + level.byte_offset, size);
+		}
+
+		return true;
+	}
+
+	bool load_dds(const std::string& path, texture_data& out_data)
+	{
+		std::vector<uint8_t> file{};
+		if (!read_file(path, file))
+			return false;
+
+		uint32_t magic{ 0 };
+		dds_header header{};
+		if (file.size() < sizeof(magic) + sizeof(header))
+		{
+			std::cout << path << " is not a dds file!\n";
+			return false;
+		}
+		memcpy(&magic, file.data(), sizeof(magic));
+		memcpy(&header, file.data() + sizeof(magic), sizeof(header));
+		if (magic != dds_magic || header.size != sizeof(dds_header))
+		{
+			std::cout << path << " is not a dds file!\n";
+			return false;
+		}
+
+		if (header.caps2 & (dds_caps2_cubemap | dds_caps2_volume))
+		{
+			std::cout << path << " is not a 2d texture!\n";
+			return false;
+		}
+
+		size_t offset{ sizeof(magic) + sizeof(header) };
+		VkFormat format{ VK_FORMAT_UNDEFINED };
+		if ((header.pixel_format.flags & dds_fourcc_flag) && header.pixel_format.fourcc == make_fourcc('D', 'X', '1', '0'))
+		{
+			dds_header_dx10 header_dx10{};
+			if (file.size() < offset + sizeof(header_dx10))
+			{
+				std::cout << path << " is truncated!\n";
+				return false;
+			}
+			memcpy(&header_dx10, file.data() + offset, sizeof(header_dx10));
+			offset += sizeof(header_dx10);
+
+			if (header_dx10.array_size > 1)
+			{
+				std::cout << path << " is not a 2d texture!\n";
+				return false;
+			}
+
+			format = dxgi_to_vk_format(header_dx10.dxgi_format);
+		}
+		else
+		{
+			format = dds_legacy_format(header.pixel_format);
+		}
+
+		if (!allocate_texture_data(path, format, header.width, header.height, std::max(header.mip_map_count, 1u), file.size() - offset, out_data))
+			return false;
+
+		// mips are stored back to back, finest first
+		for (uint32_t mip{ 0 }; mip < out_data.mip_count; ++mip)
+		{
+			const VkDeviceSize size{ get_mip_size(format, out_data.width, out_data.height, mip) };
+			if (offset > file.size() || size > file.size() - offset)
+			{
+				std::cout << path << " is truncated!\n";
+				return false;
+			}
+
+			memcpy(out_data.bytes.data() + out_data.mip_offsets[mip], file.data() + offset, size);
+			offset += size;
+		}
+
+		return true;
+	}
+
+	bool load_texture_file(const std::string& path, texture_data& out_data)
+	{
+		const size_t dot{ path.find_last_of('.') };
+		std::string extension{ dot == std::string::npos ? "" : path.substr(dot + 1) };
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+		if (extension == "ktx2")
+			return load_ktx2(path, out_data);
+		if (extension == "dds")
+			return load_dds(path, out_data);
+
+		std::cout << path << " has an unsupported texture file extension!\n";
+		return false;
+	}
+
+	bool load_texture_files(const std::vector<std::string>& paths, std::vector<texture_data>& out_data)
+	{
+		out_data.clear();
+		out_data.resize(paths.size());
+		std::atomic<bool> succeeded{ true };
+
+		jobs::parallel_for((uint32_t)paths.size(), [&](uint32_t i) {
+			if (!load_texture_file(paths[i], out_data[i]))
+				succeeded = false;
+		});
+
+		return succeeded;
+	}
+
+	bool create_texture(const texture_data& data, texture& out_texture, bool generate_mips)
+	{
+		assert(!out_texture.image.image);
+		assert(data.mip_count && data.mip_offsets.size() == data.mip_count);
+
+		// mip generation blits with linear filtering, compressed formats can't be blit destinations
+		constexpr VkFormatFeatureFlags blit_features{ VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+													  VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT };
+		const bool wants_mips{ generate_mips && data.mip_count == 1 && !get_format_info(data.format).compressed &&
+							   get_full_mip_count(data.width, data.height) > 1 };
+		const bool can_blit{ wants_mips && select_format({ data.format }, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | blit_features) != VK_FORMAT_UNDEFINED };
+
+		if (select_format({ data.format }, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == VK_FORMAT_UNDEFINED)
+		{
+			std::cout << "texture format " << data.format << " can't be sampled on this device!\n";
+			return false;
+		}
+
+		if (wants_mips && !can_blit)
+			std::cout << "texture format " << data.format << " doesn't support blits, mips won't be generated\n";
+
+		const uint32_t mip_count{ can_blit ? get_full_mip_count(data.width, data.height) : data.mip_count };
+
+		memory::buffer staging{};
+		if (!memory::create_buffer(data.bytes.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+								   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging))
+			return false;
+		memcpy(staging.mapped, data.bytes.data(), data.bytes.size());
+
+		VkImageUsageFlags usage{ VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT };
+		if (can_blit)
+			usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+		VkImageCreateInfo image_info = vkh::image_2d(data.format, data.width, data.height, mip_count, usage);
+		if (!memory::create_image(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, out_texture.image))
+		{
+			memory::destroy_buffer(staging);
+			return false;
+		}
+
+		std::vector<VkBufferImageCopy> regions(data.mip_count);
+		for (uint32_t mip{ 0 }; mip < data.mip_count; ++mip)
+		{
+			regions[mip].bufferOffset = data.mip_offsets[mip];
+			regions[mip].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 1 };
+			regions[mip].imageExtent = { std::max(1u, data.width >> mip), std::max(1u, data.height >> mip), 1 };
+		}
+
+		VkCommandBuffer command_buffer{ core::begin_single_time_commands() };
+
+		VkImageMemoryBarrier to_transfer = vkh::image_memory_barrier(out_texture.image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+																	 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_count);
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+							 0, nullptr, 0, nullptr, 1, &to_transfer);
+
+		vkCmdCopyBufferToImage(command_buffer, staging.buffer, out_texture.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+							   (uint32_t)regions.size(), regions.data());
+		capture::record_upload(data.bytes.size());
+
+		if (can_blit)
+		{
+			generate_mipmaps(command_buffer, out_texture.image.image, data.width, data.height, mip_count);
+		}
+		else
+		{
+			VkImageMemoryBarrier to_shader = vkh::image_memory_barrier(out_texture.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+																	   VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_count);
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+								 0, nullptr, 0, nullptr, 1, &to_shader);
+		}
+
+		core::end_single_time_commands(command_buffer);
+		memory::destroy_buffer(staging);
+
+		VkImageViewCreateInfo view_info = vkh::image_view_2d(out_texture.image.image, data.format, VK_IMAGE_ASPECT_COLOR_BIT, mip_count);
+		VKCALL(vkCreateImageView(core::get_logical_device(), &view_info, allocator::get_callbacks(allocator::object_type::memory), &out_texture.view),
+			   "failed to create texture image view");
+		if (!out_texture.view)
+		{
+			destroy_texture(out_texture);
+			return false;
+		}
+
+		out_texture.format = data.format;
+		out_texture.width = data.width;
+		out_texture.height = data.height;
+		out_texture.mip_count = mip_count;
+		return true;
+	}
+
+	void destroy_texture(texture& texture)
+	{
+		if (texture.view)
+			vkDestroyImageView(core::get_logical_device(), texture.view, allocator::get_callbacks(allocator::object_type::memory));
+		memory::destroy_image(texture.image);
+
+		texture = {};
+	}
+
+	void generate_mipmaps(VkCommandBuffer command_buffer, VkImage image, uint32_t width, uint32_t height, uint32_t mip_count)
+	{
+		int32_t mip_width{ (int32_t)width };
+		int32_t mip_height{ (int32_t)height };
+
+		for (uint32_t mip{ 1 }; mip < mip_count; ++mip)
+		{
+			// the previous level becomes the blit source
+			VkImageMemoryBarrier to_source = vkh::image_memory_barrier(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+																	   VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 1);
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+								 0, nullptr, 0, nullptr, 1, &to_source);
+
+			const int32_t next_width{ std::max(1, mip_width / 2) };
+			const int32_t next_height{ std::max(1, mip_height / 2) };
+
+			VkImageBlit blit{};
+			blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 0, 1 };
+			blit.srcOffsets[1] = { mip_width, mip_height, 1 };
+			blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 1 };
+			blit.dstOffsets[1] = { next_width, next_height, 1 };
+
+			vkCmdBlitImage(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+						   1, &blit, VK_FILTER_LINEAR);
+
+			VkImageMemoryBarrier to_shader = vkh::image_memory_barrier(image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+																	   VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 1);
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+								 0, nullptr, 0, nullptr, 1, &to_shader);
+
+			mip_width = next_width;
+			mip_height = next_height;
+		}
+
+		// the last level was only ever written
+		VkImageMemoryBarrier last_to_shader = vkh::image_memory_barrier(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+																		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_ASPECT_COLOR_BIT, mip_count - 1, 1);
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+							 0, nullptr, 0, nullptr, 1, &last_to_shader);
+	}
+
+	resources::sampler_handle create_sampler(uint32_t mip_count, float max_anisotropy)
+	{
+		VkSamplerCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		info.magFilter = VK_FILTER_LINEAR;
+		info.minFilter = VK_FILTER_LINEAR;
+		info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		info.anisotropyEnable = VK_TRUE;
+		info.maxAnisotropy = std::min(max_anisotropy, core::get_physical_device_properties().limits.maxSamplerAnisotropy);
+		info.compareOp = VK_COMPARE_OP_ALWAYS;
+		info.minLod = 0.f;
+		info.maxLod = (float)mip_count;
+		info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+		return resources::create_sampler(info);
+	}
+
+	streaming::texture_source make_streaming_source(std::shared_ptr<const texture_data> data)
+	{
+		assert(data);
+
+		streaming::texture_source source{};
+		source.format = data->format;
+		source.width = data->width;
+		source.height = data->height;
+		source.mip_count = data->mip_count;
+		source.mip_size = [data](uint32_t mip) { return get_mip_size(data->format, data->width, data->height, mip); };
+		source.read_mip = [data](uint32_t mip, void* out) {
+			memcpy(out, data->bytes.data() + data->mip_offsets[mip], get_mip_size(data->format, data->width, data->height, mip));
+			return true;
+		};
+		return source;
+	}
+}
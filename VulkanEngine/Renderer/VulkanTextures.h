@@ -0,0 +1,73 @@
+#pragma once
+#include "VulkanCommonHeaders.h"
+#include "VulkanMemory.h"
+#include "VulkanResource.h"
+#include "VulkanTextureStreaming.h"
+
+#include <memory>
+#include <string>
+
+namespace renderer::vulkan::textures
+{
+	// size of one block, uncompressed formats use 1x1 blocks. block_bytes is 0 for formats the loader doesn't know
+	struct format_info
+	{
+		uint32_t	block_width{ 1 };
+		uint32_t	block_height{ 1 };
+		uint32_t	block_bytes{ 0 };
+		bool		compressed{ false };
+	};
+
+	// cpu copy of a 2d texture as loaded from disk, mip 0 is the finest
+	struct texture_data
+	{
+		VkFormat					format{ VK_FORMAT_UNDEFINED };
+		uint32_t					width{ 0 };
+		uint32_t					height{ 0 };
+		uint32_t					mip_count{ 0 };
+		std::vector<VkDeviceSize>	mip_offsets;	// into bytes, aligned for vkCmdCopyBufferToImage
+		std::vector<uint8_t>		bytes;
+	};
+
+	struct texture
+	{
+		memory::image	image{};
+		VkImageView		view{ VK_NULL_HANDLE };
+		VkFormat		format{ VK_FORMAT_UNDEFINED };
+		uint32_t		width{ 0 };
+		uint32_t		height{ 0 };
+		uint32_t		mip_count{ 0 };
+	};
+
+	format_info get_format_info(VkFormat format);
+	VkDeviceSize get_mip_size(VkFormat format, uint32_t width, uint32_t height, uint32_t mip);
+	uint32_t get_full_mip_count(uint32_t width, uint32_t height);
+
+	// first candidate the device can use with the given optimal tiling features, VK_FORMAT_UNDEFINED if none.
+	// compressed candidates are skipped unless their texture compression feature is enabled on the device
+	VkFormat select_format(const std::vector<VkFormat>& candidates, VkFormatFeatureFlags features);
+	// best sampled color format for the device (bc7, astc 4x4, etc2 or rgba8), tells asset tools which encoding to load
+	VkFormat get_preferred_color_format(bool srgb);
+
+	// .ktx2 (no supercompression) and .dds (legacy fourcc and dx10 headers), 2d textures only
+	bool load_ktx2(const std::string& path, texture_data& out_data);
+	bool load_dds(const std::string& path, texture_data& out_data);
+	bool load_texture_file(const std::string& path, texture_data& out_data);
+	// decodes every file on the job system, out_data matches paths. false if any file failed
+	bool load_texture_files(const std::vector<std::string>& paths, std::vector<texture_data>& out_data);
+
+	// uploads every mip in data, uncompressed single mip sources get a full mip chain generated on the gpu.
+	// blocks until the upload is finished
+	bool create_texture(const texture_data& data, texture& out_texture, bool generate_mips = true);
+	void destroy_texture(texture& texture);
+
+	// expects mip 0 in TRANSFER_DST_OPTIMAL and the other levels in TRANSFER_DST_OPTIMAL or UNDEFINED,
+	// leaves every level in SHADER_READ_ONLY_OPTIMAL
+	void generate_mipmaps(VkCommandBuffer command_buffer, VkImage image, uint32_t width, uint32_t height, uint32_t mip_count);
+
+	// trilinear, anisotropic and repeating, released with resources::destroy like any other resource sampler
+	resources::sampler_handle create_sampler(uint32_t mip_count, float max_anisotropy = 16.f);
+
+	// lets the streaming system page mips of a loaded texture in and out
+	streaming::texture_source make_streaming_source(std::shared_ptr<const texture_data> data);
+}
@@ -0,0 +1,16 @@
+#version 450
+// compiled with: glslc meshlet.frag -o meshlet.frag.spv
+//
+// fixed directional light, enough to see the clusters the mesh shader path kept
+
+layout(location = 0) in vec3 in_normal;
+layout(location = 1) in vec2 in_uv;
+
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+	const vec3 light_direction = normalize(vec3(0.3, 1.0, 0.5));
+	const float diffuse = max(dot(normalize(in_normal), light_direction), 0.0);
+	out_color = vec4(vec3(0.15 + 0.85 * diffuse), 1.0);
+}
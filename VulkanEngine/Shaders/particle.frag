@@ -0,0 +1,23 @@
+#version 450
+// compiled with: glslc particle.frag -o particle.frag.spv
+//
+// round soft sprite fading out over the particle's lifetime, alpha blended
+
+layout(push_constant) uniform constants
+{
+	mat4	view_projection;
+	vec4	right;
+	vec4	up;
+	vec4	color;
+} pc;
+
+layout(location = 0) in vec2 corner;
+layout(location = 1) in float fade;
+
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+	const float falloff = 1.0 - smoothstep(0.5, 1.0, length(corner));
+	out_color = vec4(pc.color.rgb, pc.color.a * falloff * fade);
+}
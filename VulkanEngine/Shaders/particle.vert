@@ -0,0 +1,40 @@
+#version 450
+// compiled with: glslc particle.vert -o particle.vert.spv
+//
+// camera facing quad per particle, drawn indirectly with six vertices per instance and the instance count written by
+// particle_args.comp. instances go through the sorted draw order, no vertex buffers are bound
+
+struct particle
+{
+	vec3	position;
+	float	age;
+	vec3	velocity;
+	float	lifetime;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer particle_buffer { particle particles[]; };
+layout(std430, set = 0, binding = 5) readonly buffer order_buffer { uint order[]; };
+
+layout(push_constant) uniform constants
+{
+	mat4	view_projection;
+	vec4	right;		// xyz camera right, w half size
+	vec4	up;			// xyz camera up
+	vec4	color;
+} pc;
+
+layout(location = 0) out vec2 out_corner;
+layout(location = 1) out float out_fade;
+
+const vec2 corners[6] = vec2[](vec2(-1, -1), vec2(1, -1), vec2(1, 1), vec2(-1, -1), vec2(1, 1), vec2(-1, 1));
+
+void main()
+{
+	const particle p = particles[order[gl_InstanceIndex]];
+	const vec2 corner = corners[gl_VertexIndex];
+	const vec3 position = p.position + (pc.right.xyz * corner.x + pc.up.xyz * corner.y) * pc.right.w;
+
+	gl_Position = pc.view_projection * vec4(position, 1.0);
+	out_corner = corner;
+	out_fade = 1.0 - clamp(p.age / p.lifetime, 0.0, 1.0);
+}
@@ -0,0 +1,181 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace renderer::jobs
+{
+	namespace
+	{
+		class job_pool
+		{
+		public:
+			void start(uint32_t worker_count)
+			{
+				assert(_workers.empty());
+				_stop = false;
+				for (uint32_t i{ 0 }; i < worker_count; ++i)
+					_workers.emplace_back([this] { worker_loop(); });
+			}
+
+			void stop()
+			{
+				{
+					std::lock_guard lock{ _mutex };
+					_stop = true;
+				}
+				_condition.notify_all();
+
+				for (auto& worker : _workers)
+					worker.join();
+
+				_workers.clear();
+				_queue.clear();
+			}
+
+			void push(std::function<void()> job)
+			{
+				{
+					std::lock_guard lock{ _mutex };
+					_queue.push_back(std::move(job));
+				}
+				_condition.notify_one();
+			}
+
+			[[nodiscard]] uint32_t size() const { return (uint32_t)_workers.size(); }
+
+		private:
+			void worker_loop()
+			{
+				while (true)
+				{
+					std::function<void()> job;
+					{
+						std::unique_lock lock{ _mutex };
+						_condition.wait(lock, [this] { return _stop || !_queue.empty(); });
+						if (_stop && _queue.empty())
+							return;
+
+						job = std::move(_queue.front());
+						_queue.pop_front();
+					}
+					job();
+				}
+			}
+
+			std::vector<std::thread>			_workers;
+			std::deque<std::function<void()>>	_queue;
+			std::mutex							_mutex;
+			std::condition_variable				_condition;
+			bool								_stop{ false };
+		};
+
+		job_pool		pool{};
+		std::once_flag	init_flag;
+
+		job_pool& get_pool()
+		{
+			// lazily start with default settings if nobody called init()
+			std::call_once(init_flag, [] { pool.start(std::max(1u, std::thread::hardware_concurrency()) - 1); });
+			return pool;
+		}
+
+		// shared between the caller and the helper jobs of a single parallel_for
+		struct parallel_for_state
+		{
+			std::atomic<uint32_t>		next_index{ 0 };
+			std::atomic<uint32_t>		completed{ 0 };
+			std::mutex					mutex;
+			std::condition_variable		done;
+		};
+
+		void run_chunks(parallel_for_state& state, uint32_t count, uint32_t grain_size, const std::function<void(uint32_t)>& job)
+		{
+			while (true)
+			{
+				const uint32_t begin{ state.next_index.fetch_add(grain_size) };
+				if (begin >= count)
+					return;
+
+				const uint32_t end{ std::min(begin + grain_size, count) };
+				for (uint32_t i{ begin }; i < end; ++i)
+					job(i);
+
+				if (state.completed.fetch_add(end - begin) + (end - begin) == count)
+				{
+					std::lock_guard lock{ state.mutex };
+					state.done.notify_all();
+				}
+			}
+		}
+
+	} // anonymous namespace
+
+	void init(uint32_t worker_count)
+	{
+		std::call_once(init_flag, [worker_count] {
+			pool.start(worker_count ? worker_count : std::max(1u, std::thread::hardware_concurrency()) - 1);
+		});
+	}
+
+	void shutdown()
+	{
+		pool.stop();
+	}
+
+	uint32_t get_worker_count()
+	{
+		return get_pool().size();
+	}
+
+	std::future<void> submit(std::function<void()> job)
+	{
+		auto task = std::make_shared<std::packaged_task<void()>>(std::move(job));
+		std::future<void> result{ task->get_future() };
+
+		job_pool& jp{ get_pool() };
+		if (!jp.size())
+		{
+			(*task)();
+			return result;
+		}
+
+		jp.push([task] { (*task)(); });
+		return result;
+	}
+
+	void parallel_for(uint32_t count, const std::function<void(uint32_t)>& job, uint32_t grain_size)
+	{
+		if (!count)
+			return;
+
+		grain_size = std::max(1u, grain_size);
+		const uint32_t chunk_count{ (count + grain_size - 1) / grain_size };
+		job_pool& jp{ get_pool() };
+
+		if (chunk_count == 1 || !jp.size())
+		{
+			for (uint32_t i{ 0 }; i < count; ++i)
+				job(i);
+			return;
+		}
+
+		// helpers hold a reference to the state, it must outlive every helper that might still pick it up
+		auto state = std::make_shared<parallel_for_state>();
+		const uint32_t helper_count{ std::min(jp.size(), chunk_count - 1) };
+		for (uint32_t i{ 0 }; i < helper_count; ++i)
+			jp.push([state, count, grain_size, &job] { run_chunks(*state, count, grain_size, job); });
+
+		run_chunks(*state, count, grain_size, job);
+
+		std::unique_lock lock{ state->mutex };
+		state->done.wait(lock, [&] { return state->completed.load() == count; });
+	}
+}
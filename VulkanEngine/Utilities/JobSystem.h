@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <future>
+
+namespace renderer::jobs
+{
+	// worker_count of 0 uses hardware_concurrency - 1 workers (the calling thread also executes work)
+	void init(uint32_t worker_count = 0);
+	void shutdown();
+
+	uint32_t get_worker_count();
+
+	std::future<void> submit(std::function<void()> job);
+
+	// runs job(i) for i in [0, count), the calling thread participates and returns once every index has completed.
+	// safe to call from inside another job.
+	void parallel_for(uint32_t count, const std::function<void(uint32_t)>& job, uint32_t grain_size = 1);
+}
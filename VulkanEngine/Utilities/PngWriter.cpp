@@ -0,0 +1,180 @@
+#include "PngWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace renderer::png
+{
+	namespace
+	{
+		constexpr uint8_t	signature[]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+		constexpr size_t	max_stored_block{ 65535 };
+
+		const std::array<uint32_t, 256> crc_table{ [] {
+			std::array<uint32_t, 256> table{};
+			for (uint32_t n{ 0 }; n < 256; ++n)
+			{
+				uint32_t c{ n };
+				for (uint32_t k{ 0 }; k < 8; ++k)
+					c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+				table[n] = c;
+			}
+			return table;
+		}() };
+
+		uint32_t update_crc(uint32_t crc, const uint8_t* data, size_t size)
+		{
+			for (size_t i{ 0 }; i < size; ++i)
+				crc = crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+			return crc;
+		}
+
+		// adler32 defers the modulo, 5552 is the largest run that can't overflow 32 bits
+		void update_adler(uint32_t& a, uint32_t& b, const uint8_t* data, size_t size)
+		{
+			while (size)
+			{
+				const size_t run{ std::min<size_t>(size, 5552) };
+				for (size_t i{ 0 }; i < run; ++i)
+				{
+					a += data[i];
+					b += a;
+				}
+				a %= 65521;
+				b %= 65521;
+				data += run;
+				size -= run;
+			}
+		}
+
+		void put_u32_be(std::vector<uint8_t>& out, uint32_t value)
+		{
+			out.push_back((uint8_t)(value >> 24));
+			out.push_back((uint8_t)(value >> 16));
+			out.push_back((uint8_t)(value >> 8));
+			out.push_back((uint8_t)value);
+		}
+
+		// writes the length placeholder, the caller appends the chunk data and calls end_chunk
+		size_t begin_chunk(std::vector<uint8_t>& out, const char* type)
+		{
+			const size_t start{ out.size() };
+			put_u32_be(out, 0);
+			out.insert(out.end(), type, type + 4);
+			return start;
+		}
+
+		void end_chunk(std::vector<uint8_t>& out, size_t start)
+		{
+			const uint32_t length{ (uint32_t)(out.size() - start - 8) };
+			out[start + 0] = (uint8_t)(length >> 24);
+			out[start + 1] = (uint8_t)(length >> 16);
+			out[start + 2] = (uint8_t)(length >> 8);
+			out[start + 3] = (uint8_t)length;
+
+			// the crc covers the type and the data, not the length
+			const uint32_t crc{ update_crc(0xffffffffu, out.data() + start + 4, out.size() - start - 4) ^ 0xffffffffu };
+			put_u32_be(out, crc);
+		}
+
+	} // anonymous namespace
+
+	std::vector<uint8_t> encode(uint32_t width, uint32_t height, uint32_t channels, const uint8_t* pixels, size_t row_pitch)
+	{
+		assert(width && height && pixels);
+		assert(channels >= 1 && channels <= 4);
+		constexpr uint8_t color_types[]{ 0, 0, 4, 2, 6 };
+
+		const size_t row_bytes{ (size_t)width * channels };
+		row_pitch = row_pitch ? row_pitch : row_bytes;
+		// each row is prefixed with its filter type, 0 = none
+		const size_t raw_size{ (row_bytes + 1) * height };
+		const size_t block_count{ (raw_size + max_stored_block - 1) / max_stored_block };
+
+		std::vector<uint8_t> out{};
+		out.reserve(sizeof(signature) + 25 + 12 + 6 + raw_size + block_count * 5 + 12);
+		out.insert(out.end(), std::begin(signature), std::end(signature));
+
+		size_t chunk{ begin_chunk(out, "IHDR") };
+		put_u32_be(out, width);
+		put_u32_be(out, height);
+		out.push_back(8);						// bit depth
+		out.push_back(color_types[channels]);
+		out.push_back(0);						// deflate
+		out.push_back(0);						// adaptive filtering
+		out.push_back(0);						// no interlace
+		end_chunk(out, chunk);
+
+		chunk = begin_chunk(out, "IDAT");
+		out.push_back(0x78);					// zlib header, 32k window, no dictionary, fastest
+		out.push_back(0x01);
+
+		uint32_t adler_a{ 1 };
+		uint32_t adler_b{ 0 };
+		size_t remaining{ raw_size };
+		uint32_t row{ 0 };
+		size_t row_offset{ 0 };					// 0 is the filter byte, 1.. are pixel bytes
+
+		while (remaining)
+		{
+			const size_t block_size{ std::min(remaining, max_stored_block) };
+			remaining -= block_size;
+			out.push_back(remaining ? 0 : 1);	// bfinal, btype 00 stored
+			out.push_back((uint8_t)block_size);
+			out.push_back((uint8_t)(block_size >> 8));
+			out.push_back((uint8_t)~block_size);
+			out.push_back((uint8_t)(~block_size >> 8));
+
+			// blocks don't line up with rows, copy the largest contiguous runs
+			size_t left{ block_size };
+			while (left)
+			{
+				if (!row_offset)
+				{
+					out.push_back(0);
+					update_adler(adler_a, adler_b, &out.back(), 1);
+					row_offset = 1;
+					--left;
+					continue;
+				}
+
+				const size_t run{ std::min(left, row_bytes + 1 - row_offset) };
+				const uint8_t* source{ pixels + (size_t)row * row_pitch + row_offset - 1 };
+				out.insert(out.end(), source, source + run);
+				update_adler(adler_a, adler_b, source, run);
+				left -= run;
+				row_offset += run;
+				if (row_offset == row_bytes + 1)
+				{
+					row_offset = 0;
+					++row;
+				}
+			}
+		}
+
+		put_u32_be(out, (adler_b << 16) | adler_a);
+		end_chunk(out, chunk);
+
+		chunk = begin_chunk(out, "IEND");
+		end_chunk(out, chunk);
+		return out;
+	}
+
+	bool write(const std::string& path, uint32_t width, uint32_t height, uint32_t channels, const uint8_t* pixels, size_t row_pitch)
+	{
+		const std::vector<uint8_t> data{ encode(width, height, channels, pixels, row_pitch) };
+
+		std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+		if (!file)
+		{
+			std::cout << "failed to create " << path << "!\n";
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		return file.good();
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace renderer::png
+{
+	// 8 bit gray (1), gray alpha (2), rgb (3) or rgba (4) channels. rows are row_pitch bytes apart, 0 means tightly packed.
+	// the image data goes into stored (uncompressed) deflate blocks: no compression, but encoding runs at memcpy speed
+	// so frames can be exported at full rate, the files are meant to be recompressed offline
+	std::vector<uint8_t> encode(uint32_t width, uint32_t height, uint32_t channels, const uint8_t* pixels, size_t row_pitch = 0);
+	bool write(const std::string& path, uint32_t width, uint32_t height, uint32_t channels, const uint8_t* pixels, size_t row_pitch = 0);
+}
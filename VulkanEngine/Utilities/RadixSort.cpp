@@ -0,0 +1,109 @@
+#include "RadixSort.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace renderer::sorting
+{
+	namespace
+	{
+		constexpr uint32_t radix_bits{ 8 };
+		constexpr uint32_t bucket_count{ 1 << radix_bits };
+		constexpr uint32_t pass_count{ 64 / radix_bits };
+		// below this every block would be too small to pay for the job overhead
+		constexpr uint32_t min_block_size{ 16 * 1024 };
+
+		using histogram = std::array<uint32_t, bucket_count>;
+
+	} // anonymous namespace
+
+	void radix_sort(uint64_t* keys, uint32_t* values, uint32_t count, uint64_t* scratch_keys, uint32_t* scratch_values)
+	{
+		if (count < 2)
+			return;
+
+		// bits that differ between keys, passes over constant bytes can be skipped
+		uint64_t all_set{ ~0ull };
+		uint64_t any_set{ 0 };
+		for (uint32_t i{ 0 }; i < count; ++i)
+		{
+			all_set &= keys[i];
+			any_set |= keys[i];
+		}
+		const uint64_t varying_bits{ all_set ^ any_set };
+
+		const uint32_t block_count{ std::clamp(count / min_block_size, 1u, jobs::get_worker_count() + 1) };
+		const uint32_t block_size{ (count + block_count - 1) / block_count };
+		std::vector<histogram> offsets(block_count);
+
+		uint64_t* source_keys{ keys };
+		uint32_t* source_values{ values };
+		uint64_t* destination_keys{ scratch_keys };
+		uint32_t* destination_values{ scratch_values };
+
+		for (uint32_t pass{ 0 }; pass < pass_count; ++pass)
+		{
+			const uint32_t shift{ pass * radix_bits };
+			if (((varying_bits >> shift) & (bucket_count - 1)) == 0)
+				continue;
+
+			auto count_block = [&](uint32_t block) {
+				histogram& h{ offsets[block] };
+				h.fill(0);
+				const uint32_t end{ std::min(count, (block + 1) * block_size) };
+				for (uint32_t i{ block * block_size }; i < end; ++i)
+					++h[(source_keys[i] >> shift) & (bucket_count - 1)];
+			};
+
+			// block b writes its bucket d elements after every lower bucket and after bucket d of blocks before it, which keeps the sort stable
+			auto prefix_sum = [&]() {
+				uint32_t running{ 0 };
+				for (uint32_t digit{ 0 }; digit < bucket_count; ++digit)
+				{
+					for (uint32_t block{ 0 }; block < block_count; ++block)
+					{
+						const uint32_t digit_count{ offsets[block][digit] };
+						offsets[block][digit] = running;
+						running += digit_count;
+					}
+				}
+			};
+
+			auto scatter_block = [&](uint32_t block) {
+				histogram& h{ offsets[block] };
+				const uint32_t end{ std::min(count, (block + 1) * block_size) };
+				for (uint32_t i{ block * block_size }; i < end; ++i)
+				{
+					const uint32_t destination{ h[(source_keys[i] >> shift) & (bucket_count - 1)]++ };
+					destination_keys[destination] = source_keys[i];
+					destination_values[destination] = source_values[i];
+				}
+			};
+
+			if (block_count == 1)
+			{
+				count_block(0);
+				prefix_sum();
+				scatter_block(0);
+			}
+			else
+			{
+				jobs::parallel_for(block_count, count_block);
+				prefix_sum();
+				jobs::parallel_for(block_count, scatter_block);
+			}
+
+			std::swap(source_keys, destination_keys);
+			std::swap(source_values, destination_values);
+		}
+
+		if (source_keys != keys)
+		{
+			memcpy(keys, source_keys, count * sizeof(uint64_t));
+			memcpy(values, source_values, count * sizeof(uint32_t));
+		}
+	}
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+
+namespace renderer::sorting
+{
+	// stable lsd radix sort of 64 bit keys carrying a 32 bit payload, bytes that are equal across all keys are skipped.
+	// large inputs are histogrammed and scattered in parallel on the job system.
+	// scratch arrays must hold count elements, the sorted result always ends up in keys/values.
+	void radix_sort(uint64_t* keys, uint32_t* values, uint32_t count, uint64_t* scratch_keys, uint32_t* scratch_values);
+}
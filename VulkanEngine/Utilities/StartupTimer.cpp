@@ -0,0 +1,110 @@
+#include "StartupTimer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace renderer::startup
+{
+	namespace
+	{
+		using clock = std::chrono::steady_clock;
+
+		clock::time_point								origin{ clock::now() };
+		std::vector<phase>								phases{};
+		std::unordered_map<std::thread::id, uint32_t>	thread_indices{ { std::this_thread::get_id(), 0 } };
+		std::mutex										mutex{};
+		std::atomic<bool>								first_frame_marked{ false };
+		std::atomic<double>								first_frame_ms{ -1.0 };
+
+		double now_ms()
+		{
+			return std::chrono::duration<double, std::milli>(clock::now() - origin).count();
+		}
+
+		// expects mutex to be held
+		uint32_t get_thread_index()
+		{
+			const auto [it, inserted] = thread_indices.try_emplace(std::this_thread::get_id(), (uint32_t)thread_indices.size());
+			return it->second;
+		}
+
+	} // anonymous namespace
+
+	void reset()
+	{
+		std::lock_guard lock{ mutex };
+		origin = clock::now();
+		phases.clear();
+		thread_indices.clear();
+		thread_indices.emplace(std::this_thread::get_id(), 0);
+		first_frame_marked = false;
+		first_frame_ms = -1.0;
+	}
+
+	scoped_phase::scoped_phase(const char* name)
+		: _name{ name }, _start_ms{ now_ms() }
+	{
+	}
+
+	scoped_phase::~scoped_phase()
+	{
+		end();
+	}
+
+	void scoped_phase::next(const char* name)
+	{
+		end();
+		_name = name;
+		_start_ms = now_ms();
+	}
+
+	void scoped_phase::end()
+	{
+		const double end_ms{ now_ms() };
+		std::lock_guard lock{ mutex };
+		phases.push_back({ _name, get_thread_index(), _start_ms, end_ms - _start_ms });
+	}
+
+	bool mark_first_frame()
+	{
+		if (first_frame_marked.exchange(true))
+			return false;
+
+		first_frame_ms = now_ms();
+		return true;
+	}
+
+	double get_time_to_first_frame_ms()
+	{
+		return first_frame_ms;
+	}
+
+	std::vector<phase> get_phases()
+	{
+		std::lock_guard lock{ mutex };
+		std::vector<phase> result{ phases };
+		std::sort(result.begin(), result.end(), [](const phase& a, const phase& b) { return a.start_ms < b.start_ms; });
+		return result;
+	}
+
+	void print_report()
+	{
+		const std::vector<phase> sorted{ get_phases() };
+
+		std::cout << "startup phases:\n" << std::fixed << std::setprecision(2);
+		for (const phase& p : sorted)
+			std::cout << '\t' << std::setw(32) << std::left << p.name << std::right
+					  << " thread " << p.thread_index
+					  << std::setw(10) << p.start_ms << " ms +" << std::setw(9) << p.duration_ms << " ms\n";
+
+		if (first_frame_ms >= 0.0)
+			std::cout << "\ttime to first frame: " << first_frame_ms.load() << " ms\n";
+		std::cout << std::defaultfloat;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace renderer::startup
+{
+	struct phase
+	{
+		std::string		name;
+		uint32_t		thread_index{ 0 };	// 0 is the thread that started timing, stages run on the job system get their own index
+		double			start_ms{ 0.0 };	// since reset()
+		double			duration_ms{ 0.0 };
+	};
+
+	// restarts the clock and clears recorded phases. the clock otherwise starts when the program is loaded
+	void reset();
+
+	// thread safe, phases may overlap when independent stages run concurrently
+	class scoped_phase
+	{
+	public:
+		explicit scoped_phase(const char* name);
+		~scoped_phase();
+
+		// ends the current phase and starts the next one, for a serial sequence of stages in one scope
+		void next(const char* name);
+
+		scoped_phase(const scoped_phase&) = delete;
+		scoped_phase& operator=(const scoped_phase&) = delete;
+
+	private:
+		void end();
+
+		const char*		_name;
+		double			_start_ms;
+	};
+
+	// only the first call counts and returns true, called by core::end_frame
+	bool mark_first_frame();
+	// negative until the first frame has been submitted
+	double get_time_to_first_frame_ms();
+
+	std::vector<phase> get_phases();
+	void print_report();
+}